@@ -0,0 +1,194 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	pcm-fp32.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Single precision PCM signals
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "pcm.h"
+#include "vector.h"
+
+/* The signals are generated in blocks on the stack and added to the
+   existing samples */
+#define PCM_FP32_BLK 256
+
+struct pcm_fp32 *pcm_fp32_create(unsigned int len, float samplerate)
+{
+	struct pcm_fp32 *pcm;
+	size_t size;
+
+	if ((len == 0) || (samplerate <= 0)) {
+		fprintf(stderr, "%s: invalid length or rate.\n", __func__);
+		return NULL;
+	};
+
+	/* aligned_alloc() takes a multiple of the alignment */
+	size = sizeof(struct pcm_fp32) + (size_t)len * sizeof(float);
+	size = (size + PCM_ALIGN - 1) & ~(size_t)(PCM_ALIGN - 1);
+
+	if ((pcm = aligned_alloc(PCM_ALIGN, size)) == NULL) {
+		fprintf(stderr, "%s: aligned_alloc() failed: %s\n", __func__,
+				strerror(errno));
+		return NULL;
+	};
+
+	memset(pcm, 0, size);
+	pcm->len = len;
+	pcm->samplerate = samplerate;
+
+	return pcm;
+}
+
+int pcm_fp32_destroy(struct pcm_fp32 *pcm)
+{
+	if (pcm == NULL) {
+		fprintf(stderr, "%s: NULL pointer.", __func__);
+		return -1;
+	};
+
+	free(pcm);
+
+	return 0;
+}
+
+/* The samples as raw floats, or a WAV file for a .wav name */
+int pcm_fp32_dump(const char *fname, struct pcm_fp32 *pcm)
+{
+	return pcm_fp32_save(fname, pcm, PCM_F32);
+}
+
+int pcm_fp32_plot(const char *name, struct pcm_fp32 *pcm,
+				  const char *lstyle, bool png)
+{
+	struct pcm_plot_env env;
+	char dat_path[PATH_MAX];
+	FILE *f;
+	int ret;
+
+	if (pcm_plot_script(name, pcm->samplerate, pcm->len, lstyle, png) < 0)
+		return -1;
+
+	sprintf(dat_path, "%s.dat", name);
+	if ((f = fopen(dat_path, "wb")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!",
+			dat_path, strerror(errno));
+		return -1;
+	}
+
+	pcm_plot_env_init(&env, f, pcm->len);
+	ret = pcm_plot_env_write(&env, pcm->sample, pcm->len);
+	fclose(f);
+
+	return ret;
+}
+
+enum pcm_fp32_gen {
+	PCM_FP32_SIN,
+	PCM_FP32_SWEEP,
+	PCM_FP32_LOGSWEEP,
+	PCM_FP32_NOISE
+};
+
+/* f0 and f1 are the start and stop frequencies (Hz), the seed is of
+   the noise */
+static int __pcm_fp32_gen(struct pcm_fp32 *pcm, enum pcm_fp32_gen gen,
+						  float f0, float f1, float a, uint64_t seed)
+{
+	float y[PCM_FP32_BLK] __attribute__((aligned(PCM_ALIGN)));
+	float w0;
+	float w1;
+	size_t len;
+	size_t i0;
+
+	if (pcm == NULL) {
+		fprintf(stderr, "%s: NULL pointer.", __func__);
+		return -1;
+	};
+
+	/* Normalized start and stop frequencies (cycles per sample) */
+	w0 = f0 / pcm->samplerate;
+	w1 = f1 / pcm->samplerate;
+	len = pcm->len;
+
+	for (i0 = 0; i0 < len; i0 += PCM_FP32_BLK) {
+		size_t n = len - i0;
+		size_t i;
+
+		if (n > PCM_FP32_BLK)
+			n = PCM_FP32_BLK;
+
+		switch (gen) {
+		case PCM_FP32_SIN:
+			vec_fp32_chirp(y, n, w0, w0, len, i0);
+			break;
+		case PCM_FP32_SWEEP:
+			vec_fp32_chirp(y, n, w0, w1, len, i0);
+			break;
+		case PCM_FP32_LOGSWEEP:
+			vec_fp32_logchirp(y, n, w0, w1, len, i0);
+			break;
+		case PCM_FP32_NOISE:
+			vec_fp32_noise(y, n, seed, i0);
+			break;
+		}
+
+		/* add to the existing data in the buffer */
+		for (i = 0; i < n; ++i)
+			pcm->sample[i0 + i] += a * y[i];
+	}
+
+	return 0;
+}
+
+int pcm_fp32_sin(struct pcm_fp32 *pcm, float freq, float a)
+{
+	return __pcm_fp32_gen(pcm, PCM_FP32_SIN, freq, freq, a, 0);
+}
+
+int pcm_fp32_sweep(struct pcm_fp32 *pcm, float f0, float f1, float a)
+{
+	return __pcm_fp32_gen(pcm, PCM_FP32_SWEEP, f0, f1, a, 0);
+}
+
+int pcm_fp32_logsweep(struct pcm_fp32 *pcm, float f0, float f1, float a)
+{
+	if ((f0 <= 0) || (f1 <= 0)) {
+		fprintf(stderr, "%s: invalid frequency.", __func__);
+		return -1;
+	};
+
+	return __pcm_fp32_gen(pcm, PCM_FP32_LOGSWEEP, f0, f1, a, 0);
+}
+
+int pcm_fp32_white_noise(struct pcm_fp32 *pcm, float level, uint64_t seed)
+{
+	return __pcm_fp32_gen(pcm, PCM_FP32_NOISE, 0, 0, level, seed);
+}
@@ -0,0 +1,219 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	pcm-fp64.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Double precision PCM signals
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "pcm.h"
+#include "vector.h"
+
+/* The signals are generated in blocks on the stack and added to the
+   existing samples */
+#define PCM_FP64_BLK 256
+
+struct pcm_fp64 *pcm_fp64_create(unsigned int len, double samplerate)
+{
+	struct pcm_fp64 *pcm;
+	size_t size;
+
+	if ((len == 0) || (samplerate <= 0)) {
+		fprintf(stderr, "%s: invalid length or rate.\n", __func__);
+		return NULL;
+	};
+
+	/* aligned_alloc() takes a multiple of the alignment */
+	size = sizeof(struct pcm_fp64) + (size_t)len * sizeof(double);
+	size = (size + PCM_ALIGN - 1) & ~(size_t)(PCM_ALIGN - 1);
+
+	if ((pcm = aligned_alloc(PCM_ALIGN, size)) == NULL) {
+		fprintf(stderr, "%s: aligned_alloc() failed: %s\n", __func__,
+				strerror(errno));
+		return NULL;
+	};
+
+	memset(pcm, 0, size);
+	pcm->hdr.len = len;
+	pcm->hdr.samplerate = samplerate;
+
+	return pcm;
+}
+
+int pcm_fp64_destroy(struct pcm_fp64 *pcm)
+{
+	if (pcm == NULL) {
+		fprintf(stderr, "%s: NULL pointer.", __func__);
+		return -1;
+	};
+
+	free(pcm);
+
+	return 0;
+}
+
+/* The samples as raw doubles, or a WAV file for a .wav name */
+int pcm_fp64_dump(const char *fname, struct pcm_fp64 *pcm)
+{
+	return pcm_fp64_save(fname, pcm, PCM_F64);
+}
+
+int pcm_fp64_plot(const char *name, struct pcm_fp64 *pcm,
+				  const char *lstyle, bool png)
+{
+	float y[PCM_FP64_BLK];
+	struct pcm_plot_env env;
+	char dat_path[PATH_MAX];
+	size_t len = pcm->hdr.len;
+	size_t i0;
+	FILE *f;
+	int ret = 0;
+
+	if (pcm_plot_script(name, pcm->hdr.samplerate, len, lstyle, png) < 0)
+		return -1;
+
+	sprintf(dat_path, "%s.dat", name);
+	if ((f = fopen(dat_path, "wb")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!",
+			dat_path, strerror(errno));
+		return -1;
+	}
+
+	pcm_plot_env_init(&env, f, len);
+	for (i0 = 0; (i0 < len) && (ret == 0); i0 += PCM_FP64_BLK) {
+		size_t n = (len - i0 < PCM_FP64_BLK) ? len - i0 : PCM_FP64_BLK;
+
+		vec_fp64_to_fp32(y, &pcm->sample[i0], n);
+		ret = pcm_plot_env_write(&env, y, n);
+	}
+	fclose(f);
+
+	return ret;
+}
+
+enum pcm_fp64_gen {
+	PCM_FP64_SIN,
+	PCM_FP64_SWEEP,
+	PCM_FP64_LOGSWEEP,
+	PCM_FP64_NOISE
+};
+
+/* f0 and f1 are the start and stop frequencies (Hz), the seed is of
+   the noise */
+static int __pcm_fp64_gen(struct pcm_fp64 *pcm, enum pcm_fp64_gen gen,
+						  double f0, double f1, double a, uint64_t seed)
+{
+	double y[PCM_FP64_BLK] __attribute__((aligned(PCM_ALIGN)));
+	double w0;
+	double w1;
+	size_t len;
+	size_t i0;
+
+	if (pcm == NULL) {
+		fprintf(stderr, "%s: NULL pointer.", __func__);
+		return -1;
+	};
+
+	/* Normalized start and stop frequencies (cycles per sample) */
+	w0 = f0 / pcm->hdr.samplerate;
+	w1 = f1 / pcm->hdr.samplerate;
+	len = pcm->hdr.len;
+
+	for (i0 = 0; i0 < len; i0 += PCM_FP64_BLK) {
+		size_t n = len - i0;
+		size_t i;
+
+		if (n > PCM_FP64_BLK)
+			n = PCM_FP64_BLK;
+
+		switch (gen) {
+		case PCM_FP64_SIN:
+			vec_fp64_chirp(y, n, w0, w0, len, i0);
+			break;
+		case PCM_FP64_SWEEP:
+			vec_fp64_chirp(y, n, w0, w1, len, i0);
+			break;
+		case PCM_FP64_LOGSWEEP:
+			vec_fp64_logchirp(y, n, w0, w1, len, i0);
+			break;
+		case PCM_FP64_NOISE:
+			vec_fp64_noise(y, n, seed, i0);
+			break;
+		}
+
+		/* add to the existing data in the buffer */
+		for (i = 0; i < n; ++i)
+			pcm->sample[i0 + i] += a * y[i];
+	}
+
+	return 0;
+}
+
+int pcm_fp64_sin(struct pcm_fp64 *pcm, double freq, double a)
+{
+	return __pcm_fp64_gen(pcm, PCM_FP64_SIN, freq, freq, a, 0);
+}
+
+int pcm_fp64_sweep(struct pcm_fp64 *pcm, double f0, double f1, double a)
+{
+	return __pcm_fp64_gen(pcm, PCM_FP64_SWEEP, f0, f1, a, 0);
+}
+
+int pcm_fp64_logsweep(struct pcm_fp64 *pcm, double f0, double f1, double a)
+{
+	if ((f0 <= 0) || (f1 <= 0)) {
+		fprintf(stderr, "%s: invalid frequency.", __func__);
+		return -1;
+	};
+
+	return __pcm_fp64_gen(pcm, PCM_FP64_LOGSWEEP, f0, f1, a, 0);
+}
+
+int pcm_fp64_white_noise(struct pcm_fp64 *pcm, double level, uint64_t seed)
+{
+	return __pcm_fp64_gen(pcm, PCM_FP64_NOISE, 0, 0, level, seed);
+}
+
+/* Plain vector calls, frequencies in cycles per sample */
+
+ssize_t pcm_fp64_cosine(double y[], size_t size, double w0)
+{
+	return vec_fp64_cosine(y, size, w0);
+}
+
+ssize_t pcm_fp64_wnd_blackman(double y[], size_t npts, double alpha)
+{
+	return vec_fp64_wnd_blackman(y, npts, alpha);
+}
+
+complex double pcm_fp64_gortzel_dft(const double x[], size_t len, double w)
+{
+	return vec_fp64_gortzel_dft(x, len, w);
+}
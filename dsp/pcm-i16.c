@@ -0,0 +1,245 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	pcm-i16.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: 16 bits PCM signals
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <ctype.h>
+
+#include "pcm.h"
+#include "vector.h"
+
+/* The signals are generated in blocks on the stack, in single
+   precision, and added to the existing samples */
+#define PCM_I16_BLK 256
+
+struct pcm_i16 *pcm_i16_create(unsigned int len, unsigned int samplerate)
+{
+	struct pcm_i16 *pcm;
+	size_t size;
+
+	if ((len == 0) || (samplerate == 0)) {
+		fprintf(stderr, "%s: invalid length or rate.\n", __func__);
+		return NULL;
+	};
+
+	/* aligned_alloc() takes a multiple of the alignment */
+	size = sizeof(struct pcm_i16) + (size_t)len * sizeof(int16_t);
+	size = (size + PCM_ALIGN - 1) & ~(size_t)(PCM_ALIGN - 1);
+
+	if ((pcm = aligned_alloc(PCM_ALIGN, size)) == NULL) {
+		fprintf(stderr, "%s: aligned_alloc() failed: %s\n", __func__,
+				strerror(errno));
+		return NULL;
+	};
+
+	memset(pcm, 0, size);
+	pcm->len = len;
+	pcm->samplerate = samplerate;
+
+	return pcm;
+}
+
+int pcm_i16_destroy(struct pcm_i16 *pcm)
+{
+	if (pcm == NULL) {
+		fprintf(stderr, "%s: NULL pointer.", __func__);
+		return -1;
+	};
+
+	free(pcm);
+
+	return 0;
+}
+
+/* The samples as raw 16 bits, or a WAV file for a .wav name */
+int pcm_i16_dump(const char *fname, struct pcm_i16 *pcm)
+{
+	return pcm_i16_save(fname, pcm, PCM_S16);
+}
+
+int pcm_i16_plot(const char *name, struct pcm_i16 *pcm)
+{
+	float y[PCM_I16_BLK];
+	struct pcm_plot_env env;
+	char dat_path[PATH_MAX];
+	size_t len = pcm->len;
+	size_t i0;
+	FILE *f;
+	int ret = 0;
+
+	if (pcm_plot_script(name, pcm->samplerate, len, NULL, false) < 0)
+		return -1;
+
+	sprintf(dat_path, "%s.dat", name);
+	if ((f = fopen(dat_path, "wb")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!",
+			dat_path, strerror(errno));
+		return -1;
+	}
+
+	pcm_plot_env_init(&env, f, len);
+	for (i0 = 0; (i0 < len) && (ret == 0); i0 += PCM_I16_BLK) {
+		size_t n = (len - i0 < PCM_I16_BLK) ? len - i0 : PCM_I16_BLK;
+
+		vec_fp32_from_i16(y, &pcm->sample[i0], n);
+		ret = pcm_plot_env_write(&env, y, n);
+	}
+	fclose(f);
+
+	return ret;
+}
+
+/* The array is named after the file, without the directory and the
+   extension */
+int pcm_i16_c_dump(const char *fname, struct pcm_i16 *pcm)
+{
+	char sym[PATH_MAX];
+	const char *cp;
+	unsigned int i;
+	FILE *f;
+	int ret = 0;
+
+	cp = strrchr(fname, '/');
+	strcpy(sym, (cp == NULL) ? fname : cp + 1);
+	for (i = 0; (sym[i] != '\0') && (sym[i] != '.'); ++i) {
+		if (!isalnum((unsigned char)sym[i]))
+			sym[i] = '_';
+	}
+	sym[i] = '\0';
+
+	if ((f = fopen(fname, "w")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!",
+			fname, strerror(errno));
+		return -1;
+	}
+
+	fprintf(f, "/* %u samples, %u Hz */\n", pcm->len, pcm->samplerate);
+	fprintf(f, "const int16_t %s[%u] = {", sym, pcm->len);
+	for (i = 0; i < pcm->len; ++i) {
+		if ((i % 8) == 0)
+			fprintf(f, "\n\t");
+		fprintf(f, "%6d%s", pcm->sample[i],
+				(i + 1 < pcm->len) ? ((i % 8) == 7 ? "," : ", ") : "");
+	}
+	if (fprintf(f, "\n};\n") < 0)
+		ret = -1;
+	if (fclose(f) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+enum pcm_i16_gen {
+	PCM_I16_SIN,
+	PCM_I16_SWEEP,
+	PCM_I16_LOGSWEEP,
+	PCM_I16_NOISE
+};
+
+/* f0 and f1 are the start and stop frequencies (Hz), the seed is of
+   the noise */
+static int __pcm_i16_gen(struct pcm_i16 *pcm, enum pcm_i16_gen gen,
+						 float f0, float f1, float a, uint64_t seed)
+{
+	float x[PCM_I16_BLK] __attribute__((aligned(PCM_ALIGN)));
+	float y[PCM_I16_BLK] __attribute__((aligned(PCM_ALIGN)));
+	float w0;
+	float w1;
+	size_t len;
+	size_t i0;
+
+	if (pcm == NULL) {
+		fprintf(stderr, "%s: NULL pointer.", __func__);
+		return -1;
+	};
+
+	/* Normalized start and stop frequencies (cycles per sample) */
+	w0 = f0 / pcm->samplerate;
+	w1 = f1 / pcm->samplerate;
+	len = pcm->len;
+
+	for (i0 = 0; i0 < len; i0 += PCM_I16_BLK) {
+		size_t n = len - i0;
+		size_t i;
+
+		if (n > PCM_I16_BLK)
+			n = PCM_I16_BLK;
+
+		switch (gen) {
+		case PCM_I16_SIN:
+			vec_fp32_chirp(y, n, w0, w0, len, i0);
+			break;
+		case PCM_I16_SWEEP:
+			vec_fp32_chirp(y, n, w0, w1, len, i0);
+			break;
+		case PCM_I16_LOGSWEEP:
+			vec_fp32_logchirp(y, n, w0, w1, len, i0);
+			break;
+		case PCM_I16_NOISE:
+			vec_fp32_noise(y, n, seed, i0);
+			break;
+		}
+
+		/* add to the existing data in the buffer, saturated */
+		vec_fp32_from_i16(x, &pcm->sample[i0], n);
+		for (i = 0; i < n; ++i)
+			x[i] += a * y[i];
+		vec_fp32_to_i16(&pcm->sample[i0], x, n);
+	}
+
+	return 0;
+}
+
+int pcm_i16_sin(struct pcm_i16 *pcm, float freq, float amp)
+{
+	return __pcm_i16_gen(pcm, PCM_I16_SIN, freq, freq, amp, 0);
+}
+
+int pcm_i16_sweep(struct pcm_i16 *pcm, float f0, float f1, float amp)
+{
+	return __pcm_i16_gen(pcm, PCM_I16_SWEEP, f0, f1, amp, 0);
+}
+
+int pcm_i16_logsweep(struct pcm_i16 *pcm, float f0, float f1, float amp)
+{
+	if ((f0 <= 0) || (f1 <= 0)) {
+		fprintf(stderr, "%s: invalid frequency.", __func__);
+		return -1;
+	};
+
+	return __pcm_i16_gen(pcm, PCM_I16_LOGSWEEP, f0, f1, amp, 0);
+}
+
+int pcm_i16_white_noise(struct pcm_i16 *pcm, float level, uint64_t seed)
+{
+	return __pcm_i16_gen(pcm, PCM_I16_NOISE, 0, 0, level, seed);
+}
@@ -0,0 +1,757 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	pcm-io.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: WAV and raw PCM files
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The files are read through a read only mapping: pcm_file_data() is
+ * the interleaved samples as they are in the file, the pcm_file_read_*()
+ * calls convert them. The writes are converted into a large buffer that
+ * goes to the file in one write(2). The WAV header is written again with
+ * the sizes on close. The samples are little endian, as the host.
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pcm.h"
+#include "vector.h"
+
+/* Write buffer */
+#define PCM_FILE_BUF (1 << 20)
+/* Samples converted through the stack */
+#define PCM_FILE_CHUNK 1024
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xfffe
+#define WAV_HDR_LEN 44
+
+struct pcm_file {
+	struct pcm_file_info info;
+	int fd;
+	bool wav;
+	bool write;
+	unsigned int size; /* bytes per sample */
+	/* read */
+	const uint8_t * map;
+	size_t map_len;
+	const uint8_t * data;
+	uint64_t pos; /* frame */
+	/* write */
+	uint8_t * buf;
+	size_t cnt;
+	uint64_t bytes;
+};
+
+static const unsigned int pcm_fmt_size[] = {
+	[PCM_S16] = 2,
+	[PCM_S24] = 3,
+	[PCM_S32] = 4,
+	[PCM_F32] = 4,
+	[PCM_F64] = 8
+};
+
+static inline unsigned int __le16(const uint8_t * p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t __le32(const uint8_t * p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void __put_le16(uint8_t * p, unsigned int v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static inline void __put_le32(uint8_t * p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/* Decode n samples */
+static void __dec_fp64(double y[], const uint8_t * p, enum pcm_fmt fmt,
+					   size_t n)
+{
+	size_t i;
+
+	switch (fmt) {
+	case PCM_S16:
+		for (i = 0; i < n; ++i) {
+			int16_t v;
+
+			memcpy(&v, p + 2 * i, 2);
+			y[i] = v * (1.0 / 32768);
+		}
+		break;
+	case PCM_S24:
+		for (i = 0; i < n; ++i) {
+			int32_t v = (int32_t)(((uint32_t)p[3 * i] << 8) |
+								  ((uint32_t)p[3 * i + 1] << 16) |
+								  ((uint32_t)p[3 * i + 2] << 24)) >> 8;
+
+			y[i] = v * (1.0 / 8388608);
+		}
+		break;
+	case PCM_S32:
+		for (i = 0; i < n; ++i) {
+			int32_t v;
+
+			memcpy(&v, p + 4 * i, 4);
+			y[i] = v * (1.0 / 2147483648.0);
+		}
+		break;
+	case PCM_F32:
+		for (i = 0; i < n; ++i) {
+			float v;
+
+			memcpy(&v, p + 4 * i, 4);
+			y[i] = v;
+		}
+		break;
+	case PCM_F64:
+		memcpy(y, p, n * sizeof(double));
+		break;
+	}
+}
+
+/* Round and saturate to a signed integer of the full scale s */
+static inline int32_t __sat(double v, double s)
+{
+	v *= s;
+	if (v > s - 1)
+		return s - 1;
+	if (v < -s)
+		return -s;
+
+	return lrint(v);
+}
+
+/* Encode n samples */
+static void __enc_fp64(uint8_t * p, const double x[], enum pcm_fmt fmt,
+					   size_t n)
+{
+	size_t i;
+
+	switch (fmt) {
+	case PCM_S16:
+		for (i = 0; i < n; ++i) {
+			int16_t v = __sat(x[i], 32768);
+
+			memcpy(p + 2 * i, &v, 2);
+		}
+		break;
+	case PCM_S24:
+		for (i = 0; i < n; ++i) {
+			int32_t v = __sat(x[i], 8388608);
+
+			p[3 * i] = v;
+			p[3 * i + 1] = v >> 8;
+			p[3 * i + 2] = v >> 16;
+		}
+		break;
+	case PCM_S32:
+		for (i = 0; i < n; ++i) {
+			int32_t v = __sat(x[i], 2147483648.0);
+
+			memcpy(p + 4 * i, &v, 4);
+		}
+		break;
+	case PCM_F32:
+		for (i = 0; i < n; ++i) {
+			float v = x[i];
+
+			memcpy(p + 4 * i, &v, 4);
+		}
+		break;
+	case PCM_F64:
+		memcpy(p, x, n * sizeof(double));
+		break;
+	}
+}
+
+/* Format of the fmt chunk */
+static int __wav_fmt(const uint8_t * p, uint32_t len,
+					 struct pcm_file_info * info)
+{
+	unsigned int tag;
+	unsigned int bits;
+
+	if (len < 16)
+		return -1;
+
+	tag = __le16(p);
+	info->channels = __le16(p + 2);
+	info->samplerate = __le32(p + 4);
+	bits = __le16(p + 14);
+	if ((tag == WAV_FORMAT_EXTENSIBLE) && (len >= 40))
+		tag = __le16(p + 24);
+
+	if ((tag == WAV_FORMAT_PCM) && (bits == 16))
+		info->fmt = PCM_S16;
+	else if ((tag == WAV_FORMAT_PCM) && (bits == 24))
+		info->fmt = PCM_S24;
+	else if ((tag == WAV_FORMAT_PCM) && (bits == 32))
+		info->fmt = PCM_S32;
+	else if ((tag == WAV_FORMAT_FLOAT) && (bits == 32))
+		info->fmt = PCM_F32;
+	else if ((tag == WAV_FORMAT_FLOAT) && (bits == 64))
+		info->fmt = PCM_F64;
+	else
+		return -1;
+
+	return (info->channels > 0) ? 0 : -1;
+}
+
+/* Walk the RIFF chunks up to the data */
+static int __wav_parse(struct pcm_file * pf)
+{
+	const uint8_t * p = pf->map;
+	size_t len = pf->map_len;
+	size_t off = 12;
+	bool fmt = false;
+
+	if ((len < 12) || (memcmp(p, "RIFF", 4) != 0) ||
+		(memcmp(p + 8, "WAVE", 4) != 0))
+		return -1;
+
+	while (off + 8 <= len) {
+		uint32_t n = __le32(p + off + 4);
+
+		if (memcmp(p + off, "fmt ", 4) == 0) {
+			if ((off + 8 + n > len) ||
+				(__wav_fmt(p + off + 8, n, &pf->info) < 0))
+				return -1;
+			fmt = true;
+		} else if (memcmp(p + off, "data", 4) == 0) {
+			if (!fmt)
+				return -1;
+			pf->data = p + off + 8;
+			/* streamed files leave the size at 0 or ~0 */
+			if ((n == 0) || (n > len - off - 8))
+				n = len - off - 8;
+			pf->size = pcm_fmt_size[pf->info.fmt];
+			pf->info.frames = n / (pf->size * pf->info.channels);
+			return 0;
+		}
+		off += 8 + n + (n & 1);
+	}
+
+	return -1;
+}
+
+static bool __is_wav(const char * path)
+{
+	const char * s = strrchr(path, '.');
+
+	return (s != NULL) && (strcasecmp(s, ".wav") == 0);
+}
+
+struct pcm_file * pcm_file_open(const char * path,
+								const struct pcm_file_info * raw)
+{
+	struct pcm_file * pf;
+	struct stat st;
+	void * map;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		fprintf(stderr, "%s: open(\"%s\") failed: %s\n", __func__,
+				path, strerror(errno));
+		return NULL;
+	}
+
+	if ((fstat(fd, &st) < 0) || (st.st_size == 0)) {
+		fprintf(stderr, "%s: \"%s\" is empty.\n", __func__, path);
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: mmap() failed: %s\n", __func__,
+				strerror(errno));
+		return NULL;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	if ((pf = calloc(1, sizeof(struct pcm_file))) == NULL) {
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	pf->fd = -1;
+	pf->map = map;
+	pf->map_len = st.st_size;
+
+	if (raw != NULL) {
+		pf->info = *raw;
+		pf->data = pf->map;
+		pf->size = pcm_fmt_size[raw->fmt];
+		if (raw->channels > 0)
+			pf->info.frames = pf->map_len / (pf->size * raw->channels);
+	} else if (__wav_parse(pf) < 0) {
+		fprintf(stderr, "%s: \"%s\": invalid or unsupported WAV file.\n",
+				__func__, path);
+		goto error;
+	} else {
+		pf->wav = true;
+	}
+
+	if ((pf->info.channels == 0) || (pf->info.channels > PCM_FILE_CHUNK)) {
+		fprintf(stderr, "%s: invalid channels %u.\n", __func__,
+				pf->info.channels);
+		goto error;
+	}
+
+	return pf;
+
+error:
+	munmap((void *)pf->map, pf->map_len);
+	free(pf);
+
+	return NULL;
+}
+
+const struct pcm_file_info * pcm_file_info(const struct pcm_file * pf)
+{
+	return &pf->info;
+}
+
+const void * pcm_file_data(const struct pcm_file * pf)
+{
+	return pf->data;
+}
+
+ssize_t pcm_file_read_fp64(struct pcm_file * pf, double y[], size_t frames)
+{
+	if (pf->write)
+		return -1;
+
+	if (frames > pf->info.frames - pf->pos)
+		frames = pf->info.frames - pf->pos;
+
+	__dec_fp64(y, pf->data + pf->pos * pf->size * pf->info.channels,
+			   pf->info.fmt, frames * pf->info.channels);
+	pf->pos += frames;
+
+	return frames;
+}
+
+ssize_t pcm_file_read_fp32(struct pcm_file * pf, float y[], size_t frames)
+{
+	double t[PCM_FILE_CHUNK];
+	unsigned int nch = pf->info.channels;
+	size_t step = PCM_FILE_CHUNK / nch;
+	size_t cnt = 0;
+	ssize_t n;
+
+	while ((cnt < frames) && ((n = pcm_file_read_fp64(pf, t,
+				(frames - cnt < step) ? frames - cnt : step)) > 0)) {
+		vec_fp64_to_fp32(&y[cnt * nch], t, n * nch);
+		cnt += n;
+	}
+
+	return cnt;
+}
+
+ssize_t pcm_file_read_i16(struct pcm_file * pf, int16_t y[], size_t frames)
+{
+	double t[PCM_FILE_CHUNK];
+	unsigned int nch = pf->info.channels;
+	size_t step = PCM_FILE_CHUNK / nch;
+	size_t cnt = 0;
+	ssize_t n;
+
+	while ((cnt < frames) && ((n = pcm_file_read_fp64(pf, t,
+				(frames - cnt < step) ? frames - cnt : step)) > 0)) {
+		vec_fp64_to_i16(&y[cnt * nch], t, n * nch);
+		cnt += n;
+	}
+
+	return cnt;
+}
+
+/* Canonical 44 byte header, PCM or IEEE float */
+static void __wav_hdr(uint8_t * p, const struct pcm_file_info * info,
+					  uint64_t bytes)
+{
+	unsigned int size = pcm_fmt_size[info->fmt];
+	unsigned int align = size * info->channels;
+	bool flt = (info->fmt == PCM_F32) || (info->fmt == PCM_F64);
+
+	/* the sizes saturate past 4 GiB, the readers take the data up to
+	   the end of the file */
+	if (bytes > UINT32_MAX - WAV_HDR_LEN)
+		bytes = UINT32_MAX - WAV_HDR_LEN;
+
+	memcpy(p, "RIFF", 4);
+	__put_le32(p + 4, WAV_HDR_LEN - 8 + bytes);
+	memcpy(p + 8, "WAVE", 4);
+	memcpy(p + 12, "fmt ", 4);
+	__put_le32(p + 16, 16);
+	__put_le16(p + 20, flt ? WAV_FORMAT_FLOAT : WAV_FORMAT_PCM);
+	__put_le16(p + 22, info->channels);
+	__put_le32(p + 24, (uint32_t)info->samplerate);
+	__put_le32(p + 28, (uint32_t)info->samplerate * align);
+	__put_le16(p + 32, align);
+	__put_le16(p + 34, size * 8);
+	memcpy(p + 36, "data", 4);
+	__put_le32(p + 40, bytes);
+}
+
+struct pcm_file * pcm_file_create(const char * path,
+								  const struct pcm_file_info * info, bool wav)
+{
+	struct pcm_file * pf;
+
+	if ((info->channels == 0) || (info->channels > PCM_FILE_CHUNK)) {
+		fprintf(stderr, "%s: invalid channels %u.\n", __func__,
+				info->channels);
+		return NULL;
+	}
+
+	if ((pf = calloc(1, sizeof(struct pcm_file))) == NULL)
+		return NULL;
+
+	if ((pf->buf = malloc(PCM_FILE_BUF)) == NULL) {
+		free(pf);
+		return NULL;
+	}
+
+	if ((pf->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		fprintf(stderr, "%s: open(\"%s\") failed: %s\n", __func__,
+				path, strerror(errno));
+		free(pf->buf);
+		free(pf);
+		return NULL;
+	}
+
+	pf->info = *info;
+	pf->info.frames = 0;
+	pf->wav = wav;
+	pf->write = true;
+	pf->size = pcm_fmt_size[info->fmt];
+	if (wav) {
+		__wav_hdr(pf->buf, &pf->info, 0);
+		pf->cnt = WAV_HDR_LEN;
+	}
+
+	return pf;
+}
+
+static int __pcm_file_flush(struct pcm_file * pf)
+{
+	size_t off = 0;
+
+	while (off < pf->cnt) {
+		ssize_t n = write(pf->fd, pf->buf + off, pf->cnt - off);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "%s: write() failed: %s\n", __func__,
+					strerror(errno));
+			return -1;
+		}
+		off += n;
+	}
+	pf->cnt = 0;
+
+	return 0;
+}
+
+ssize_t pcm_file_write_fp64(struct pcm_file * pf, const double x[],
+							size_t frames)
+{
+	unsigned int frm = pf->size * pf->info.channels;
+	size_t cnt = 0;
+
+	if (!pf->write)
+		return -1;
+
+	while (cnt < frames) {
+		size_t n = (PCM_FILE_BUF - pf->cnt) / frm;
+
+		if (n == 0) {
+			if (__pcm_file_flush(pf) < 0)
+				return -1;
+			continue;
+		}
+		if (n > frames - cnt)
+			n = frames - cnt;
+
+		__enc_fp64(pf->buf + pf->cnt, x + cnt * pf->info.channels,
+				   pf->info.fmt, n * pf->info.channels);
+		pf->cnt += n * frm;
+		pf->bytes += n * frm;
+		cnt += n;
+	}
+	pf->info.frames += frames;
+
+	return frames;
+}
+
+ssize_t pcm_file_write_fp32(struct pcm_file * pf, const float x[],
+							size_t frames)
+{
+	double t[PCM_FILE_CHUNK];
+	unsigned int nch = pf->info.channels;
+	size_t step = PCM_FILE_CHUNK / nch;
+	size_t cnt;
+
+	for (cnt = 0; cnt < frames; cnt += step) {
+		size_t n = (frames - cnt < step) ? frames - cnt : step;
+
+		vec_fp64_from_fp32(t, &x[cnt * nch], n * nch);
+		if (pcm_file_write_fp64(pf, t, n) < 0)
+			return -1;
+	}
+
+	return frames;
+}
+
+ssize_t pcm_file_write_i16(struct pcm_file * pf, const int16_t x[],
+						   size_t frames)
+{
+	double t[PCM_FILE_CHUNK];
+	unsigned int nch = pf->info.channels;
+	size_t step = PCM_FILE_CHUNK / nch;
+	size_t cnt;
+
+	for (cnt = 0; cnt < frames; cnt += step) {
+		size_t n = (frames - cnt < step) ? frames - cnt : step;
+
+		vec_fp64_from_i16(t, &x[cnt * nch], n * nch);
+		if (pcm_file_write_fp64(pf, t, n) < 0)
+			return -1;
+	}
+
+	return frames;
+}
+
+int pcm_file_close(struct pcm_file * pf)
+{
+	int ret = 0;
+
+	if (pf->write) {
+		ret = __pcm_file_flush(pf);
+		if (pf->wav) {
+			uint8_t hdr[WAV_HDR_LEN];
+
+			__wav_hdr(hdr, &pf->info, pf->bytes);
+			if (pwrite(pf->fd, hdr, WAV_HDR_LEN, 0) != WAV_HDR_LEN)
+				ret = -1;
+		}
+		if (close(pf->fd) < 0)
+			ret = -1;
+		free(pf->buf);
+	} else {
+		munmap((void *)pf->map, pf->map_len);
+	}
+	free(pf);
+
+	return ret;
+}
+
+/* First channel of a file, mono signals */
+static struct pcm_file * __load_open(const char * path,
+									 const struct pcm_file_info * raw)
+{
+	struct pcm_file * pf;
+
+	if ((pf = pcm_file_open(path, __is_wav(path) ? NULL : raw)) == NULL)
+		return NULL;
+
+	if ((pf->info.frames == 0) || (pf->info.frames > UINT32_MAX)) {
+		fprintf(stderr, "%s: \"%s\": %llu frames, %u channels.\n",
+				__func__, path, (unsigned long long)pf->info.frames,
+				pf->info.channels);
+		pcm_file_close(pf);
+		return NULL;
+	}
+
+	return pf;
+}
+
+/* Next samples of the first channel, up to n */
+static size_t __load_read(struct pcm_file * pf, double y[], size_t n)
+{
+	double t[PCM_FILE_CHUNK];
+	unsigned int nch = pf->info.channels;
+	ssize_t r;
+	ssize_t i;
+
+	if (n > PCM_FILE_CHUNK / nch)
+		n = PCM_FILE_CHUNK / nch;
+	if ((r = pcm_file_read_fp64(pf, t, n)) <= 0)
+		return 0;
+	for (i = 0; i < r; ++i)
+		y[i] = t[i * nch];
+
+	return r;
+}
+
+struct pcm_fp64 * pcm_fp64_load(const char * path,
+								const struct pcm_file_info * raw)
+{
+	struct pcm_file * pf;
+	struct pcm_fp64 * pcm;
+	size_t len;
+	size_t i;
+	size_t n;
+
+	if ((pf = __load_open(path, raw)) == NULL)
+		return NULL;
+
+	len = pf->info.frames;
+	if ((pcm = pcm_fp64_create(len, pf->info.samplerate)) != NULL) {
+		for (i = 0; (n = __load_read(pf, &pcm->sample[i], len - i)); i += n)
+			;
+	}
+	pcm_file_close(pf);
+
+	return pcm;
+}
+
+struct pcm_fp32 * pcm_fp32_load(const char * path,
+								const struct pcm_file_info * raw)
+{
+	double t[PCM_FILE_CHUNK];
+	struct pcm_file * pf;
+	struct pcm_fp32 * pcm;
+	size_t len;
+	size_t i;
+	size_t n;
+
+	if ((pf = __load_open(path, raw)) == NULL)
+		return NULL;
+
+	len = pf->info.frames;
+	if ((pcm = pcm_fp32_create(len, pf->info.samplerate)) != NULL) {
+		for (i = 0; (n = __load_read(pf, t, len - i)); i += n)
+			vec_fp64_to_fp32(&pcm->sample[i], t, n);
+	}
+	pcm_file_close(pf);
+
+	return pcm;
+}
+
+struct pcm_i16 * pcm_i16_load(const char * path,
+							  const struct pcm_file_info * raw)
+{
+	double t[PCM_FILE_CHUNK];
+	struct pcm_file * pf;
+	struct pcm_i16 * pcm;
+	size_t len;
+	size_t i;
+	size_t n;
+
+	if ((pf = __load_open(path, raw)) == NULL)
+		return NULL;
+
+	len = pf->info.frames;
+	if ((pcm = pcm_i16_create(len, lrint(pf->info.samplerate))) != NULL) {
+		for (i = 0; (n = __load_read(pf, t, len - i)); i += n)
+			vec_fp64_to_i16(&pcm->sample[i], t, n);
+	}
+	pcm_file_close(pf);
+
+	return pcm;
+}
+
+/* WAV file for the .wav names, raw otherwise */
+static struct pcm_file * __save_create(const char * path, enum pcm_fmt fmt,
+									   double samplerate)
+{
+	struct pcm_file_info info = {
+		.fmt = fmt,
+		.channels = 1,
+		.samplerate = samplerate
+	};
+
+	return pcm_file_create(path, &info, __is_wav(path));
+}
+
+int pcm_fp64_save(const char * path, const struct pcm_fp64 * pcm,
+				  enum pcm_fmt fmt)
+{
+	struct pcm_file * pf;
+	int ret = 0;
+
+	if ((pf = __save_create(path, fmt, pcm->hdr.samplerate)) == NULL)
+		return -1;
+	if (pcm_file_write_fp64(pf, pcm->sample, pcm->hdr.len) < 0)
+		ret = -1;
+
+	return (pcm_file_close(pf) < 0) ? -1 : ret;
+}
+
+int pcm_fp32_save(const char * path, const struct pcm_fp32 * pcm,
+				  enum pcm_fmt fmt)
+{
+	struct pcm_file * pf;
+	int ret = 0;
+
+	if ((pf = __save_create(path, fmt, pcm->samplerate)) == NULL)
+		return -1;
+	if (pcm_file_write_fp32(pf, pcm->sample, pcm->len) < 0)
+		ret = -1;
+
+	return (pcm_file_close(pf) < 0) ? -1 : ret;
+}
+
+int pcm_i16_save(const char * path, const struct pcm_i16 * pcm,
+				 enum pcm_fmt fmt)
+{
+	struct pcm_file * pf;
+	int ret = 0;
+
+	if ((pf = __save_create(path, fmt, pcm->samplerate)) == NULL)
+		return -1;
+	if (pcm_file_write_i16(pf, pcm->sample, pcm->len) < 0)
+		ret = -1;
+
+	return (pcm_file_close(pf) < 0) ? -1 : ret;
+}
@@ -0,0 +1,143 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	pcm-plot.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: gnuplot scripts and plot data of the PCM signals
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "pcm.h"
+#include "vector.h"
+
+void pcm_plot_env_init(struct pcm_plot_env *env, FILE *f, uint64_t len)
+{
+	memset(env, 0, sizeof(struct pcm_plot_env));
+	env->f = f;
+	env->len = len;
+	env->cols = (len > PCM_PLOT_COLS) ? PCM_PLOT_COLS : 0;
+}
+
+/* the samples as raw floats, or (min, max) float pairs of each column:
+   column k covers the samples [k * len / cols, (k + 1) * len / cols) */
+int pcm_plot_env_write(struct pcm_plot_env *env, const float x[],
+					   unsigned int cnt)
+{
+	if (env->cols == 0)
+		return (fwrite(x, sizeof(float), cnt, env->f) == cnt) ? 0 : -1;
+
+	while ((cnt > 0) && (env->k < env->cols)) {
+		uint64_t end = (env->k + 1) * env->len / env->cols;
+		unsigned int n = (end - env->n < cnt) ? end - env->n : cnt;
+		float mn;
+		float mx;
+
+		vec_fp32_envelope(&mn, &mx, NULL, 1, x, n);
+		if (!env->open) {
+			env->min = mn;
+			env->max = mx;
+			env->open = true;
+		} else {
+			env->min = (mn < env->min) ? mn : env->min;
+			env->max = (mx > env->max) ? mx : env->max;
+		}
+		env->n += n;
+		x += n;
+		cnt -= n;
+
+		if (env->n == end) {
+			float rec[2] = { env->min, env->max };
+
+			if (fwrite(rec, sizeof(float), 2, env->f) != 2)
+				return -1;
+			env->open = false;
+			env->k++;
+		}
+	}
+
+	return 0;
+}
+
+/* write the gnuplot script of the NAME.dat plot data */
+int pcm_plot_script(const char *name, double samplerate, uint64_t len,
+					const char *lstyle, bool png)
+{
+	char plt_path[PATH_MAX];
+	char out_path[PATH_MAX];
+	char dat_path[PATH_MAX];
+	FILE *f;
+
+	sprintf(plt_path, "%s.plt", name);
+	sprintf(out_path, "%s.png", name);
+	sprintf(dat_path, "%s.dat", name);
+
+	if ((f = fopen(plt_path, "w")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!",
+			plt_path, strerror(errno));
+		return -1;
+	}
+	fprintf(f, "set terminal wxt\n");
+	if (png) {
+		fprintf(f,
+			"set terminal png size 2048,1024 font 'verdana,12'\n");
+		fprintf(f, "set output '%s'\n", out_path);
+	}
+	fprintf(f, "set offset graph 0.0,0.0,0.0,0.0\n");
+	fprintf(f, "# labels\n");	/* labels */
+	fprintf(f, "set xlabel 'time(s)'\n");
+	fprintf(f, "set ylabel '%s'\n", name);
+	fprintf(f, "# define axis\n");	/* axis */
+	fprintf(f, "set style line 11 lc rgb '#c0c0c0' lt 0.5\n");
+	fprintf(f, "set border 3 back ls 11\n");
+	fprintf(f, "set tics out nomirror\n");
+	fprintf(f, "# define grid\n");	/* grid */
+	fprintf(f, "set style line 12 lc rgb '#808080' lt 0 lw 1\n");
+	fprintf(f, "set grid back ls 12\n");
+	fprintf(f, "# line styles\n");	/* line styles */
+	if (lstyle) {
+		fprintf(f, "set style line 1 %s\n", lstyle);
+	} else {
+		fprintf(f,
+			"set style line 1 lc rgb '#101010' pt 0 lt 1 lw 1\n");
+	}
+	fprintf(f, "set style line 2 lc rgb '#108010' pt 0 lt 0.5 lw 1\n");
+	if (len > PCM_PLOT_COLS) {
+		/* min/max envelope */
+		fprintf(f, "plot '%s' binary format='%%float32%%float32' "
+			"using ($0 * %.9g):1:2 notitle with filledcurves ls 1\n",
+			dat_path, (double)len / PCM_PLOT_COLS / samplerate);
+	} else {
+		fprintf(f, "plot '%s' binary format='%%float32' "
+			"using ($0 / %.1f):1 notitle with lp ls 1\n",
+			dat_path, samplerate);
+	}
+	fprintf(f, "set output\n");
+	fprintf(f, "quit\n");
+	fclose(f);
+
+	return 0;
+}
@@ -30,26 +30,30 @@ _Pragma ("GCC optimize (\"Ofast\")")
 
 #include <limits.h>
 #include <math.h>
+#include <string.h>
 
 #include "vector.h"
 
-ssize_t vec_fp32_cosine(float y[], size_t len, float w0)
-{
-	unsigned int i;
-	double dw;
+/* 8 x float SIMD vector (GCC vector extensions) */
+typedef float v8sf_t __attribute__ ((vector_size (8 * sizeof(float))));
+typedef int32_t v8si_t __attribute__ ((vector_size (8 * sizeof(int32_t))));
 
-	dw = (double)(2.0 * M_PI) * w0;
+#define VEC_FP32_LANES 8
 
-	for (i = 0; i < len; ++i) {
-		y[i] = cos(dw * i);
-	}
+/* Number of samples processed per block in the Goertzel bank */
+#ifndef VEC_FP32_GOERTZEL_BLK
+#define VEC_FP32_GOERTZEL_BLK 2048
+#endif
 
-	return len;
-}
+/* Maximum number of SIMD lane groups updated in a single pass
+   over the input. */
+#ifndef VEC_FP32_GOERTZEL_GRP_MAX
+#define VEC_FP32_GOERTZEL_GRP_MAX 16
+#endif
 
-ssize_t vec_fp64_wnd_blackman(float y[], size_t len, float alpha)
+ssize_t vec_fp32_wnd_blackman(float y[], size_t len, float alpha)
 {
-	unsigned int i;
+	size_t i;
 	double sum;
 	double a0;
 	double a1;
@@ -74,9 +78,9 @@ ssize_t vec_fp64_wnd_blackman(float y[], size_t len, float alpha)
 	return len;
 }
 
-complex float vec_fp64_gortzel_dft(const float x[], size_t len, float w)
+complex float vec_fp32_gortzel_dft(const float x[], size_t len, float w)
 {
-	unsigned int i;
+	size_t i;
 	double coeff;
 	double scale;
 	double omega;
@@ -101,4 +105,227 @@ complex float vec_fp64_gortzel_dft(const float x[], size_t len, float w)
 	return (s1 - cexp(-I * omega) * s2) * scale;
 }
 
+/*
+ * Multi frequency Goertzel filter bank, single precision.
+ *
+ * Same as vec_fp64_goertzel_bank() with 8 lanes per SIMD vector. 
+ * The recursions run in single precision, the error grows with len
+ * and with 1/sin(2*pi*w), use the double precision version for long
+ * sequences or frequencies close to DC or Nyquist.
+ */
+ssize_t vec_fp32_goertzel_bank(complex float z[], const float w[], size_t m,
+							   const float x[], size_t len)
+{
+	v8sf_t c[VEC_FP32_GOERTZEL_GRP_MAX];
+	v8sf_t s1[VEC_FP32_GOERTZEL_GRP_MAX];
+	v8sf_t s2[VEC_FP32_GOERTZEL_GRP_MAX];
+	size_t ngrp;
+	size_t k0;
+	size_t i0;
+	unsigned int j;
+	unsigned int k;
+	double scale;
+
+	scale = (double)(2.0) / len;
+
+	for (k0 = 0; k0 < m; k0 += ngrp * VEC_FP32_LANES) {
+		size_t cnt = m - k0;
+
+		ngrp = (cnt + VEC_FP32_LANES - 1) / VEC_FP32_LANES;
+		if (ngrp > VEC_FP32_GOERTZEL_GRP_MAX)
+			ngrp = VEC_FP32_GOERTZEL_GRP_MAX;
+
+		/* one frequency per lane, unused lanes run at DC */
+		for (j = 0; j < ngrp; ++j) {
+			for (k = 0; k < VEC_FP32_LANES; ++k) {
+				size_t idx = k0 + j * VEC_FP32_LANES + k;
+				double omega;
+
+				omega = (idx < m) ? (double)(2.0 * M_PI) * w[idx] : 0;
+				c[j][k] = (double)(2.0) * cos(omega);
+			}
+			s1[j] = (v8sf_t){ 0, 0, 0, 0, 0, 0, 0, 0 };
+			s2[j] = (v8sf_t){ 0, 0, 0, 0, 0, 0, 0, 0 };
+		}
+
+		for (i0 = 0; i0 < len; i0 += VEC_FP32_GOERTZEL_BLK) {
+			size_t n = len - i0;
+			const float * xp = &x[i0];
+
+			if (n > VEC_FP32_GOERTZEL_BLK)
+				n = VEC_FP32_GOERTZEL_BLK;
+
+			/* two independent groups per loop to hide the 
+			   latency of the recursion */
+			for (j = 0; (j + 1) < ngrp; j += 2) {
+				v8sf_t ca = c[j];
+				v8sf_t cb = c[j + 1];
+				v8sf_t a1 = s1[j];
+				v8sf_t a2 = s2[j];
+				v8sf_t b1 = s1[j + 1];
+				v8sf_t b2 = s2[j + 1];
+				size_t i;
+
+				for (i = 0; i < n; ++i) {
+					v8sf_t sa;
+					v8sf_t sb;
+
+					sa = xp[i] + (ca * a1) - a2;
+					sb = xp[i] + (cb * b1) - b2;
+					a2 = a1;
+					a1 = sa;
+					b2 = b1;
+					b1 = sb;
+				}
+
+				s1[j] = a1;
+				s2[j] = a2;
+				s1[j + 1] = b1;
+				s2[j + 1] = b2;
+			}
+
+			if (j < ngrp) {
+				v8sf_t ca = c[j];
+				v8sf_t a1 = s1[j];
+				v8sf_t a2 = s2[j];
+				size_t i;
+
+				for (i = 0; i < n; ++i) {
+					v8sf_t sa;
+
+					sa = xp[i] + (ca * a1) - a2;
+					a2 = a1;
+					a1 = sa;
+				}
+
+				s1[j] = a1;
+				s2[j] = a2;
+			}
+		}
+
+		for (j = 0; j < ngrp; ++j) {
+			for (k = 0; k < VEC_FP32_LANES; ++k) {
+				size_t idx = k0 + j * VEC_FP32_LANES + k;
+				double omega;
+
+				if (idx >= m)
+					break;
+
+				omega = (double)(2.0 * M_PI) * w[idx];
+				z[idx] = (s1[j][k] - cexp(-I * omega) * s2[j][k]) * scale;
+			}
+		}
+	}
+
+	return m;
+}
+
+/* Minimum, maximum and sum of squares of n > 0 samples */
+static void __fp32_env(float * pmin, float * pmax, float * psq,
+					  const float x[], size_t n)
+{
+	float mn = x[0];
+	float mx = x[0];
+	float sq = 0;
+	size_t i = 0;
+	int j;
+
+	if (n >= 2 * VEC_FP32_LANES) {
+		v8sf_t vmin;
+		v8sf_t vmax;
+		v8sf_t vsq;
+
+		memcpy(&vmin, x, sizeof(v8sf_t));
+		vmax = vmin;
+		vsq = vmin * vmin;
+		for (i = VEC_FP32_LANES; (i + VEC_FP32_LANES) <= n; i += VEC_FP32_LANES) {
+			v8si_t lt;
+			v8si_t gt;
+			v8sf_t v;
+
+			memcpy(&v, &x[i], sizeof(v8sf_t));
+			/* lane select, the vector ?: is C++ only */
+			lt = (v8si_t)(v < vmin);
+			gt = (v8si_t)(v > vmax);
+			vmin = (v8sf_t)((lt & (v8si_t)v) | (~lt & (v8si_t)vmin));
+			vmax = (v8sf_t)((gt & (v8si_t)v) | (~gt & (v8si_t)vmax));
+			vsq += v * v;
+		}
+		for (j = 0; j < VEC_FP32_LANES; ++j) {
+			mn = (vmin[j] < mn) ? vmin[j] : mn;
+			mx = (vmax[j] > mx) ? vmax[j] : mx;
+			sq += vsq[j];
+		}
+	}
+
+	for (; i < n; ++i) {
+		mn = (x[i] < mn) ? x[i] : mn;
+		mx = (x[i] > mx) ? x[i] : mx;
+		sq += x[i] * x[i];
+	}
+
+	*pmin = mn;
+	*pmax = mx;
+	*psq = sq;
+}
+
+/*
+ * Min/max envelope of a signal, for plots.
+ *
+ * x[] is split in m columns, column k covers the samples
+ * [k * len / m, (k + 1) * len / m). Their minimum and maximum go to
+ * ymin[k] and ymax[k] and, if rms is not NULL, their RMS to rms[k].
+ * A vertical stroke from ymin[k] to ymax[k] draws the same as all the
+ * samples of the column. With m > len the columns repeat samples.
+ *
+ * return: number of columns (m).
+ */
+ssize_t vec_fp32_envelope(float ymin[], float ymax[], float rms[], size_t m,
+						  const float x[], size_t len)
+{
+	size_t k;
+
+	if (len == 0)
+		return 0;
+
+	for (k = 0; k < m; ++k) {
+		size_t i0 = k * len / m;
+		size_t i1 = (k + 1) * len / m;
+		float sq;
+
+		if (i1 == i0)
+			i1 = i0 + 1;
+		__fp32_env(&ymin[k], &ymax[k], &sq, &x[i0], i1 - i0);
+		if (rms != NULL)
+			rms[k] = sqrtf(sq / (i1 - i0));
+	}
+
+	return m;
+}
+
+ssize_t vec_fp32_from_i16(float y[], const int16_t x[], size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		y[i] = x[i] * (1.0f / 32768);
+
+	return len;
+}
 
+/* Round (half away from zero) and saturate, the loop is branch free and
+   truncates so it vectorizes without SSE4.1 */
+ssize_t vec_fp32_to_i16(int16_t y[], const float x[], size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		float v = x[i] * 32768;
+
+		v = (v > 32767) ? 32767 : v;
+		v = (v < -32768) ? -32768 : v;
+		y[i] = (int32_t)(v + ((v < 0) ? -0.5f : 0.5f));
+	}
+
+	return len;
+}
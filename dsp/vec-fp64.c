@@ -30,26 +30,32 @@ _Pragma ("GCC optimize (\"Ofast\")")
 
 #include <limits.h>
 #include <math.h>
+#include <string.h>
 
 #include "vector.h"
 
-ssize_t vec_fp64_cosine(double y[], size_t len, double w0)
-{
-	unsigned int i;
-	double dw;
+/* 4 x double SIMD vector (GCC vector extensions) */
+typedef double v4df_t __attribute__ ((vector_size (4 * sizeof(double))));
+typedef int64_t v4di_t __attribute__ ((vector_size (4 * sizeof(int64_t))));
 
-	dw = (double)(2.0 * M_PI) * w0;
+#define VEC_FP64_LANES 4
 
-	for (i = 0; i < len; ++i) {
-		y[i] = cos(dw * i);
-	}
+/* Number of samples processed per block in the Goertzel bank. 
+   A block is loaded once from memory and stays in L1 while all
+   the recursions run over it. */
+#ifndef VEC_FP64_GOERTZEL_BLK
+#define VEC_FP64_GOERTZEL_BLK 1024
+#endif
 
-	return len;
-}
+/* Maximum number of SIMD lane groups updated in a single pass
+   over the input. */
+#ifndef VEC_FP64_GOERTZEL_GRP_MAX
+#define VEC_FP64_GOERTZEL_GRP_MAX 32
+#endif
 
 ssize_t vec_fp64_wnd_blackman(double y[], size_t len, double alpha)
 {
-	unsigned int i;
+	size_t i;
 	double sum;
 	double a0;
 	double a1;
@@ -76,7 +82,7 @@ ssize_t vec_fp64_wnd_blackman(double y[], size_t len, double alpha)
 
 complex double vec_fp64_gortzel_dft(const double x[], size_t len, double w)
 {
-	unsigned int i;
+	size_t i;
 	double coeff;
 	double scale;
 	double omega;
@@ -101,4 +107,253 @@ complex double vec_fp64_gortzel_dft(const double x[], size_t len, double w)
 	return (s1 - cexp(-I * omega) * s2) * scale;
 }
 
+/*
+ * Multi frequency Goertzel filter bank.
+ *
+ * Evaluates the single term DFT of x[] at the m normalized frequencies
+ * w[] (cyc/samp) in a single pass over the input. Each SIMD lane runs
+ * an independent Goertzel recursion, the input is processed in blocks
+ * of VEC_FP64_GOERTZEL_BLK samples, so the signal is read from memory 
+ * only once for up to (VEC_FP64_GOERTZEL_GRP_MAX * VEC_FP64_LANES) 
+ * frequencies.
+ *
+ * z : output, z[k] is the same as vec_fp64_gortzel_dft(x, len, w[k]);
+ *
+ * return: number of frequencies evaluated (m).
+ */
+ssize_t vec_fp64_goertzel_bank(complex double z[], const double w[], size_t m,
+							   const double x[], size_t len)
+{
+	v4df_t c[VEC_FP64_GOERTZEL_GRP_MAX];
+	v4df_t s1[VEC_FP64_GOERTZEL_GRP_MAX];
+	v4df_t s2[VEC_FP64_GOERTZEL_GRP_MAX];
+	size_t ngrp;
+	size_t k0;
+	size_t i0;
+	unsigned int j;
+	unsigned int k;
+	double scale;
+
+	scale = (double)(2.0) / len;
+
+	for (k0 = 0; k0 < m; k0 += ngrp * VEC_FP64_LANES) {
+		size_t cnt = m - k0;
+
+		ngrp = (cnt + VEC_FP64_LANES - 1) / VEC_FP64_LANES;
+		if (ngrp > VEC_FP64_GOERTZEL_GRP_MAX)
+			ngrp = VEC_FP64_GOERTZEL_GRP_MAX;
+
+		/* one frequency per lane, unused lanes run at DC */
+		for (j = 0; j < ngrp; ++j) {
+			for (k = 0; k < VEC_FP64_LANES; ++k) {
+				size_t idx = k0 + j * VEC_FP64_LANES + k;
+				double omega;
+
+				omega = (idx < m) ? (double)(2.0 * M_PI) * w[idx] : 0;
+				c[j][k] = (double)(2.0) * cos(omega);
+			}
+			s1[j] = (v4df_t){ 0, 0, 0, 0 };
+			s2[j] = (v4df_t){ 0, 0, 0, 0 };
+		}
+
+		for (i0 = 0; i0 < len; i0 += VEC_FP64_GOERTZEL_BLK) {
+			size_t n = len - i0;
+			const double * xp = &x[i0];
+
+			if (n > VEC_FP64_GOERTZEL_BLK)
+				n = VEC_FP64_GOERTZEL_BLK;
+
+			/* two independent groups per loop to hide the 
+			   latency of the recursion */
+			for (j = 0; (j + 1) < ngrp; j += 2) {
+				v4df_t ca = c[j];
+				v4df_t cb = c[j + 1];
+				v4df_t a1 = s1[j];
+				v4df_t a2 = s2[j];
+				v4df_t b1 = s1[j + 1];
+				v4df_t b2 = s2[j + 1];
+				size_t i;
+
+				for (i = 0; i < n; ++i) {
+					v4df_t sa;
+					v4df_t sb;
+
+					sa = xp[i] + (ca * a1) - a2;
+					sb = xp[i] + (cb * b1) - b2;
+					a2 = a1;
+					a1 = sa;
+					b2 = b1;
+					b1 = sb;
+				}
+
+				s1[j] = a1;
+				s2[j] = a2;
+				s1[j + 1] = b1;
+				s2[j + 1] = b2;
+			}
+
+			if (j < ngrp) {
+				v4df_t ca = c[j];
+				v4df_t a1 = s1[j];
+				v4df_t a2 = s2[j];
+				size_t i;
+
+				for (i = 0; i < n; ++i) {
+					v4df_t sa;
+
+					sa = xp[i] + (ca * a1) - a2;
+					a2 = a1;
+					a1 = sa;
+				}
+
+				s1[j] = a1;
+				s2[j] = a2;
+			}
+		}
+
+		for (j = 0; j < ngrp; ++j) {
+			for (k = 0; k < VEC_FP64_LANES; ++k) {
+				size_t idx = k0 + j * VEC_FP64_LANES + k;
+				double omega;
+
+				if (idx >= m)
+					break;
+
+				omega = (double)(2.0 * M_PI) * w[idx];
+				z[idx] = (s1[j][k] - cexp(-I * omega) * s2[j][k]) * scale;
+			}
+		}
+	}
+
+	return m;
+}
+
+/* Minimum, maximum and sum of squares of n > 0 samples */
+static void __fp64_env(double * pmin, double * pmax, double * psq,
+					  const double x[], size_t n)
+{
+	double mn = x[0];
+	double mx = x[0];
+	double sq = 0;
+	size_t i = 0;
+	int j;
+
+	if (n >= 2 * VEC_FP64_LANES) {
+		v4df_t vmin;
+		v4df_t vmax;
+		v4df_t vsq;
+
+		memcpy(&vmin, x, sizeof(v4df_t));
+		vmax = vmin;
+		vsq = vmin * vmin;
+		for (i = VEC_FP64_LANES; (i + VEC_FP64_LANES) <= n; i += VEC_FP64_LANES) {
+			v4di_t lt;
+			v4di_t gt;
+			v4df_t v;
+
+			memcpy(&v, &x[i], sizeof(v4df_t));
+			/* lane select, the vector ?: is C++ only */
+			lt = (v4di_t)(v < vmin);
+			gt = (v4di_t)(v > vmax);
+			vmin = (v4df_t)((lt & (v4di_t)v) | (~lt & (v4di_t)vmin));
+			vmax = (v4df_t)((gt & (v4di_t)v) | (~gt & (v4di_t)vmax));
+			vsq += v * v;
+		}
+		for (j = 0; j < VEC_FP64_LANES; ++j) {
+			mn = (vmin[j] < mn) ? vmin[j] : mn;
+			mx = (vmax[j] > mx) ? vmax[j] : mx;
+			sq += vsq[j];
+		}
+	}
+
+	for (; i < n; ++i) {
+		mn = (x[i] < mn) ? x[i] : mn;
+		mx = (x[i] > mx) ? x[i] : mx;
+		sq += x[i] * x[i];
+	}
+
+	*pmin = mn;
+	*pmax = mx;
+	*psq = sq;
+}
+
+/*
+ * Min/max envelope of a signal, for plots.
+ *
+ * x[] is split in m columns, column k covers the samples
+ * [k * len / m, (k + 1) * len / m). Their minimum and maximum go to
+ * ymin[k] and ymax[k] and, if rms is not NULL, their RMS to rms[k].
+ * A vertical stroke from ymin[k] to ymax[k] draws the same as all the
+ * samples of the column. With m > len the columns repeat samples.
+ *
+ * return: number of columns (m).
+ */
+ssize_t vec_fp64_envelope(double ymin[], double ymax[], double rms[], size_t m,
+						  const double x[], size_t len)
+{
+	size_t k;
+
+	if (len == 0)
+		return 0;
+
+	for (k = 0; k < m; ++k) {
+		size_t i0 = k * len / m;
+		size_t i1 = (k + 1) * len / m;
+		double sq;
+
+		if (i1 == i0)
+			i1 = i0 + 1;
+		__fp64_env(&ymin[k], &ymax[k], &sq, &x[i0], i1 - i0);
+		if (rms != NULL)
+			rms[k] = sqrt(sq / (i1 - i0));
+	}
+
+	return m;
+}
+
+ssize_t vec_fp64_from_i16(double y[], const int16_t x[], size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		y[i] = x[i] * (1.0 / 32768);
+
+	return len;
+}
 
+/* Round (half away from zero) and saturate, the loop is branch free and
+   truncates so it vectorizes without SSE4.1 */
+ssize_t vec_fp64_to_i16(int16_t y[], const double x[], size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		double v = x[i] * 32768;
+
+		v = (v > 32767) ? 32767 : v;
+		v = (v < -32768) ? -32768 : v;
+		y[i] = (int32_t)(v + ((v < 0) ? -0.5 : 0.5));
+	}
+
+	return len;
+}
+
+ssize_t vec_fp64_from_fp32(double y[], const float x[], size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		y[i] = x[i];
+
+	return len;
+}
+
+ssize_t vec_fp64_to_fp32(float y[], const double x[], size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		y[i] = x[i];
+
+	return len;
+}
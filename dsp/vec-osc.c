@@ -0,0 +1,647 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	vec-osc.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Vectorized oscillators: tones, complex exponentials and chirps
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Tones and linear chirps have a quadratic phase (in cycles):
+ *
+ *   cyc(n) = c1 * n + c2 * n^2
+ *
+ * They are generated by a complex rotation recurrence, each SIMD lane
+ * holds one sample of a group of consecutive samples:
+ *
+ *   z(n + L) = z(n) * r(n),  r(n + L) = r(n) * d
+ *
+ * The recurrence is re-seeded from libm every block (OSC_FP64_BLK or
+ * OSC_FP32_BLK samples, OSC_FP64_CHIRP_BLK for double precision
+ * chirps), this renormalizes both the amplitude and the phase, so the
+ * error does not grow with the length of the signal.
+ *
+ * Log chirps have an exponential phase and are generated with a
+ * vectorized polynomial sin/cos (fdlibm kernels on [-pi/4, pi/4]).
+ *
+ * Error bounds (absolute, unit amplitude, against the exact phase
+ * computed from the same double precision parameters, checked with a
+ * quad precision reference up to 2M samples):
+ *
+ *   vec_fp64_cosine/sine/cexp   < 5e-14
+ *   vec_fp64_chirp              < 1e-13
+ *   vec_fp64_logchirp           < 1e-15 + 2e-14 * cyc(n)
+ *   vec_fp32_cosine/sine/cexp   < 1e-6
+ *   vec_fp32_chirp              < 1e-5
+ *   vec_fp32_logchirp           < 1e-7 (+ float rounding)
+ *
+ * The log chirp bound grows with the total number of cycles, cyc(n),
+ * because the phase at the start of each block is only known to a few
+ * ulps, a double precision phase passed to libm has the same behaviour.
+ *
+ * White noise is a counter based generator: sample n is the splitmix64
+ * hash of seed + (n + 1) * golden ratio, so the lanes are independent
+ * and the blocks give the same samples as a single call.
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#include "vector.h"
+
+/* 4 x double SIMD vector (GCC vector extensions) */
+typedef double v4df_t __attribute__ ((vector_size (4 * sizeof(double))));
+typedef int64_t v4di_t __attribute__ ((vector_size (4 * sizeof(int64_t))));
+typedef uint64_t v4du_t __attribute__ ((vector_size (4 * sizeof(uint64_t))));
+
+/* 8 x float SIMD vector (GCC vector extensions) */
+typedef float v8sf_t __attribute__ ((vector_size (8 * sizeof(float))));
+
+#define OSC_FP64_LANES 4
+#define OSC_FP32_LANES 8
+
+/* Re-seeding interval for the rotation recurrences */
+#ifndef OSC_FP64_BLK
+#define OSC_FP64_BLK 256
+#endif
+
+#ifndef OSC_FP32_BLK
+#define OSC_FP32_BLK 128
+#endif
+
+/* Chirps re-seed more often: the lane rotation r is itself rotated at
+   each step, and its rounding error makes the phase error of z grow
+   with the square of the steps in a block */
+#ifndef OSC_FP64_CHIRP_BLK
+#define OSC_FP64_CHIRP_BLK 128
+#endif
+
+enum osc_out {
+	OSC_COS = 0,
+	OSC_SIN = 1,
+	OSC_CEXP = 2
+};
+
+/* exp(j * 2 * pi * cyc), the phase is reduced to a fraction of cycle
+   before calling libm to keep the argument small */
+static inline complex double __cis_cyc(double cyc)
+{
+	double f = cyc - rint(cyc);
+	double ph = (double)(2.0 * M_PI) * f;
+
+	return cos(ph) + I * sin(ph);
+}
+
+/* c1 * n + c2 * n^2 reduced to a fraction of cycle. The products are
+   split into high and low parts (fma), so the phase does not lose
+   precision for large n. Fast math would fold the low parts to zero. */
+static double __attribute__((optimize("no-fast-math"))) __quad_cyc(double c1, double c2, double n)
+{
+	double a = c1 * n;
+	double a_lo = fma(c1, n, -a);
+	double p = c2 * n;
+	double p_lo = fma(c2, n, -p);
+	double b = p * n;
+	double b_lo = fma(p, n, -b);
+
+	return (a - rint(a)) + (b - rint(b)) + a_lo + b_lo + p_lo * n;
+}
+
+/*
+ * Seed the lanes of a rotation recurrence at sample n0.
+ *
+ * z[k] = exp(j*2*pi*cyc(n0 + k))
+ * r[k] = exp(j*2*pi*(cyc(n0 + k + L) - cyc(n0 + k)))
+ */
+static void __osc_seed(complex double z[], complex double r[], unsigned int L,
+					   double c1, double c2, double n0)
+{
+	complex double s;
+	complex double d1;
+	complex double dl;
+	unsigned int k;
+
+	d1 = __cis_cyc(2.0 * c2);
+	dl = __cis_cyc(2.0 * c2 * L);
+
+	z[0] = __cis_cyc(__quad_cyc(c1, c2, n0));
+	s = __cis_cyc(c1 + c2 * (2.0 * n0 + 1.0));
+	r[0] = __cis_cyc(c1 * L + c2 * (2.0 * n0 * L + (double)L * L));
+
+	for (k = 1; k < L; ++k) {
+		z[k] = z[k - 1] * s;
+		s *= d1;
+		r[k] = r[k - 1] * dl;
+	}
+}
+
+static void __osc_fp64(void * y, enum osc_out out, size_t len,
+					   double c1, double c2, size_t n0)
+{
+	complex double zs[OSC_FP64_LANES];
+	complex double rs[OSC_FP64_LANES];
+	double * yr = (double *)y;
+	complex double * yc = (complex double *)y;
+	complex double dd;
+	size_t blk;
+	size_t i0;
+	unsigned int k;
+
+	/* growth of the lane rotation at each step */
+	dd = __cis_cyc(2.0 * c2 * OSC_FP64_LANES * OSC_FP64_LANES);
+	blk = (c2 == 0) ? OSC_FP64_BLK : OSC_FP64_CHIRP_BLK;
+
+	for (i0 = 0; i0 < len; i0 += blk) {
+		size_t n = len - i0;
+		v4df_t zr, zi, rr, ri;
+		double ddr = creal(dd);
+		double ddi = cimag(dd);
+		unsigned int i;
+
+		if (n > blk)
+			n = blk;
+
+		__osc_seed(zs, rs, OSC_FP64_LANES, c1, c2, (double)n0 + i0);
+
+		for (k = 0; k < OSC_FP64_LANES; ++k) {
+			zr[k] = creal(zs[k]);
+			zi[k] = cimag(zs[k]);
+			rr[k] = creal(rs[k]);
+			ri[k] = cimag(rs[k]);
+		}
+
+		for (i = 0; i < n; i += OSC_FP64_LANES) {
+			unsigned int m = n - i;
+			v4df_t tr;
+			v4df_t ti;
+
+			if (m >= OSC_FP64_LANES) {
+				switch (out) {
+				case OSC_COS:
+					memcpy(&yr[i0 + i], &zr, sizeof(v4df_t));
+					break;
+				case OSC_SIN:
+					memcpy(&yr[i0 + i], &zi, sizeof(v4df_t));
+					break;
+				case OSC_CEXP:
+					for (k = 0; k < OSC_FP64_LANES; ++k)
+						yc[i0 + i + k] = zr[k] + I * zi[k];
+					break;
+				}
+			} else {
+				for (k = 0; k < m; ++k) {
+					if (out == OSC_COS)
+						yr[i0 + i + k] = zr[k];
+					else if (out == OSC_SIN)
+						yr[i0 + i + k] = zi[k];
+					else
+						yc[i0 + i + k] = zr[k] + I * zi[k];
+				}
+			}
+
+			/* z = z * r */
+			tr = zr * rr - zi * ri;
+			ti = zr * ri + zi * rr;
+			zr = tr;
+			zi = ti;
+
+			/* r = r * dd */
+			tr = rr * ddr - ri * ddi;
+			ti = rr * ddi + ri * ddr;
+			rr = tr;
+			ri = ti;
+		}
+	}
+}
+
+static void __osc_fp32(void * y, enum osc_out out, size_t len,
+					   double c1, double c2, size_t n0)
+{
+	complex double zs[OSC_FP32_LANES];
+	complex double rs[OSC_FP32_LANES];
+	float * yr = (float *)y;
+	complex float * yc = (complex float *)y;
+	complex double dd;
+	size_t blk;
+	size_t i0;
+	unsigned int k;
+
+	/* growth of the lane rotation at each step */
+	dd = __cis_cyc(2.0 * c2 * OSC_FP32_LANES * OSC_FP32_LANES);
+	/* the single precision rounding dominates */
+	blk = OSC_FP32_BLK;
+
+	for (i0 = 0; i0 < len; i0 += blk) {
+		size_t n = len - i0;
+		v8sf_t zr, zi, rr, ri;
+		float ddr = creal(dd);
+		float ddi = cimag(dd);
+		unsigned int i;
+
+		if (n > blk)
+			n = blk;
+
+		__osc_seed(zs, rs, OSC_FP32_LANES, c1, c2, (double)n0 + i0);
+
+		for (k = 0; k < OSC_FP32_LANES; ++k) {
+			zr[k] = creal(zs[k]);
+			zi[k] = cimag(zs[k]);
+			rr[k] = creal(rs[k]);
+			ri[k] = cimag(rs[k]);
+		}
+
+		for (i = 0; i < n; i += OSC_FP32_LANES) {
+			unsigned int m = n - i;
+			v8sf_t tr;
+			v8sf_t ti;
+
+			if (m >= OSC_FP32_LANES) {
+				switch (out) {
+				case OSC_COS:
+					memcpy(&yr[i0 + i], &zr, sizeof(v8sf_t));
+					break;
+				case OSC_SIN:
+					memcpy(&yr[i0 + i], &zi, sizeof(v8sf_t));
+					break;
+				case OSC_CEXP:
+					for (k = 0; k < OSC_FP32_LANES; ++k)
+						yc[i0 + i + k] = zr[k] + I * zi[k];
+					break;
+				}
+			} else {
+				for (k = 0; k < m; ++k) {
+					if (out == OSC_COS)
+						yr[i0 + i + k] = zr[k];
+					else if (out == OSC_SIN)
+						yr[i0 + i + k] = zi[k];
+					else
+						yc[i0 + i + k] = zr[k] + I * zi[k];
+				}
+			}
+
+			/* z = z * r */
+			tr = zr * rr - zi * ri;
+			ti = zr * ri + zi * rr;
+			zr = tr;
+			zi = ti;
+
+			/* r = r * dd */
+			tr = rr * ddr - ri * ddi;
+			ti = rr * ddi + ri * ddr;
+			rr = tr;
+			ri = ti;
+		}
+	}
+}
+
+/*
+ * sin(2*pi*f) and cos(2*pi*f) for any sign of f (cycles).
+ *
+ * The phase is reduced to r = f - q/4 in [-1/8, 1/8], which is exact,
+ * then the fdlibm minimax polynomials are evaluated at x = 2*pi*r and
+ * the results are swapped/negated according to the quadrant q. The
+ * reduction is symmetric: q is rounded away from zero, a negative q
+ * selects the quadrant q mod 4 in two's complement.
+ */
+static inline void __v4df_sincos_cyc(const v4df_t * pf, v4df_t * ps, v4df_t * pc)
+{
+	const double S1 = -1.66666666666666324348e-01;
+	const double S2 =  8.33333333332248946124e-03;
+	const double S3 = -1.98412698298579493134e-04;
+	const double S4 =  2.75573137070700676789e-06;
+	const double S5 = -2.50507602534068634195e-08;
+	const double S6 =  1.58969099521155010221e-10;
+	const double C1 =  4.16666666666666019037e-02;
+	const double C2 = -1.38888888888741095749e-03;
+	const double C3 =  2.48015872894767294178e-05;
+	const double C4 = -2.75573143513906633035e-07;
+	const double C5 =  2.08757232129817482790e-09;
+	const double C6 = -1.13596475577881948265e-11;
+	const v4di_t one = { 1, 1, 1, 1 };
+	const v4di_t sign = { INT64_MIN, INT64_MIN, INT64_MIN, INT64_MIN };
+	const v4df_t half = { 0.5, 0.5, 0.5, 0.5 };
+	v4di_t q;
+	v4di_t odd;
+	v4di_t hi;
+	v4di_t sc;
+	v4di_t ss;
+	v4df_t x;
+	v4df_t z;
+	v4df_t s;
+	v4df_t c;
+	v4df_t f = *pf;
+
+	/* fraction of cycle, (-1, 1) with the sign of f */
+	f = f - __builtin_convertvector(__builtin_convertvector(f, v4di_t),
+									v4df_t);
+	/* nearest quadrant, +/- 0.5 and truncate towards zero */
+	q = __builtin_convertvector(f * 4.0 +
+								(v4df_t)((v4di_t)half | ((v4di_t)f & sign)),
+								v4di_t);
+	x = (f - __builtin_convertvector(q, v4df_t) * 0.25) * (2.0 * M_PI);
+
+	z = x * x;
+	s = x + x * z * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+	c = 1.0 - 0.5 * z + z * z *
+		(C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+
+	/* odd quadrants swap sin and cos */
+	odd = -(q & one);
+	hi = (q >> 1) & one;
+	sc = ((v4di_t)c & ~odd) | ((v4di_t)s & odd);
+	ss = ((v4di_t)s & ~odd) | ((v4di_t)c & odd);
+	/* quadrant signs: cos -> (hi ^ odd), sin -> hi */
+	sc ^= ((hi ^ (odd & one)) << 63);
+	ss ^= (hi << 63);
+
+	*pc = (v4df_t)sc;
+	*ps = (v4df_t)ss;
+}
+
+/*
+ * Exponential phase: cyc(n) = w0 * (q^n - 1) / lnq, q = exp(lnq).
+ *
+ * At the start of a block n0 the phase is computed as
+ * w0 * n0 * expm1(x) / x, x = lnq * n0, which keeps the relative error
+ * of a few ulps even when the chirp is close to linear (w0 / lnq much
+ * larger than the phase). Inside the block:
+ *
+ *   cyc(n0 + i) = cyc(n0) + w(n0) * e(i),  e(i) = (q^i - 1) / lnq
+ *
+ * with e(i + L) = e(i) * q^L + e(L) for each lane.
+ */
+static void __logosc(double * y64, float * y32, size_t len,
+					 double w0, double lnq, size_t n0)
+{
+	v4df_t e0;
+	double ql;
+	double el;
+	size_t i0;
+	unsigned int j;
+
+	for (j = 0; j < OSC_FP64_LANES; ++j)
+		e0[j] = expm1(lnq * j) / lnq;
+	el = expm1(lnq * OSC_FP64_LANES) / lnq;
+	ql = exp(lnq * OSC_FP64_LANES);
+
+	for (i0 = 0; i0 < len; i0 += OSC_FP64_BLK) {
+		size_t n = len - i0;
+		double n1 = (double)n0 + i0;
+		double x = lnq * n1;
+		double cy0;
+		double w;
+		v4df_t e;
+		unsigned int i;
+
+		if (n > OSC_FP64_BLK)
+			n = OSC_FP64_BLK;
+
+		/* phase and frequency at the beginning of the block */
+		cy0 = (n1 == 0) ? 0 : w0 * n1 * (expm1(x) / x);
+		cy0 -= floor(cy0);
+		w = w0 * exp(x);
+		e = e0;
+
+		for (i = 0; i < n; i += OSC_FP64_LANES) {
+			unsigned int m = n - i;
+			v4df_t s;
+			v4df_t c;
+			v4df_t f;
+
+			f = cy0 + w * e;
+			__v4df_sincos_cyc(&f, &s, &c);
+
+			if (m > OSC_FP64_LANES)
+				m = OSC_FP64_LANES;
+
+			if (y64 != NULL) {
+				for (j = 0; j < m; ++j)
+					y64[i0 + i + j] = s[j];
+			} else {
+				for (j = 0; j < m; ++j)
+					y32[i0 + i + j] = s[j];
+			}
+
+			e = e * ql + el;
+		}
+	}
+}
+
+/* Weyl sequence step of the noise generator */
+#define NOISE_GOLDEN 0x9e3779b97f4a7c15ULL
+
+static inline uint64_t __mix64(uint64_t h)
+{
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+
+	return h ^ (h >> 31);
+}
+
+/* Uniform noise in [-1, 1) from sample n0, double or single precision
+   output */
+static void __noise(double * y64, float * y32, size_t len, uint64_t seed,
+					size_t n0)
+{
+	const double s = 1.0 / 9223372036854775808.0;
+	v4du_t z;
+	size_t i;
+	int k;
+
+	for (k = 0; k < OSC_FP64_LANES; ++k)
+		z[k] = seed + (n0 + k + 1) * NOISE_GOLDEN;
+
+	for (i = 0; (i + OSC_FP64_LANES) <= len; i += OSC_FP64_LANES) {
+		v4du_t h = z;
+		v4df_t v;
+
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+		h ^= h >> 31;
+		v = __builtin_convertvector((v4di_t)h, v4df_t) * s;
+		z += OSC_FP64_LANES * NOISE_GOLDEN;
+
+		if (y64 != NULL) {
+			memcpy(&y64[i], &v, sizeof(v4df_t));
+		} else {
+			for (k = 0; k < OSC_FP64_LANES; ++k)
+				y32[i + k] = v[k];
+		}
+	}
+
+	for (; i < len; ++i) {
+		double v = (int64_t)__mix64(seed + (n0 + i + 1) * NOISE_GOLDEN) * s;
+
+		if (y64 != NULL)
+			y64[i] = v;
+		else
+			y32[i] = v;
+	}
+}
+
+/* Quadratic phase coefficient of a linear chirp, a constant frequency
+   for an empty sweep */
+static inline double __chirp_c2(double w0, double w1, size_t cnt)
+{
+	return (cnt == 0) ? 0.0 : (w1 - w0) / (2.0 * cnt);
+}
+
+/* ---------------------------------------------------------------------------
+ * Double precision floating point
+ * ---------------------------------------------------------------------------
+ * */
+
+ssize_t vec_fp64_cosine(double y[], size_t len, double w0)
+{
+	__osc_fp64(y, OSC_COS, len, w0, 0.0, 0);
+
+	return len;
+}
+
+ssize_t vec_fp64_sine(double y[], size_t len, double w0)
+{
+	__osc_fp64(y, OSC_SIN, len, w0, 0.0, 0);
+
+	return len;
+}
+
+ssize_t vec_fp64_cexp(complex double y[], size_t len, double w0)
+{
+	__osc_fp64(y, OSC_CEXP, len, w0, 0.0, 0);
+
+	return len;
+}
+
+/*
+ * Linear chirp (sine phase).
+ *
+ * The instantaneous frequency goes from w0 at n = 0 to w1 at n = cnt
+ * (cyc/samp). len samples are generated starting at n = n0, so long
+ * sweeps can be produced in blocks.
+ */
+ssize_t vec_fp64_chirp(double y[], size_t len, double w0, double w1,
+					   size_t cnt, size_t n0)
+{
+	__osc_fp64(y, OSC_SIN, len, w0, __chirp_c2(w0, w1, cnt), n0);
+
+	return len;
+}
+
+/*
+ * Logarithmic (exponential) chirp (sine phase).
+ *
+ * The instantaneous frequency goes from w0 at n = 0 to w1 at n = cnt
+ * (cyc/samp), w(n) = w0 * (w1/w0)^(n/cnt).
+ */
+ssize_t vec_fp64_logchirp(double y[], size_t len, double w0, double w1,
+						  size_t cnt, size_t n0)
+{
+	double lnq;
+
+	if (cnt == 0)
+		return vec_fp64_chirp(y, len, w0, w0, cnt, n0);
+
+	lnq = log(w1 / w0) / cnt;
+	if (fabs(lnq) < 1e-15)
+		return vec_fp64_chirp(y, len, w0, w0, cnt, n0);
+
+	__logosc(y, NULL, len, w0, lnq, n0);
+
+	return len;
+}
+
+/*
+ * Uniform white noise in [-1, 1).
+ *
+ * The samples n0 to n0 + len - 1 of the sequence of the seed, long
+ * signals can be produced in blocks.
+ */
+ssize_t vec_fp64_noise(double y[], size_t len, uint64_t seed, size_t n0)
+{
+	__noise(y, NULL, len, seed, n0);
+
+	return len;
+}
+
+/* ---------------------------------------------------------------------------
+ * Single precision floating point
+ * ---------------------------------------------------------------------------
+ * */
+
+ssize_t vec_fp32_cosine(float y[], size_t len, float w0)
+{
+	__osc_fp32(y, OSC_COS, len, w0, 0.0, 0);
+
+	return len;
+}
+
+ssize_t vec_fp32_sine(float y[], size_t len, float w0)
+{
+	__osc_fp32(y, OSC_SIN, len, w0, 0.0, 0);
+
+	return len;
+}
+
+ssize_t vec_fp32_cexp(complex float y[], size_t len, float w0)
+{
+	__osc_fp32(y, OSC_CEXP, len, w0, 0.0, 0);
+
+	return len;
+}
+
+ssize_t vec_fp32_chirp(float y[], size_t len, float w0, float w1,
+					   size_t cnt, size_t n0)
+{
+	__osc_fp32(y, OSC_SIN, len, w0, __chirp_c2(w0, w1, cnt), n0);
+
+	return len;
+}
+
+/* The phase of the log chirp is accumulated in double precision, only
+   the output is rounded to single precision */
+ssize_t vec_fp32_logchirp(float y[], size_t len, float w0, float w1,
+						  size_t cnt, size_t n0)
+{
+	double lnq;
+
+	if (cnt == 0)
+		return vec_fp32_chirp(y, len, w0, w0, cnt, n0);
+
+	lnq = log((double)w1 / w0) / cnt;
+	if (fabs(lnq) < 1e-15)
+		return vec_fp32_chirp(y, len, w0, w0, cnt, n0);
+
+	__logosc(NULL, y, len, w0, lnq, n0);
+
+	return len;
+}
+
+ssize_t vec_fp32_noise(float y[], size_t len, uint64_t seed, size_t n0)
+{
+	__noise(NULL, y, len, seed, n0);
+
+	return len;
+}
@@ -31,9 +31,15 @@ _Pragma ("GCC optimize (\"Ofast\")")
 #include "glwdf.h"
 #include <complex.h>
 #include <assert.h>
+#include <string.h>
 #include <pthread.h>
 #include <pcm.h>
 
+/* Frequency grid of the plot, refined on each response: lower
+   frequency [cyc/samp], points and interpolation tolerance [dB] */
+#define FREQ_W0 (0.5 / 256)
+#define FREQ_NPTS 512
+#define FREQ_TOL_DB 0.05
 
 extern PlotFigure * dbg_figure; 
 
@@ -82,22 +88,31 @@ void freq_plt_update(struct lwdf_fp64_freq * ffr,
 	double * f;
 	complex double * z;
 	double samplerate;
+	struct lwdf_resp_vec rv;
 
 	samplerate = lwdf_fp64_samplerate_get(flt);
 
+	/* the grid follows the band edges and the zeros of the response */
+	lwdf_fp64_freq_adapt_set(ffr, FREQ_W0, 0.5, FREQ_NPTS, FREQ_TOL_DB);
+
 	n = lwdf_fp64_lowwpass_freq_resp(ffr, flt, &w, &z);
 
 	db = calloc(n, sizeof(double));
 	ph = calloc(n, sizeof(double));
 	f = calloc(n, sizeof(double));
 
+	/* unwrapped phase from the analytic response */
+	memset(&rv, 0, sizeof(rv));
+	rv.ph = ph;
+	lwdf_fp64_resp_eval(flt, LWDF_RESP_LOWPASS, w, n, &rv);
+
 #if (DEBUG > 0)
 	fprintf(stderr, "n=%d\n", n);
 #endif
 
 	for (i = 0; i < n; ++i) {
 		db[i] = 20*log10(cabs(z[i]));
-		ph[i] = carg(z[i]) / (2 * M_PI);
+		ph[i] /= (2 * M_PI);
 	
 		/* convert frequencies to Hz */
 		f[i] = w[i] * samplerate; 
@@ -246,7 +261,6 @@ GlwdfFreqTool * glwdf_freq_tool_new(GtkBuilder * builder, GtkWidget * parent,
 	PlotSeries * series;
 	struct lwdf_fp64_freq * ffr;
 	const struct plt_color * color;
-	unsigned int npts = 512;
 	double samplerate;
 	double gamma[128];
 	size_t cnt;
@@ -262,10 +276,13 @@ GlwdfFreqTool * glwdf_freq_tool_new(GtkBuilder * builder, GtkWidget * parent,
 
 	/* New frequency analysis object */
 	ffr = lwdf_fp64_freq_new(flt, 8 * 1024);
-
-	lwdf_fp64_freq_log_set(ffr, 0.5/256, 0.5, 256);
 	ftool->ffr = ffr;
 
+	/* Response cache, persistent if LWDF_RESP_CACHE names a file */
+	ftool->cache = lwdf_fp64_cache_new(64, getenv("LWDF_RESP_CACHE"));
+	if (ftool->cache != NULL)
+		lwdf_fp64_freq_cache_set(ffr, ftool->cache);
+
 	window = GTK_WIDGET(gtk_builder_get_object(builder, "wnd_filter"));
 	grid_gamma = GTK_WIDGET(gtk_builder_get_object(builder, "grid_gamma"));
 	drawing_plot = GTK_WIDGET(gtk_builder_get_object(builder, "freq_plot"));
@@ -280,7 +297,7 @@ GlwdfFreqTool * glwdf_freq_tool_new(GtkBuilder * builder, GtkWidget * parent,
 	/* initialize the amplitude plot */
 	figure = freq_response_plot_init(drawing_plot, samplerate);
 
-	series = plt_line_series_new(figure, "Amp", npts);
+	series = plt_line_series_new(figure, "Amp", FREQ_NPTS);
 	color = plt_stock_color_get();
 	plt_series_line_color_set(series, color);
 	plt_series_line_width_set(series, 2.0);
@@ -299,6 +316,8 @@ void glwdf_freq_tool_free(GlwdfFreqTool * ftool)
 	assert(ftool != NULL);
 
 	lwdf_fp64_freq_free(ftool->ffr);
+	if (ftool->cache != NULL)
+		lwdf_fp64_cache_free(ftool->cache);
 
 	g_free(ftool);
 
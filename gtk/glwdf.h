@@ -53,6 +53,7 @@ struct glwdf_freq_tool {
 
 	struct lwdf_fp64 * flt;
 	struct lwdf_fp64_freq * ffr;
+	struct lwdf_fp64_cache * cache;
 
 	struct {
 		PlotFigure * figure; 
@@ -28,6 +28,7 @@
 
 #define __PLOT_CORE__
 #include "plot-i.h"
+#include "vector.h"
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
@@ -206,3 +207,58 @@ int plt_line_series_draw(struct plt_figure * figure)
 	return 0;	
 }
 
+/*
+ * Samples y[i] at x0 + i * dx. When they do not fit in the series each
+ * pair of points is the minimum and the maximum of a column of samples,
+ * drawn as a vertical stroke at the column's start.
+ */
+int plt_line_series_envelope_set(struct plt_series * series, double x0,
+								 double dx, const double y[], size_t cnt)
+{
+	unsigned int m;
+	unsigned int k;
+	double * px;
+	double * py;
+	int ret;
+
+	assert(series != NULL);
+	assert(y != NULL);
+
+	if (cnt == 0)
+		return plt_line_series_clear(series);
+
+	m = series->info.line.nmax / 2;
+	if (cnt <= series->info.line.nmax)
+		m = cnt;
+
+	px = g_new(double, 2 * m);
+	py = g_new(double, 2 * m);
+
+	if (m == cnt) {
+		for (k = 0; k < cnt; ++k) {
+			px[k] = x0 + k * dx;
+			py[k] = y[k];
+		}
+	} else {
+		double * ymin = px;
+		double * ymax = px + m;
+
+		vec_fp64_envelope(ymin, ymax, NULL, m, y, cnt);
+		for (k = 0; k < m; ++k) {
+			py[2 * k] = ymin[k];
+			py[2 * k + 1] = ymax[k];
+		}
+		for (k = 0; k < m; ++k) {
+			px[2 * k] = x0 + ((double)k * cnt / m) * dx;
+			px[2 * k + 1] = px[2 * k];
+		}
+		m *= 2;
+	}
+
+	ret = plt_line_series_set(series, px, py, m);
+
+	g_free(px);
+	g_free(py);
+
+	return ret;
+}
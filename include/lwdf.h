@@ -54,18 +54,44 @@ enum lwdf_type {
 /* max filter order */
 #define LWDF_ORDER_MAX 127
 
-/* Input to the filter generator */
+/* max coefficient wordlength */
+#define LWDF_NBITS_MAX 31
+
+/* tolerance of the specification mask checks [dB] */
+#define LWDF_SPEC_TOL 1e-3
+
+/* lwdf_design() errors */
+#define LWDF_ERR_SPEC -1 /* invalid specification */
+#define LWDF_ERR_ORDER -2 /* invalid order */
+#define LWDF_ERR_RANGE -3 /* empty design parameter range */
+
+/* Input to the filter generator. The int fields are loaded from the
+   configuration file as int (DEFINE_INT in lwdf-conf.c) */
 struct lwdfwiz_param {
 	double samplerate;
-	uint8_t ftype;
+	int ftype;
 	uint8_t order;
-	uint8_t nbits;
+	int nbits;
 	/* bireciprocal filter */
 	bool bi;
 	/* bireciprocal for decimation/interpolation */
 	bool id;
 	bool rx;
 	bool ff;
+	/* minimize multipliers (power-of-two/CSD coefficients) */
+	bool mm;
+	/* C code: channels of the vectorized kernel, 0 = scalar code */
+	int nchan;
+	/* C code: vector lanes, 0 = 8 if nchan allows, else 4 */
+	int vlen;
+	/* C code: samples per block loop iteration, 0 = 1 */
+	int unroll;
+	/* C code: polyphase stages, decimation/interpolation by 2^stages */
+	int stages;
+	/* C code: double instead of float (nbits = 0) */
+	bool fp64;
+	/* C code: shift and add multipliers (nbits > 0) */
+	bool csd;
 	double asmin; 
 	double as; 
 	double es; 
@@ -73,6 +99,10 @@ struct lwdfwiz_param {
 	double ap;
 	double ep;
 	double fp;
+	/* Butterworth design parameter */
+	double g;
+	/* Elliptic stopband edge, in [fsmin, fs] */
+	double ft;
 };
 
 /* Output from the filter generator */
@@ -80,6 +110,27 @@ struct lwdf_info {
 	double samplerate;
 	unsigned int order;
 	double gamma[LWDF_ORDER_MAX];	
+	/* achieved specification */
+	bool bi;
+	double as;
+	double es;
+	double ap;
+	double ep;
+	double fs;
+	double fp;
+	double g;
+};
+
+/* Order and design parameter ranges for a specification */
+struct lwdf_design_range {
+	unsigned int nmin; /* minimum order */
+	unsigned int order; /* order the ranges refer to */
+	double gmin; /* Butterworth g: better passband */
+	double gmax; /* Butterworth g: better stopband */
+	double epmin; /* Chebyshev, elliptic: better passband */
+	double epmax; /* Chebyshev, elliptic: better stopband */
+	double fsmin; /* elliptic: better transition */
+	double fsmax; /* elliptic: better pass&stopband */
 };
 
 struct lwdfwiz_cfg {
@@ -88,9 +139,122 @@ struct lwdfwiz_cfg {
 	char prefix[32];
 	char cfname[256];
 	char jlfname[256];
+	char cache[256];
 };
 
 
+/* Implementation cost */
+struct lwdf_cost {
+	unsigned int mul; /* multipliers per sample */
+	unsigned int shift; /* adaptors with a power of two coefficient */
+	unsigned int adaptor; /* non trivial adaptors (g != 0) */
+	unsigned int coeff; /* distinct multiplier coefficients */
+	unsigned int nbits; /* coefficient wordlength, 0 = floating point */
+};
+
+/* Digits of a CSD multiplier, bit 0 first */
+#define LWDF_CSD_MAX 32
+
+/* Shift and add form of x * t: the sum of d[k] * (t << k) and of
+   u[k] * (m << k), with the common subexpression m = t + sign * (t << dist)
+   when a digit pair repeats (dist = 0: none) */
+struct lwdf_csd {
+	int8_t d[LWDF_CSD_MAX];
+	int8_t u[LWDF_CSD_MAX];
+	int dist;
+	int sign;
+};
+
+/* Operations per output sample of the generated C code */
+struct lwdf_ops {
+	unsigned int add; /* additions and subtractions */
+	unsigned int mul; /* multiplies */
+	unsigned int shift; /* shifts */
+	unsigned int load; /* memory reads */
+	unsigned int store; /* memory writes */
+	unsigned int depth; /* critical path, operations from input to output */
+	unsigned int nst; /* state variables */
+	unsigned int state; /* state memory [bytes] */
+};
+
+/* Target profile of the cycle estimate */
+struct lwdf_target {
+	const char * name;
+	/* issue cost of each operation [cycles] */
+	double add;
+	double mul;
+	double shift;
+	double load;
+	double store;
+	double loop; /* loop overhead per iteration [cycles] */
+	unsigned int regs; /* registers for the states and temporaries */
+	unsigned int issue; /* operations per cycle, 0 = in order */
+	/* result latencies of the out of order targets [cycles] */
+	double lat_add;
+	double lat_mul;
+	double lat_shift;
+};
+
+/* Design space exploration candidate */
+struct lwdf_cand {
+	struct lwdfwiz_param wiz; /* design parameters, nbits = wordlength */
+	struct lwdf_info inf;
+	struct lwdf_cost cost;
+	double as_margin; /* stopband margin [dB] */
+	double ap_margin; /* passband margin [dB] */
+	bool valid;
+};
+
+/* Design space exploration settings */
+struct lwdf_explore_cfg {
+	unsigned int dn; /* orders from nmin to nmin + dn */
+	unsigned int nstep; /* samples of each free parameter */
+	unsigned int nbits_max; /* max coefficient wordlength */
+	unsigned int nthreads; /* worker threads, 0 = number of CPUs */
+	struct lwdf_design_cache * cache; /* optional design cache */
+};
+
+/* Multiplierless coefficient optimization settings */
+struct lwdf_spt_cfg {
+	unsigned int nbits; /* coefficient wordlength */
+	unsigned int nthreads; /* worker threads, 0 = number of CPUs */
+	unsigned long nodes_max; /* search limit, 0 = unlimited */
+	double slack; /* mask relaxation of partial solutions (0 to 1) */
+};
+
+/* Custom mask on a frequency grid, for lwdf_fit() */
+struct lwdf_mask {
+	size_t len; /* number of grid points */
+	const double * w; /* frequencies [cycles/sample], 0 to 0.5 */
+	const double * lo; /* min gain [dB], -INFINITY for none */
+	const double * hi; /* max gain [dB], INFINITY for none */
+	const double * wt; /* gain weights, NULL for all 1 */
+	const bool * gd; /* group delay constrained points, NULL for none */
+	double gd_ripple; /* max group delay variation [samples] */
+};
+
+/* Mask fit settings */
+struct lwdf_fit_cfg {
+	unsigned int iter_max; /* iterations limit, 0 = default */
+};
+
+/* Frequency transformations of a lowpass prototype */
+enum lwdf_xform_type {
+	LWDF_XFORM_LOWPASS = 0,
+	LWDF_XFORM_HIGHPASS = 1,
+	LWDF_XFORM_BANDPASS = 2,
+	LWDF_XFORM_BANDSTOP = 3
+};
+
+struct lwdf_xform {
+	unsigned int type; /* enum lwdf_xform_type */
+	double f1; /* passband edge, lower band edge [Hz] */
+	double f2; /* upper band edge [Hz] (bandpass, bandstop) */
+};
+
+/* Filter design cache */
+struct lwdf_design_cache;
+
 /* Floating point single precision filter */
 struct lwdf_fp32;
 
@@ -100,6 +264,23 @@ struct lwdf_fp64;
 /* Filter frequency response analysis */
 struct lwdf_fp64_freq;
 
+/* Frequency response cache */
+struct lwdf_fp64_cache;
+
+/* Analytic response output vectors, any of them can be NULL */
+struct lwdf_resp_vec {
+	double * mag; /* magnitude */
+	double * ph; /* phase [rad] */
+	double * gd; /* group delay [samples] */
+	double * pd; /* phase delay [samples] */
+};
+
+/* Response types */
+enum lwdf_resp {
+	LWDF_RESP_LOWPASS = 0,
+	LWDF_RESP_HIGHPASS = 1
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -107,14 +288,102 @@ extern "C" {
 /* Terminal/console mode wizard */
 int lwdfwiz_term(struct lwdfwiz_param * wiz, struct lwdf_info * inf);
 
+void lwdfwiz_cache_set(struct lwdf_design_cache * cache);
+
+/* Filter design, no I/O */
+int lwdf_design(const struct lwdfwiz_param * wiz, struct lwdf_info * inf);
+
+int lwdf_design_range(const struct lwdfwiz_param * wiz,
+					  struct lwdf_design_range * rng);
+
+/* Design cache, path NULL for a memory only cache */
+struct lwdf_design_cache * lwdf_design_cache_open(const char * path);
+
+void lwdf_design_cache_close(struct lwdf_design_cache * cache);
+
+int lwdf_design_cache_get(struct lwdf_design_cache * cache,
+						  const struct lwdfwiz_param * wiz,
+						  struct lwdf_info * inf,
+						  double * as_margin, double * ap_margin);
+
+int lwdf_design_cache_put(struct lwdf_design_cache * cache,
+						  const struct lwdfwiz_param * wiz,
+						  const struct lwdf_info * inf,
+						  double as_margin, double ap_margin);
+
+void lwdf_design_cache_stat(struct lwdf_design_cache * cache,
+							unsigned int * hit, unsigned int * miss);
+
+int lwdf_design_cached(struct lwdf_design_cache * cache,
+					   const struct lwdfwiz_param * wiz,
+					   struct lwdf_info * inf,
+					   double * as_margin, double * ap_margin);
+
+/* Design space exploration, returns the Pareto front on cost */
+int lwdf_explore(const struct lwdfwiz_param * spec,
+				 const struct lwdf_explore_cfg * cfg,
+				 struct lwdf_cand ** pfront);
+
+void lwdf_gamma_quantize(double q[], const double gamma[],
+						 unsigned int order, unsigned int nbits);
+
+void lwdf_cost_get(const double gamma[], unsigned int order,
+				   unsigned int nbits, struct lwdf_cost * cost);
+
+/* Power-of-two/CSD coefficient search within the specification mask */
+int lwdf_spt_optimize(const struct lwdfwiz_param * spec,
+					  const double gamma[], unsigned int order,
+					  const struct lwdf_spt_cfg * cfg, double q[]);
+
+/* Highpass, bandpass and bandstop from a lowpass design */
+int lwdf_xform(const struct lwdf_info * proto, const struct lwdf_xform * xf,
+			   struct lwdf_info * inf);
+
+/* Gradient based fit of gamma[] to a custom mask */
+int lwdf_fit(const struct lwdf_mask * mask, unsigned int resp,
+			 double gamma[], unsigned int order,
+			 const struct lwdf_fit_cfg * cfg, double * err);
+
 int lwdf_cgen(FILE *fout, const char * prefix, 
 			   const struct lwdfwiz_param * wiz, 
 			   const struct lwdf_info * inf);
 
+/* Canonical signed digits of x > 0 with a common subexpression */
+void lwdf_csd_get(int x, struct lwdf_csd * csd);
+
+/* Built in target profiles, terminated by a NULL name */
+extern const struct lwdf_target lwdf_target_tab[];
+
+const struct lwdf_target * lwdf_target_get(const char * name);
+
+/* Static cost of the lwdf_cgen() lowpass block loop (decimate2() for
+   the interpolation/decimation designs) */
+void lwdf_cgen_ops(const struct lwdfwiz_param * wiz,
+				   const struct lwdf_info * inf, struct lwdf_ops * ops);
+
+/* Estimated cycles per output sample on a target */
+double lwdf_cgen_cycles(const struct lwdfwiz_param * wiz,
+						const struct lwdf_info * inf,
+						const struct lwdf_target * tgt);
+
+/* JSON cost report, with the cycles of every built in target */
+int lwdf_cgen_report(FILE * f, const struct lwdfwiz_param * wiz,
+					 const struct lwdf_info * inf);
+
+/* Benchmark the C code variants on the host, emit the fastest one */
+int lwdf_cgen_tune(FILE * fout, const char * prefix,
+				   const struct lwdfwiz_param * wiz,
+				   const struct lwdf_info * inf);
+
 int lwdf_jlgen(FILE *fout, const char * prefix, 
 			   const struct lwdfwiz_param * wiz, 
 			   const struct lwdf_info * inf);
 
+/* C++20 header, the filter as a class template */
+int lwdf_cppgen(FILE *fout, const char * prefix,
+				const struct lwdfwiz_param * wiz,
+				const struct lwdf_info * inf);
+
 
 
 /* 
@@ -156,11 +425,77 @@ ssize_t lwdf_fp64_freq_log_set(struct lwdf_fp64_freq * ffr,
 
 ssize_t lwdf_fp64_freq_lin_set(struct lwdf_fp64_freq * ffr, 
 							   double w0, double w1, ssize_t npts);
+
+/* Adaptive grid, refined until the interpolation error is below tol [dB] */
+ssize_t lwdf_fp64_freq_adapt_set(struct lwdf_fp64_freq * ffr,
+								 double w0, double w1, ssize_t npts,
+								 double tol);
+
+/* Attach a response cache to the frequency analysis, NULL to detach */
+int lwdf_fp64_freq_cache_set(struct lwdf_fp64_freq * ffr,
+							 struct lwdf_fp64_cache * cache);
+
+/* 
+ * Frequency response cache 
+ * */
+
+struct lwdf_fp64_cache * lwdf_fp64_cache_new(size_t max, const char * path);
+
+void lwdf_fp64_cache_free(struct lwdf_fp64_cache * cache);
+
+ssize_t lwdf_fp64_cache_get(struct lwdf_fp64_cache * cache,
+							struct lwdf_fp64 * flt, unsigned int resp,
+							size_t dftn, const double w[],
+							complex double z[], size_t len);
+
+int lwdf_fp64_cache_put(struct lwdf_fp64_cache * cache,
+						struct lwdf_fp64 * flt, unsigned int resp,
+						size_t dftn, const double w[],
+						const complex double z[], size_t len);
+
+void lwdf_fp64_cache_stat(struct lwdf_fp64_cache * cache,
+						  unsigned int * hit, unsigned int * miss);
+
+/* 
+ * Analytic response (magnitude, phase and group delay)
+ * */
+
+ssize_t lwdf_resp_eval(const double gamma[], unsigned int order,
+					   unsigned int resp, const double w[], size_t len,
+					   const struct lwdf_resp_vec * rv);
+
+ssize_t lwdf_fp64_resp_eval(struct lwdf_fp64 * flt, unsigned int resp,
+							const double w[], size_t len,
+							const struct lwdf_resp_vec * rv);
+
+int lwdf_spec_margin(const struct lwdfwiz_param * wiz,
+					 const double gamma[], unsigned int order,
+					 double * as_margin, double * ap_margin);
 /* 
  * Filtering 
  *  These functions performs filtering over a vector
  * */
 
+/* Native block kernel: the coefficients are built in, st[] is the
+   state of the struct lwdf_fp64 */
+typedef void (* lwdf_fp64_kernel_t)(double st[], double y[],
+									const double x[], unsigned int len);
+
+/* Use native kernels for the lowpass and highpass until the coefficients
+   change, release(arg) is called when they are dropped */
+int lwdf_fp64_kernel_set(struct lwdf_fp64 * flt, lwdf_fp64_kernel_t lp,
+						 lwdf_fp64_kernel_t hp, void (* release)(void *),
+						 void * arg);
+
+/* Compile the current coefficients with lwdf_cgen() and the host C
+   compiler and load them as the kernels. On error the generic kernels
+   stay in use */
+int lwdf_fp64_jit(struct lwdf_fp64 * flt);
+
+/* lwdf_fp64_jit() for cnt filters with the same coefficients, the
+   channels of a stream: one compilation, the kernels are shared */
+int lwdf_fp64_jit_shared(struct lwdf_fp64 * flt[], unsigned int cnt);
+
 /* Low Pass */
 ssize_t lwdf_fp64_lowpass(struct lwdf_fp64 * flt, double y[], 
 						  const double x[], size_t len);
@@ -33,19 +33,25 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <complex.h>
 
+/* Alignment of the samples, a cache line, the widest SIMD vector */
+#define PCM_ALIGN 64
 
-struct pcm16 {
+/* The signals are allocated by the create and load calls, aligned, and
+   released with the destroy calls */
+
+struct pcm_i16 {
 	uint32_t len;
 	uint32_t samplerate;
-	int16_t sample[];
+	int16_t sample[] __attribute__((aligned(PCM_ALIGN)));
 };
 
 struct pcm_fp32 {
 	uint32_t len;
 	float samplerate;
-	float sample[];
+	float sample[] __attribute__((aligned(PCM_ALIGN)));
 };
 
 struct pcm_fp64 {
@@ -53,7 +59,41 @@ struct pcm_fp64 {
 		uint32_t len;
 		float samplerate;
 	} hdr;
-	double sample[];
+	double sample[] __attribute__((aligned(PCM_ALIGN)));
+};
+
+/* Sample formats of the WAV and raw files */
+enum pcm_fmt {
+	PCM_S16 = 0,
+	PCM_S24,
+	PCM_S32,
+	PCM_F32,
+	PCM_F64
+};
+
+struct pcm_file_info {
+	enum pcm_fmt fmt;
+	unsigned int channels;
+	double samplerate;
+	uint64_t frames;
+};
+
+struct pcm_file;
+
+/* Columns of the plots, the longer signals are drawn as their min/max
+   envelope */
+#define PCM_PLOT_COLS 2048
+
+/* Plot data of a signal of len samples, written block by block */
+struct pcm_plot_env {
+	FILE *f;
+	uint64_t len;
+	uint64_t n;
+	unsigned int cols; /* 0: the samples */
+	unsigned int k;
+	bool open;
+	float min;
+	float max;
 };
 
 #ifdef __cplusplus
@@ -64,20 +104,26 @@ struct pcm_i16 *pcm_i16_create(unsigned int len, unsigned int samplerate);
 
 int pcm_i16_destroy(struct pcm_i16 *pcm);
 
-/* Add a sinusoidal waveform to the existing one */
+/* Add a sinusoidal waveform to the existing one, amp is relative to
+   the full scale, the sums saturate */
 int pcm_i16_sin(struct pcm_i16 *pcm, float freq, float amp);
 
 /* Add a sinusoidal sweep */
 int pcm_i16_sweep(struct pcm_i16 *pcm, float f0, float f1, float amp);
 
-/* Add white noise to the the waveform */
-int pcm_i16_white_noise(struct pcm_i16 *pcm, float level);
+int pcm_i16_logsweep(struct pcm_i16 *pcm, float f0, float f1, float amp);
+
+/* Add uniform white noise in [-level, level), the same seed gives the
+   same noise */
+int pcm_i16_white_noise(struct pcm_i16 *pcm, float level, uint64_t seed);
 
 /* write the waveform into a file suitable for gnuplot */
 int pcm_i16_dump(const char *fname, struct pcm_i16 *pcm);
 
 int pcm_i16_plot(const char *name, struct pcm_i16 *pcm);
 
+/* write the waveform as a C array */
+
 int pcm_i16_c_dump(const char *fname, struct pcm_i16 *pcm);
 
 /* Floating point */
@@ -97,6 +143,10 @@ int pcm_fp64_sweep(struct pcm_fp64 *pcm, double f0, double f1, double a);
 
 int pcm_fp64_logsweep(struct pcm_fp64 *pcm, double f0, double f1, double a);
 
+int pcm_fp64_sin(struct pcm_fp64 *pcm, double freq, double a);
+
+int pcm_fp64_white_noise(struct pcm_fp64 *pcm, double level, uint64_t seed);
+
 ssize_t pcm_fp64_cosine(double y[], size_t size, double w0);
 
 ssize_t pcm_fp64_wnd_blackman(double y[], size_t npts, double alpha);
@@ -121,6 +171,77 @@ int pcm_fp32_sweep(struct pcm_fp32 *pcm, float f0, float f1, float a);
 
 int pcm_fp32_logsweep(struct pcm_fp32 *pcm, float f0, float f1, float a);
 
+int pcm_fp32_sin(struct pcm_fp32 *pcm, float freq, float a);
+
+int pcm_fp32_white_noise(struct pcm_fp32 *pcm, float level, uint64_t seed);
+
+/* Plots */
+
+/* write the gnuplot script of the NAME.dat plot data of a signal of len
+   samples */
+int pcm_plot_script(const char *name, double samplerate, uint64_t len,
+					const char *lstyle, bool png);
+
+void pcm_plot_env_init(struct pcm_plot_env *env, FILE *f, uint64_t len);
+
+/* write the plot data of the next cnt samples */
+int pcm_plot_env_write(struct pcm_plot_env *env, const float x[],
+					   unsigned int cnt);
+
+/* WAV and raw files */
+
+/* Map a WAV file, or a raw file of the raw format, channels and rate */
+struct pcm_file *pcm_file_open(const char *path,
+							   const struct pcm_file_info *raw);
+
+/* Create a WAV file, or a raw file when wav is false */
+struct pcm_file *pcm_file_create(const char *path,
+								 const struct pcm_file_info *info, bool wav);
+
+int pcm_file_close(struct pcm_file *pf);
+
+const struct pcm_file_info *pcm_file_info(const struct pcm_file *pf);
+
+/* Interleaved samples of the mapped file, as they are stored */
+const void *pcm_file_data(const struct pcm_file *pf);
+
+/* Read and convert the next interleaved frames */
+ssize_t pcm_file_read_fp64(struct pcm_file *pf, double y[], size_t frames);
+
+ssize_t pcm_file_read_fp32(struct pcm_file *pf, float y[], size_t frames);
+
+ssize_t pcm_file_read_i16(struct pcm_file *pf, int16_t y[], size_t frames);
+
+/* Convert and append interleaved frames */
+ssize_t pcm_file_write_fp64(struct pcm_file *pf, const double x[],
+							size_t frames);
+
+ssize_t pcm_file_write_fp32(struct pcm_file *pf, const float x[],
+							size_t frames);
+
+ssize_t pcm_file_write_i16(struct pcm_file *pf, const int16_t x[],
+						   size_t frames);
+
+/* Whole signals, WAV files for the .wav names, raw otherwise. The
+   loaders take the first channel. */
+struct pcm_fp64 *pcm_fp64_load(const char *path,
+							   const struct pcm_file_info *raw);
+
+int pcm_fp64_save(const char *path, const struct pcm_fp64 *pcm,
+				  enum pcm_fmt fmt);
+
+struct pcm_fp32 *pcm_fp32_load(const char *path,
+							   const struct pcm_file_info *raw);
+
+int pcm_fp32_save(const char *path, const struct pcm_fp32 *pcm,
+				  enum pcm_fmt fmt);
+
+struct pcm_i16 *pcm_i16_load(const char *path,
+							 const struct pcm_file_info *raw);
+
+int pcm_i16_save(const char *path, const struct pcm_i16 *pcm,
+				 enum pcm_fmt fmt);
+
 #ifdef __cplusplus
 }
 #endif
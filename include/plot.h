@@ -101,6 +101,10 @@ int plt_line_series_insert(PlotSeries * lin, const double x[],
 int plt_line_series_set(PlotSeries * series, const double x[], 
 						const double y[], size_t cnt);
 
+/* Samples at x0 + i * dx, a min/max envelope when they do not fit */
+int plt_line_series_envelope_set(PlotSeries * series, double x0,
+								 double dx, const double y[], size_t cnt);
+
 
 int plt_line_series_clear(PlotSeries * fig);
 
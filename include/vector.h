@@ -45,23 +45,91 @@ extern "C" {
  * ---------------------------------------------------------------------------
  * */
 
+/* Oscillators */
+
 ssize_t vec_fp32_cosine(float y[], size_t len, float w0);
 
+ssize_t vec_fp32_sine(float y[], size_t len, float w0);
+
+ssize_t vec_fp32_cexp(complex float y[], size_t len, float w0);
+
+ssize_t vec_fp32_chirp(float y[], size_t len, float w0, float w1, 
+					   size_t cnt, size_t n0);
+
+ssize_t vec_fp32_logchirp(float y[], size_t len, float w0, float w1, 
+						  size_t cnt, size_t n0);
+
+ssize_t vec_fp32_noise(float y[], size_t len, uint64_t seed, size_t n0);
+
+/* Windows */
+
 ssize_t vec_fp32_wnd_blackman(float y[], size_t len, float alpha);
 
+/* Goertzel (single term DFT) */
+
 complex float vec_fp32_gortzel_dft(const float x[], size_t len, float w);
 
+ssize_t vec_fp32_goertzel_bank(complex float z[], const float w[], size_t m,
+							   const float x[], size_t len);
+
+/* Min/max (and RMS) envelope of m columns, for plots */
+
+ssize_t vec_fp32_envelope(float ymin[], float ymax[], float rms[], size_t m,
+						  const float x[], size_t len);
+
+/* Conversions, 16 bits full scale is [-1, 1) */
+
+ssize_t vec_fp32_from_i16(float y[], const int16_t x[], size_t len);
+
+ssize_t vec_fp32_to_i16(int16_t y[], const float x[], size_t len);
+
 /* ---------------------------------------------------------------------------
  * Double precision floating point 
  * ---------------------------------------------------------------------------
  * */
 
+/* Oscillators */
+
 ssize_t vec_fp64_cosine(double y[], size_t len, double w0);
 
+ssize_t vec_fp64_sine(double y[], size_t len, double w0);
+
+ssize_t vec_fp64_cexp(complex double y[], size_t len, double w0);
+
+ssize_t vec_fp64_chirp(double y[], size_t len, double w0, double w1, 
+					   size_t cnt, size_t n0);
+
+ssize_t vec_fp64_logchirp(double y[], size_t len, double w0, double w1, 
+						  size_t cnt, size_t n0);
+
+ssize_t vec_fp64_noise(double y[], size_t len, uint64_t seed, size_t n0);
+
+/* Windows */
+
 ssize_t vec_fp64_wnd_blackman(double y[], size_t len, double alpha);
 
+/* Goertzel (single term DFT) */
+
 complex double vec_fp64_gortzel_dft(const double x[], size_t len, double w);
 
+ssize_t vec_fp64_goertzel_bank(complex double z[], const double w[], size_t m,
+							   const double x[], size_t len);
+
+/* Min/max (and RMS) envelope of m columns, for plots */
+
+ssize_t vec_fp64_envelope(double ymin[], double ymax[], double rms[], size_t m,
+						  const double x[], size_t len);
+
+/* Conversions, 16 bits full scale is [-1, 1) */
+
+ssize_t vec_fp64_from_i16(double y[], const int16_t x[], size_t len);
+
+ssize_t vec_fp64_to_i16(int16_t y[], const double x[], size_t len);
+
+ssize_t vec_fp64_from_fp32(double y[], const float x[], size_t len);
+
+ssize_t vec_fp64_to_fp32(float y[], const double x[], size_t len);
+
 
 #ifdef __cplusplus
 }
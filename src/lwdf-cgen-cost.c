@@ -0,0 +1,334 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-cgen-cost.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: static cost of the generated C code
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The operations are counted on the adaptors as lwdf_cgen() writes
+ * them, per output sample of the lowpass block loop (or of decimate2()
+ * for the polyphase designs):
+ *
+ *   t = in1 - in2;  out = a * t +/- in2;  out' = out - t;
+ *
+ * that is 3 additions and a multiply, a shift for a power of two fixed
+ * point coefficient, a multiply and a shift for the others (or the
+ * shifts and adds of the CSD form). Zero gamma adaptors are moves and
+ * cost nothing.
+ *
+ * The cycle estimate of an in order target is the sum of the operation
+ * costs. An out of order target is bound by its issue width or by the
+ * longest recurrence through the states, whichever is slower: the
+ * input to output chain of one sample overlaps with the next samples,
+ * the state updates do not.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "lwdf.h"
+
+const struct lwdf_target lwdf_target_tab[] = {
+	/* in order, single cycle FPU and MAC, 2 cycle loads, no spare
+	   registers with the pointers and the loop counter */
+	{ .name = "cortex-m4", .add = 1, .mul = 1, .shift = 1,
+	  .load = 2, .store = 1, .loop = 3, .regs = 12, .issue = 0,
+	  .lat_add = 1, .lat_mul = 1, .lat_shift = 1 },
+	/* out of order, scalar SSE, two FP ports */
+	{ .name = "x86", .add = 1, .mul = 1, .shift = 1,
+	  .load = 1, .store = 1, .loop = 1, .regs = 16, .issue = 2,
+	  .lat_add = 4, .lat_mul = 4, .lat_shift = 1 },
+	{ .name = NULL }
+};
+
+const struct lwdf_target * lwdf_target_get(const char * name)
+{
+	int i;
+
+	for (i = 0; lwdf_target_tab[i].name != NULL; ++i) {
+		if (strcmp(lwdf_target_tab[i].name, name) == 0)
+			return &lwdf_target_tab[i];
+	}
+
+	return NULL;
+}
+
+/* Operation latencies of the dataflow walk */
+struct cost_lat {
+	double add;
+	double mul;
+	double shift;
+};
+
+struct cost_walk {
+	const double * gamma;
+	unsigned int N;
+	unsigned int nbits;
+	bool csd;
+	struct cost_lat lat;
+	/* ready time of each state, old and new */
+	double st[LWDF_ORDER_MAX];
+	struct lwdf_ops * ops;
+};
+
+/* Fixed point adaptor coefficient */
+static int __alpha_q(double g, unsigned int nbits)
+{
+	double a;
+
+	a = (g > 0.5) ? 1.0 - g : (g > 0.0) ? g : (g > -0.5) ? -g : 1.0 + g;
+
+	return (int)ldexp(a, nbits);
+}
+
+/* Shift and add multiplier: ready time of the product, the terms are
+   summed as a tree */
+static double __walk_csd(struct cost_walk * w, int q, double t)
+{
+	struct lwdf_csd c;
+	unsigned int n = 0;
+	unsigned int sh = 1;
+	int k;
+
+	lwdf_csd_get(q, &c);
+	for (k = 0; k < LWDF_CSD_MAX; ++k) {
+		n += (c.d[k] != 0) + (c.u[k] != 0);
+		sh += ((c.d[k] != 0) + (c.u[k] != 0)) * (k > 0);
+	}
+
+	if (w->ops != NULL) {
+		w->ops->add += n - 1 + (c.dist ? 1 : 0);
+		w->ops->shift += sh + (c.dist ? 1 : 0);
+	}
+	if (c.dist)
+		t += w->lat.shift + w->lat.add;
+
+	return t + w->lat.shift + ceil(log2(n)) * w->lat.add + w->lat.shift;
+}
+
+/* Adaptor k: ready times of the inputs in, the outputs are the upper
+   (out) and the state (st) */
+static void __walk_adaptor(struct cost_walk * w, unsigned int k,
+						   double in1, double in2,
+						   double * out1, double * out2)
+{
+	double g = w->gamma[k];
+	double t;
+	double p;
+	int q;
+
+	if (g == 0.0) {
+		*out1 = in2;
+		*out2 = in1;
+		return;
+	}
+
+	t = fmax(in1, in2) + w->lat.add;
+	q = __alpha_q(g, w->nbits);
+	if (w->nbits == 0) {
+		p = t + w->lat.mul;
+		if (w->ops != NULL)
+			w->ops->mul++;
+	} else if ((q > 0) && ((q & (q - 1)) == 0)) {
+		p = t + w->lat.shift;
+		if (w->ops != NULL)
+			w->ops->shift++;
+	} else if (w->csd && (q > 0)) {
+		p = __walk_csd(w, q, t);
+	} else {
+		p = t + w->lat.mul + w->lat.shift;
+		if (w->ops != NULL) {
+			w->ops->mul++;
+			w->ops->shift++;
+		}
+	}
+	*out1 = fmax(p, in2) + w->lat.add;
+	*out2 = *out1 + w->lat.add;
+	if (w->ops != NULL)
+		w->ops->add += 3;
+}
+
+/* Arm from the section k0, v is the ready time of the input. With rec
+   set the input of each section is taken as ready long before, what is
+   left is the path through the states of the section. */
+static double __walk_arm(struct cost_walk * w, unsigned int k0, double v,
+						 bool rec)
+{
+	double s[LWDF_ORDER_MAX];
+	unsigned int k;
+	double x;
+
+	memcpy(s, w->st, sizeof(s));
+
+	for (k = k0; (k + 1) < w->N; k += 4) {
+		if (rec)
+			v = -INFINITY;
+		__walk_adaptor(w, k + 1, w->st[k], w->st[k + 1], &x, &s[k + 1]);
+		__walk_adaptor(w, k, v, x, &v, &s[k]);
+	}
+
+	for (k = k0; (k + 1) < w->N; k += 4) {
+		w->st[k] = s[k];
+		w->st[k + 1] = s[k + 1];
+	}
+
+	return v;
+}
+
+/* Ready time of the output (or of the latest state with rec) */
+static double __walk(struct cost_walk * w, bool rec)
+{
+	double o1;
+	double o2;
+	double y;
+	unsigned int k;
+
+	for (k = 0; k < w->N; ++k)
+		w->st[k] = 0;
+
+	__walk_adaptor(w, 0, rec ? -INFINITY : 0, w->st[0], &o2, &w->st[0]);
+	o2 = __walk_arm(w, 3, o2, rec);
+	o1 = __walk_arm(w, 1, 0, rec);
+
+	/* (o1 + o2) * 0.5 or >> 1 */
+	y = fmax(o1, o2) + w->lat.add;
+	y += (w->nbits == 0) ? w->lat.mul : w->lat.shift;
+	if (w->ops != NULL) {
+		w->ops->add++;
+		if (w->nbits == 0)
+			w->ops->mul++;
+		else
+			w->ops->shift++;
+	}
+
+	if (rec) {
+		y = 0;
+		for (k = 0; k < w->N; ++k)
+			y = fmax(y, w->st[k]);
+	}
+
+	return y;
+}
+
+void lwdf_cgen_ops(const struct lwdfwiz_param * wiz,
+				   const struct lwdf_info * inf, struct lwdf_ops * ops)
+{
+	bool id = wiz->bi && wiz->id;
+	unsigned int nst;
+	unsigned int N = inf->order;
+	unsigned int k;
+	struct cost_walk w = {
+		.gamma = inf->gamma,
+		.N = N,
+		.nbits = wiz->nbits,
+			.csd = (wiz->nbits != 0) && wiz->csd,
+		.lat = { 1, 1, 1 },
+		.ops = ops
+	};
+
+	memset(ops, 0, sizeof(struct lwdf_ops));
+	ops->depth = (unsigned int)__walk(&w, false);
+
+	nst = N;
+	if (id) {
+		for (nst = 0, k = 0; k < N; ++k)
+			nst += (inf->gamma[k] != 0.0) ? 1 : 0;
+	}
+	ops->state = nst * ((wiz->nbits == 0) && wiz->fp64 ? 8 : 4);
+	/* the decimator reads two samples */
+	ops->load = id ? 2 : 1;
+	ops->store = 1;
+	ops->nst = nst;
+}
+
+double lwdf_cgen_cycles(const struct lwdfwiz_param * wiz,
+						const struct lwdf_info * inf,
+						const struct lwdf_target * tgt)
+{
+	struct lwdf_ops ops;
+	unsigned int unroll = (wiz->unroll > 1) ? wiz->unroll : 1;
+	unsigned int spill;
+	double cyc;
+
+	lwdf_cgen_ops(wiz, inf, &ops);
+
+	/* states and about 3 temporaries live across the loop body */
+	spill = (ops.nst + 3 > tgt->regs) ? ops.nst + 3 - tgt->regs : 0;
+	ops.load += spill;
+	ops.store += spill;
+
+	if (tgt->issue == 0) {
+		cyc = ops.add * tgt->add + ops.mul * tgt->mul +
+			ops.shift * tgt->shift + ops.load * tgt->load +
+			ops.store * tgt->store;
+	} else {
+		struct cost_walk w = {
+			.gamma = inf->gamma,
+			.N = inf->order,
+			.nbits = wiz->nbits,
+			.csd = (wiz->nbits != 0) && wiz->csd,
+			.lat = { tgt->lat_add, tgt->lat_mul, tgt->lat_shift },
+			.ops = NULL
+		};
+		double rec = __walk(&w, true);
+
+		cyc = (double)(ops.add + ops.mul + ops.shift + ops.load +
+					   ops.store) / tgt->issue;
+		if (rec > cyc)
+			cyc = rec;
+	}
+
+	return cyc + tgt->loop / unroll;
+}
+
+int lwdf_cgen_report(FILE * f, const struct lwdfwiz_param * wiz,
+					 const struct lwdf_info * inf)
+{
+	struct lwdf_ops ops;
+	int i;
+
+	lwdf_cgen_ops(wiz, inf, &ops);
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"order\": %u,\n", inf->order);
+	fprintf(f, "  \"nbits\": %u,\n", wiz->nbits);
+	fprintf(f, "  \"kernel\": \"%s\",\n",
+			(wiz->bi && wiz->id) ? "decimate2" : "lp_filter");
+	fprintf(f, "  \"per_sample\": { \"add\": %u, \"mul\": %u, "
+			"\"shift\": %u, \"load\": %u, \"store\": %u },\n",
+			ops.add, ops.mul, ops.shift, ops.load, ops.store);
+	fprintf(f, "  \"critical_path\": %u,\n", ops.depth);
+	fprintf(f, "  \"state_bytes\": %u,\n", ops.state);
+	fprintf(f, "  \"cycles_per_sample\": {");
+	for (i = 0; lwdf_target_tab[i].name != NULL; ++i) {
+		fprintf(f, "%s \"%s\": %.1f", i ? "," : "", lwdf_target_tab[i].name,
+				lwdf_cgen_cycles(wiz, inf, &lwdf_target_tab[i]));
+	}
+	fprintf(f, " }\n");
+	fprintf(f, "}\n");
+
+	return 0;
+}
@@ -27,6 +27,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "lwdf.h"
 
 #define LWDF_NMAX (LWDF_ORDER_MAX) 
@@ -48,8 +50,97 @@ static double alpha(double g)
 	return a;
 }
 
-static void adaptor(int i, int t, double g, char *in1, char *in2,
-	     char *out1, char *out2, FILE * f, int nbits)
+/* CSD digits of x > 0, the most frequent digit pair factored out.
+   The sharing is scoped to one adaptor: each adaptor multiplies its own
+   difference t, so no two multipliers of the filter have an operand in
+   common and there is no subexpression to share between adaptors */
+void lwdf_csd_get(int x, struct lwdf_csd * csd)
+{
+	int8_t d[LWDF_CSD_MAX];
+	int best = 0;
+	int dist;
+	int s;
+	int n;
+	int k;
+
+	memset(csd, 0, sizeof(struct lwdf_csd));
+	for (k = 0; (x != 0) && (k < LWDF_CSD_MAX); k++) {
+		if (x & 1) {
+			csd->d[k] = 2 - (x & 3);
+			x -= csd->d[k];
+		}
+		x >>= 1;
+	}
+
+	/* most frequent digit pair (k, k + dist), the digits of a
+	   CSD number are never adjacent */
+	for (dist = 2; dist < LWDF_CSD_MAX; dist++) {
+		for (s = -1; s <= 1; s += 2) {
+			memcpy(d, csd->d, sizeof(d));
+			for (n = 0, k = 0; (k + dist) < LWDF_CSD_MAX; k++) {
+				if ((d[k] != 0) && (d[k + dist] == s * d[k])) {
+					d[k] = d[k + dist] = 0;
+					n++;
+				}
+			}
+			if (n > best) {
+				best = n;
+				csd->dist = dist;
+				csd->sign = s;
+			}
+		}
+	}
+
+	if (best < 2) {
+		csd->dist = 0;
+		csd->sign = 0;
+		return;
+	}
+
+	for (k = 0; (k + csd->dist) < LWDF_CSD_MAX; k++) {
+		if ((csd->d[k] != 0) &&
+			(csd->d[k + csd->dist] == csd->sign * csd->d[k])) {
+			csd->u[k] = csd->d[k];
+			csd->d[k] = csd->d[k + csd->dist] = 0;
+		}
+	}
+}
+
+/* Shift and add terms of aQ * t, the common subexpression in m0 */
+static void __csd_terms(FILE * f, int t, const struct lwdf_csd * csd)
+{
+	bool first = true;
+	int k;
+
+	for (k = LWDF_CSD_MAX - 1; k >= 0; k--) {
+		int8_t dig[2] = { csd->u[k], csd->d[k] };
+		int j;
+
+		for (j = 0; j < 2; j++) {
+			char v[8];
+
+			if (dig[j] == 0)
+				continue;
+			if (j == 0)
+				snprintf(v, sizeof(v), "m0");
+			else
+				snprintf(v, sizeof(v), "t%d", t);
+			if (first)
+				fprintf(f, "%s", (dig[j] < 0) ? "-" : "");
+			else
+				fprintf(f, " %c ", (dig[j] < 0) ? '-' : '+');
+			if (k == 0)
+				fprintf(f, "%s", v);
+			else
+				fprintf(f, "(%s<<%d)", v, k);
+			first = false;
+		}
+	}
+}
+
+static void adaptor(int i, int t, double g, const char *in1,
+		const char *in2, const char *out1, const char *out2, FILE * f,
+		int nbits, bool csd)
 {
 	char pm = '+';
 	int si = 0;
@@ -60,7 +151,7 @@ static void adaptor(int i, int t, double g, char *in1, char *in2,
 	double a;
 
 	fprintf(f, "\n");
-	fprintf(f, "\t/* g[%d] = %.8f; */\n ", i, g);
+	fprintf(f, "\t/* g[%d] = %.8f; */\n", i, g);
 	fprintf(f, "\t/* lwd_adaptor(g[%d], %s, %s, &%s, &%s); */\n", i, in1, in2, out1, out2);
 
 	if (g == 0.0) {
@@ -106,6 +197,20 @@ static void adaptor(int i, int t, double g, char *in1, char *in2,
 			else
 				fprintf(f, "\t%s = %7s(t%d>>%d) %c %s;\n", 
 						out2, "", t, b, pm, in2);
+		} else if (csd && (aQ > 0)) {
+			struct lwdf_csd c;
+
+			lwdf_csd_get(aQ, &c);
+			fprintf(f, "\t/* %d*t%d */\n", aQ, t);
+			if (c.dist)
+				fprintf(f, "\tm0 = t%d %c (t%d<<%d);\n", t,
+						(c.sign < 0) ? '-' : '+', t, c.dist);
+			if (so)
+				fprintf(f, "\t%s = ((", out1);
+			else
+				fprintf(f, "\t%s = ((", out2);
+			__csd_terms(f, t, &c);
+			fprintf(f, ")>>%d) %c %s;\n", nbits, pm, in2);
 		} else {
 			if (so)
 				fprintf(f, "\t%s = ((%d*t%d)>>%d) %c %s;\n", 
@@ -122,50 +227,97 @@ static void adaptor(int i, int t, double g, char *in1, char *in2,
 	return;
 }
 
-int lwdf_cgen(FILE * fout, const char * prefix,
-			  const struct lwdfwiz_param * wiz, 
-			  const struct lwdf_info * inf)
-{
-	char in1[16], in2[16], out1[16], out2[16];
-	const char *dtype;
-	int N, nbits;
-	int ftype;
-	double F;
+/* Names of the inputs, outputs and states in the emitted code */
+struct cgen_io {
+	const char * st; /* state, format of the index */
+	const char * i1;
+	const char * i2;
+	const char * o1;
+	const char * o2;
+};
+
+/* Output of the block functions */
+enum {
+	CGEN_LOWPASS = 0,
+	CGEN_HIGHPASS = 1,
+	CGEN_SPLITBAND = 2
+};
+
+/* Polyphase stages of the multistage rate changers, up to 16x */
+#define CGEN_STAGES_MAX 4
+
+/* Generator settings derived from wiz */
+struct cgen {
+	int N;
+	int nbits;
 	bool bi;
 	bool id;
 	int rx;
-	int i, j, k;
+	/* state index of the adaptors (decimation/interpolation) */
 	int rl[LWDF_NMAX];
+	/* number of states */
+	int nst;
+	/* block loop unrolling */
+	int unroll;
+	/* polyphase stages, rate change of 2^stages */
+	int stages;
+	/* double precision float code */
+	bool fp64;
+	/* shift and add multipliers */
+	bool csd;
+	/* a CSD multiplier has a common subexpression, m0 */
+	bool m0;
+};
 
-	N = wiz->order;
-	F = wiz->samplerate;
-	ftype = wiz->ftype;
+static void __cgen_init(struct cgen * cg, const struct lwdfwiz_param * wiz,
+						const struct lwdf_info * inf)
+{
+	int i;
 
+	cg->N = wiz->order;
 	/* bireciprocal filter (0=no 1=yes)? */
-	bi = wiz->bi;
+	cg->bi = wiz->bi;
 	/* bireciprocal for decimation/interpolation (0=no, 1=yes)? */
-	id = wiz->id;
-	if (bi) {
-		/* bireciprocal for decimation/interpolation (0=no, 1=yes)? */
-		id = wiz->id;
-	} else {
-		id = false;
-	}
+	cg->id = cg->bi ? wiz->id : false;
 	/* bits (not including sign bit, 0=no quantization)? */
-	nbits = wiz->nbits;
+	cg->nbits = wiz->nbits;
 	/* reuse and minimize temporary variables (0=no, 1=yes)?  */
-	rx = wiz->rx ? 1 : 0;
+	cg->rx = wiz->rx ? 1 : 0;
+	/* samples per iteration of the block loops */
+	cg->unroll = (wiz->unroll > 1) ? wiz->unroll : 1;
+	cg->stages = (wiz->stages > 1) ? wiz->stages : 1;
+	cg->fp64 = (wiz->nbits == 0) && wiz->fp64;
+	cg->csd = (wiz->nbits != 0) && wiz->csd;
 
-	if (nbits == 0)
-		dtype = "float";
-	else
-		dtype = "int";
+	cg->m0 = false;
+	for (i = 0; cg->csd && (i < cg->N); i++) {
+		struct lwdf_csd c;
+
+		lwdf_csd_get((int)(alpha(inf->gamma[i]) * (1 << cg->nbits)), &c);
+		if (c.dist)
+			cg->m0 = true;
+	}
+
+	cg->nst = 0;
+	for (i = 0; i < cg->N; i++) {
+		if (inf->gamma[i] != 0.0)
+			cg->rl[i] = cg->nst++;
+	}
+	if (!cg->id)
+		cg->nst = cg->N;
+}
+
+static void __cgen_head(FILE * fout, const struct lwdfwiz_param * wiz,
+						const struct cgen * cg)
+{
+	double F = wiz->samplerate;
+	int N = cg->N;
 
 	fprintf(fout, "/* -----------------------------------------------------\n");
 	fprintf(fout, " * This file was automatically generated, do not edit!\n");
 	fprintf(fout, " *\n");
 
-	switch (ftype) {
+	switch (wiz->ftype) {
 	case LWDF_BUTTW:
 		fprintf(fout, " * Buttworth order %d\n", N);
 		break;
@@ -177,9 +329,9 @@ int lwdf_cgen(FILE * fout, const char * prefix,
 		break;
 	}
 
-	if (bi) {
+	if (cg->bi) {
 		fprintf(fout, " * - bireciprocal");
-		if (id)
+		if (cg->id)
 			fprintf(fout, ", for interpolation/decimation");
 		fprintf(fout, "\n");
 	}
@@ -194,25 +346,43 @@ int lwdf_cgen(FILE * fout, const char * prefix,
 	fprintf(fout, " * -----------------------------------------------------\n");
 	fprintf(fout, " */\n");
 	fprintf(fout, "\n");
+}
 
-	fprintf(fout, "void filter(%s st[], %s i1, %s i2, %s *o1, %s *o2)\n", 
-			dtype, dtype, dtype, dtype, dtype);
-	fprintf(fout, "{\n");
+/* Static cost summary, lwdf_cgen_report() has the details */
+static void __cgen_cost(FILE * fout, const struct lwdfwiz_param * wiz,
+						const struct lwdf_info * inf)
+{
+	struct lwdf_ops ops;
+	int i;
 
-	k = 0;
-	for (i = 0; i < N; i++) {
-		double a;
+	lwdf_cgen_ops(wiz, inf, &ops);
 
-		if (inf->gamma[i] != 0.0) {
-			a = alpha(inf->gamma[i]);
-			fprintf(fout, "\tconst float a%d = ", i);
-			fprintf(fout, "%12.9f\n", a);
-			rl[i] = k++;
-		}
+	fprintf(fout, "/* %s per sample: %u add, %u mul, %u shift, "
+			"%u load, %u store\n",
+			(wiz->bi && wiz->id) ? "decimate2()" : "lp_filter()",
+			ops.add, ops.mul, ops.shift, ops.load, ops.store);
+	fprintf(fout, "   critical path %u, state %u bytes\n   cycles:",
+			ops.depth, ops.state);
+	for (i = 0; lwdf_target_tab[i].name != NULL; ++i) {
+		fprintf(fout, "%s %s %.1f", i ? "," : "", lwdf_target_tab[i].name,
+				lwdf_cgen_cycles(wiz, inf, &lwdf_target_tab[i]));
 	}
-	fprintf(fout, "\n");
+	fprintf(fout, " */\n\n");
+}
+
+/* Declarations of the temporary variables */
+static void __cgen_temps(FILE * fout, const char * dtype,
+						 const struct lwdf_info * inf, const struct cgen * cg)
+{
+	int N = cg->N;
+	bool id = cg->id;
+	char sep;
+	int i;
 
-	if (wiz->rx) {
+	if (cg->m0)
+		fprintf(fout, "\t%s m0;\n", dtype);
+
+	if (cg->rx) {
 		if ((!id) || (N > 1))
 			fprintf(fout, "\t%s t0", dtype);
 		if (id) {
@@ -226,109 +396,117 @@ int lwdf_cgen(FILE * fout, const char * prefix,
 		}
 		if ((!id) || (N > 1))
 			fprintf(fout, ";\n");
-	} else {
-		char sep;
-		if ((!id) || (N > 1))
+		return;
+	}
+
+	if ((!id) || (N > 1))
+		fprintf(fout, "\t%s", dtype);
+	sep = ' ';
+	for (i = 0; i < N; i++)
+		if (inf->gamma[i] != 0.0) {
+			fprintf(fout, "%ct%d", sep, i);
+			sep = ',';
+		}
+	if ((!id) || (N > 1))
+		fprintf(fout, ";\n");
+	if (!id) {
+		if (N > 1) {
 			fprintf(fout, "\t%s", dtype);
-		sep = ' ';
-		for (i = 0; i < N; i++)
-			if (inf->gamma[i] != 0.0) {
-				fprintf(fout, "%ct%d", sep, i);
-				sep = ',';
-			}
-		if ((!id) || (N > 1))
+			sep = ' ';
+		}
+		for (i = 0; i <= (N - 5); i++) {
+			fprintf(fout, "%cx%d", sep, i);
+			sep = ',';
+		}
+		if ((N - 3) > 0) {
+			fprintf(fout, "%cx%d", sep, N - 3);
+			sep = ',';
+		}
+		if ((N - 1) > 0) {
+			fprintf(fout, "%cx%d", sep, N - 1);
+			sep = ',';
+		}
+		if (N > 1)
 			fprintf(fout, ";\n");
-		if (!id) {
-			if (N > 1) {
-				fprintf(fout, "\t%s", dtype);
-				sep = ' ';
-			}
-			for (i = 0; i <= (N - 5); i++) {
-				fprintf(fout, "%cx%d", sep, i);
-				sep = ',';
-			}
-			if ((N - 3) > 0) {
-				fprintf(fout, "%cx%d", sep, N - 3);
-				sep = ',';
-			}
-			if ((N - 1) > 0) {
-				fprintf(fout, "%cx%d", sep, N - 1);
-				sep = ',';
-			}
-			if (N > 1)
-				fprintf(fout, ";\n");
-		} else {
-			if (N > 5) {
-				fprintf(fout, "\t%s", dtype);
-				sep = ' ';
-			}
-			for (i = 1; i <= (N - 5); i += 2) {
-				fprintf(fout, "%cx%d", sep, i);
-				sep = ',';
-			}
-			if (N > 5)
-				fprintf(fout, ";\n");
+	} else {
+		/* the arm outputs but the last one of each arm */
+		if (N > 5) {
+			fprintf(fout, "\t%s", dtype);
+			sep = ' ';
 		}
+		for (i = 1; i <= (N - 5); i += 2) {
+			fprintf(fout, "%cx%d", sep, cg->rl[i]);
+			sep = ',';
+		}
+		if (N > 5)
+			fprintf(fout, ";\n");
 	}
+}
 
-	if (id)
-		fprintf(fout, "\t/* interpolator input: i1=i2=sample(n) */\n "
-			"\t/* decimator input: i1=sample(n), i2=sample(n+1) */\n");
-	else
-		fprintf(fout, "\t/* filter input: i1=i2=sample(n) */\n");
+/* The adaptors of the upper and lower arms */
+static void __cgen_arms(FILE * fout, const struct cgen_io * io,
+						const struct lwdf_info * inf, const struct cgen * cg)
+{
+	char in1[16], in2[16], out1[16], out2[16];
+	int N = cg->N;
+	int nbits = cg->nbits;
+	bool id = cg->id;
+	int rx = cg->rx;
+	int i, j, k;
 
 	fprintf(fout, "\n\t/* Upper arm ------------ */\n");
 	if (id && (N <= 3))
-		fprintf(fout, "\t*o2 = i1;\n");
+		fprintf(fout, "\t%s = %s;\n", io->o2, io->i1);
 
 	j = 0;
 	if (!id) {
+		sprintf(in2, io->st, 0);
 		if (N <= 3) {
-			adaptor(0, 0, inf->gamma[0], "i2", "st[0]", "*o2", "st[0]",
-				fout, nbits);
+			adaptor(0, 0, inf->gamma[0], io->i2, in2,
+				io->o2, in2, fout, nbits, cg->csd);
 		} else {
 			j = rx;
-			adaptor(0, 0, inf->gamma[0], "i2", "st[0]",
-				rx ? "x1" : "x0", "st[0]", fout, nbits);
+			adaptor(0, 0, inf->gamma[0], io->i2, in2,
+				rx ? "x1" : "x0", in2, fout, nbits, cg->csd);
 		};
 	}
 
 	for (i = 3; i < N; i += 4) {
 		if (!id) {
-			sprintf(in1, "st[%d]", i);
-			sprintf(in2, "st[%d]", i + 1);
+			sprintf(in1, io->st, i);
+			sprintf(in2, io->st, i + 1);
 			sprintf(out1, "x%d", rx ? (i + 1) % 2 : i + 1);
-			sprintf(out2, "st[%d]", i + 1);
+			sprintf(out2, io->st, i + 1);
 
 			adaptor(i + 1, rx ? 0 : i + 1, inf->gamma[i + 1], in1, in2,
-				out1, out2, fout, nbits);
+				out1, out2, fout, nbits, cg->csd);
 
 			sprintf(in1, "x%d", rx ? j % 2 : j);
 			sprintf(in2, "x%d", rx ? (i + 1) % 2 : i + 1);
 			if ((i + 4) >= N)
-				sprintf(out1, "*o2");
+				sprintf(out1, "%s", io->o2);
 			else
 				sprintf(out1, "x%d", rx ? i % 2 : i);
-			sprintf(out2, "st[%d]", i);
+			sprintf(out2, io->st, i);
 
 			adaptor(i, rx ? 0 : i, inf->gamma[i], in1, in2, out1, out2,
-				fout, nbits);
+				fout, nbits, cg->csd);
 		} else {
-			k = rl[i];
+			k = cg->rl[i];
 
 			if (i == 3)
-				sprintf(in1, "i1 ");
+				sprintf(in1, "%s", io->i1);
 			else
-				sprintf(in1, "x%d", rx ? 0 : j);
-			sprintf(in2, "st[%d]", k);
+				sprintf(in1, "x%d", rx ? 0 : cg->rl[j]);
+			sprintf(in2, io->st, k);
 			if ((i + 4) >= N)
-				sprintf(out1, "*o2");
+				sprintf(out1, "%s", io->o2);
 			else
 				sprintf(out1, "x%d", rx ? 0 : k);
-			sprintf(out2, "st[%d]", k);
+			sprintf(out2, io->st, k);
 
 			adaptor(i, rx ? 0 : i, inf->gamma[i], in1, in2, out1, out2,
-				fout, nbits);
+				fout, nbits, cg->csd);
 		}
 		j = i;
 	}
@@ -337,81 +515,586 @@ int lwdf_cgen(FILE * fout, const char * prefix,
 	if (N == 1) {
 		fprintf(fout, "\n");
 		if (!id)
-			fprintf(fout, "\t*o1 = i1;\n");
+			fprintf(fout, "\t%s = %s;\n", io->o1, io->i1);
 		else
-			fprintf(fout, "\t*o1 = i2;\n");
+			fprintf(fout, "\t%s = %s;\n", io->o1, io->i2);
 	}
 	for (i = 1; i < N; i += 4) {
 		if (!id) {
-			sprintf(in1, "st[%d]", i);
-			sprintf(in2, "st[%d]", i + 1);
+			sprintf(in1, io->st, i);
+			sprintf(in2, io->st, i + 1);
 			sprintf(out1, "x%d", rx ? (i + 1) % 2 : i + 1);
-			sprintf(out2, "st[%d]", i + 1);
+			sprintf(out2, io->st, i + 1);
 			
 			adaptor(i + 1, rx ? 0 : i + 1, inf->gamma[i + 1], in1, in2,
-				out1, out2, fout, nbits);
+				out1, out2, fout, nbits, cg->csd);
 
 			if (i == 1)
-				sprintf(in1, "i1");
+				sprintf(in1, "%s", io->i1);
 			else
 				sprintf(in1, "x%d", rx ? j % 2 : j);
 			sprintf(in2, "x%d", rx ? (i + 1) % 2 : i + 1);
 			if ((i + 4) >= N)
-				sprintf(out1, "*o1");
+				sprintf(out1, "%s", io->o1);
 			else
 				sprintf(out1, "x%d", rx ? i % 2 : i);
-			sprintf(out2, "st[%d]", i);
+			sprintf(out2, io->st, i);
 
 			adaptor(i, rx ? 0 : i, inf->gamma[i], in1, in2, out1, out2,
-				fout, nbits);
+				fout, nbits, cg->csd);
 		} else {
-			k = rl[i];
+			k = cg->rl[i];
 
 			if (i == 1)
-				sprintf(in1, "i2");
+				sprintf(in1, "%s", io->i2);
 			else
-				sprintf(in1, "x%d", rx ? 0 : j);
-			sprintf(in2, "st[%d]", k);
+				sprintf(in1, "x%d", rx ? 0 : cg->rl[j]);
+			sprintf(in2, io->st, k);
 			if ((i + 4) >= N)
-				sprintf(out1, "*o1");
+				sprintf(out1, "%s", io->o1);
 			else
 				sprintf(out1, "x%d", rx ? 0 : k);
-			sprintf(out2, "st[%d]", k);
+			sprintf(out2, io->st, k);
 
 			adaptor(i, rx ? 0 : i, inf->gamma[i], in1, in2, out1, out2,
-				fout, nbits);
+				fout, nbits, cg->csd);
 		}
 		j = i;
 	}
-	if (id)
-		fprintf(fout,
-			"\n"
-			"\t/* decimator output: sample(n)=(o1+/-o2)>>1 for lowpass/highpass */\n"
-			"\t/* interpolator output: sample(n)=o1, sample(n+1)=+/-o2 for lowpass/highpass */\n");
+}
+
+/* Coefficients of the float code */
+static void __cgen_consts(FILE * fout, const struct lwdf_info * inf,
+						  const struct cgen * cg)
+{
+	int i;
+
+	if (cg->nbits != 0)
+		return;
+
+	for (i = 0; i < cg->N; i++) {
+		if (inf->gamma[i] == 0.0)
+			continue;
+		if (cg->fp64)
+			fprintf(fout, "\tconst double a%d = %.17g;\n", i,
+					alpha(inf->gamma[i]));
+		else
+			fprintf(fout, "\tconst float a%d = %12.9f;\n", i,
+					alpha(inf->gamma[i]));
+	}
+	fprintf(fout, "\n");
+}
+
+/* The arms inside a loop body, one more level of indentation */
+static int __cgen_loop_arms(FILE * fout, const struct cgen_io * io,
+							const struct lwdf_info * inf,
+							const struct cgen * cg)
+{
+	char * buf;
+	size_t size;
+	FILE * f;
+	char * cp;
+	char * nl;
+
+	/* the arms are written at function level, shift them into the loop */
+	if ((f = open_memstream(&buf, &size)) == NULL) {
+		fprintf(stderr, "%s: open_memstream() failed.\n", __func__);
+		return -1;
+	}
+	__cgen_arms(f, io, inf, cg);
+	fprintf(f, "\n");
+	fclose(f);
+
+	for (cp = buf; (nl = strchr(cp, '\n')) != NULL; cp = nl + 1) {
+		*nl = '\0';
+		fprintf(fout, (*cp == '\0') ? "\n" : "\t%s\n", cp);
+	}
+	free(buf);
+
+	return 0;
+}
+
+/* One sample of a block function, inside the loop */
+static int __cgen_step(FILE * fout, int out, const char * idx,
+					   const struct lwdf_info * inf, const struct cgen * cg)
+{
+	struct cgen_io io = { "s%d", NULL, NULL, "o1", "o2" };
+	const char * sum = (cg->nbits == 0) ? "\t\t%s[%s] = (%s) * 0.5f;\n" :
+		"\t\t%s[%s] = (%s) >> 1;\n";
+	char xi[32];
+
+	snprintf(xi, sizeof(xi), "x[%s]", idx);
+	io.i1 = xi;
+	io.i2 = xi;
+
+	if (__cgen_loop_arms(fout, &io, inf, cg) < 0)
+		return -1;
+
+	if (out == CGEN_LOWPASS)
+		fprintf(fout, sum, "y", idx, "o1 + o2");
+	else if (out == CGEN_HIGHPASS)
+		fprintf(fout, sum, "y", idx, "o2 - o1");
+	else {
+		fprintf(fout, sum, "ylp", idx, "o1 + o2");
+		fprintf(fout, sum, "yhp", idx, "o2 - o1");
+	}
+
+	return 0;
+}
+
+/*
+ * Block function: the state is loaded into locals, the whole block is
+ * filtered and the state is stored back at the end. The loop body is
+ * repeated 'unroll' times, the remainder goes one sample at a time.
+ */
+static int __cgen_block(FILE * fout, const char * prefix, int out,
+						const char * dtype, const struct lwdf_info * inf,
+						const struct cgen * cg)
+{
+	static const char * const name[] = { "lp_filter", "hp_filter",
+		"splitband" };
+	int U = cg->unroll;
+	char idx[16];
+	int u;
+	int k;
+
+	if (out == CGEN_SPLITBAND)
+		fprintf(fout, "void %s%s(%s st[], %s ylp[], %s yhp[], "
+				"const %s x[], unsigned int len)\n",
+				prefix, name[out], dtype, dtype, dtype, dtype);
 	else
-		fprintf(fout,
-			"\n"
-			"\t/* filter output: \n"
-			"\t     sample(n)=(o1+/-o2)>>1 for lowpass/highpass */\n");
+		fprintf(fout, "void %s%s(%s st[], %s y[], const %s x[], "
+				"unsigned int len)\n", prefix, name[out], dtype, dtype, dtype);
+	fprintf(fout, "{\n");
+
+	__cgen_consts(fout, inf, cg);
+	for (k = 0; k < cg->nst; ++k)
+		fprintf(fout, "\t%s s%d = st[%d];\n", dtype, k, k);
+	fprintf(fout, "\t%s o1, o2;\n", dtype);
+	__cgen_temps(fout, dtype, inf, cg);
+	fprintf(fout, "\tunsigned int i;\n");
+	fprintf(fout, "\n");
+
+	if (U > 1) {
+		fprintf(fout, "\tfor (i = 0; i + %d <= len; i += %d) {\n", U, U);
+		for (u = 0; u < U; ++u) {
+			if (u == 0)
+				snprintf(idx, sizeof(idx), "i");
+			else
+				snprintf(idx, sizeof(idx), "i + %d", u);
+			if (__cgen_step(fout, out, idx, inf, cg) < 0)
+				return -1;
+		}
+		fprintf(fout, "\t}\n");
+		fprintf(fout, "\tfor (; i < len; ++i) {\n");
+	} else {
+		fprintf(fout, "\tfor (i = 0; i < len; ++i) {\n");
+	}
+	if (__cgen_step(fout, out, "i", inf, cg) < 0)
+		return -1;
+	fprintf(fout, "\t}\n");
+	fprintf(fout, "\n");
+
+	for (k = 0; k < cg->nst; ++k)
+		fprintf(fout, "\tst[%d] = s%d;\n", k, k);
 	fprintf(fout, "}\n\n");
-	
-	fprintf(fout, "void hp_filter(%s st[], %s y[], %s x[], unsigned int len)\n", 
-			dtype, dtype, dtype);
+
+	return 0;
+}
+
+/* Locals of the polyphase state, one set per stage */
+static void __cgen_st_name(char * fmt, size_t max, int j, int stages)
+{
+	if (stages > 1)
+		snprintf(fmt, max, "s%d_%%d", j);
+	else
+		snprintf(fmt, max, "s%%d");
+}
+
+static void __cgen_st_load(FILE * fout, const char * dtype, int stages,
+						   const struct cgen * cg)
+{
+	char fmt[16];
+	char name[16];
+	int j;
+	int k;
+
+	for (j = 0; j < stages; ++j) {
+		__cgen_st_name(fmt, sizeof(fmt), j, stages);
+		for (k = 0; k < cg->nst; ++k) {
+			snprintf(name, sizeof(name), fmt, k);
+			fprintf(fout, "\t%s %s = st[%d];\n", dtype, name, j * cg->nst + k);
+		}
+	}
+}
+
+static void __cgen_st_store(FILE * fout, int stages, const struct cgen * cg)
+{
+	char fmt[16];
+	char name[16];
+	int j;
+	int k;
+
+	for (j = 0; j < stages; ++j) {
+		__cgen_st_name(fmt, sizeof(fmt), j, stages);
+		for (k = 0; k < cg->nst; ++k) {
+			snprintf(name, sizeof(name), fmt, k);
+			fprintf(fout, "\tst[%d] = %s;\n", j * cg->nst + k, name);
+		}
+	}
+}
+
+/*
+ * Decimator stage j, the output goes to 'out'. The first stage takes
+ * the input pair x[n + off], x[n + off + 1], the other ones the outputs
+ * of two runs of the stage before.
+ */
+static int __cgen_decim_stage(FILE * fout, int j, int stages, int off,
+							  const char * out, const struct lwdf_info * inf,
+							  const struct cgen * cg)
+{
+	struct cgen_io io = { NULL, NULL, NULL, "o1", "o2" };
+	char fmt[16];
+	char i1[32];
+	char i2[32];
+
+	if (j == 0) {
+		if (off == 0)
+			snprintf(i1, sizeof(i1), "x[n]");
+		else
+			snprintf(i1, sizeof(i1), "x[n + %d]", off);
+		snprintf(i2, sizeof(i2), "x[n + %d]", off + 1);
+	} else {
+		snprintf(i1, sizeof(i1), "p%d", j);
+		snprintf(i2, sizeof(i2), "d%d", j - 1);
+		if (__cgen_decim_stage(fout, j - 1, stages, off, i1, inf, cg) < 0)
+			return -1;
+		if (__cgen_decim_stage(fout, j - 1, stages, off + (1 << j), i2,
+							   inf, cg) < 0)
+			return -1;
+	}
+
+	__cgen_st_name(fmt, sizeof(fmt), j, stages);
+	io.st = fmt;
+	io.i1 = i1;
+	io.i2 = i2;
+	if (__cgen_loop_arms(fout, &io, inf, cg) < 0)
+		return -1;
+
+	if (cg->nbits == 0)
+		fprintf(fout, "\t\t%s = (o1 + o2) * 0.5f;\n", out);
+	else
+		fprintf(fout, "\t\t%s = (o1 + o2) >> 1;\n", out);
+
+	return 0;
+}
+
+/* Interpolator stage j, takes 'in' and writes 2^(stages - j) outputs */
+static int __cgen_interp_stage(FILE * fout, int j, int stages, int off,
+							   const char * in, const struct lwdf_info * inf,
+							   const struct cgen * cg)
+{
+	struct cgen_io io = { NULL, NULL, NULL, "o1", "o2" };
+	char fmt[16];
+	char u[16];
+	char v[16];
+
+	__cgen_st_name(fmt, sizeof(fmt), j, stages);
+	io.st = fmt;
+	io.i1 = in;
+	io.i2 = in;
+	if (__cgen_loop_arms(fout, &io, inf, cg) < 0)
+		return -1;
+
+	if (j == stages - 1) {
+		if (off == 0)
+			fprintf(fout, "\t\ty[m] = o1;\n");
+		else
+			fprintf(fout, "\t\ty[m + %d] = o1;\n", off);
+		fprintf(fout, "\t\ty[m + %d] = o2;\n", off + 1);
+		return 0;
+	}
+
+	/* the next stages overwrite o1 and o2 */
+	snprintf(u, sizeof(u), "u%d", j);
+	snprintf(v, sizeof(v), "v%d", j);
+	fprintf(fout, "\t\t%s = o1;\n", u);
+	fprintf(fout, "\t\t%s = o2;\n", v);
+	if (__cgen_interp_stage(fout, j + 1, stages, off, u, inf, cg) < 0)
+		return -1;
+	return __cgen_interp_stage(fout, j + 1, stages,
+							   off + (1 << (stages - j - 1)), v, inf, cg);
+}
+
+/*
+ * Polyphase decimator, lowpass and downsampling by M = 2^stages:
+ * len output samples from M * len input samples. The stages share the
+ * halfband coefficients, each one has nst states in st[].
+ */
+static int __cgen_decim(FILE * fout, const char * prefix, int stages,
+						const char * dtype, const struct lwdf_info * inf,
+						const struct cgen * cg)
+{
+	int M = 1 << stages;
+	int j;
+
+	fprintf(fout, "/* %dx decimator: y[i] from x[%d*i] .. x[%d*i + %d], "
+			"%d states */\n", M, M, M, M - 1, stages * cg->nst);
+	fprintf(fout, "void %sdecimate%d(%s st[], %s y[], const %s x[], "
+			"unsigned int len)\n", prefix, M, dtype, dtype, dtype);
 	fprintf(fout, "{\n");
-	
+
+	__cgen_consts(fout, inf, cg);
+	__cgen_st_load(fout, dtype, stages, cg);
+	fprintf(fout, "\t%s o1, o2;\n", dtype);
+	for (j = 1; j < stages; ++j)
+		fprintf(fout, "\t%s p%d, d%d;\n", dtype, j, j - 1);
+	__cgen_temps(fout, dtype, inf, cg);
+	fprintf(fout, "\tunsigned int i, n;\n");
+	fprintf(fout, "\n");
+
+	fprintf(fout, "\tfor (i = 0, n = 0; i < len; ++i, n += %d) {\n", M);
+	if (__cgen_decim_stage(fout, stages - 1, stages, 0, "y[i]",
+						   inf, cg) < 0)
+		return -1;
+	fprintf(fout, "\t}\n");
+	fprintf(fout, "\n");
+
+	__cgen_st_store(fout, stages, cg);
 	fprintf(fout, "}\n\n");
 
-	fprintf(fout, "void lp_filter(%s st[], %s y[], %s x[], unsigned int len)\n", 
-			dtype, dtype, dtype);
+	return 0;
+}
+
+/*
+ * Polyphase interpolator, upsampling by M = 2^stages and lowpass:
+ * M * len output samples from len input samples, unity passband gain.
+ */
+static int __cgen_interp(FILE * fout, const char * prefix, int stages,
+						 const char * dtype, const struct lwdf_info * inf,
+						 const struct cgen * cg)
+{
+	int M = 1 << stages;
+	int j;
+
+	fprintf(fout, "/* %dx interpolator: y[%d*i] .. y[%d*i + %d] from x[i], "
+			"%d states */\n", M, M, M, M - 1, stages * cg->nst);
+	fprintf(fout, "void %sinterpolate%d(%s st[], %s y[], const %s x[], "
+			"unsigned int len)\n", prefix, M, dtype, dtype, dtype);
 	fprintf(fout, "{\n");
-	fprintf(fout, "\tint i;\n");
+
+	__cgen_consts(fout, inf, cg);
+	__cgen_st_load(fout, dtype, stages, cg);
 	fprintf(fout, "\t%s o1, o2;\n", dtype);
+	for (j = 0; j < stages - 1; ++j)
+		fprintf(fout, "\t%s u%d, v%d;\n", dtype, j, j);
+	__cgen_temps(fout, dtype, inf, cg);
+	fprintf(fout, "\tunsigned int i, m;\n");
 	fprintf(fout, "\n");
-	fprintf(fout, "\tfor (i = 0; i < len; ++i) {\n");
-	fprintf(fout, "\t\tfilter(st, x[i], x[i], &o1, &o2)\n");
-	fprintf(fout, "\t\ty[i] = o1 + o2;\n");
+
+	fprintf(fout, "\tfor (i = 0, m = 0; i < len; ++i, m += %d) {\n", M);
+	if (__cgen_interp_stage(fout, 0, stages, 0, "x[i]", inf, cg) < 0)
+		return -1;
 	fprintf(fout, "\t}\n");
+	fprintf(fout, "\n");
+
+	__cgen_st_store(fout, stages, cg);
 	fprintf(fout, "}\n\n");
 
 	return 0;
 }
+
+/*
+ * Multi-channel kernel with the GCC/Clang vector extensions. One vector
+ * holds the same state of vlen channels, the channel blocks are filtered
+ * one after the other. The frames are interleaved, x[n][c] is the
+ * sample n of channel c, and the state is st[k][c].
+ */
+static int __cgen_vec(FILE * fout, const char * prefix,
+					  const struct lwdfwiz_param * wiz,
+					  const struct lwdf_info * inf, const struct cgen * cg)
+{
+	const struct cgen_io io = { "s[%d]", "*i1", "*i2", "*o1", "*o2" };
+	unsigned int nchan = wiz->nchan;
+	unsigned int vlen = wiz->vlen;
+	const char * dtype;
+	char vtype[64];
+	unsigned int l;
+	int i;
+
+	if (vlen == 0)
+		vlen = ((nchan % 8) == 0) ? 8 : 4;
+
+	if ((vlen & (vlen - 1)) || (vlen < 2) || (vlen > 16) ||
+		(nchan % vlen)) {
+		fprintf(stderr, "%s: %d channels in vectors of %d.\n",
+				__func__, nchan, vlen);
+		return -1;
+	}
+
+	if (cg->nbits != 0)
+		dtype = "int";
+	else
+		dtype = cg->fp64 ? "double" : "float";
+	snprintf(vtype, sizeof(vtype), "%svec_t", prefix);
+
+	__cgen_head(fout, wiz, cg);
+
+	fprintf(fout, "#include <string.h>\n\n");
+	fprintf(fout, "/* %d channels, vectors of %d */\n", nchan, vlen);
+	fprintf(fout, "typedef %s %s __attribute__((vector_size(%d)));\n\n",
+			dtype, vtype, (int)(vlen * (cg->fp64 ? 8 : 4)));
+
+	fprintf(fout, "static inline void %svfilter(%s s[], const %s *i1,"
+			" const %s *i2, %s *o1, %s *o2)\n",
+			prefix, vtype, vtype, vtype, vtype, vtype);
+	fprintf(fout, "{\n");
+
+	if (cg->nbits == 0) {
+		for (i = 0; i < cg->N; i++) {
+			double a;
+
+			if (inf->gamma[i] == 0.0)
+				continue;
+
+			a = alpha(inf->gamma[i]);
+			fprintf(fout, "\tconst %s a%d = {", vtype, i);
+			for (l = 0; l < vlen; ++l)
+				fprintf(fout, cg->fp64 ? "%s%.17g" : "%s%.9f", (l % 4) ? ", " :
+						(l ? ",\n\t\t" : "\n\t\t"), a);
+			fprintf(fout, "\n\t};\n");
+		}
+		fprintf(fout, "\n");
+	}
+
+	__cgen_temps(fout, vtype, inf, cg);
+	__cgen_arms(fout, &io, inf, cg);
+	fprintf(fout, "}\n\n");
+
+	if (cg->id) {
+		/* the polyphase input and output depend on the rate change */
+		fprintf(fout, "/* decimator input: i1=sample(n), i2=sample(n+1),"
+				" output: (o1+/-o2)/2\n"
+				"   interpolator input: i1=i2=sample(n), output:"
+				" sample(n)=o1, sample(n+1)=+/-o2 */\n");
+		return 0;
+	}
+
+	for (l = 0; l < 2; ++l) {
+		const char * name = (l == 0) ? "lowpass" : "highpass";
+		const char * op = (l == 0) ? "o1 + o2" : "o2 - o1";
+
+		fprintf(fout, "void %sv%s(%s st[][%d], %s y[][%d], "
+				"const %s x[][%d], unsigned int len)\n",
+				prefix, name, dtype, nchan, dtype, nchan, dtype, nchan);
+		fprintf(fout, "{\n");
+		fprintf(fout, "\t%s s[%d];\n", vtype, cg->nst);
+		fprintf(fout, "\t%s i1, o1, o2, yv;\n", vtype);
+		fprintf(fout, "\tunsigned int c, i, k;\n");
+		fprintf(fout, "\n");
+		fprintf(fout, "\tfor (c = 0; c < %d; c += %d) {\n", nchan, vlen);
+		fprintf(fout, "\t\tfor (k = 0; k < %d; ++k)\n", cg->nst);
+		fprintf(fout, "\t\t\tmemcpy(&s[k], &st[k][c], sizeof(%s));\n", vtype);
+		fprintf(fout, "\t\tfor (i = 0; i < len; ++i) {\n");
+		fprintf(fout, "\t\t\tmemcpy(&i1, &x[i][c], sizeof(%s));\n", vtype);
+		fprintf(fout, "\t\t\t%svfilter(s, &i1, &i1, &o1, &o2);\n", prefix);
+		if (cg->nbits == 0)
+			fprintf(fout, "\t\t\tyv = (%s) * 0.5f;\n", op);
+		else
+			fprintf(fout, "\t\t\tyv = (%s) >> 1;\n", op);
+		fprintf(fout, "\t\t\tmemcpy(&y[i][c], &yv, sizeof(%s));\n", vtype);
+		fprintf(fout, "\t\t}\n");
+		fprintf(fout, "\t\tfor (k = 0; k < %d; ++k)\n", cg->nst);
+		fprintf(fout, "\t\t\tmemcpy(&st[k][c], &s[k], sizeof(%s));\n", vtype);
+		fprintf(fout, "\t}\n");
+		fprintf(fout, "}\n\n");
+	}
+
+	return 0;
+}
+
+int lwdf_cgen(FILE * fout, const char * prefix,
+			  const struct lwdfwiz_param * wiz, 
+			  const struct lwdf_info * inf)
+{
+	const struct cgen_io io = { "st[%d]", "i1", "i2", "*o1", "*o2" };
+	struct cgen cg;
+	const char *dtype;
+	int i;
+
+	__cgen_init(&cg, wiz, inf);
+
+	if (wiz->unroll > 16) {
+		fprintf(stderr, "%s: unroll %d, maximum is 16.\n",
+				__func__, wiz->unroll);
+		return -1;
+	}
+
+	if (wiz->stages > CGEN_STAGES_MAX) {
+		fprintf(stderr, "%s: %d stages, maximum is %d.\n",
+				__func__, wiz->stages, CGEN_STAGES_MAX);
+		return -1;
+	}
+
+	if (wiz->nchan > 0)
+		return __cgen_vec(fout, prefix, wiz, inf, &cg);
+
+	if (cg.nbits != 0)
+		dtype = "int";
+	else
+		dtype = cg.fp64 ? "double" : "float";
+
+	__cgen_head(fout, wiz, &cg);
+	__cgen_cost(fout, wiz, inf);
+
+	fprintf(fout, "void %sfilter(%s st[], %s i1, %s i2, %s *o1, %s *o2)\n",
+			prefix, dtype, dtype, dtype, dtype, dtype);
+	fprintf(fout, "{\n");
+
+	__cgen_consts(fout, inf, &cg);
+	__cgen_temps(fout, dtype, inf, &cg);
+
+	if (cg.id)
+		fprintf(fout, "\t/* interpolator input: i1=i2=sample(n) */\n"
+			"\t/* decimator input: i1=sample(n), i2=sample(n+1) */\n");
+	else
+		fprintf(fout, "\t/* filter input: i1=i2=sample(n) */\n");
+
+	__cgen_arms(fout, &io, inf, &cg);
+
+	if (cg.id)
+		fprintf(fout,
+			"\n"
+			"\t/* decimator output: \n"
+			"\t     lowpass (o1+o2)/2, highpass (o2-o1)/2 */\n"
+			"\t/* interpolator output: \n"
+			"\t     lowpass sample(n)=o1, sample(n+1)=o2,\n"
+			"\t     highpass sample(n)=-o1, sample(n+1)=o2 */\n");
+	else
+		fprintf(fout,
+			"\n"
+			"\t/* filter output: \n"
+			"\t     lowpass sample(n)=(o1+o2)/2, highpass sample(n)=(o2-o1)/2 */\n");
+	fprintf(fout, "}\n\n");
+	
+	if (cg.id) {
+		if (__cgen_decim(fout, prefix, 1, dtype, inf, &cg) < 0)
+			return -1;
+		if (__cgen_interp(fout, prefix, 1, dtype, inf, &cg) < 0)
+			return -1;
+		if (cg.stages > 1) {
+			if (__cgen_decim(fout, prefix, cg.stages, dtype, inf, &cg) < 0)
+				return -1;
+			if (__cgen_interp(fout, prefix, cg.stages, dtype, inf, &cg) < 0)
+				return -1;
+		}
+		return 0;
+	}
+
+	for (i = 0; i < 3; ++i) {
+		if (__cgen_block(fout, prefix, i, dtype, inf, &cg) < 0)
+			return -1;
+	}
+
+	return 0;
+}
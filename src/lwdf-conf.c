@@ -0,0 +1,100 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ * 
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-conf.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: configuration file profile
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "lwdf.h"
+#include "conf.h"
+#include "lwdf-conf.h"
+
+struct lwdfwiz_cfg conf = {
+	.wiz = {
+		.samplerate = 88200,
+		.ftype = LWDF_ELLIP,
+		.order = 13,
+		.nbits = 0,
+		.bi = false,
+		.id = false,
+		.rx = false,
+		.ff = false,
+		.mm = false,
+		.asmin = 6.0,
+		.as = 6.0,
+		.es = 0.0,
+		.fs = 22100.0,
+		.ap = 0.0,
+		.ep = 0.0,
+		.fp = 0.0,
+		.g = 0.0,
+		.ft = 22100.0
+	},
+	.prefix = "lp",
+	.cfname = "../test/filter.c",
+	.jlfname = "test.jl",
+	.cache = ""
+};
+
+/*
+ * Configuration profile, lwdfwiz.conf
+ */
+/* *INDENT-OFF* */
+BEGIN_SECTION(wiz)
+       DEFINE_FLOAT("samplerate", &conf.wiz.samplerate)
+       DEFINE_INT("ftype", &conf.wiz.ftype)
+       DEFINE_INT("nbits", &conf.wiz.nbits)
+       DEFINE_FLOAT("asmin", &conf.wiz.asmin)
+       DEFINE_FLOAT("as", &conf.wiz.as)
+       DEFINE_FLOAT("es", &conf.wiz.es)
+       DEFINE_FLOAT("fs", &conf.wiz.fs)
+       DEFINE_FLOAT("ap", &conf.wiz.ap)
+       DEFINE_FLOAT("ep", &conf.wiz.ep)
+       DEFINE_FLOAT("fp", &conf.wiz.fp)
+       DEFINE_FLOAT("g", &conf.wiz.g)
+       DEFINE_FLOAT("ft", &conf.wiz.ft)
+       DEFINE_BOOLEAN("bi", &conf.wiz.bi)
+       DEFINE_BOOLEAN("id", &conf.wiz.id)
+       DEFINE_BOOLEAN("rx", &conf.wiz.rx)
+       DEFINE_BOOLEAN("ff", &conf.wiz.ff)
+       DEFINE_BOOLEAN("mm", &conf.wiz.mm)
+       DEFINE_INT("nchan", &conf.wiz.nchan)
+       DEFINE_INT("vlen", &conf.wiz.vlen)
+       DEFINE_INT("unroll", &conf.wiz.unroll)
+       DEFINE_INT("stages", &conf.wiz.stages)
+       DEFINE_BOOLEAN("csd", &conf.wiz.csd)
+END_SECTION
+/* *INDENT-ON* */
+
+BEGIN_SECTION(conf_root)
+       DEFINE_SECTION("wizard", &wiz)
+       DEFINE_STRING("prefix", &conf.prefix)
+       DEFINE_STRING("cfname", &conf.cfname)
+       DEFINE_STRING("jlfname", &conf.jlfname)
+       DEFINE_STRING("cache", &conf.cache)
+END_SECTION
@@ -0,0 +1,40 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ * 
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-conf.h
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: configuration file profile
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __LWDF_CONF_H__
+#define __LWDF_CONF_H__
+
+#include "lwdf.h"
+#include "conf.h"
+
+/* Settings of lwdfwiz.conf, loaded and saved through conf_root */
+extern struct lwdfwiz_cfg conf;
+
+extern struct conf_var conf_root[];
+
+#endif /* __LWDF_CONF_H__ */
@@ -0,0 +1,269 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-cppgen.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: C++ header generator
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The header has two parts: the lwdf::filter class template, the same
+ * for every design and guarded so several headers can be included
+ * together, and the design, a constexpr gamma array in its own
+ * namespace with the filter alias. The order and the gamma values are
+ * template parameters, the adaptor chain is unrolled at compile time,
+ * zero gamma adaptors fold into moves and the fixed point multipliers
+ * that are powers of two become shifts. It needs C++20 (std::span).
+ */
+
+#include <stdio.h>
+#include "lwdf.h"
+
+static const char * const cpp_template[] = {
+	"#ifndef LWDF_FILTER_TEMPLATE",
+	"#define LWDF_FILTER_TEMPLATE",
+	"",
+	"#include <array>",
+	"#include <bit>",
+	"#include <cstddef>",
+	"#include <cstdint>",
+	"#include <span>",
+	"#include <type_traits>",
+	"",
+	"namespace lwdf {",
+	"",
+	"/*",
+	" * Lattice wave digital filter of odd order N, gamma coefficients G.",
+	" * T is float, double or a signed integer. The integer code has NB",
+	" * fraction bits in the adaptor multipliers.",
+	" */",
+	"template <typename T, std::size_t N, const std::array<double, N> & G,",
+	"\t\t  int NB = 15>",
+	"class filter {",
+	"\tstatic_assert((N & 1) == 1, \"the order must be odd\");",
+	"",
+	"\tusing state = std::array<T, N>;",
+	"",
+	"\tstatic constexpr bool fixed = std::is_integral_v<T>;",
+	"",
+	"\tstatic constexpr double alpha(double g)",
+	"\t{",
+	"\t\treturn (g > 0.5) ? 1.0 - g : (g > 0.0) ? g :",
+	"\t\t\t(g > -0.5) ? -g : 1.0 + g;",
+	"\t}",
+	"",
+	"\ttemplate <std::size_t K>",
+	"\tstatic constexpr T mul(T t)",
+	"\t{",
+	"\t\tif constexpr (fixed) {",
+	"\t\t\tconstexpr std::int64_t q =",
+	"\t\t\t\tstd::int64_t(alpha(G[K]) * double(std::int64_t(1) << NB));",
+	"",
+	"\t\t\tif constexpr ((q > 0) && ((q & (q - 1)) == 0))",
+	"\t\t\t\treturn t >> (NB - std::countr_zero(std::uint64_t(q)));",
+	"\t\t\telse",
+	"\t\t\t\treturn T((q * std::int64_t(t)) >> NB);",
+	"\t\t} else {",
+	"\t\t\treturn T(alpha(G[K])) * t;",
+	"\t\t}",
+	"\t}",
+	"",
+	"\ttemplate <std::size_t K>",
+	"\tstatic constexpr void adaptor(T in1, T in2, T & out1, T & out2)",
+	"\t{",
+	"\t\tconstexpr double g = G[K];",
+	"",
+	"\t\tif constexpr (g == 0.0) {",
+	"\t\t\tout1 = in2;",
+	"\t\t\tout2 = in1;",
+	"\t\t} else if constexpr (g > 0.5) {",
+	"\t\t\tT t = in1 - in2;",
+	"\t\t\tout2 = mul<K>(t) + in2;",
+	"\t\t\tout1 = out2 - t;",
+	"\t\t} else if constexpr (g > 0.0) {",
+	"\t\t\tT t = in2 - in1;",
+	"\t\t\tout1 = mul<K>(t) + in2;",
+	"\t\t\tout2 = out1 - t;",
+	"\t\t} else if constexpr (g > -0.5) {",
+	"\t\t\tT t = in1 - in2;",
+	"\t\t\tout1 = mul<K>(t) - in2;",
+	"\t\t\tout2 = out1 - t;",
+	"\t\t} else {",
+	"\t\t\tT t = in2 - in1;",
+	"\t\t\tout2 = mul<K>(t) - in2;",
+	"\t\t\tout1 = out2 - t;",
+	"\t\t}",
+	"\t}",
+	"",
+	"\t/* second order sections (K, K + 1), (K + 4, K + 5), ... of an arm */",
+	"\ttemplate <std::size_t K>",
+	"\tstatic constexpr void chain(state & s, T & v)",
+	"\t{",
+	"\t\tif constexpr (K + 1 < N) {",
+	"\t\t\tT x;",
+	"",
+	"\t\t\tadaptor<K + 1>(s[K], s[K + 1], x, s[K + 1]);",
+	"\t\t\tadaptor<K>(v, x, v, s[K]);",
+	"\t\t\tchain<K + 4>(s, v);",
+	"\t\t}",
+	"\t}",
+	"",
+	"\t/* o2 upper arm, o1 lower arm */",
+	"\tstatic constexpr void arms(state & s, T in, T & o1, T & o2)",
+	"\t{",
+	"\t\tadaptor<0>(in, s[0], o2, s[0]);",
+	"\t\tchain<3>(s, o2);",
+	"\t\to1 = in;",
+	"\t\tchain<1>(s, o1);",
+	"\t}",
+	"",
+	"\tstatic constexpr T half(T v)",
+	"\t{",
+	"\t\tif constexpr (fixed)",
+	"\t\t\treturn v >> 1;",
+	"\t\telse",
+	"\t\t\treturn v * T(0.5);",
+	"\t}",
+	"",
+	"\tstate st{};",
+	"",
+	"public:",
+	"\tusing value_type = T;",
+	"\tstatic constexpr std::size_t order = N;",
+	"",
+	"\tconstexpr void reset()",
+	"\t{",
+	"\t\tst.fill(T{});",
+	"\t}",
+	"",
+	"\t/* lowpass, y.size() >= x.size() */",
+	"\tconstexpr void process(std::span<const T> x, std::span<T> y)",
+	"\t{",
+	"\t\tstate s = st;",
+	"\t\tT o1, o2;",
+	"",
+	"\t\tfor (std::size_t i = 0; i < x.size(); ++i) {",
+	"\t\t\tarms(s, x[i], o1, o2);",
+	"\t\t\ty[i] = half(o1 + o2);",
+	"\t\t}",
+	"\t\tst = s;",
+	"\t}",
+	"",
+	"\tconstexpr void process_highpass(std::span<const T> x, std::span<T> y)",
+	"\t{",
+	"\t\tstate s = st;",
+	"\t\tT o1, o2;",
+	"",
+	"\t\tfor (std::size_t i = 0; i < x.size(); ++i) {",
+	"\t\t\tarms(s, x[i], o1, o2);",
+	"\t\t\ty[i] = half(o2 - o1);",
+	"\t\t}",
+	"\t\tst = s;",
+	"\t}",
+	"",
+	"\tconstexpr void process_splitband(std::span<const T> x,",
+	"\t\t\t\t\t\t\t\t\t std::span<T> lp, std::span<T> hp)",
+	"\t{",
+	"\t\tstate s = st;",
+	"\t\tT o1, o2;",
+	"",
+	"\t\tfor (std::size_t i = 0; i < x.size(); ++i) {",
+	"\t\t\tarms(s, x[i], o1, o2);",
+	"\t\t\tlp[i] = half(o1 + o2);",
+	"\t\t\thp[i] = half(o2 - o1);",
+	"\t\t}",
+	"\t\tst = s;",
+	"\t}",
+	"};",
+	"",
+	"} // namespace lwdf",
+	"",
+	"#endif // LWDF_FILTER_TEMPLATE",
+	NULL
+};
+
+int lwdf_cppgen(FILE *fout, const char * prefix,
+				const struct lwdfwiz_param * wiz,
+				const struct lwdf_info * inf)
+{
+	double F = wiz->samplerate;
+	int N = wiz->order;
+	int i;
+
+	if ((N & 1) == 0) {
+		fprintf(stderr, "%s: even order %d.\n", __func__, N);
+		return -1;
+	}
+
+	fprintf(fout, "/* -----------------------------------------------------\n");
+	fprintf(fout, " * This file was automatically generated, do not edit!\n");
+	fprintf(fout, " *\n");
+
+	switch (wiz->ftype) {
+	case LWDF_BUTTW:
+		fprintf(fout, " * Buttworth order %d\n", N);
+		break;
+	case LWDF_CHEB1:
+		fprintf(fout, " * Chebyshev I order %d\n", N);
+		break;
+	case LWDF_ELLIP:
+		fprintf(fout, " * Elliptic/Cauer order %d\n", N);
+		break;
+	}
+
+	if (wiz->bi)
+		fprintf(fout, " * - bireciprocal\n");
+	fprintf(fout,
+		" * - stopband min attenuation as=%.0f dB at fs=%.2f%% (100%%=F/2)\n",
+		wiz->as, wiz->fs / (F / 2.0));
+	fprintf(fout,
+		" * - passband attenuation spread ap=%.2f dB at fp=%.2f%% (100%%=F/2)\n",
+		wiz->ap, wiz->fp / (F / 2.0));
+	fprintf(fout, " *\n");
+	fprintf(fout, " * Usage: %sdesign::filter<float> f; f.process(x, y);\n",
+			prefix);
+	fprintf(fout, " * -----------------------------------------------------\n");
+	fprintf(fout, " */\n");
+	fprintf(fout, "\n");
+	fprintf(fout, "#pragma once\n");
+	fprintf(fout, "\n");
+
+	for (i = 0; cpp_template[i] != NULL; ++i)
+		fprintf(fout, "%s\n", cpp_template[i]);
+	fprintf(fout, "\n");
+
+	fprintf(fout, "namespace %sdesign {\n", prefix);
+	fprintf(fout, "\n");
+	fprintf(fout, "inline constexpr std::array<double, %d> gamma = {\n", N);
+	for (i = 0; i < N; i++)
+		fprintf(fout, "\t%.17g%s\n", inf->gamma[i], (i < N - 1) ? "," : "");
+	fprintf(fout, "};\n");
+	fprintf(fout, "\n");
+	fprintf(fout, "template <typename T, int NB = %d>\n",
+			(wiz->nbits > 0) ? wiz->nbits : 15);
+	fprintf(fout, "using filter = lwdf::filter<T, %d, gamma, NB>;\n", N);
+	fprintf(fout, "\n");
+	fprintf(fout, "} // namespace %sdesign\n", prefix);
+
+	return 0;
+}
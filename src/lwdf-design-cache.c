@@ -0,0 +1,592 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-design-cache.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Filter design cache
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Designs are cached by their normalized specification: the fields of
+ * struct lwdfwiz_param that lwdf_design() uses for the filter type,
+ * all the others set to zero. The value is the struct lwdf_info of the
+ * design and the margins to the specification mask.
+ *
+ * The cache is an open addressing hash table of fixed size records,
+ * which is also the file format:
+ *
+ *   file = struct dcache_hdr, struct dcache_rec[nslot]
+ *
+ * A record with hash 0 is an empty slot. The file is memory mapped and
+ * a lookup probes the table in place, without parsing. Readers hold a
+ * shared lock on the file and writers an exclusive one, so several
+ * processes can use the same file. When the table is half full it is
+ * rehashed in place to twice the size. The records are stored in the
+ * host byte order, a file with a different record size is rejected.
+ *
+ * Without a file the same table is kept in memory.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lwdf.h"
+
+#define DCACHE_MAGIC "LWDFDC01"
+#define DCACHE_NSLOT_MIN 64
+
+/* Normalized specification */
+struct dcache_key {
+	uint8_t ftype;
+	uint8_t bi;
+	uint8_t ff;
+	uint8_t rsvd;
+	uint32_t order;
+	double samplerate;
+	double asmin;
+	double fs;
+	double ap;
+	double fp;
+	double g;
+	double ep;
+	double ft;
+};
+
+struct dcache_rec {
+	uint64_t hash; /* 0 means empty */
+	struct dcache_key key;
+	double as_margin;
+	double ap_margin;
+	struct lwdf_info inf;
+};
+
+struct dcache_hdr {
+	char magic[8];
+	uint32_t recsize;
+	uint32_t nslot; /* power of 2 */
+	uint32_t nused;
+	uint32_t rsvd[9];
+};
+
+struct lwdf_design_cache {
+	pthread_mutex_t mutex;
+	int fd; /* -1 for a memory only cache */
+	uint8_t * map;
+	size_t map_size;
+	struct {
+		unsigned int hit;
+		unsigned int miss;
+	} stat;
+};
+
+/*
+ * FNV-1a hash
+ */
+
+#define FNV64_OFFS 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+static inline uint64_t __fnv64(uint64_t h, const void * buf, size_t len)
+{
+	const uint8_t * cp = (const uint8_t *)buf;
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		h ^= cp[i];
+		h *= FNV64_PRIME;
+	}
+
+	return h;
+}
+
+/* Keep only the fields used by the design */
+static uint64_t __key_init(struct dcache_key * key,
+						   const struct lwdfwiz_param * wiz)
+{
+	struct lwdf_design_range rng;
+	uint64_t h;
+
+	memset(key, 0, sizeof(struct dcache_key));
+
+	key->ftype = wiz->ftype;
+	key->bi = (wiz->ftype == LWDF_ELLIP) && wiz->bi;
+	key->ff = wiz->ff;
+	/* order 0 (the minimum) and the same explicit order share a record */
+	if (lwdf_design_range(wiz, &rng) < 0)
+		key->order = wiz->order;
+	else
+		key->order = rng.order;
+	key->samplerate = wiz->samplerate;
+	key->asmin = wiz->asmin;
+	key->fs = wiz->fs;
+	if (!key->bi) {
+		key->ap = wiz->ap;
+		key->fp = wiz->fp;
+	}
+
+	switch (wiz->ftype) {
+	case LWDF_BUTTW:
+		key->g = wiz->g;
+		break;
+	case LWDF_ELLIP:
+		key->ft = wiz->ft;
+		/* fall through */
+	case LWDF_CHEB1:
+		key->ep = wiz->ep;
+		break;
+	}
+
+	h = __fnv64(FNV64_OFFS, key, sizeof(struct dcache_key));
+
+	return (h == 0) ? 1 : h;
+}
+
+static inline struct dcache_hdr * __hdr(struct lwdf_design_cache * cache)
+{
+	return (struct dcache_hdr *)cache->map;
+}
+
+static inline struct dcache_rec * __slot(struct lwdf_design_cache * cache,
+										 size_t i)
+{
+	return (struct dcache_rec *)(cache->map + sizeof(struct dcache_hdr)) + i;
+}
+
+static size_t __table_size(size_t nslot)
+{
+	return sizeof(struct dcache_hdr) + nslot * sizeof(struct dcache_rec);
+}
+
+static struct dcache_rec * __lookup(struct lwdf_design_cache * cache,
+									uint64_t hash,
+									const struct dcache_key * key)
+{
+	size_t mask = __hdr(cache)->nslot - 1;
+	size_t i = hash & mask;
+	struct dcache_rec * rec;
+
+	while ((rec = __slot(cache, i))->hash != 0) {
+		if ((rec->hash == hash) &&
+			(memcmp(&rec->key, key, sizeof(struct dcache_key)) == 0))
+			return rec;
+		i = (i + 1) & mask;
+	}
+
+	return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Storage
+ * ---------------------------------------------------------------------------
+ */
+
+/* Map the file again if its size changed */
+static int __sync(struct lwdf_design_cache * cache)
+{
+	struct stat st;
+	void * map;
+
+	if (cache->fd < 0)
+		return 0;
+
+	if (fstat(cache->fd, &st) < 0) {
+		fprintf(stderr, "%s: fstat() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+
+	if ((size_t)st.st_size == cache->map_size)
+		return 0;
+
+	if ((size_t)st.st_size < __table_size(DCACHE_NSLOT_MIN)) {
+		fprintf(stderr, "%s: invalid cache file.\n", __func__);
+		return -1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, cache->fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: mmap() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+
+	if (cache->map != NULL)
+		munmap(cache->map, cache->map_size);
+	cache->map = map;
+	cache->map_size = st.st_size;
+
+	if ((memcmp(__hdr(cache)->magic, DCACHE_MAGIC, 8) != 0) ||
+		(__hdr(cache)->recsize != sizeof(struct dcache_rec)) ||
+		(__table_size(__hdr(cache)->nslot) != cache->map_size)) {
+		fprintf(stderr, "%s: invalid cache file.\n", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int __write(struct lwdf_design_cache * cache, const void * buf,
+				   size_t len, size_t offs)
+{
+	const uint8_t * cp = (const uint8_t *)buf;
+
+	if (cache->fd < 0) {
+		memcpy(cache->map + offs, buf, len);
+		return 0;
+	}
+
+	while (len > 0) {
+		ssize_t n;
+
+		if ((n = pwrite(cache->fd, cp, len, offs)) < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "%s: pwrite() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		}
+		cp += n;
+		offs += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* Create an empty table of nslot records */
+static int __table_init(struct lwdf_design_cache * cache, size_t nslot)
+{
+	struct dcache_hdr hdr;
+	size_t size = __table_size(nslot);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, DCACHE_MAGIC, 8);
+	hdr.recsize = sizeof(struct dcache_rec);
+	hdr.nslot = nslot;
+	hdr.nused = 0;
+
+	if (cache->fd < 0) {
+		uint8_t * map;
+
+		if ((map = calloc(1, size)) == NULL) {
+			fprintf(stderr, "%s: calloc() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		}
+		free(cache->map);
+		cache->map = map;
+		cache->map_size = size;
+	} else {
+		/* zero fill */
+		if ((ftruncate(cache->fd, 0) < 0) ||
+			(ftruncate(cache->fd, size) < 0)) {
+			fprintf(stderr, "%s: ftruncate() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		}
+	}
+
+	if (__write(cache, &hdr, sizeof(hdr), 0) < 0)
+		return -1;
+
+	return __sync(cache);
+}
+
+/* Insert a record, the table must have a free slot */
+static int __insert(struct lwdf_design_cache * cache,
+					const struct dcache_rec * rec)
+{
+	struct dcache_hdr hdr = *__hdr(cache);
+	size_t mask = hdr.nslot - 1;
+	size_t i = rec->hash & mask;
+
+	while (__slot(cache, i)->hash != 0)
+		i = (i + 1) & mask;
+
+	if (__write(cache, rec, sizeof(struct dcache_rec),
+				sizeof(struct dcache_hdr) +
+				i * sizeof(struct dcache_rec)) < 0)
+		return -1;
+
+	hdr.nused++;
+
+	return __write(cache, &hdr, sizeof(hdr), 0);
+}
+
+/* Rehash to twice the number of slots */
+static int __grow(struct lwdf_design_cache * cache)
+{
+	size_t nslot = __hdr(cache)->nslot;
+	struct dcache_rec * tab;
+	size_t i;
+	int ret = 0;
+
+	/* copy the records out of the mapping */
+	if ((tab = malloc(nslot * sizeof(struct dcache_rec))) == NULL) {
+		fprintf(stderr, "%s: malloc() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+	memcpy(tab, __slot(cache, 0), nslot * sizeof(struct dcache_rec));
+
+	if (__table_init(cache, 2 * nslot) < 0) {
+		free(tab);
+		return -1;
+	}
+
+	for (i = 0; (i < nslot) && (ret == 0); ++i) {
+		if (tab[i].hash != 0)
+			ret = __insert(cache, &tab[i]);
+	}
+
+	free(tab);
+
+	return (ret < 0) ? ret : __sync(cache);
+}
+
+/* ---------------------------------------------------------------------------
+ * API
+ * ---------------------------------------------------------------------------
+ */
+
+/*
+ * Open (or create) a design cache file. If path is NULL the cache is
+ * kept in memory only.
+ */
+struct lwdf_design_cache * lwdf_design_cache_open(const char * path)
+{
+	struct lwdf_design_cache * cache;
+	struct stat st;
+	int ret;
+
+	if ((cache = calloc(1, sizeof(struct lwdf_design_cache))) == NULL) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+			strerror(errno));
+		return NULL;
+	};
+
+	pthread_mutex_init(&cache->mutex, NULL);
+	cache->fd = -1;
+
+	if (path == NULL) {
+		if (__table_init(cache, DCACHE_NSLOT_MIN) < 0) {
+			lwdf_design_cache_close(cache);
+			return NULL;
+		}
+		return cache;
+	}
+
+	if ((cache->fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+		fprintf(stderr, "%s: open(\"%s\") failed: %s", __func__,
+				path, strerror(errno));
+		lwdf_design_cache_close(cache);
+		return NULL;
+	}
+
+	flock(cache->fd, LOCK_EX);
+	if ((ret = fstat(cache->fd, &st)) == 0) {
+		if (st.st_size == 0)
+			ret = __table_init(cache, DCACHE_NSLOT_MIN);
+		else
+			ret = __sync(cache);
+	}
+	flock(cache->fd, LOCK_UN);
+
+	if (ret < 0) {
+		lwdf_design_cache_close(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void lwdf_design_cache_close(struct lwdf_design_cache * cache)
+{
+	assert(cache != NULL);
+
+	if (cache->fd >= 0) {
+		if (cache->map != NULL)
+			munmap(cache->map, cache->map_size);
+		close(cache->fd);
+	} else {
+		free(cache->map);
+	}
+
+	pthread_mutex_destroy(&cache->mutex);
+	free(cache);
+}
+
+/*
+ * Look up the design of the specification wiz. On a hit inf and the
+ * margins (if not NULL) are filled in and 1 is returned, 0 is returned
+ * on a miss.
+ */
+int lwdf_design_cache_get(struct lwdf_design_cache * cache,
+						  const struct lwdfwiz_param * wiz,
+						  struct lwdf_info * inf,
+						  double * as_margin, double * ap_margin)
+{
+	struct dcache_key key;
+	struct dcache_rec * rec = NULL;
+	uint64_t hash;
+
+	assert(cache != NULL);
+	assert(wiz != NULL);
+	assert(inf != NULL);
+
+	hash = __key_init(&key, wiz);
+
+	pthread_mutex_lock(&cache->mutex);
+	if (cache->fd >= 0)
+		flock(cache->fd, LOCK_SH);
+
+	if ((__sync(cache) == 0) &&
+		((rec = __lookup(cache, hash, &key)) != NULL)) {
+		*inf = rec->inf;
+		if (as_margin != NULL)
+			*as_margin = rec->as_margin;
+		if (ap_margin != NULL)
+			*ap_margin = rec->ap_margin;
+		cache->stat.hit++;
+	} else {
+		cache->stat.miss++;
+	}
+
+	if (cache->fd >= 0)
+		flock(cache->fd, LOCK_UN);
+	pthread_mutex_unlock(&cache->mutex);
+
+	return (rec != NULL) ? 1 : 0;
+}
+
+/*
+ * Store the design inf of the specification wiz.
+ */
+int lwdf_design_cache_put(struct lwdf_design_cache * cache,
+						  const struct lwdfwiz_param * wiz,
+						  const struct lwdf_info * inf,
+						  double as_margin, double ap_margin)
+{
+	struct dcache_rec rec;
+	struct dcache_rec * old;
+	int ret = -1;
+
+	assert(cache != NULL);
+	assert(wiz != NULL);
+	assert(inf != NULL);
+
+	memset(&rec, 0, sizeof(rec));
+	rec.hash = __key_init(&rec.key, wiz);
+	rec.as_margin = as_margin;
+	rec.ap_margin = ap_margin;
+	rec.inf = *inf;
+
+	pthread_mutex_lock(&cache->mutex);
+	if (cache->fd >= 0)
+		flock(cache->fd, LOCK_EX);
+
+	if (__sync(cache) < 0)
+		goto done;
+
+	if ((old = __lookup(cache, rec.hash, &rec.key)) != NULL) {
+		/* replace */
+		ret = __write(cache, &rec, sizeof(rec), (uint8_t *)old - cache->map);
+		goto done;
+	}
+
+	if ((2 * (__hdr(cache)->nused + 1) > __hdr(cache)->nslot) &&
+		(__grow(cache) < 0))
+		goto done;
+
+	ret = __insert(cache, &rec);
+
+done:
+	if (cache->fd >= 0)
+		flock(cache->fd, LOCK_UN);
+	pthread_mutex_unlock(&cache->mutex);
+
+	return ret;
+}
+
+void lwdf_design_cache_stat(struct lwdf_design_cache * cache,
+							unsigned int * hit, unsigned int * miss)
+{
+	assert(cache != NULL);
+
+	pthread_mutex_lock(&cache->mutex);
+	if (hit != NULL)
+		*hit = cache->stat.hit;
+	if (miss != NULL)
+		*miss = cache->stat.miss;
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+/*
+ * Same as lwdf_design(), looking the design up in the cache first (if
+ * not NULL). New designs are stored in the cache with their margins to
+ * the specification mask, which are also returned if the pointers are
+ * not NULL.
+ */
+int lwdf_design_cached(struct lwdf_design_cache * cache,
+					   const struct lwdfwiz_param * wiz,
+					   struct lwdf_info * inf,
+					   double * as_margin, double * ap_margin)
+{
+	double gamma[LWDF_ORDER_MAX];
+	double as_m;
+	double ap_m;
+	int N;
+	int i;
+
+	if ((cache != NULL) &&
+		(lwdf_design_cache_get(cache, wiz, inf, as_margin, ap_margin) > 0))
+		return inf->order;
+
+	if ((N = lwdf_design(wiz, inf)) < 0)
+		return N;
+
+	/* the mask is checked on the lowpass, undo the flip */
+	for (i = 0; i < N; ++i) {
+		gamma[i] = inf->gamma[i];
+		if (wiz->ff && ((i % 2) == 0))
+			gamma[i] = -gamma[i];
+	}
+	lwdf_spec_margin(wiz, gamma, N, &as_m, &ap_m);
+
+	if (cache != NULL)
+		lwdf_design_cache_put(cache, wiz, inf, as_m, ap_m);
+
+	if (as_margin != NULL)
+		*as_margin = as_m;
+	if (ap_margin != NULL)
+		*ap_margin = ap_m;
+
+	return N;
+}
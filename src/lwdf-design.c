@@ -0,0 +1,461 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-design.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Lattice wave digital filter design (no I/O)
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Based on:
+ *  Explicit Formulas for Lattice Wave Digital Filters, Lajos Gazsi, 1985 IEEE
+ *
+ * These functions are reentrant, they don't allocate memory and don't
+ * perform any I/O. Errors are reported by the return value:
+ *
+ *  LWDF_ERR_SPEC:  invalid specification (frequencies, attenuations)
+ *  LWDF_ERR_ORDER: order is even, too large or below the minimum
+ *  LWDF_ERR_RANGE: the design parameter range is empty
+ */
+
+#include <string.h>
+
+#include "lwdf.h"
+
+/* Transformed specification */
+struct lwdf_spec {
+	double F;
+	double es;
+	double ep;
+	double phis;
+	double phip;
+	double fp;
+	bool bi;
+};
+
+/* Stopband (elliptic) design constants */
+struct lwdf_ellip {
+	double q0, q1, q2, q3, q4;
+	double m0, m1, m2, m3;
+};
+
+static int __lwdf_spec(const struct lwdfwiz_param * wiz,
+					   struct lwdf_spec * s)
+{
+	double F = wiz->samplerate;
+
+	if ((wiz->ftype < LWDF_BUTTW) || (wiz->ftype > LWDF_ELLIP))
+		return LWDF_ERR_SPEC;
+
+	if (F <= 0.0)
+		return LWDF_ERR_SPEC;
+
+	if ((wiz->asmin > 200.0) || (wiz->asmin <= 0.0))
+		return LWDF_ERR_SPEC;
+
+	if ((wiz->fs >= F / 2.0) || (wiz->fs <= 0))
+		return LWDF_ERR_SPEC;
+
+	s->F = F;
+	s->bi = (wiz->ftype == LWDF_ELLIP) && wiz->bi;
+
+	/* as = 10.0*log(1.0+es*es) / log(10.0); */
+	s->es = sqrt(exp(log(10.0) * (wiz->asmin / 10.0)) - 1.0);
+
+	/* stopband transformed frequency */
+	s->phis = tan(M_PI * wiz->fs / F);
+
+	if (s->bi) {
+		if (s->phis < 1)
+			return LWDF_ERR_SPEC;
+		s->ep = 1.0 / s->es;
+		s->phip = 1.0 / s->phis;
+		s->fp = (F / 2.0) - wiz->fs;
+	} else {
+		if ((wiz->ap > 100.0) || (wiz->ap <= 0.0))
+			return LWDF_ERR_SPEC;
+		if ((wiz->fp >= F / 2.0) || (wiz->fp <= 0) || (wiz->fp >= wiz->fs))
+			return LWDF_ERR_SPEC;
+		s->ep = sqrt(exp(log(10.0) * (wiz->ap / 10.0)) - 1.0);
+		/* passband transformed frequency */
+		s->phip = tan(M_PI * wiz->fp / F);
+		s->fp = wiz->fp;
+	}
+
+	if (isnan(s->phis) || isnan(s->phip) || isnan(s->es))
+		return LWDF_ERR_SPEC;
+
+	return 0;
+}
+
+static int __lwdf_nmin(unsigned int ftype, const struct lwdf_spec * s)
+{
+	double k0, k1, k4, c1, c2, c3;
+	int nmin;
+	int i;
+
+	k0 = sqrt(s->phis / s->phip);
+	k1 = k0 * k0 + sqrt(k0 * k0 * k0 * k0 - 1.0);
+	for (k4 = k1, i = 0; i < 3; i++)
+		k4 = k4 * k4 + sqrt(k4 * k4 * k4 * k4 - 1.0);
+
+	if (isnan(k0) || isnan(k1) || isnan(k4))
+		return LWDF_ERR_SPEC;
+
+	switch (ftype) {
+	case LWDF_BUTTW:
+	default:
+		c1 = 1.0;
+		c2 = 1.0;
+		c3 = k0 * k0;
+		break;
+	case LWDF_CHEB1:
+		c1 = 1.0;
+		c2 = 2.0;
+		c3 = k1;
+		break;
+	case LWDF_ELLIP:
+		c1 = 8.0;
+		c2 = 4.0;
+		c3 = 2.0 * k4;
+		break;
+	}
+
+	nmin = (int)ceil(c1 * log(c2 * s->es / s->ep) / log(c3));
+
+	if ((nmin % 2) == 0)
+		nmin++;		/* odd min order */
+
+	if (nmin < 1)
+		nmin = 1;
+
+	return nmin;
+}
+
+/* Butterworth design parameter range */
+static void __buttw_range(const struct lwdf_spec * s, unsigned int N,
+						  double * ks, double * kp)
+{
+	double es2n = exp(log(s->es * s->es) * (1.0 / N));
+	double ep2n = exp(log(s->ep * s->ep) * (1.0 / N));
+
+	*ks = (es2n - s->phis * s->phis) / (es2n + s->phis * s->phis);
+	*kp = (ep2n - s->phip * s->phip) / (ep2n + s->phip * s->phip);
+}
+
+/* Elliptic: minimum stopband edge for order N */
+static double __ellip_fsmin(const struct lwdf_spec * s, unsigned int N)
+{
+	double r;
+	double t;
+	int i;
+
+	if (s->bi)
+		r = s->es;
+	else
+		r = sqrt(s->es / s->ep);
+	r = r * r + sqrt(r * r * r * r - 1.0);
+	r = r * r + sqrt(r * r * r * r - 1.0);
+	t = (0.5) * exp(log(2.0 * r) * (4.0 / (double)N));
+	for (i = 0; i < 4; i++)
+		t = sqrt((0.5) * (t + 1 / t));
+
+	if (s->bi)
+		return (s->F / M_PI) * atan(t);
+
+	return (s->F / M_PI) * atan(s->phip * t * t);
+}
+
+/* Elliptic constants for the stopband edge phis */
+static int __ellip_init(const struct lwdf_spec * s, unsigned int N,
+						double phis, struct lwdf_ellip * e)
+{
+	if (s->bi)
+		e->q0 = phis;
+	else
+		e->q0 = sqrt(phis / s->phip);
+	e->q1 = e->q0 * e->q0 + sqrt(e->q0 * e->q0 * e->q0 * e->q0 - 1.0);
+	e->q2 = e->q1 * e->q1 + sqrt(e->q1 * e->q1 * e->q1 * e->q1 - 1.0);
+	e->q3 = e->q2 * e->q2 + sqrt(e->q2 * e->q2 * e->q2 * e->q2 - 1.0);
+	e->q4 = e->q3 * e->q3 + sqrt(e->q3 * e->q3 * e->q3 * e->q3 - 1.0);
+	e->m3 = (0.5) * exp(log(2.0 * e->q4) * ((double)N / 2.0));
+	e->m2 = sqrt((0.5) * (e->m3 + 1.0 / e->m3));
+	e->m1 = sqrt((0.5) * (e->m2 + 1.0 / e->m2));
+	e->m0 = sqrt((0.5) * (e->m1 + 1.0 / e->m1));
+
+	if (isnan(e->m0) || isnan(e->m1) || isnan(e->m2) || isnan(e->m3))
+		return LWDF_ERR_SPEC;
+
+	return 0;
+}
+
+static double __clamp(double x, double min, double max)
+{
+	if (x < min)
+		return min;
+	if (x > max)
+		return max;
+	return x;
+}
+
+static int __lwdf_order(const struct lwdfwiz_param * wiz,
+						const struct lwdf_spec * s)
+{
+	int nmin;
+	int N;
+
+	if ((nmin = __lwdf_nmin(wiz->ftype, s)) < 0)
+		return nmin;
+
+	N = (wiz->order == 0) ? nmin : wiz->order;
+
+	if ((N > LWDF_ORDER_MAX) || ((N % 2) == 0) || (N < nmin))
+		return LWDF_ERR_ORDER;
+
+	return N;
+}
+
+/*
+ * Compute the minimum order and the ranges of the free design
+ * parameters for the order wiz->order (minimum if 0). For elliptic
+ * filters the passband ripple range depends on the stopband edge,
+ * wiz->ft (clamped to [fsmin, fsmax]).
+ */
+int lwdf_design_range(const struct lwdfwiz_param * wiz,
+					  struct lwdf_design_range * rng)
+{
+	struct lwdf_spec s;
+	struct lwdf_ellip e;
+	double t;
+	int ret;
+	int N;
+
+	memset(rng, 0, sizeof(struct lwdf_design_range));
+
+	if ((ret = __lwdf_spec(wiz, &s)) < 0)
+		return ret;
+
+	if ((ret = __lwdf_nmin(wiz->ftype, &s)) < 0)
+		return ret;
+	rng->nmin = ret;
+
+	if ((N = __lwdf_order(wiz, &s)) < 0)
+		return N;
+	rng->order = N;
+
+	switch (wiz->ftype) {
+	case LWDF_BUTTW:
+		__buttw_range(&s, N, &rng->gmin, &rng->gmax);
+		if (rng->gmin > rng->gmax)
+			return LWDF_ERR_RANGE;
+		break;
+
+	case LWDF_CHEB1:
+		t = sqrt(s.phis / s.phip);
+		t = t * t + sqrt(t * t * t * t - 1.0);
+		rng->epmin = (2.0 * s.es) / pow(t, N);
+		rng->epmax = s.ep;
+		if (rng->epmin > rng->epmax)
+			return LWDF_ERR_RANGE;
+		break;
+
+	case LWDF_ELLIP:
+		rng->fsmin = __ellip_fsmin(&s, N);
+		rng->fsmax = wiz->fs;
+		if (rng->fsmin > rng->fsmax)
+			return LWDF_ERR_RANGE;
+
+		t = tan(M_PI * __clamp(wiz->ft, rng->fsmin, rng->fsmax) / s.F);
+		if ((ret = __ellip_init(&s, N, t, &e)) < 0)
+			return ret;
+		if (s.bi)
+			rng->epmin = 1.0 / e.m0;
+		else
+			rng->epmin = s.es / (e.m0 * e.m0);
+		rng->epmax = s.ep;
+		if (isnan(rng->epmin) || (rng->epmin == 0.0) ||
+			(rng->epmin > rng->epmax))
+			return LWDF_ERR_RANGE;
+		break;
+	}
+
+	return N;
+}
+
+/*
+ * Design a lattice wave digital filter.
+ *
+ * The specification is taken from wiz: ftype, samplerate, asmin, fs,
+ * ap and fp (not used by bireciprocal elliptic filters), bi and ff.
+ * The order is wiz->order, or the minimum order if 0. The free design
+ * parameters are wiz->g (Butterworth), wiz->ep (Chebyshev and elliptic)
+ * and wiz->ft (elliptic stopband edge), they are clamped to the ranges
+ * reported by lwdf_design_range().
+ *
+ * Returns the filter order or a negative error code.
+ */
+int lwdf_design(const struct lwdfwiz_param * wiz, struct lwdf_info * inf)
+{
+	struct lwdf_design_range rng;
+	struct lwdf_spec s;
+	struct lwdf_ellip e;
+	double * gamma = inf->gamma;
+	double t, tt, g, w, r, Ai, Bi, ep, es, phis;
+	bool bi;
+	int ret;
+	int N;
+	int i;
+
+	if ((ret = lwdf_design_range(wiz, &rng)) < 0)
+		return ret;
+
+	__lwdf_spec(wiz, &s);
+	N = rng.order;
+	bi = s.bi;
+	ep = s.ep;
+	es = s.es;
+	phis = s.phis;
+
+	for (i = 0; i < LWDF_ORDER_MAX; i++)
+		gamma[i] = 0.0;
+	inf->g = 0.0;
+
+	switch (wiz->ftype) {
+	case LWDF_BUTTW:
+	default:
+		g = __clamp(wiz->g, rng.gmin, rng.gmax);
+		inf->g = g;
+
+		if (g == 0.0) {
+			/* Butterworth bireciprocal */
+			bi = true;
+			gamma[0] = 0.0;
+			for (i = 1; i <= ((N - 1) / 2); i++) {
+				t = tan(M_PI * (double)i / 2.0 / (double)N);
+				gamma[i * 2 - 1] = -(t * t);
+				gamma[i * 2] = 0.0;
+			}
+		} else {
+			/* Butterworth */
+			bi = false;
+			t = sqrt(1.0 - g * g);
+			gamma[0] = (1.0 + g - t) / (1.0 + g + t);
+			for (i = 1; i <= ((N - 1) / 2); i++) {
+				tt = t * cos(M_PI * (double)i / (double)N);
+				gamma[i * 2 - 1] = (tt - 1.0) / (tt + 1.0);
+				gamma[i * 2] = g;
+			}
+		}
+		break;
+
+	case LWDF_CHEB1:
+		ep = __clamp(wiz->ep, rng.epmin, rng.epmax);
+
+		w = exp(log(((1.0 / ep) + sqrt(1.0 / (ep * ep) + 1.0))) *
+			(1.0 / (double)N));
+		r = (w - 1.0 / w) * s.phip;
+		gamma[0] = (2.0 - r) / (2.0 + r);
+		for (i = 1; i <= ((N - 1) / 2); i++) {
+			t = M_PI * (double)i / (double)N;
+			Ai = r * cos(t);
+			Bi = (w * w + 1.0 / (w * w) -
+			      2.0 * cos(2.0 * t)) * (s.phip * s.phip) / 4.0;
+			gamma[i * 2 - 1] = (Ai - Bi - 1.0) / (Ai + Bi + 1.0);
+			gamma[i * 2] = (1.0 - Bi) / (1.0 + Bi);
+		}
+		break;
+
+	case LWDF_ELLIP:
+		phis = tan(M_PI * __clamp(wiz->ft, rng.fsmin, rng.fsmax) / s.F);
+		__ellip_init(&s, N, phis, &e);
+		ep = __clamp(wiz->ep, rng.epmin, rng.epmax);
+
+		if (bi)
+			es = e.m0;
+		else
+			es = ep * e.m0 * e.m0;
+		g = 1.0 / ep + sqrt(1.0 / (ep * ep) + 1.0);
+		g = e.m1 * g + sqrt((e.m1 * g * e.m1 * g) + 1.0);
+		g = e.m2 * g + sqrt((e.m2 * g * e.m2 * g) + 1.0);
+		t = exp(log((e.m3 / g) + sqrt((e.m3 * e.m3 / g / g) + 1.0)) *
+			(1.0 / (double)N));
+		t = 1.0 / (2.0 * e.q4) * (t - 1.0 / t);
+		t = 1.0 / (2.0 * e.q3) * (t - 1.0 / t);
+		t = 1.0 / (2.0 * e.q2) * (t - 1.0 / t);
+		t = 1.0 / (2.0 * e.q1) * (t - 1.0 / t);
+		if (bi)
+			w = -1.0;
+		else
+			w = 1.0 / (2.0 * e.q0) * (t - 1.0 / t);
+		if (bi)
+			gamma[0] = 0;
+		else
+			gamma[0] = (1.0 + w * e.q0 * s.phip) /
+				(1.0 - w * e.q0 * s.phip);
+		for (i = 1; i <= ((N - 1) / 2); i++) {
+			double q0 = e.q0;
+
+			t = e.q4 / sin((double)i * M_PI / (double)N);
+			t = 1.0 / (2.0 * e.q3) * (t + 1.0 / t);
+			t = 1.0 / (2.0 * e.q2) * (t + 1.0 / t);
+			t = 1.0 / (2.0 * e.q1) * (t + 1.0 / t);
+			t = 1.0 / (2.0 * q0) * (t + 1.0 / t);
+			tt = 1.0 / t;
+			if (bi) {
+				Bi = 1.0;
+				Ai = 2.0 / (1.0 + tt * tt) *
+					sqrt(1.0 - (q0 * q0 + 1.0 / (q0 * q0) - tt * tt) *
+						 tt * tt);
+				gamma[i * 2 - 1] = (Ai - 2.0) / (Ai + 2.0);
+				gamma[i * 2] = 0.0;
+			} else {
+				t = (1.0 + w * w * tt * tt);
+				Bi = (w * w + tt * tt) / t * (q0 * s.phip * q0 * s.phip);
+				Ai = (-2.0 * w * q0 * s.phip) / t *
+					sqrt(1.0 - (q0 * q0 + 1.0 / (q0 * q0) - tt * tt) *
+						 tt * tt);
+				gamma[i * 2 - 1] = (Ai - Bi - 1.0) / (Ai + Bi + 1.0);
+				gamma[i * 2] = (1.0 - Bi) / (1.0 + Bi);
+			}
+		}
+		break;
+	}
+
+	if (wiz->ff) {
+		/* flip frequency response around F/4 */
+		for (i = 0; i < N; i += 2)
+			gamma[i] = -gamma[i];
+	}
+
+	inf->samplerate = s.F;
+	inf->order = N;
+	inf->bi = bi;
+	inf->ep = ep;
+	inf->es = es;
+	inf->ap = 10.0 * log(1.0 + ep * ep) / log(10.0);
+	inf->as = 10.0 * log(1.0 + es * es) / log(10.0);
+	inf->fp = s.fp;
+	inf->fs = (s.F / M_PI) * atan(phis);
+
+	return N;
+}
@@ -0,0 +1,472 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-explore.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Design space exploration
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The explorer enumerates the candidate designs for a specification:
+ *
+ *  - filter type: Butterworth, Chebyshev I, elliptic (and bireciprocal
+ *    elliptic);
+ *  - order: nmin to nmin + dn;
+ *  - free parameter: g (Butterworth, including 0 and the powers of two
+ *    in range), ep (Chebyshev, elliptic) and the elliptic stopband edge
+ *    in [fsmin, fsmax], each sampled at nstep points.
+ *
+ * The candidates are evaluated by a pool of threads. For each one the
+ * minimum coefficient wordlength that still meets the specification
+ * mask is searched and the cost of the quantized filter is computed.
+ * The Pareto front on (multipliers, adaptors, coefficients, wordlength)
+ * is returned.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwdf.h"
+
+#define LWDF_EXPLORE_THREAD_MAX 64
+
+struct lwdf_explore {
+	const struct lwdfwiz_param * spec;
+	const struct lwdf_explore_cfg * cfg;
+	struct lwdf_cand * cand;
+	unsigned int cnt;
+	unsigned int max;
+	unsigned int next; /* next candidate to be evaluated */
+	pthread_mutex_t mutex;
+};
+
+/* Coefficient alpha as used by the adaptors */
+static double __alpha(double g)
+{
+	if (g > 0.5)
+		return 1.0 - g;
+	if (g > 0.0)
+		return g;
+	if (g > -0.5)
+		return -g;
+	return 1.0 + g;
+}
+
+/* Inverse of __alpha() for the region of g */
+static double __alpha_inv(double g, double a)
+{
+	if (g > 0.5)
+		return 1.0 - a;
+	if (g > 0.0)
+		return a;
+	if (g > -0.5)
+		return -a;
+	return a - 1.0;
+}
+
+/* Quantize the coefficients to nbits (truncating alpha, as the code
+   generator does) */
+void lwdf_gamma_quantize(double q[], const double gamma[],
+						 unsigned int order, unsigned int nbits)
+{
+	double Q = ldexp(1.0, nbits);
+	unsigned int i;
+
+	for (i = 0; i < order; ++i) {
+		double g = gamma[i];
+
+		if ((g == 0.0) || (nbits == 0))
+			q[i] = g;
+		else
+			q[i] = __alpha_inv(g, (int)(__alpha(g) * Q) / Q);
+	}
+}
+
+/*
+ * Cost of a filter implementation with nbits coefficients (0 means
+ * floating point).
+ */
+void lwdf_cost_get(const double gamma[], unsigned int order,
+				   unsigned int nbits, struct lwdf_cost * cost)
+{
+	int aq[LWDF_ORDER_MAX];
+	unsigned int i;
+	unsigned int j;
+
+	memset(cost, 0, sizeof(struct lwdf_cost));
+	cost->nbits = nbits;
+
+	for (i = 0; i < order; ++i) {
+		double g = gamma[i];
+		double a;
+		int q;
+
+		if (g == 0.0)
+			continue;
+
+		cost->adaptor++;
+		a = __alpha(g);
+
+		if (nbits == 0) {
+			cost->mul++;
+			q = (int)ldexp(a, 30);
+		} else {
+			q = (int)ldexp(a, nbits);
+			if ((q > 0) && ((q & (q - 1)) == 0)) {
+				cost->shift++;
+				continue;
+			}
+			cost->mul++;
+		}
+
+		/* distinct multiplier coefficients */
+		for (j = 0; j < cost->coeff; ++j) {
+			if (aq[j] == q)
+				break;
+		}
+		if (j == cost->coeff)
+			aq[cost->coeff++] = q;
+	}
+}
+
+/* Find the minimum wordlength that meets the specification mask */
+static int __explore_eval(struct lwdf_explore * xp, struct lwdf_cand * c)
+{
+	const struct lwdf_explore_cfg * cfg = xp->cfg;
+	double q[LWDF_ORDER_MAX];
+	unsigned int nbits;
+	int N;
+
+	if ((N = lwdf_design_cached(cfg->cache, &c->wiz, &c->inf,
+								&c->as_margin, &c->ap_margin)) < 0)
+		return -1;
+
+	/* the unquantized filter must meet the specification */
+	if ((c->as_margin < -LWDF_SPEC_TOL) || (c->ap_margin < -LWDF_SPEC_TOL))
+		return -1;
+
+	for (nbits = 2; nbits <= cfg->nbits_max; ++nbits) {
+		double as_m;
+		double ap_m;
+
+		lwdf_gamma_quantize(q, c->inf.gamma, N, nbits);
+		if (lwdf_spec_margin(xp->spec, q, N, &as_m, &ap_m)) {
+			lwdf_cost_get(c->inf.gamma, N, nbits, &c->cost);
+			c->wiz.nbits = nbits;
+			c->as_margin = as_m;
+			c->ap_margin = ap_m;
+			return 0;
+		}
+	}
+
+	/* floating point only */
+	lwdf_cost_get(c->inf.gamma, N, 0, &c->cost);
+	c->wiz.nbits = 0;
+
+	return 0;
+}
+
+static void * __explore_task(void * arg)
+{
+	struct lwdf_explore * xp = (struct lwdf_explore *)arg;
+
+	for (;;) {
+		struct lwdf_cand * c;
+		unsigned int i;
+
+		pthread_mutex_lock(&xp->mutex);
+		i = xp->next++;
+		pthread_mutex_unlock(&xp->mutex);
+
+		if (i >= xp->cnt)
+			break;
+
+		c = &xp->cand[i];
+		c->valid = (__explore_eval(xp, c) == 0);
+	}
+
+	return NULL;
+}
+
+static int __cand_add(struct lwdf_explore * xp,
+					  const struct lwdfwiz_param * wiz)
+{
+	if (xp->cnt == xp->max) {
+		struct lwdf_cand * cand;
+		unsigned int max = (xp->max == 0) ? 256 : 2 * xp->max;
+
+		cand = realloc(xp->cand, max * sizeof(struct lwdf_cand));
+		if (cand == NULL) {
+			fprintf(stderr, "%s: realloc() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		}
+		xp->cand = cand;
+		xp->max = max;
+	}
+
+	memset(&xp->cand[xp->cnt], 0, sizeof(struct lwdf_cand));
+	xp->cand[xp->cnt].wiz = *wiz;
+	xp->cnt++;
+
+	return 0;
+}
+
+static double __step(double min, double max, unsigned int i, unsigned int n)
+{
+	if (n <= 1)
+		return min + (max - min) / 2;
+
+	return min + ((max - min) * i) / (n - 1);
+}
+
+/* Enumerate the candidates of one filter type and order */
+static int __explore_gen(struct lwdf_explore * xp, struct lwdfwiz_param * wiz)
+{
+	unsigned int nstep = xp->cfg->nstep;
+	struct lwdf_design_range rng;
+	unsigned int i;
+	unsigned int j;
+	int k;
+
+	if (lwdf_design_range(wiz, &rng) < 0)
+		return 0;
+
+	switch (wiz->ftype) {
+	case LWDF_BUTTW:
+		for (i = 0; i < nstep; ++i) {
+			wiz->g = __step(rng.gmin, rng.gmax, i, nstep);
+			if (__cand_add(xp, wiz) < 0)
+				return -1;
+		}
+		/* bireciprocal */
+		if ((rng.gmin <= 0.0) && (rng.gmax >= 0.0)) {
+			wiz->g = 0.0;
+			if (__cand_add(xp, wiz) < 0)
+				return -1;
+		}
+		/* multiplierless, g = +/-2^k */
+		for (k = -1; k > -32; --k) {
+			double q = ldexp(1.0, k);
+
+			if ((q >= rng.gmin) && (q <= rng.gmax)) {
+				wiz->g = q;
+				if (__cand_add(xp, wiz) < 0)
+					return -1;
+			}
+			if ((-q >= rng.gmin) && (-q <= rng.gmax)) {
+				wiz->g = -q;
+				if (__cand_add(xp, wiz) < 0)
+					return -1;
+			}
+		}
+		break;
+
+	case LWDF_CHEB1:
+		for (i = 0; i < nstep; ++i) {
+			wiz->ep = __step(rng.epmin, rng.epmax, i, nstep);
+			if (__cand_add(xp, wiz) < 0)
+				return -1;
+		}
+		break;
+
+	case LWDF_ELLIP:
+		for (i = 0; i < nstep; ++i) {
+			wiz->ft = __step(rng.fsmin, rng.fsmax, i, nstep);
+			if (lwdf_design_range(wiz, &rng) < 0)
+				continue;
+			for (j = 0; j < nstep; ++j) {
+				wiz->ep = __step(rng.epmin, rng.epmax, j, nstep);
+				if (__cand_add(xp, wiz) < 0)
+					return -1;
+			}
+		}
+		break;
+	}
+
+	return 0;
+}
+
+/* a dominates b */
+static bool __dominates(const struct lwdf_cost * a, const struct lwdf_cost * b)
+{
+	unsigned int ca[4] = { a->mul, a->adaptor, a->coeff, a->nbits };
+	unsigned int cb[4] = { b->mul, b->adaptor, b->coeff, b->nbits };
+	bool lt = false;
+	int i;
+
+	/* floating point is the most expensive wordlength */
+	if (ca[3] == 0)
+		ca[3] = 64;
+	if (cb[3] == 0)
+		cb[3] = 64;
+
+	for (i = 0; i < 4; ++i) {
+		if (ca[i] > cb[i])
+			return false;
+		if (ca[i] < cb[i])
+			lt = true;
+	}
+
+	return lt;
+}
+
+static int __cand_cmp(const void * p1, const void * p2)
+{
+	const struct lwdf_cand * a = (const struct lwdf_cand *)p1;
+	const struct lwdf_cand * b = (const struct lwdf_cand *)p2;
+
+	if (a->cost.mul != b->cost.mul)
+		return a->cost.mul - b->cost.mul;
+	if (a->cost.adaptor != b->cost.adaptor)
+		return a->cost.adaptor - b->cost.adaptor;
+	if (a->cost.coeff != b->cost.coeff)
+		return a->cost.coeff - b->cost.coeff;
+	if (a->cost.nbits != b->cost.nbits)
+		return a->cost.nbits - b->cost.nbits;
+	/* larger stopband margin first */
+	return (a->as_margin < b->as_margin) - (a->as_margin > b->as_margin);
+}
+
+/*
+ * Explore the design space of the specification spec (samplerate, fp,
+ * fs, ap and asmin). On success *pfront points to an array with the
+ * Pareto optimal candidates, sorted by cost, which must be released
+ * with free(). Returns the number of candidates or -1 on error.
+ */
+int lwdf_explore(const struct lwdfwiz_param * spec,
+				 const struct lwdf_explore_cfg * cfg,
+				 struct lwdf_cand ** pfront)
+{
+	pthread_t thread[LWDF_EXPLORE_THREAD_MAX];
+	struct lwdf_explore xp;
+	struct lwdfwiz_param wiz;
+	struct lwdf_design_range rng;
+	unsigned int nthreads;
+	unsigned int n;
+	unsigned int i;
+	unsigned int j;
+	int ftype;
+	int bi;
+	int N;
+
+	assert(spec != NULL);
+	assert(cfg != NULL);
+	assert(pfront != NULL);
+
+	if ((cfg->nbits_max < 2) || (cfg->nbits_max > LWDF_NBITS_MAX)) {
+		fprintf(stderr, "%s: invalid wordlength %u.\n", __func__,
+				cfg->nbits_max);
+		return -1;
+	}
+
+	memset(&xp, 0, sizeof(xp));
+	xp.spec = spec;
+	xp.cfg = cfg;
+	pthread_mutex_init(&xp.mutex, NULL);
+
+	/* enumerate the candidates */
+	for (ftype = LWDF_BUTTW; ftype <= LWDF_ELLIP; ++ftype) {
+		for (bi = 0; bi <= ((ftype == LWDF_ELLIP) ? 1 : 0); ++bi) {
+			wiz = *spec;
+			wiz.ftype = ftype;
+			wiz.bi = bi;
+			wiz.ff = false;
+			wiz.order = 0;
+			wiz.ft = spec->fs;
+			if (lwdf_design_range(&wiz, &rng) < 0)
+				continue;
+
+			for (N = rng.nmin; (N <= (int)(rng.nmin + cfg->dn)) &&
+				 (N <= LWDF_ORDER_MAX); N += 2) {
+				wiz.order = N;
+				wiz.ft = spec->fs;
+				if (__explore_gen(&xp, &wiz) < 0)
+					goto error;
+			}
+		}
+	}
+
+	/* evaluate */
+	nthreads = cfg->nthreads;
+	if (nthreads == 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > LWDF_EXPLORE_THREAD_MAX)
+		nthreads = LWDF_EXPLORE_THREAD_MAX;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	for (i = 0; i < nthreads; ++i) {
+		if (pthread_create(&thread[i], NULL, __explore_task, &xp) != 0) {
+			fprintf(stderr, "%s: pthread_create() failed.\n", __func__);
+			break;
+		}
+	}
+	/* help, in case of thread creation failure */
+	__explore_task(&xp);
+	for (j = 0; j < i; ++j)
+		pthread_join(thread[j], NULL);
+
+	/* Pareto front */
+	n = 0;
+	for (i = 0; i < xp.cnt; ++i) {
+		bool dominated = false;
+
+		if (!xp.cand[i].valid)
+			continue;
+
+		for (j = 0; j < xp.cnt; ++j) {
+			if (xp.cand[j].valid &&
+				__dominates(&xp.cand[j].cost, &xp.cand[i].cost)) {
+				dominated = true;
+				break;
+			}
+		}
+
+		if (!dominated)
+			xp.cand[n++] = xp.cand[i];
+	}
+
+	qsort(xp.cand, n, sizeof(struct lwdf_cand), __cand_cmp);
+
+	/* keep the best margin of each cost */
+	for (i = 0, j = 0; i < n; ++i) {
+		if ((j > 0) && (memcmp(&xp.cand[j - 1].cost, &xp.cand[i].cost,
+							   sizeof(struct lwdf_cost)) == 0))
+			continue;
+		xp.cand[j++] = xp.cand[i];
+	}
+
+	pthread_mutex_destroy(&xp.mutex);
+	*pfront = xp.cand;
+
+	return j;
+
+error:
+	pthread_mutex_destroy(&xp.mutex);
+	free(xp.cand);
+	return -1;
+}
@@ -0,0 +1,560 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-filter.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: streaming filter of WAV and raw files
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The file goes through three threads: the reader converts blocks of
+ * frames from the mapped input, the main thread filters them, one
+ * lwdf_fp64 per channel, and the writer converts and writes them out.
+ * Each side has two blocks, one is filled while the other is in use.
+ *
+ * Decimation by D keeps every D-th filtered sample, interpolation by U
+ * inserts U - 1 zeros after each sample (gain U) before the filter. The
+ * design is for the rate the filter runs at: the input rate when
+ * decimating, the output rate when interpolating.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "lwdf.h"
+#include "pcm.h"
+#include "conf.h"
+#include "lwdf-conf.h"
+
+#define PROG_NAME "lwdf-filter"
+#define VERSION_MAJOR 1
+#define VERSION_MINOR 0
+
+/* Frames per block */
+#define FILTER_BLK 4096
+/* Blocks of each side, double buffering */
+#define FILTER_NBUF 2
+
+static char *progname;
+
+struct blk {
+	size_t frames;
+	double * v; /* interleaved */
+};
+
+/* Two blocks going around between a producer and a consumer */
+struct ring {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct blk blk[FILTER_NBUF];
+	unsigned int head; /* filled by the producer */
+	unsigned int tail; /* released by the consumer */
+	bool eof;
+};
+
+struct xfer {
+	struct ring in;
+	struct ring out;
+	struct pcm_file * fin;
+	struct pcm_file * fout;
+	unsigned int nch;
+	int err;
+};
+
+static int ring_init(struct ring * r, size_t len)
+{
+	unsigned int i;
+
+	pthread_mutex_init(&r->mutex, NULL);
+	pthread_cond_init(&r->cond, NULL);
+	r->head = 0;
+	r->tail = 0;
+	r->eof = false;
+	for (i = 0; i < FILTER_NBUF; ++i) {
+		if ((r->blk[i].v = calloc(len, sizeof(double))) == NULL) {
+			/* nothing is left to destroy */
+			while (i-- > 0)
+				free(r->blk[i].v);
+			pthread_cond_destroy(&r->cond);
+			pthread_mutex_destroy(&r->mutex);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void ring_destroy(struct ring * r)
+{
+	unsigned int i;
+
+	for (i = 0; i < FILTER_NBUF; ++i)
+		free(r->blk[i].v);
+	pthread_cond_destroy(&r->cond);
+	pthread_mutex_destroy(&r->mutex);
+}
+
+/* Producer: next empty block, NULL when the consumer is gone */
+static struct blk * ring_get(struct ring * r)
+{
+	struct blk * b = NULL;
+
+	pthread_mutex_lock(&r->mutex);
+	while ((r->head - r->tail == FILTER_NBUF) && !r->eof)
+		pthread_cond_wait(&r->cond, &r->mutex);
+	if (!r->eof)
+		b = &r->blk[r->head % FILTER_NBUF];
+	pthread_mutex_unlock(&r->mutex);
+
+	return b;
+}
+
+/* Producer: the block is filled */
+static void ring_put(struct ring * r)
+{
+	pthread_mutex_lock(&r->mutex);
+	r->head++;
+	pthread_cond_broadcast(&r->cond);
+	pthread_mutex_unlock(&r->mutex);
+}
+
+/* Consumer: next filled block, NULL at the end */
+static struct blk * ring_peek(struct ring * r)
+{
+	struct blk * b = NULL;
+
+	pthread_mutex_lock(&r->mutex);
+	while ((r->head == r->tail) && !r->eof)
+		pthread_cond_wait(&r->cond, &r->mutex);
+	if (r->head != r->tail)
+		b = &r->blk[r->tail % FILTER_NBUF];
+	pthread_mutex_unlock(&r->mutex);
+
+	return b;
+}
+
+/* Consumer: the block is free again */
+static void ring_release(struct ring * r)
+{
+	pthread_mutex_lock(&r->mutex);
+	r->tail++;
+	pthread_cond_broadcast(&r->cond);
+	pthread_mutex_unlock(&r->mutex);
+}
+
+/* No more blocks, from either side */
+static void ring_close(struct ring * r)
+{
+	pthread_mutex_lock(&r->mutex);
+	r->eof = true;
+	pthread_cond_broadcast(&r->cond);
+	pthread_mutex_unlock(&r->mutex);
+}
+
+static void * reader_task(void * arg)
+{
+	struct xfer * x = arg;
+	struct blk * b;
+	ssize_t n;
+
+	while ((b = ring_get(&x->in)) != NULL) {
+		if ((n = pcm_file_read_fp64(x->fin, b->v, FILTER_BLK)) <= 0)
+			break;
+		b->frames = n;
+		ring_put(&x->in);
+	}
+	ring_close(&x->in);
+
+	return NULL;
+}
+
+static void * writer_task(void * arg)
+{
+	struct xfer * x = arg;
+	struct blk * b;
+
+	while ((b = ring_peek(&x->out)) != NULL) {
+		if (pcm_file_write_fp64(x->fout, b->v, b->frames) < 0) {
+			x->err = -1;
+			break;
+		}
+		ring_release(&x->out);
+	}
+	/* stop the filter on error */
+	ring_close(&x->out);
+
+	return NULL;
+}
+
+/* The gamma file of lwdfwiz -g, one " gamma[ i] = value" per line */
+static int gamma_load(const char * path, double gamma[], unsigned int max)
+{
+	char buf[256];
+	unsigned int n = 0;
+	unsigned int i;
+	double g;
+	FILE * f;
+
+	if ((f = fopen(path, "r")) == NULL) {
+		fprintf(stderr, "%s: fopen(\"%s\") failed.\n", __func__, path);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), f) != NULL) {
+		if (sscanf(buf, " gamma[%u] = %lf", &i, &g) != 2)
+			continue;
+		if ((i != n) || (n == max)) {
+			fprintf(stderr, "%s: %s: unexpected gamma[%u].\n", __func__,
+					path, i);
+			fclose(f);
+			return -1;
+		}
+		gamma[n++] = g;
+	}
+	fclose(f);
+
+	if ((n & 1) == 0) {
+		fprintf(stderr, "%s: %s: even order %u.\n", __func__, path, n);
+		return -1;
+	}
+
+	return n;
+}
+
+static int fmt_parse(const char * s, enum pcm_fmt * fmt)
+{
+	static const char * const name[] = {
+		[PCM_S16] = "s16",
+		[PCM_S24] = "s24",
+		[PCM_S32] = "s32",
+		[PCM_F32] = "f32",
+		[PCM_F64] = "f64"
+	};
+	int i;
+
+	for (i = PCM_S16; i <= PCM_F64; ++i) {
+		if (strcasecmp(s, name[i]) == 0) {
+			*fmt = i;
+			return 0;
+		}
+	}
+
+	fprintf(stderr, "invalid sample format '%s'\n", s);
+
+	return -1;
+}
+
+static bool is_wav(const char * path)
+{
+	const char * s = strrchr(path, '.');
+
+	return (s != NULL) && (strcasecmp(s, ".wav") == 0);
+}
+
+static void show_usage(void)
+{
+	fprintf(stderr, "Usage: %s [OPTION...] INPUT OUTPUT\n", progname);
+	fprintf(stderr, "  -h  \tShow this help message\n");
+	fprintf(stderr, "  -v  \tShow version\n");
+	fprintf(stderr, "  -q  \tQuiet\n");
+	fprintf(stderr, "  -g \t'FILE'\tgamma coefficients file (lwdfwiz -g)\n");
+	fprintf(stderr, "  -c \t'FILE'\tdesign from a lwdfwiz configuration"
+			" file\n");
+	fprintf(stderr, "  -d \t'FACTOR'\tdecimation factor\n");
+	fprintf(stderr, "  -u \t'FACTOR'\tinterpolation factor\n");
+	fprintf(stderr, "  -r \t'FMT'\traw input format: s16 s24 s32 f32 f64\n");
+	fprintf(stderr, "  -n \t'CHANNELS'\traw input channels\n");
+	fprintf(stderr, "  -F \t'FREQ'\traw input samplerate [Hz]\n");
+	fprintf(stderr, "  -f \t'FMT'\toutput format, default to the input\n");
+	fprintf(stderr, "  -j  \tcompile the filter kernel with the host C"
+			" compiler\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "The .wav files are WAV, the others raw.\n");
+	fprintf(stderr, "\n");
+}
+
+static void show_version(void)
+{
+	fprintf(stderr, "%s %d.%d\n", PROG_NAME, VERSION_MAJOR, VERSION_MINOR);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pcm_file_info raw = {
+		.fmt = PCM_S16,
+		.channels = 1,
+		.samplerate = 44100
+	};
+	struct pcm_file_info info;
+	const char * gmname = NULL;
+	const char * cfname = NULL;
+	double gamma[LWDF_ORDER_MAX];
+	struct lwdf_fp64 ** flt = NULL;
+	struct xfer x;
+	pthread_t rd_thread;
+	pthread_t wr_thread;
+	struct blk * bi;
+	struct blk * bo;
+	enum pcm_fmt ofmt = PCM_S16;
+	bool ofmt_set = false;
+	bool raw_set = false;
+	bool jit = false;
+	bool verbose = true;
+	unsigned int down = 1;
+	unsigned int up = 1;
+	unsigned int phase = 0;
+	uint64_t nout = 0;
+	double frate;
+	double * t = NULL;
+	int N;
+	int ret = 1;
+	int c;
+	unsigned int k;
+	unsigned int i;
+
+	/* the program name start just after the last slash */
+	if ((progname = (char *)strrchr(argv[0], '/')) == NULL)
+		progname = argv[0];
+	else
+		progname++;
+
+	/* parse the command line options */
+	while ((c = getopt(argc, argv, "V?hvqjg:c:d:u:r:n:F:f:")) > 0) {
+		switch (c) {
+		case 'V':
+		case 'v':
+			show_version();
+			return 0;
+		case '?':
+		case 'h':
+			show_usage();
+			return 1;
+		case 'q':
+			verbose = false;
+			break;
+		case 'j':
+			jit = true;
+			break;
+		case 'g':
+			gmname = optarg;
+			break;
+		case 'c':
+			cfname = optarg;
+			break;
+		case 'd':
+			down = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			up = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			if (fmt_parse(optarg, &raw.fmt) < 0)
+				return 2;
+			raw_set = true;
+			break;
+		case 'n':
+			raw.channels = strtoul(optarg, NULL, 0);
+			raw_set = true;
+			break;
+		case 'F':
+			raw.samplerate = strtod(optarg, NULL);
+			raw_set = true;
+			break;
+		case 'f':
+			if (fmt_parse(optarg, &ofmt) < 0)
+				return 2;
+			ofmt_set = true;
+			break;
+		default:
+			show_usage();
+			return 2;
+		}
+	}
+
+	if (argc - optind != 2) {
+		show_usage();
+		return 2;
+	}
+
+	if ((gmname == NULL) == (cfname == NULL)) {
+		fprintf(stderr, "one of -g or -c is required\n");
+		return 2;
+	}
+
+	if ((down == 0) || (up == 0) || ((down > 1) && (up > 1))) {
+		fprintf(stderr, "invalid decimation/interpolation factor\n");
+		return 2;
+	}
+
+	if (gmname != NULL) {
+		if ((N = gamma_load(gmname, gamma, LWDF_ORDER_MAX)) < 0)
+			return 1;
+	} else {
+		struct lwdf_info inf;
+
+		if (load_conf(cfname, conf_root) <= 0) {
+			fprintf(stderr, "can't load the configuration \"%s\"\n", cfname);
+			return 1;
+		}
+		if (lwdf_design(&conf.wiz, &inf) < 0) {
+			fprintf(stderr, "filter design failed\n");
+			return 1;
+		}
+		N = inf.order;
+		memcpy(gamma, inf.gamma, N * sizeof(double));
+	}
+
+	if (is_wav(argv[optind]) && raw_set)
+		fprintf(stderr, "WAV input, -r -n -F ignored\n");
+
+	if ((x.fin = pcm_file_open(argv[optind],
+							   is_wav(argv[optind]) ? NULL : &raw)) == NULL)
+		return 1;
+
+	info = *pcm_file_info(x.fin);
+	x.nch = info.channels;
+	x.err = 0;
+	frate = info.samplerate * up;
+	info.samplerate = frate / down;
+	if (ofmt_set)
+		info.fmt = ofmt;
+
+	if ((x.fout = pcm_file_create(argv[optind + 1], &info,
+								  is_wav(argv[optind + 1]))) == NULL) {
+		pcm_file_close(x.fin);
+		return 1;
+	}
+
+	if (verbose) {
+		fprintf(stderr, "%s: %u channels, %llu frames at %.1f Hz\n",
+				argv[optind], x.nch,
+				(unsigned long long)pcm_file_info(x.fin)->frames,
+				pcm_file_info(x.fin)->samplerate);
+		fprintf(stderr, "filter: order %d at %.1f Hz\n", N, frate);
+		if ((cfname != NULL) && (conf.wiz.samplerate != frate))
+			fprintf(stderr, "warning: the design is for %.1f Hz\n",
+					conf.wiz.samplerate);
+	}
+
+	/* one filter per channel */
+	if ((flt = calloc(x.nch, sizeof(struct lwdf_fp64 *))) == NULL)
+		goto close;
+	for (k = 0; k < x.nch; ++k) {
+		if ((flt[k] = lwdf_fp64_new(frate)) == NULL)
+			goto close;
+		lwdf_fp64_gamma_set(flt[k], gamma, N);
+	}
+	/* compiled once, the channels share the kernels */
+	if (jit && (lwdf_fp64_jit_shared(flt, x.nch) < 0))
+		fprintf(stderr, "warning: generic kernels in use\n");
+
+	if ((t = calloc((size_t)FILTER_BLK * up, sizeof(double))) == NULL)
+		goto close;
+	if (ring_init(&x.in, (size_t)FILTER_BLK * x.nch) < 0) {
+		fprintf(stderr, "out of memory\n");
+		goto close;
+	}
+	if (ring_init(&x.out, (size_t)FILTER_BLK * up * x.nch) < 0) {
+		fprintf(stderr, "out of memory\n");
+		goto ring_in;
+	}
+
+	if (pthread_create(&rd_thread, NULL, reader_task, &x) != 0) {
+		fprintf(stderr, "pthread_create() failed.\n");
+		goto rings;
+	}
+	if (pthread_create(&wr_thread, NULL, writer_task, &x) != 0) {
+		fprintf(stderr, "pthread_create() failed.\n");
+		ring_close(&x.in);
+		pthread_join(rd_thread, NULL);
+		goto rings;
+	}
+
+	while ((bi = ring_peek(&x.in)) != NULL) {
+		unsigned int n = bi->frames * up;
+		unsigned int m = 0;
+
+		if ((bo = ring_get(&x.out)) == NULL)
+			break;
+
+		for (k = 0; k < x.nch; ++k) {
+			unsigned int p = phase;
+
+			/* zero stuffing */
+			memset(t, 0, n * sizeof(double));
+			for (i = 0; i < bi->frames; ++i)
+				t[i * up] = bi->v[i * x.nch + k] * up;
+
+			lwdf_fp64_lowpass(flt[k], t, t, n);
+
+			for (i = 0, m = 0; i < n; ++i) {
+				if (p == 0)
+					bo->v[m++ * x.nch + k] = t[i];
+				if (++p == down)
+					p = 0;
+			}
+		}
+		phase = (phase + n) % down;
+		bo->frames = m;
+		nout += m;
+
+		ring_release(&x.in);
+		ring_put(&x.out);
+	}
+	/* the reader stops when the writer failed */
+	ring_close(&x.in);
+	ring_close(&x.out);
+
+	pthread_join(rd_thread, NULL);
+	pthread_join(wr_thread, NULL);
+
+	if (x.err == 0) {
+		ret = 0;
+		if (verbose)
+			fprintf(stderr, "%s: %llu frames at %.1f Hz\n", argv[optind + 1],
+					(unsigned long long)nout, info.samplerate);
+	}
+
+rings:
+	ring_destroy(&x.out);
+ring_in:
+	ring_destroy(&x.in);
+close:
+	free(t);
+	if (flt != NULL) {
+		for (k = 0; k < x.nch; ++k) {
+			if (flt[k] != NULL)
+				lwdf_fp64_free(flt[k]);
+		}
+		free(flt);
+	}
+	if (pcm_file_close(x.fout) < 0)
+		ret = 1;
+	pcm_file_close(x.fin);
+
+	return ret;
+}
@@ -0,0 +1,515 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-fit.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Lattice filter fit to a custom magnitude/group delay mask
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The coefficients are fitted with Levenberg-Marquardt to a mask given
+ * on a frequency grid: min and max gain (dB) and, optionally, a bound
+ * on the group delay deviation from its mean over a set of points.
+ * The residual of a point is its distance to the mask (0 inside), so
+ * the cost is 0 when the mask is met.
+ *
+ * The coefficients are parametrized as gamma = tanh(theta), every
+ * theta gives |gamma| < 1 and a stable filter.
+ *
+ * With the section denominator D(w) = 1 + a1 e^-jw + a2 e^-j2w (see
+ * lwdf-fp64-resp.c), the phase and group delay of a section are:
+ *
+ *   phi = -N w - 2 arg(D)
+ *   tau = N - 2 Re(S / D), S = a1 e^-jw + 2 a2 e^-j2w
+ *
+ * and their derivatives with respect to ak:
+ *
+ *   d phi / d ak = -2 Im(e^-jkw / D)
+ *   d tau / d a1 = -2 Re(e^-jw (D - S) / D^2)
+ *   d tau / d a2 = -2 Re(e^-j2w (2 D - S) / D^2)
+ *
+ * with a1 = -g for the first order section, a1 = g2 (g1 - 1), a2 = -g1
+ * for the second order ones. The gain of the lowpass is
+ * 20 log10|cos(d/2)| (highpass: sin), d being the difference of the
+ * branch phases.
+ *
+ * The response and the derivatives are computed one section at a time
+ * over the whole grid, the inner loops run over the frequencies.
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "lwdf.h"
+
+#define FIT_GAIN_MIN -200.0
+#define FIT_LAMBDA_INIT 1e-3
+#define FIT_LAMBDA_MAX 1e12
+#define FIT_ITER_MAX 500
+
+struct lwdf_fit {
+	const struct lwdf_mask * mask;
+	unsigned int resp;
+	unsigned int order;
+	size_t len;
+	/* grid */
+	complex double * e1;
+	complex double * e2;
+	/* branch phases and group delay */
+	double * ph[2];
+	double * gd;
+	/* d phi / d gamma[k] and d gd / d gamma[k], order x len */
+	double * dph;
+	double * dgd;
+	/* branch of each coefficient: 0 upper, 1 lower */
+	uint8_t br[LWDF_ORDER_MAX];
+	/* residuals and jacobian (d r / d theta), nres x order */
+	size_t nres;
+	double * r;
+	double * J;
+};
+
+/* Branch phase and group delay of all sections over the grid. If jac
+   is set, the derivatives are computed as well. */
+static void __fit_resp(struct lwdf_fit * fit, const double gamma[], bool jac)
+{
+	size_t len = fit->len;
+	unsigned int k;
+	size_t i;
+
+	memset(fit->ph[0], 0, len * sizeof(double));
+	memset(fit->ph[1], 0, len * sizeof(double));
+	memset(fit->gd, 0, len * sizeof(double));
+
+	for (k = 0; k < fit->order; k += (k == 0) ? 1 : 2) {
+		double * ph = fit->ph[fit->br[k]];
+		double * dph1 = &fit->dph[k * len];
+		double * dgd1 = &fit->dgd[k * len];
+		double * dph2 = &fit->dph[(k + 1) * len];
+		double * dgd2 = &fit->dgd[(k + 1) * len];
+		double g1 = gamma[k];
+		double g2 = (k == 0) ? 0 : gamma[k + 1];
+		double a1 = (k == 0) ? -g1 : g2 * (g1 - 1.0);
+		double a2 = (k == 0) ? 0 : -g1;
+		double n = (k == 0) ? 1 : 2;
+
+		for (i = 0; i < len; ++i) {
+			complex double e1 = fit->e1[i];
+			complex double e2 = fit->e2[i];
+			complex double d = 1.0 + a1 * e1 + a2 * e2;
+			complex double s = a1 * e1 + 2.0 * a2 * e2;
+			double w = carg(e1);
+
+			ph[i] += n * w - 2.0 * carg(d);
+			fit->gd[i] += (n - 2.0 * creal(s / d)) / 2;
+
+			if (jac) {
+				complex double d2 = d * d;
+				double p1 = -2.0 * cimag(e1 / d);
+				double p2 = -2.0 * cimag(e2 / d);
+				double t1 = -2.0 * creal(e1 * (d - s) / d2);
+				double t2 = -2.0 * creal(e2 * (2.0 * d - s) / d2);
+
+				if (k == 0) {
+					/* a1 = -g */
+					dph1[i] = -p1;
+					dgd1[i] = -t1 / 2;
+				} else {
+					/* a1 = g2 (g1 - 1), a2 = -g1 */
+					dph1[i] = p1 * g2 - p2;
+					dgd1[i] = (t1 * g2 - t2) / 2;
+					dph2[i] = p1 * (g1 - 1.0);
+					dgd2[i] = (t1 * (g1 - 1.0)) / 2;
+				}
+			}
+		}
+	}
+}
+
+/* Residuals (and jacobian) at gamma, returns the cost */
+static double __fit_eval(struct lwdf_fit * fit, const double gamma[],
+						 bool jac)
+{
+	const struct lwdf_mask * mask = fit->mask;
+	unsigned int n = fit->order;
+	size_t len = fit->len;
+	double * r = fit->r;
+	double * J = fit->J;
+	double cost = 0;
+	double mu = 0;
+	size_t ngd = 0;
+	unsigned int k;
+	size_t i;
+
+	__fit_resp(fit, gamma, jac);
+
+	if (jac)
+		memset(J, 0, fit->nres * n * sizeof(double));
+
+	/* gain */
+	for (i = 0; i < len; ++i) {
+		double d = (fit->ph[0][i] - fit->ph[1][i]) / 2;
+		double wt = (mask->wt != NULL) ? mask->wt[i] : 1.0;
+		double c;
+		double q;
+		double G;
+
+		/* c'/c = q d(ph0 - ph1)/dg */
+		if (fit->resp == LWDF_RESP_HIGHPASS) {
+			c = sin(d);
+			q = cos(d) / (2 * c);
+		} else {
+			c = cos(d);
+			q = -sin(d) / (2 * c);
+		}
+
+		if (fabs(c) > pow(10, FIT_GAIN_MIN / 20)) {
+			G = 20 * log10(fabs(c));
+		} else {
+			G = FIT_GAIN_MIN;
+			q = 0;
+		}
+
+		if (G > mask->hi[i])
+			r[i] = wt * (G - mask->hi[i]);
+		else if (G < mask->lo[i])
+			r[i] = wt * (G - mask->lo[i]);
+		else
+			r[i] = 0;
+
+		if (jac && (r[i] != 0)) {
+			double f = wt * (20 / M_LN10) * q;
+
+			for (k = 0; k < n; ++k) {
+				double s = (fit->br[k] == 0) ? 1.0 : -1.0;
+				J[i * n + k] = f * s * fit->dph[k * len + i];
+			}
+		}
+
+		cost += r[i] * r[i];
+	}
+
+	if (mask->gd == NULL)
+		return cost;
+
+	/* group delay deviation from the mean */
+	for (i = 0; i < len; ++i) {
+		if (mask->gd[i]) {
+			mu += fit->gd[i];
+			ngd++;
+		}
+	}
+	if (ngd == 0)
+		return cost;
+	mu /= ngd;
+
+	for (i = 0; i < len; ++i) {
+		double * rg = &r[len + i];
+		double dev = fit->gd[i] - mu;
+		double tol = mask->gd_ripple / 2;
+
+		if (!mask->gd[i])
+			*rg = 0;
+		else if (dev > tol)
+			*rg = dev - tol;
+		else if (dev < -tol)
+			*rg = dev + tol;
+		else
+			*rg = 0;
+
+		cost += *rg * *rg;
+	}
+
+	if (jac) {
+		for (k = 0; k < n; ++k) {
+			const double * dgd = &fit->dgd[k * len];
+			double dmu = 0;
+
+			for (i = 0; i < len; ++i) {
+				if (mask->gd[i])
+					dmu += dgd[i];
+			}
+			dmu /= ngd;
+
+			for (i = 0; i < len; ++i) {
+				if (r[len + i] != 0)
+					J[(len + i) * n + k] = dgd[i] - dmu;
+			}
+		}
+	}
+
+	return cost;
+}
+
+/* Solve A x = b, A symmetric positive definite (n x n, overwritten by
+   its Cholesky factor) */
+static int __chol_solve(double * A, double * x, const double * b,
+						unsigned int n)
+{
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	for (j = 0; j < n; ++j) {
+		double s = A[j * n + j];
+
+		for (k = 0; k < j; ++k)
+			s -= A[j * n + k] * A[j * n + k];
+		if (s <= 0)
+			return -1;
+		A[j * n + j] = sqrt(s);
+
+		for (i = j + 1; i < n; ++i) {
+			s = A[i * n + j];
+			for (k = 0; k < j; ++k)
+				s -= A[i * n + k] * A[j * n + k];
+			A[i * n + j] = s / A[j * n + j];
+		}
+	}
+
+	/* L y = b */
+	for (i = 0; i < n; ++i) {
+		double s = b[i];
+
+		for (k = 0; k < i; ++k)
+			s -= A[i * n + k] * x[k];
+		x[i] = s / A[i * n + i];
+	}
+
+	/* L' x = y */
+	for (i = n; i-- > 0; ) {
+		double s = x[i];
+
+		for (k = i + 1; k < n; ++k)
+			s -= A[k * n + i] * x[k];
+		x[i] = s / A[i * n + i];
+	}
+
+	return 0;
+}
+
+static void __fit_free(struct lwdf_fit * fit)
+{
+	free(fit->e1);
+	free(fit->e2);
+	free(fit->ph[0]);
+	free(fit->ph[1]);
+	free(fit->gd);
+	free(fit->dph);
+	free(fit->dgd);
+	free(fit->r);
+	free(fit->J);
+}
+
+static int __fit_init(struct lwdf_fit * fit, const struct lwdf_mask * mask,
+					  unsigned int order, unsigned int resp)
+{
+	size_t len = mask->len;
+	unsigned int k;
+	size_t i;
+
+	memset(fit, 0, sizeof(struct lwdf_fit));
+	fit->mask = mask;
+	fit->resp = resp;
+	fit->order = order;
+	fit->len = len;
+	fit->nres = (mask->gd != NULL) ? 2 * len : len;
+
+	fit->e1 = calloc(len, sizeof(complex double));
+	fit->e2 = calloc(len, sizeof(complex double));
+	fit->ph[0] = calloc(len, sizeof(double));
+	fit->ph[1] = calloc(len, sizeof(double));
+	fit->gd = calloc(len, sizeof(double));
+	fit->dph = calloc(order * len, sizeof(double));
+	fit->dgd = calloc(order * len, sizeof(double));
+	fit->r = calloc(fit->nres, sizeof(double));
+	fit->J = calloc(fit->nres * order, sizeof(double));
+
+	if ((fit->e1 == NULL) || (fit->e2 == NULL) || (fit->ph[0] == NULL) ||
+		(fit->ph[1] == NULL) || (fit->gd == NULL) || (fit->dph == NULL) ||
+		(fit->dgd == NULL) || (fit->r == NULL) || (fit->J == NULL)) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+				strerror(errno));
+		__fit_free(fit);
+		return -1;
+	}
+
+	for (i = 0; i < len; ++i) {
+		double w = 2.0 * M_PI * mask->w[i];
+
+		fit->e1[i] = cos(w) - I * sin(w);
+		fit->e2[i] = fit->e1[i] * fit->e1[i];
+	}
+
+	/* upper: 0, (3,4), (7,8) ...; lower: (1,2), (5,6) ... */
+	fit->br[0] = 0;
+	for (k = 1; k < order; ++k)
+		fit->br[k] = (((k - 1) / 2) & 1) ? 0 : 1;
+
+	return 0;
+}
+
+/*
+ * Fit the coefficients gamma[] of a lattice filter of the given order to
+ * the mask. gamma[] holds the initial guess (e.g. a classic design) and
+ * is replaced by the result. If err is not NULL the max distance to the
+ * mask (dB or samples) is returned there.
+ *
+ * Returns 1 if the mask is met, 0 if not, or -1 on error.
+ */
+int lwdf_fit(const struct lwdf_mask * mask, unsigned int resp,
+			 double gamma[], unsigned int order,
+			 const struct lwdf_fit_cfg * cfg, double * err)
+{
+	double theta[LWDF_ORDER_MAX];
+	double g[LWDF_ORDER_MAX];
+	double b[LWDF_ORDER_MAX];
+	double x[LWDF_ORDER_MAX];
+	double t[LWDF_ORDER_MAX];
+	unsigned int iter_max;
+	struct lwdf_fit fit;
+	double lambda;
+	double * JtJ;
+	double * A;
+	double cost;
+	double e = 0;
+	unsigned int it;
+	unsigned int i;
+	unsigned int j;
+	size_t m;
+
+	assert(mask != NULL);
+	assert(gamma != NULL);
+
+	if ((order < 1) || (order > LWDF_ORDER_MAX) || ((order & 1) == 0)) {
+		fprintf(stderr, "%s: invalid order %d.\n", __func__, order);
+		return -1;
+	}
+
+	if (__fit_init(&fit, mask, order, resp) < 0)
+		return -1;
+
+	JtJ = calloc(order * order, sizeof(double));
+	A = calloc(order * order, sizeof(double));
+	if ((JtJ == NULL) || (A == NULL)) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+				strerror(errno));
+		free(JtJ);
+		free(A);
+		__fit_free(&fit);
+		return -1;
+	}
+
+	iter_max = ((cfg != NULL) && (cfg->iter_max > 0)) ?
+		cfg->iter_max : FIT_ITER_MAX;
+
+	for (i = 0; i < order; ++i) {
+		/* keep away from the unit circle */
+		double y = fmax(fmin(gamma[i], 1.0 - 1e-12), -1.0 + 1e-12);
+		theta[i] = atanh(y);
+		g[i] = tanh(theta[i]);
+	}
+
+	lambda = FIT_LAMBDA_INIT;
+	cost = __fit_eval(&fit, g, true);
+
+	for (it = 0; (it < iter_max) && (cost > 0); ++it) {
+		bool accept = false;
+
+		/* chain rule: d gamma / d theta = 1 - gamma^2 */
+		for (m = 0; m < fit.nres; ++m) {
+			if (fit.r[m] == 0)
+				continue;
+			for (i = 0; i < order; ++i)
+				fit.J[m * order + i] *= 1.0 - g[i] * g[i];
+		}
+
+		/* normal equations */
+		for (i = 0; i < order; ++i) {
+			double s = 0;
+
+			for (m = 0; m < fit.nres; ++m)
+				s += fit.J[m * order + i] * fit.r[m];
+			b[i] = -s;
+
+			for (j = 0; j <= i; ++j) {
+				s = 0;
+				for (m = 0; m < fit.nres; ++m)
+					s += fit.J[m * order + i] * fit.J[m * order + j];
+				JtJ[i * order + j] = s;
+				JtJ[j * order + i] = s;
+			}
+		}
+
+		while (lambda < FIT_LAMBDA_MAX) {
+			double c;
+
+			memcpy(A, JtJ, order * order * sizeof(double));
+			for (i = 0; i < order; ++i)
+				A[i * order + i] += lambda * JtJ[i * order + i] + 1e-12;
+
+			if (__chol_solve(A, x, b, order) == 0) {
+				for (i = 0; i < order; ++i)
+					t[i] = tanh(theta[i] + x[i]);
+
+				if ((c = __fit_eval(&fit, t, false)) < cost) {
+					for (i = 0; i < order; ++i) {
+						theta[i] += x[i];
+						g[i] = t[i];
+					}
+					lambda = fmax(lambda / 3, 1e-12);
+					accept = true;
+					break;
+				}
+			}
+			lambda *= 4;
+		}
+
+		if (!accept)
+			break; /* local minimum */
+
+		/* residuals and jacobian at the new point */
+		cost = __fit_eval(&fit, g, true);
+	}
+
+	/* max distance to the mask */
+	__fit_eval(&fit, g, false);
+	for (m = 0; m < fit.nres; ++m) {
+		double wt = ((m < fit.len) && (mask->wt != NULL)) ?
+			mask->wt[m] : 1.0;
+		e = fmax(e, fabs(fit.r[m]) / wt);
+	}
+	if (err != NULL)
+		*err = e;
+
+	memcpy(gamma, g, order * sizeof(double));
+
+	free(JtJ);
+	free(A);
+	__fit_free(&fit);
+
+	return (e <= LWDF_SPEC_TOL) ? 1 : 0;
+}
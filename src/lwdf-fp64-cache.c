@@ -0,0 +1,818 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-fp64-cache.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Frequency response cache
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Frequency responses are cached by their inputs: response type,
+ * samplerate, DFT length, gamma[] and the frequency vector w[]. A 64bit
+ * FNV-1a hash of these is used for the lookup, but the full record is
+ * compared before reporting a hit, so collisions are harmless.
+ *
+ * The in-memory cache keeps up to 'max' responses and evicts the
+ * least recently used one.
+ *
+ * The optional disk file is append only:
+ *
+ *   file   = struct cache_file_hdr record*
+ *   record = struct cache_rec, gamma[order], w[len], z[len]
+ *
+ * The file is memory mapped for reading, records appended by other
+ * processes are picked up when the mapping is refreshed. A truncated
+ * record at the end of the file (interrupted write) is ignored. The
+ * records are stored in the host byte order.
+ *
+ * The records carry the version of the response computation, records
+ * from another version never match. When an append would make the
+ * file larger than CACHE_FILE_MAX it is compacted in place: only the
+ * most recent records of the current version, up to half of the limit,
+ * are kept and the generation in the header is incremented. The other
+ * processes rebuild their index when the generation changes or the
+ * file shrinks. Readers hold a shared lock and writers an exclusive
+ * one, so a mapping is never accessed past the end of the file.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lwdf.h"
+
+#define CACHE_FILE_MAGIC "LWDFRC02"
+/* older file formats are discarded */
+#define CACHE_FILE_MAGIC_PREFIX "LWDFRC"
+#define CACHE_REC_MAGIC 0x52464457 /* "WDFR" */
+
+/* Version of the response computation, increment when the results of
+   lwdf_fp64_freq change */
+#define CACHE_ENGINE_VERSION 2
+
+/* Disk file size limit */
+#ifndef CACHE_FILE_MAX
+#define CACHE_FILE_MAX (64UL << 20)
+#endif
+
+/* Disk file header */
+struct cache_file_hdr {
+	char magic[8];
+	uint32_t gen; /* incremented by each compaction */
+	uint32_t rsvd;
+};
+
+/* Record header, the same layout is used in memory and on disk */
+struct cache_rec {
+	uint32_t magic;
+	uint32_t size; /* total record size in bytes */
+	uint64_t hash;
+	double samplerate;
+	uint32_t dftn;
+	uint16_t resp;
+	uint16_t order;
+	uint32_t len;
+	uint32_t version; /* CACHE_ENGINE_VERSION */
+	/* double gamma[order]; */
+	/* double w[len]; */
+	/* complex double z[len]; */
+	double data[];
+};
+
+/* In memory entry */
+struct cache_ent {
+	struct cache_ent * prev; /* LRU list */
+	struct cache_ent * next;
+	struct cache_ent * chain; /* hash bucket chain */
+	struct cache_rec rec;
+};
+
+/* Disk index slot (open addressing) */
+struct cache_slot {
+	uint64_t hash;
+	uint64_t offs; /* 0 means empty */
+};
+
+struct lwdf_fp64_cache {
+	pthread_mutex_t mutex;
+
+	/* In memory LRU */
+	size_t max; /* max number of entries */
+	size_t cnt; /* number of entries */
+	struct cache_ent * head; /* most recently used */
+	struct cache_ent * tail; /* least recently used */
+	size_t nbkt;
+	struct cache_ent ** bkt;
+
+	/* Disk file */
+	int fd;
+	uint8_t * map;
+	size_t map_size;
+	size_t scan_offs; /* file offset of the next record to be indexed */
+	uint32_t gen; /* file generation of the index */
+	size_t nslot;
+	size_t nused;
+	struct cache_slot * slot;
+
+	struct {
+		unsigned int hit;
+		unsigned int miss;
+	} stat;
+};
+
+/*
+ * FNV-1a hash
+ */
+
+#define FNV64_OFFS 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+static inline uint64_t __fnv64(uint64_t h, const void * buf, size_t len)
+{
+	const uint8_t * cp = (const uint8_t *)buf;
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		h ^= cp[i];
+		h *= FNV64_PRIME;
+	}
+
+	return h;
+}
+
+static size_t __rec_size(unsigned int order, size_t len)
+{
+	return sizeof(struct cache_rec) + order * sizeof(double) +
+		len * (sizeof(double) + sizeof(complex double));
+}
+
+/* Fill in a record header and key data (gamma and w) */
+static void __rec_key(struct cache_rec * rec, struct lwdf_fp64 * flt,
+					  unsigned int resp, size_t dftn,
+					  const double w[], size_t len)
+{
+	double * gamma = rec->data;
+	uint64_t h;
+
+	rec->magic = CACHE_REC_MAGIC;
+	rec->samplerate = lwdf_fp64_samplerate_get(flt);
+	rec->dftn = dftn;
+	rec->resp = resp;
+	rec->order = lwdf_fp64_gamma_get(flt, gamma, LWDF_ORDER_MAX);
+	rec->len = len;
+	rec->version = CACHE_ENGINE_VERSION;
+	rec->size = __rec_size(rec->order, len);
+	memcpy(&gamma[rec->order], w, len * sizeof(double));
+
+	h = FNV64_OFFS;
+	h = __fnv64(h, &rec->samplerate, sizeof(double));
+	h = __fnv64(h, &rec->dftn, sizeof(uint32_t));
+	h = __fnv64(h, &rec->resp, sizeof(uint16_t));
+	h = __fnv64(h, &rec->order, sizeof(uint16_t));
+	h = __fnv64(h, &rec->len, sizeof(uint32_t));
+	h = __fnv64(h, &rec->version, sizeof(uint32_t));
+	h = __fnv64(h, rec->data, (rec->order + len) * sizeof(double));
+	rec->hash = h;
+}
+
+/* Compare the keys of two records */
+static bool __rec_match(const struct cache_rec * a, const struct cache_rec * b)
+{
+	return (a->hash == b->hash) && (a->samplerate == b->samplerate) &&
+		(a->dftn == b->dftn) && (a->resp == b->resp) &&
+		(a->order == b->order) && (a->len == b->len) &&
+		(a->version == b->version) && (memcmp(a->data, b->data, (a->order + a->len) *
+				sizeof(double)) == 0);
+}
+
+static inline const complex double * __rec_z(const struct cache_rec * rec)
+{
+	return (const complex double *)&rec->data[rec->order + rec->len];
+}
+
+/* ---------------------------------------------------------------------------
+ * In memory LRU
+ * ---------------------------------------------------------------------------
+ */
+
+static void __lru_unlink(struct lwdf_fp64_cache * cache,
+						 struct cache_ent * ent)
+{
+	if (ent->prev != NULL)
+		ent->prev->next = ent->next;
+	else
+		cache->head = ent->next;
+
+	if (ent->next != NULL)
+		ent->next->prev = ent->prev;
+	else
+		cache->tail = ent->prev;
+}
+
+static void __lru_push(struct lwdf_fp64_cache * cache,
+					   struct cache_ent * ent)
+{
+	ent->prev = NULL;
+	ent->next = cache->head;
+	if (cache->head != NULL)
+		cache->head->prev = ent;
+	else
+		cache->tail = ent;
+	cache->head = ent;
+}
+
+static struct cache_ent * __mem_lookup(struct lwdf_fp64_cache * cache,
+									   const struct cache_rec * key)
+{
+	struct cache_ent * ent;
+
+	ent = cache->bkt[key->hash & (cache->nbkt - 1)];
+	while (ent != NULL) {
+		if (__rec_match(&ent->rec, key)) {
+			/* move to the front of the LRU list */
+			__lru_unlink(cache, ent);
+			__lru_push(cache, ent);
+			return ent;
+		}
+		ent = ent->chain;
+	}
+
+	return NULL;
+}
+
+static void __mem_remove(struct lwdf_fp64_cache * cache,
+						 struct cache_ent * ent)
+{
+	struct cache_ent ** pp;
+
+	pp = &cache->bkt[ent->rec.hash & (cache->nbkt - 1)];
+	while (*pp != ent)
+		pp = &(*pp)->chain;
+	*pp = ent->chain;
+
+	__lru_unlink(cache, ent);
+	cache->cnt--;
+	free(ent);
+}
+
+/* Insert a copy of the record, evicting the least recently used entry
+   if the cache is full */
+static int __mem_insert(struct lwdf_fp64_cache * cache,
+						const struct cache_rec * rec)
+{
+	struct cache_ent * ent;
+	size_t i;
+
+	if (cache->max == 0)
+		return 0;
+
+	while (cache->cnt >= cache->max)
+		__mem_remove(cache, cache->tail);
+
+	i = offsetof(struct cache_ent, rec) + rec->size;
+	if ((ent = malloc(i)) == NULL) {
+		fprintf(stderr, "%s: malloc() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	};
+
+	memcpy(&ent->rec, rec, rec->size);
+	i = rec->hash & (cache->nbkt - 1);
+	ent->chain = cache->bkt[i];
+	cache->bkt[i] = ent;
+	__lru_push(cache, ent);
+	cache->cnt++;
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Disk file
+ * ---------------------------------------------------------------------------
+ */
+
+static int __slot_insert(struct lwdf_fp64_cache * cache,
+						 uint64_t hash, uint64_t offs)
+{
+	size_t i;
+
+	if (2 * (cache->nused + 1) > cache->nslot) {
+		struct cache_slot * slot;
+		size_t nslot;
+		size_t j;
+
+		nslot = (cache->nslot == 0) ? 256 : 2 * cache->nslot;
+		if ((slot = calloc(nslot, sizeof(struct cache_slot))) == NULL) {
+			fprintf(stderr, "%s: calloc() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		};
+
+		/* rehash */
+		for (j = 0; j < cache->nslot; ++j) {
+			if (cache->slot[j].offs == 0)
+				continue;
+			i = cache->slot[j].hash & (nslot - 1);
+			while (slot[i].offs != 0)
+				i = (i + 1) & (nslot - 1);
+			slot[i] = cache->slot[j];
+		}
+
+		free(cache->slot);
+		cache->slot = slot;
+		cache->nslot = nslot;
+	}
+
+	i = hash & (cache->nslot - 1);
+	while (cache->slot[i].offs != 0)
+		i = (i + 1) & (cache->nslot - 1);
+	cache->slot[i].hash = hash;
+	cache->slot[i].offs = offs;
+	cache->nused++;
+
+	return 0;
+}
+
+static void __index_reset(struct lwdf_fp64_cache * cache)
+{
+	if (cache->slot != NULL)
+		memset(cache->slot, 0, cache->nslot * sizeof(struct cache_slot));
+	cache->nused = 0;
+	cache->scan_offs = 0;
+}
+
+/* Map the whole file and index the records not seen yet. Must be called
+   with the file locked. */
+static int __disk_sync(struct lwdf_fp64_cache * cache)
+{
+	const struct cache_file_hdr * hdr;
+	struct stat st;
+	size_t offs;
+
+	if (fstat(cache->fd, &st) < 0) {
+		fprintf(stderr, "%s: fstat() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+
+	/* truncated or compacted by another process, the offsets in the
+	   index are no longer valid */
+	if ((size_t)st.st_size < cache->map_size)
+		__index_reset(cache);
+
+	if ((size_t)st.st_size != cache->map_size) {
+		if (cache->map != NULL)
+			munmap(cache->map, cache->map_size);
+		cache->map = NULL;
+		cache->map_size = 0;
+
+		if ((size_t)st.st_size < sizeof(struct cache_file_hdr)) {
+			/* empty, the header is written by the next append */
+			__index_reset(cache);
+			return 0;
+		}
+
+		cache->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED,
+						  cache->fd, 0);
+		if (cache->map == MAP_FAILED) {
+			fprintf(stderr, "%s: mmap() failed: %s", __func__,
+					strerror(errno));
+			cache->map = NULL;
+			return -1;
+		}
+		cache->map_size = st.st_size;
+	}
+
+	if (cache->map == NULL)
+		return 0;
+
+	hdr = (const struct cache_file_hdr *)cache->map;
+	if (memcmp(hdr->magic, CACHE_FILE_MAGIC, 8) != 0) {
+		fprintf(stderr, "%s: invalid cache file.\n", __func__);
+		return -1;
+	}
+
+	/* compacted, possibly grown back past the old size */
+	if (hdr->gen != cache->gen) {
+		__index_reset(cache);
+		cache->gen = hdr->gen;
+	}
+
+	if (cache->scan_offs == 0)
+		cache->scan_offs = sizeof(struct cache_file_hdr);
+
+	offs = cache->scan_offs;
+	while (offs + sizeof(struct cache_rec) <= cache->map_size) {
+		const struct cache_rec * rec;
+
+		rec = (const struct cache_rec *)(cache->map + offs);
+		if ((rec->magic != CACHE_REC_MAGIC) ||
+			(rec->size != __rec_size(rec->order, rec->len)))
+			break; /* corrupted, stop indexing */
+		if (offs + rec->size > cache->map_size)
+			break; /* incomplete */
+
+		if (__slot_insert(cache, rec->hash, offs) < 0)
+			return -1;
+
+		offs += rec->size;
+	}
+	cache->scan_offs = offs;
+
+	return 0;
+}
+
+static const struct cache_rec * __disk_lookup(struct lwdf_fp64_cache * cache,
+											  const struct cache_rec * key)
+{
+	size_t i;
+
+	if (__disk_sync(cache) < 0)
+		return NULL;
+
+	if (cache->nslot == 0)
+		return NULL;
+
+	i = key->hash & (cache->nslot - 1);
+	while (cache->slot[i].offs != 0) {
+		if (cache->slot[i].hash == key->hash) {
+			const struct cache_rec * rec;
+
+			rec = (const struct cache_rec *)(cache->map +
+											 cache->slot[i].offs);
+			if (__rec_match(rec, key))
+				return rec;
+		}
+		i = (i + 1) & (cache->nslot - 1);
+	}
+
+	return NULL;
+}
+
+static int __disk_write(int fd, const void * buf, size_t len)
+{
+	const uint8_t * cp = (const uint8_t *)buf;
+
+	while (len > 0) {
+		ssize_t n;
+
+		if ((n = write(fd, cp, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "%s: write() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		}
+		cp += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* Empty the file and write a new header */
+static int __disk_reset(int fd, uint32_t gen)
+{
+	struct cache_file_hdr hdr;
+
+	if (ftruncate(fd, 0) < 0) {
+		fprintf(stderr, "%s: ftruncate() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CACHE_FILE_MAGIC, 8);
+	hdr.gen = gen;
+
+	return __disk_write(fd, &hdr, sizeof(hdr));
+}
+
+/* Keep the most recent records of the current version, up to half of
+   the size limit. Must be called with the file exclusively locked,
+   after __disk_sync(). */
+static int __disk_compact(struct lwdf_fp64_cache * cache)
+{
+	size_t end = cache->scan_offs;
+	size_t offs;
+	size_t keep;
+	size_t n = 0;
+	uint8_t * buf;
+	int ret;
+
+	/* first record to keep */
+	offs = sizeof(struct cache_file_hdr);
+	while ((offs < end) && (end - offs > CACHE_FILE_MAX / 2)) {
+		const struct cache_rec * rec;
+
+		rec = (const struct cache_rec *)(cache->map + offs);
+		offs += rec->size;
+	}
+	keep = offs;
+
+	if ((buf = malloc(end - keep + 1)) == NULL) {
+		fprintf(stderr, "%s: malloc() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+
+	for (offs = keep; offs < end; ) {
+		const struct cache_rec * rec;
+
+		rec = (const struct cache_rec *)(cache->map + offs);
+		if (rec->version == CACHE_ENGINE_VERSION) {
+			memcpy(&buf[n], rec, rec->size);
+			n += rec->size;
+		}
+		offs += rec->size;
+	}
+
+	munmap(cache->map, cache->map_size);
+	cache->map = NULL;
+	cache->map_size = 0;
+
+	if ((ret = __disk_reset(cache->fd, cache->gen + 1)) == 0)
+		ret = __disk_write(cache->fd, buf, n);
+	free(buf);
+
+	if (ret < 0)
+		return -1;
+
+	return __disk_sync(cache);
+}
+
+/* Must be called with the file exclusively locked, after __disk_sync() */
+static int __disk_append(struct lwdf_fp64_cache * cache,
+						 const struct cache_rec * rec)
+{
+	if (rec->size > CACHE_FILE_MAX / 2)
+		return 0; /* too large to be worth keeping */
+
+	/* drop an incomplete record left by an interrupted write, the
+	   appended ones would not be reachable */
+	if ((cache->map != NULL) && (cache->scan_offs < cache->map_size)) {
+		if (ftruncate(cache->fd, cache->scan_offs) < 0) {
+			fprintf(stderr, "%s: ftruncate() failed: %s", __func__,
+					strerror(errno));
+			return -1;
+		}
+		if (__disk_sync(cache) < 0)
+			return -1;
+	}
+
+	if (cache->map_size + rec->size > CACHE_FILE_MAX) {
+		if (__disk_compact(cache) < 0)
+			return -1;
+	}
+
+	if ((cache->map_size == 0) && (__disk_reset(cache->fd, cache->gen + 1) < 0))
+		return -1;
+
+	return __disk_write(cache->fd, rec, rec->size);
+}
+
+static int __disk_open(struct lwdf_fp64_cache * cache, const char * path)
+{
+	struct cache_file_hdr hdr;
+	ssize_t n;
+	int ret;
+	int fd;
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0) {
+		fprintf(stderr, "%s: open(\"%s\") failed: %s", __func__,
+				path, strerror(errno));
+		return -1;
+	}
+
+	flock(fd, LOCK_EX);
+
+	ret = 0;
+	if ((n = pread(fd, &hdr, sizeof(hdr), 0)) == 0) {
+		/* new file */
+		ret = __disk_reset(fd, 0);
+	} else if ((n != sizeof(hdr)) ||
+			   (memcmp(hdr.magic, CACHE_FILE_MAGIC, 8) != 0)) {
+		if ((n >= 6) && (memcmp(hdr.magic, CACHE_FILE_MAGIC_PREFIX, 6) == 0)) {
+			/* older format */
+			ret = __disk_reset(fd, 0);
+		} else {
+			fprintf(stderr, "%s: \"%s\" is not a cache file.\n", __func__,
+					path);
+			ret = -1;
+		}
+	}
+
+	cache->fd = fd;
+	if ((ret < 0) || (__disk_sync(cache) < 0)) {
+		flock(fd, LOCK_UN);
+		if (cache->map != NULL)
+			munmap(cache->map, cache->map_size);
+		cache->map = NULL;
+		cache->map_size = 0;
+		cache->fd = -1;
+		close(fd);
+		return -1;
+	}
+
+	flock(fd, LOCK_UN);
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * API
+ * ---------------------------------------------------------------------------
+ */
+
+/*
+ * Create a frequency response cache holding up to 'max' responses in
+ * memory. If 'path' is not NULL the responses are also stored in this
+ * file and loaded from it on demand.
+ */
+struct lwdf_fp64_cache * lwdf_fp64_cache_new(size_t max, const char * path)
+{
+	struct lwdf_fp64_cache * cache;
+	size_t nbkt;
+
+	if ((cache = calloc(1, sizeof(struct lwdf_fp64_cache))) == NULL) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+			strerror(errno));
+		return NULL;
+	};
+
+	/* power of 2 buckets, about one entry per bucket */
+	for (nbkt = 16; nbkt < max; nbkt *= 2);
+
+	if ((cache->bkt = calloc(nbkt, sizeof(struct cache_ent *))) == NULL) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+			strerror(errno));
+		free(cache);
+		return NULL;
+	};
+
+	pthread_mutex_init(&cache->mutex, NULL);
+	cache->nbkt = nbkt;
+	cache->max = max;
+	cache->fd = -1;
+
+	if ((path != NULL) && (__disk_open(cache, path) < 0)) {
+		lwdf_fp64_cache_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void lwdf_fp64_cache_free(struct lwdf_fp64_cache * cache)
+{
+	assert(cache != NULL);
+
+	while (cache->tail != NULL)
+		__mem_remove(cache, cache->tail);
+
+	if (cache->map != NULL)
+		munmap(cache->map, cache->map_size);
+	if (cache->fd >= 0)
+		close(cache->fd);
+
+	pthread_mutex_destroy(&cache->mutex);
+	free(cache->slot);
+	free(cache->bkt);
+	free(cache);
+}
+
+/*
+ * Look up the response of the filter at the frequencies w[]. On a hit
+ * the stored response is copied to z[] and len is returned, 0 is
+ * returned on a miss.
+ */
+ssize_t lwdf_fp64_cache_get(struct lwdf_fp64_cache * cache,
+							struct lwdf_fp64 * flt, unsigned int resp,
+							size_t dftn, const double w[],
+							complex double z[], size_t len)
+{
+	const struct cache_rec * rec = NULL;
+	struct cache_rec * key;
+	struct cache_ent * ent;
+
+	assert(cache != NULL);
+	assert(flt != NULL);
+
+	if ((key = malloc(__rec_size(LWDF_ORDER_MAX, len))) == NULL) {
+		fprintf(stderr, "%s: malloc() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	};
+
+	__rec_key(key, flt, resp, dftn, w, len);
+
+	pthread_mutex_lock(&cache->mutex);
+
+	if ((ent = __mem_lookup(cache, key)) != NULL) {
+		rec = &ent->rec;
+		memcpy(z, __rec_z(rec), len * sizeof(complex double));
+	} else if (cache->fd >= 0) {
+		flock(cache->fd, LOCK_SH);
+		if ((rec = __disk_lookup(cache, key)) != NULL) {
+			memcpy(z, __rec_z(rec), len * sizeof(complex double));
+			/* promote to memory */
+			__mem_insert(cache, rec);
+		}
+		flock(cache->fd, LOCK_UN);
+	}
+
+	if (rec != NULL)
+		cache->stat.hit++;
+	else
+		cache->stat.miss++;
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	free(key);
+
+	return (rec != NULL) ? len : 0;
+}
+
+/*
+ * Store the response z[] of the filter at the frequencies w[].
+ */
+int lwdf_fp64_cache_put(struct lwdf_fp64_cache * cache,
+						struct lwdf_fp64 * flt, unsigned int resp,
+						size_t dftn, const double w[],
+						const complex double z[], size_t len)
+{
+	struct cache_rec * rec;
+	int ret = 0;
+
+	assert(cache != NULL);
+	assert(flt != NULL);
+
+	if ((rec = malloc(__rec_size(LWDF_ORDER_MAX, len))) == NULL) {
+		fprintf(stderr, "%s: malloc() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	};
+
+	__rec_key(rec, flt, resp, dftn, w, len);
+	memcpy((void *)__rec_z(rec), z, len * sizeof(complex double));
+
+	pthread_mutex_lock(&cache->mutex);
+
+	if (__mem_lookup(cache, rec) == NULL) {
+		ret = __mem_insert(cache, rec);
+		if ((ret == 0) && (cache->fd >= 0)) {
+			/* serialize writers from other processes */
+			flock(cache->fd, LOCK_EX);
+			if ((__disk_sync(cache) == 0) &&
+				(__disk_lookup(cache, rec) == NULL))
+				ret = __disk_append(cache, rec);
+			flock(cache->fd, LOCK_UN);
+		}
+	}
+
+	pthread_mutex_unlock(&cache->mutex);
+
+	free(rec);
+
+	return ret;
+}
+
+void lwdf_fp64_cache_stat(struct lwdf_fp64_cache * cache,
+						  unsigned int * hit, unsigned int * miss)
+{
+	assert(cache != NULL);
+
+	pthread_mutex_lock(&cache->mutex);
+	if (hit != NULL)
+		*hit = cache->stat.hit;
+	if (miss != NULL)
+		*miss = cache->stat.miss;
+	pthread_mutex_unlock(&cache->mutex);
+}
@@ -45,6 +45,7 @@ _Pragma ("GCC optimize (\"Ofast\")")
 struct lwdf_fp64_freq {
 	bool log;
 	struct lwdf_fp64 * flt;
+	struct lwdf_fp64_cache * cache; /* optional response cache */
 
 	size_t max_len; /* allocated vector length */
 
@@ -241,6 +242,239 @@ ssize_t lwdf_fp64_freq_log_set(struct lwdf_fp64_freq * ffr,
 	return ffr->len = cnt;
 }
 
+/*
+ * Adaptive frequency grid.
+ *
+ * The grid starts with ADAPT_INIT_CNT uniform intervals between w0 and
+ * w1 and the interval with the largest error is bisected until all
+ * the errors are below tol or npts points are used. The error of an
+ * interval is the deviation of the response at its midpoint from the
+ * linear interpolation of its end points:
+ *
+ *   err = max(|dB(m) - dB(a) - t (dB(b) - dB(a))| / (20/ln(10)),
+ *             |ph(m) - ph(a) - t (ph(b) - ph(a))|),  t = (m - a)/(b - a)
+ *
+ * which is the relative error (nepers and radians) of the interpolated
+ * response. The tolerance is given in dB. The response is evaluated
+ * analytically, so the refinement is cheap, and it converges on the
+ * band edges and on the transmission zeros (phase jumps of pi).
+ *
+ * The points are snapped to the DFT lattice w = m / dftn (m even), an
+ * interval is not split further when it spans a single lattice step.
+ */
+
+#define ADAPT_INIT_CNT 16
+#define ADAPT_DB_MIN -200.0
+
+struct adapt_node {
+	int m; /* lattice index */
+	double db;
+	double ph;
+};
+
+struct adapt_itv {
+	double err;
+	int a; /* node index of the end points */
+	int b;
+	struct adapt_node mid;
+};
+
+static void __adapt_eval(struct lwdf_fp64 * flt, size_t dftn,
+						 struct adapt_node * nd)
+{
+	struct lwdf_resp_vec rv;
+	double w = (double)nd->m / dftn;
+	double mag;
+
+	memset(&rv, 0, sizeof(rv));
+	rv.mag = &mag;
+	rv.ph = &nd->ph;
+	lwdf_fp64_resp_eval(flt, LWDF_RESP_LOWPASS, &w, 1, &rv);
+
+	nd->db = (mag > 0) ? 20 * log10(mag) : ADAPT_DB_MIN;
+	if (nd->db < ADAPT_DB_MIN)
+		nd->db = ADAPT_DB_MIN;
+}
+
+/* Create an interval between two nodes, evaluating its midpoint */
+static void __adapt_itv(struct lwdf_fp64 * flt, size_t dftn,
+						const struct adapt_node nd[], int a, int b,
+						struct adapt_itv * itv)
+{
+	double edb;
+	double eph;
+	double t;
+
+	itv->a = a;
+	itv->b = b;
+
+	if (nd[b].m - nd[a].m < 4) {
+		/* can't be split */
+		itv->err = 0;
+		return;
+	}
+
+	itv->mid.m = ((nd[a].m + nd[b].m) / 4) * 2;
+	__adapt_eval(flt, dftn, &itv->mid);
+
+	/* the snapped point is not always at the middle, interpolate at
+	   its actual position */
+	t = (double)(itv->mid.m - nd[a].m) / (nd[b].m - nd[a].m);
+	edb = fabs(itv->mid.db - (nd[a].db + t * (nd[b].db - nd[a].db))) /
+		(20 / M_LN10);
+	eph = fabs(itv->mid.ph - (nd[a].ph + t * (nd[b].ph - nd[a].ph)));
+	itv->err = (edb > eph) ? edb : eph;
+}
+
+/* Max-heap of intervals ordered by error */
+static void __heap_push(struct adapt_itv hp[], int n, 
+						const struct adapt_itv * itv)
+{
+	int i = n;
+
+	while (i > 0) {
+		int p = (i - 1) / 2;
+		if (hp[p].err >= itv->err)
+			break;
+		hp[i] = hp[p];
+		i = p;
+	}
+	hp[i] = *itv;
+}
+
+static void __heap_pop(struct adapt_itv hp[], int n, struct adapt_itv * itv)
+{
+	struct adapt_itv last = hp[n - 1];
+	int i = 0;
+
+	*itv = hp[0];
+	n--;
+
+	for (;;) {
+		int c = 2 * i + 1;
+		if (c >= n)
+			break;
+		if ((c + 1 < n) && (hp[c + 1].err > hp[c].err))
+			c++;
+		if (last.err >= hp[c].err)
+			break;
+		hp[i] = hp[c];
+		i = c;
+	}
+	hp[i] = last;
+}
+
+static int __adapt_node_cmp(const void * a, const void * b)
+{
+	return ((const struct adapt_node *)a)->m - 
+		((const struct adapt_node *)b)->m;
+}
+
+ssize_t lwdf_fp64_freq_adapt_set(struct lwdf_fp64_freq * ffr,
+								 double w0, double w1, ssize_t npts,
+								 double tol)
+{
+	struct adapt_node * nd;
+	struct adapt_itv * hp;
+	struct adapt_itv itv;
+	struct lwdf_fp64 * flt;
+	size_t dftn;
+	int nhp;
+	int cnt;
+	int m0;
+	int m1;
+	int i;
+
+	assert(ffr != NULL);
+	assert(ffr->flt != NULL);
+	assert(npts >= 2);
+	assert(tol > 0);
+
+	flt = ffr->flt;
+	dftn = ffr->dftn;
+
+	/* lattice limits */
+	m0 = (int)(round(dftn * w0 / 2) * 2);
+	m1 = (int)(round(dftn * w1 / 2) * 2);
+	if (m0 < 2)
+		m0 = 2;
+	if (m1 > (int)dftn / 2)
+		m1 = dftn / 2;
+	if (m1 <= m0) {
+		fprintf(stderr, "%s: invalid frequency range.\n", __func__);
+		return -1;
+	}
+
+	if (__lwdf_fp64_vec_realloc(ffr, npts) < 0)
+		return -1;
+
+	if ((nd = calloc(npts, sizeof(struct adapt_node))) == NULL) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+			strerror(errno));
+		return -1;
+	};
+
+	if ((hp = calloc(npts, sizeof(struct adapt_itv))) == NULL) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+			strerror(errno));
+		free(nd);
+		return -1;
+	};
+
+	/* initial grid */
+	cnt = 0;
+	for (i = 0; (i <= ADAPT_INIT_CNT) && (cnt < npts); ++i) {
+		int m = m0 + (int)(((double)(m1 - m0) * i) / ADAPT_INIT_CNT / 2) * 2;
+
+		if ((cnt > 0) && (m == nd[cnt - 1].m))
+			continue;
+		nd[cnt].m = m;
+		__adapt_eval(flt, dftn, &nd[cnt]);
+		cnt++;
+	}
+
+	nhp = 0;
+	for (i = 1; i < cnt; ++i) {
+		__adapt_itv(flt, dftn, nd, i - 1, i, &itv);
+		__heap_push(hp, nhp++, &itv);
+	}
+
+	/* refine the worst interval */
+	while ((nhp > 0) && (cnt < npts)) {
+		struct adapt_itv lo;
+		struct adapt_itv hi;
+		int k;
+
+		if (hp[0].err <= tol / (20 / M_LN10))
+			break;
+
+		__heap_pop(hp, nhp--, &itv);
+
+		k = cnt++;
+		nd[k] = itv.mid;
+
+		__adapt_itv(flt, dftn, nd, itv.a, k, &lo);
+		__adapt_itv(flt, dftn, nd, k, itv.b, &hi);
+		__heap_push(hp, nhp++, &lo);
+		__heap_push(hp, nhp++, &hi);
+	}
+
+#if (DEBUG > 1)
+	fprintf(stderr, "%s: cnt=%d err=%g\n", __func__, cnt, 
+			(nhp > 0) ? hp[0].err * (20 / M_LN10) : 0.0);
+#endif
+
+	qsort(nd, cnt, sizeof(struct adapt_node), __adapt_node_cmp);
+
+	for (i = 0; i < cnt; ++i)
+		ffr->w[i] = (double)nd[i].m / dftn;
+
+	free(hp);
+	free(nd);
+
+	return ffr->len = cnt;
+}
+
 /*
  * Create a new LWDF frequency analysis object
  */
@@ -345,6 +579,16 @@ void lwdf_fp64_freq_free(struct lwdf_fp64_freq * ffr)
 	free(ffr);
 }
 
+int lwdf_fp64_freq_cache_set(struct lwdf_fp64_freq * ffr,
+							 struct lwdf_fp64_cache * cache)
+{
+	assert(ffr != NULL);
+
+	ffr->cache = cache;
+
+	return 0;
+}
+
 void plt_dbg(double y[], size_t npts);
 
 ssize_t lwdf_fp64_lowwpass_freq_resp(struct lwdf_fp64_freq * ffr,
@@ -378,6 +622,11 @@ ssize_t lwdf_fp64_lowwpass_freq_resp(struct lwdf_fp64_freq * ffr,
 	n = ffr->len;
 	dftn = ffr->dftn;
 
+	if ((ffr->cache != NULL) && 
+		(lwdf_fp64_cache_get(ffr->cache, flt, LWDF_RESP_LOWPASS, 
+							 dftn, w, z, n) > 0))
+		goto done;
+
 	for (k = 0; k < n; ++k) {
 #if FREQ_RESP_WND 
 		unsigned int i;
@@ -406,6 +655,11 @@ ssize_t lwdf_fp64_lowwpass_freq_resp(struct lwdf_fp64_freq * ffr,
 
 	}
 
+	if (ffr->cache != NULL)
+		lwdf_fp64_cache_put(ffr->cache, flt, LWDF_RESP_LOWPASS, 
+							dftn, w, z, n);
+
+done:
 	if (pz != NULL)
 		*pz = z;
 
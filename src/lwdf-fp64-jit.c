@@ -0,0 +1,179 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-fp64-jit.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: native kernels of a double precision filter
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The block loops of lwdf_cgen() in double precision, with the
+ * coefficients as constants, are compiled into a shared object and
+ * loaded with dlopen(). The generated code keeps the state layout of
+ * the runtime filter, st[k] is the state of the adaptor k, so the
+ * native and the generic kernels can be switched at any sample.
+ *
+ * Filters with the same coefficients, the channels of a stream, share
+ * one library. Each filter holds a reference, the library is unloaded
+ * when the last one drops its kernels.
+ *
+ * The compiler is $CC, default cc, with -O2 -march=native.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <stdatomic.h>
+
+#include "lwdf.h"
+
+#define JIT_PREFIX "lwdf_jit_"
+
+/* Loaded library, one reference per filter */
+struct jit_lib {
+	void * dl;
+	atomic_uint ref;
+};
+
+static void __jit_release(void * arg)
+{
+	struct jit_lib * lib = (struct jit_lib *)arg;
+
+	if (atomic_fetch_sub(&lib->ref, 1) == 1) {
+		dlclose(lib->dl);
+		free(lib);
+	}
+}
+
+int lwdf_fp64_jit_shared(struct lwdf_fp64 * flt[], unsigned int cnt)
+{
+	char dir[] = "/tmp/lwdf-jit-XXXXXX";
+	const char * cc = getenv("CC");
+	struct lwdfwiz_param wiz;
+	struct lwdf_info inf;
+	lwdf_fp64_kernel_t lp;
+	lwdf_fp64_kernel_t hp;
+	struct jit_lib * jl;
+	char src[64];
+	char lib[64];
+	char cmd[512];
+	void * dl;
+	FILE * f;
+	unsigned int k;
+	int ret;
+	int n;
+
+	if (cnt == 0)
+		return 0;
+
+	n = lwdf_fp64_gamma_get(flt[0], inf.gamma, LWDF_ORDER_MAX);
+	if ((n <= 0) || ((n & 1) == 0)) {
+		fprintf(stderr, "%s: invalid order %d.\n", __func__, n);
+		return -1;
+	}
+
+	/* the kernels have the coefficients built in */
+	for (k = 1; k < cnt; ++k) {
+		double g[LWDF_ORDER_MAX];
+
+		if ((lwdf_fp64_gamma_get(flt[k], g, LWDF_ORDER_MAX) != n) ||
+			(memcmp(g, inf.gamma, n * sizeof(double)) != 0)) {
+			fprintf(stderr, "%s: filter %u: other coefficients.\n",
+					__func__, k);
+			return -1;
+		}
+	}
+
+	memset(&wiz, 0, sizeof(wiz));
+	wiz.samplerate = lwdf_fp64_samplerate_get(flt[0]);
+	wiz.order = n;
+	wiz.fp64 = true;
+	inf.order = n;
+
+	if (cc == NULL)
+		cc = "cc";
+
+	if (mkdtemp(dir) == NULL) {
+		fprintf(stderr, "%s: mkdtemp(): %s.\n", __func__, strerror(errno));
+		return -1;
+	}
+	snprintf(src, sizeof(src), "%s/jit.c", dir);
+	snprintf(lib, sizeof(lib), "%s/jit.so", dir);
+
+	if ((f = fopen(src, "w")) == NULL) {
+		fprintf(stderr, "%s: %s: %s.\n", __func__, src, strerror(errno));
+		rmdir(dir);
+		return -1;
+	}
+	ret = lwdf_cgen(f, JIT_PREFIX, &wiz, &inf);
+	fclose(f);
+
+	if (ret >= 0) {
+		snprintf(cmd, sizeof(cmd), "%s -O2 -march=native -fPIC -shared "
+				 "-o %s %s 2>/dev/null", cc, lib, src);
+		if ((ret = system(cmd)) != 0)
+			fprintf(stderr, "%s: \"%s\" failed.\n", __func__, cmd);
+	}
+
+	dl = NULL;
+	if (ret == 0) {
+		/* the mapping stays after the file is removed */
+		if ((dl = dlopen(lib, RTLD_NOW | RTLD_LOCAL)) == NULL)
+			fprintf(stderr, "%s: dlopen(): %s.\n", __func__, dlerror());
+	}
+
+	unlink(src);
+	unlink(lib);
+	rmdir(dir);
+
+	if (dl == NULL)
+		return -1;
+
+	lp = (lwdf_fp64_kernel_t)dlsym(dl, JIT_PREFIX "lp_filter");
+	hp = (lwdf_fp64_kernel_t)dlsym(dl, JIT_PREFIX "hp_filter");
+	if ((lp == NULL) || (hp == NULL)) {
+		fprintf(stderr, "%s: dlsym(): %s.\n", __func__, dlerror());
+		dlclose(dl);
+		return -1;
+	}
+
+	if ((jl = malloc(sizeof(struct jit_lib))) == NULL) {
+		dlclose(dl);
+		return -1;
+	}
+	jl->dl = dl;
+	atomic_init(&jl->ref, cnt);
+
+	for (k = 0; k < cnt; ++k)
+		lwdf_fp64_kernel_set(flt[k], lp, hp, __jit_release, jl);
+
+	return 0;
+}
+
+int lwdf_fp64_jit(struct lwdf_fp64 * flt)
+{
+	return lwdf_fp64_jit_shared(&flt, 1);
+}
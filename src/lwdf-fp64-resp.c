@@ -0,0 +1,251 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-fp64-resp.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Analytic frequency response (magnitude, phase, group delay)
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The lattice filter is the sum (lowpass) or difference (highpass) of
+ * two allpass branches:
+ *
+ *   upper: gamma[0] first order, then sections (gamma[4k+3], gamma[4k+4])
+ *   lower: sections (gamma[4k+1], gamma[4k+2])
+ *
+ * A first order section is:
+ *
+ *   A(z) = (-g + z^-1) / (1 - g z^-1)
+ *
+ * A second order section (g1 outer, g2 inner adaptor) is:
+ *
+ *   A(z) = (a2 + a1 z^-1 + z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ *   a1 = g2 (g1 - 1), a2 = -g1
+ *
+ * With D(w) = 1 + a1 e^-jw + a2 e^-j2w, each section of order N has:
+ *
+ *   phase(w) = -N w - 2 arg(D(w))
+ *   delay(w) = N - 2 Re(sum(k ak e^-jkw) / D(w))
+ *
+ * All the poles are inside the unit circle, so arg(D) stays in
+ * (-pi, pi) and the branch phases are continuous without unwrapping.
+ * If pa and pb are the branch phases:
+ *
+ *   lowpass:  H = e^j(pa + pb)/2 cos((pa - pb)/2)
+ *   highpass: H = e^j(pa + pb)/2 j sin((pa - pb)/2)
+ *
+ * The returned phase jumps by pi at the transmission zeros, where the
+ * real amplitude changes sign. The group delay is the average of the
+ * branch delays.
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <assert.h>
+#include <string.h>
+
+#include "lwdf.h"
+
+/* Phase and group delay of one allpass section */
+static inline void __sect_eval(complex double e1, complex double e2,
+							   double a1, double a2, unsigned int n,
+							   double w, double * ph, double * gd)
+{
+	complex double d;
+	complex double s;
+
+	d = 1.0 + a1 * e1 + a2 * e2;
+	s = a1 * e1 + 2.0 * a2 * e2;
+
+	*ph += -(double)n * w - 2.0 * carg(d);
+	*gd += (double)n - 2.0 * creal(s / d);
+}
+
+/* Phase and group delay of the two branches at w (rad/samp) */
+static void __branch_eval(const double gamma[], unsigned int order,
+						  double w, double ph[2], double gd[2])
+{
+	complex double e1;
+	complex double e2;
+	unsigned int k;
+
+	e1 = cos(w) - I * sin(w);
+	e2 = e1 * e1;
+
+	ph[0] = 0;
+	gd[0] = 0;
+	ph[1] = 0;
+	gd[1] = 0;
+
+	/* upper branch: first order section, gamma[0] = -1 is A(z) = 1 and
+	   gamma[0] = 1 is A(z) = -1 (see lwdf_xform()) */
+	if (gamma[0] == 1.0)
+		ph[0] = M_PI;
+	else if (gamma[0] != -1.0)
+		__sect_eval(e1, e2, -gamma[0], 0.0, 1, w, &ph[0], &gd[0]);
+
+	for (k = 1; k + 1 < order; k += 2) {
+		double g1 = gamma[k];
+		double g2 = gamma[k + 1];
+		/* (1,2), (5,6), ... lower; (3,4), (7,8), ... upper */
+		unsigned int b = (((k - 1) / 2) & 1) ? 0 : 1;
+
+		__sect_eval(e1, e2, g2 * (g1 - 1.0), -g1, 2, w, &ph[b], &gd[b]);
+	}
+}
+
+/*
+ * Analytic response of a lattice filter given its coefficients.
+ *
+ * w[]: normalized frequencies (cyc/samp), len points.
+ * Any of the output vectors in rv can be NULL.
+ */
+ssize_t lwdf_resp_eval(const double gamma[], unsigned int order,
+					   unsigned int resp, const double w[], size_t len,
+					   const struct lwdf_resp_vec * rv)
+{
+	unsigned int i;
+
+	assert(gamma != NULL);
+	assert(w != NULL);
+	assert(rv != NULL);
+
+	if ((order < 1) || (order > LWDF_ORDER_MAX) || ((order & 1) == 0)) {
+		fprintf(stderr, "%s: invalid order %d.\n", __func__, order);
+		return -1;
+	}
+
+	for (i = 0; i < len; ++i) {
+		double wr = (double)(2.0 * M_PI) * w[i];
+		double ph[2];
+		double gd[2];
+		double a;
+		double p;
+
+		__branch_eval(gamma, order, wr, ph, gd);
+
+		p = (ph[0] + ph[1]) / 2;
+		if (resp == LWDF_RESP_HIGHPASS) {
+			a = sin((ph[0] - ph[1]) / 2);
+			p += M_PI / 2;
+		} else {
+			a = cos((ph[0] - ph[1]) / 2);
+		}
+
+		if (a < 0) {
+			a = -a;
+			p += M_PI;
+		}
+
+		if (rv->mag != NULL)
+			rv->mag[i] = a;
+		if (rv->ph != NULL)
+			rv->ph[i] = p;
+		if (rv->gd != NULL)
+			rv->gd[i] = (gd[0] + gd[1]) / 2;
+		if (rv->pd != NULL)
+			rv->pd[i] = (wr > 0) ? -p / wr : (gd[0] + gd[1]) / 2;
+	}
+
+	return len;
+}
+
+/*
+ * Analytic response of a run time filter
+ */
+ssize_t lwdf_fp64_resp_eval(struct lwdf_fp64 * flt, unsigned int resp,
+							const double w[], size_t len,
+							const struct lwdf_resp_vec * rv)
+{
+	double gamma[LWDF_ORDER_MAX];
+	ssize_t cnt;
+
+	assert(flt != NULL);
+
+	cnt = lwdf_fp64_gamma_get(flt, gamma, LWDF_ORDER_MAX);
+
+	return lwdf_resp_eval(gamma, cnt, resp, w, len, rv);
+}
+
+#define SPEC_GRID_NPTS 256
+
+/*
+ * Check a lowpass response against the specification mask of wiz:
+ * attenuation spread below ap in [0, fp] and attenuation above asmin
+ * in [fs, F/2]. The margins (dB) are positive when the specification
+ * is met. The mask is sampled on a uniform grid of each band.
+ *
+ * Returns 1 if the mask is met, 0 otherwise.
+ */
+int lwdf_spec_margin(const struct lwdfwiz_param * wiz,
+					 const double gamma[], unsigned int order,
+					 double * as_margin, double * ap_margin)
+{
+	double w[SPEC_GRID_NPTS + 1];
+	double mag[SPEC_GRID_NPTS + 1];
+	struct lwdf_resp_vec rv;
+	double amin;
+	double amax;
+	double wp;
+	double ws;
+	int i;
+
+	memset(&rv, 0, sizeof(rv));
+	rv.mag = mag;
+
+	wp = wiz->fp / wiz->samplerate;
+	ws = wiz->fs / wiz->samplerate;
+
+	/* passband: max attenuation */
+	for (i = 0; i <= SPEC_GRID_NPTS; ++i)
+		w[i] = (wp * i) / SPEC_GRID_NPTS;
+	if (lwdf_resp_eval(gamma, order, LWDF_RESP_LOWPASS, w,
+					   SPEC_GRID_NPTS + 1, &rv) < 0)
+		return 0;
+	amax = 0;
+	for (i = 0; i <= SPEC_GRID_NPTS; ++i) {
+		double a = -20 * log10(mag[i]);
+		if (a > amax)
+			amax = a;
+	}
+
+	/* stopband: min attenuation */
+	for (i = 0; i <= SPEC_GRID_NPTS; ++i)
+		w[i] = ws + ((0.5 - ws) * i) / SPEC_GRID_NPTS;
+	lwdf_resp_eval(gamma, order, LWDF_RESP_LOWPASS, w,
+				   SPEC_GRID_NPTS + 1, &rv);
+	amin = 400;
+	for (i = 0; i <= SPEC_GRID_NPTS; ++i) {
+		double a = (mag[i] > 0) ? -20 * log10(mag[i]) : 400;
+		if (a < amin)
+			amin = a;
+	}
+
+	if (as_margin != NULL)
+		*as_margin = amin - wiz->asmin;
+	if (ap_margin != NULL)
+		*ap_margin = wiz->ap - amax;
+
+	return ((amin - wiz->asmin) >= -LWDF_SPEC_TOL) &&
+		((wiz->ap - amax) >= -LWDF_SPEC_TOL);
+}
@@ -32,6 +32,7 @@ _Pragma ("GCC optimize (\"Ofast\")")
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 
 /* Number of coefficients is the same as order in most cases */
@@ -56,8 +57,27 @@ struct lwdf_fp64 {
 		uint16_t cnt;
 		double t[LWDF_STATE_MAX];
 	} state;
+
+	/* Native kernels of the current coefficients */
+	struct {
+		lwdf_fp64_kernel_t lp;
+		lwdf_fp64_kernel_t hp;
+		void (* release)(void *);
+		void * arg;
+	} kern;
 };
 
+static void __lwdf_fp64_kernel_drop(struct lwdf_fp64 * flt)
+{
+	if (flt->kern.release != NULL)
+		flt->kern.release(flt->kern.arg);
+
+	flt->kern.lp = NULL;
+	flt->kern.hp = NULL;
+	flt->kern.release = NULL;
+	flt->kern.arg = NULL;
+}
+
 
 static inline void lwd_adaptor0(double g, double in1, double in2, 
 								double *out1, double *out2)
@@ -413,70 +433,6 @@ static double lwdf_fa_15(double g[], double st[], double i2)
 	return o2;
 }
 
-static double lwdf_fa_21(double g[], double st[], double i2)
-{
-	double x0, x3, x4, x7, x8, x11, x12, x15, x16, x19, x20;
-	double x23, x24, x27, x28, x31, x32, x35, x36, x40;
-	double o2;
-
- 	lwd_adaptor(g[0], i2, st[0], &x0, &st[0]);
- 	lwd_adaptor(g[4], st[3], st[4], &x4, &st[4]);
- 	lwd_adaptor(g[3], x0, x4, &x3, &st[3]);
- 	lwd_adaptor(g[8], st[7], st[8], &x8, &st[8]);
- 	lwd_adaptor(g[7], x3, x8, &x7, &st[7]);
- 	lwd_adaptor(g[12], st[11], st[12], &x12, &st[12]);
- 	lwd_adaptor(g[11], x7, x12, &x11, &st[11]);
- 	lwd_adaptor(g[16], st[15], st[16], &x16, &st[16]);
- 	lwd_adaptor(g[15], x11, x16, &x15, &st[15]);
- 	lwd_adaptor(g[20], st[19], st[20], &x20, &st[20]);
- 	lwd_adaptor(g[19], x15, x20, &x19, &st[19]);
- 	lwd_adaptor(g[24], st[23], st[24], &x24, &st[24]);
- 	lwd_adaptor(g[23], x19, x24, &x23, &st[23]);
- 	lwd_adaptor(g[28], st[27], st[28], &x28, &st[28]);
- 	lwd_adaptor(g[27], x23, x28, &x27, &st[27]);
- 	lwd_adaptor(g[32], st[31], st[32], &x32, &st[32]);
- 	lwd_adaptor(g[31], x27, x32, &x31, &st[31]);
- 	lwd_adaptor(g[36], st[35], st[36], &x36, &st[36]);
- 	lwd_adaptor(g[35], x31, x36, &x35, &st[35]);
- 	lwd_adaptor(g[40], st[39], st[40], &x40, &st[40]);
- 	lwd_adaptor(g[39], x35, x40, &o2, &st[39]);
-
-	return o2;
-}
-
-
-static double lwdf_fb_22(double g[], double st[], double i1)
-{
-	double x1, x2, x5, x6, x9, x10, x13, x14, x17, x18, x21;
-	double x22, x25, x26, x29, x30, x33, x34, x37, x38, x42;
-	double o1;
-
- 	lwd_adaptor(g[2], st[1], st[2], &x2, &st[2]);
- 	lwd_adaptor(g[1], i1, x2, &x1, &st[1]);
- 	lwd_adaptor(g[6], st[5], st[6], &x6, &st[6]);
- 	lwd_adaptor(g[5], x1, x6, &x5, &st[5]);
- 	lwd_adaptor(g[10], st[9], st[10], &x10, &st[10]);
- 	lwd_adaptor(g[9], x5, x10, &x9, &st[9]);
- 	lwd_adaptor(g[14], st[13], st[14], &x14, &st[14]);
- 	lwd_adaptor(g[13], x9, x14, &x13, &st[13]);
- 	lwd_adaptor(g[18], st[17], st[18], &x18, &st[18]);
- 	lwd_adaptor(g[17], x13, x18, &x17, &st[17]);
- 	lwd_adaptor(g[22], st[21], st[22], &x22, &st[22]);
- 	lwd_adaptor(g[21], x17, x22, &x21, &st[21]);
- 	lwd_adaptor(g[26], st[25], st[26], &x26, &st[26]);
- 	lwd_adaptor(g[25], x21, x26, &x25, &st[25]);
- 	lwd_adaptor(g[30], st[29], st[30], &x30, &st[30]);
- 	lwd_adaptor(g[29], x25, x30, &x29, &st[29]);
- 	lwd_adaptor(g[34], st[33], st[34], &x34, &st[34]);
- 	lwd_adaptor(g[33], x29, x34, &x33, &st[33]);
- 	lwd_adaptor(g[38], st[37], st[38], &x38, &st[38]);
- 	lwd_adaptor(g[37], x33, x38, &x37, &st[37]);
- 	lwd_adaptor(g[42], st[41], st[42], &x42, &st[42]);
- 	lwd_adaptor(g[41], x37, x42, &o1, &st[41]);
-
-	return o1;
-}
-
 struct lwdf_sub {
 	double (* fa)(double *, double *, double);
 	double (* fb)(double *, double *, double);
@@ -497,11 +453,43 @@ const struct lwdf_sub sub_lut[] = {
 	{ lwdf_fa_11, lwdf_fb_12 },
 	{ lwdf_fa_13, lwdf_fb_12 },
 	{ lwdf_fa_13, lwdf_fb_14 },
-	{ lwdf_fa_15, lwdf_fb_14 },
-	{ lwdf_fa_15, lwdf_fb_14 },
-	{ lwdf_fa_21, lwdf_fb_22 }
+	{ lwdf_fa_15, lwdf_fb_14 }  /* 29 */
 };
 
+#define SUB_LUT_LEN (sizeof(sub_lut) / sizeof(sub_lut[0]))
+
+/* Upper branch of any order */
+static double lwdf_fa_n(double g[], double st[], double i2, unsigned int n)
+{
+	unsigned int k;
+	double x;
+	double o2;
+
+	lwd_adaptor(g[0], i2, st[0], &o2, &st[0]);
+	for (k = 3; (k + 1) < n; k += 4) {
+		lwd_adaptor(g[k + 1], st[k], st[k + 1], &x, &st[k + 1]);
+		lwd_adaptor(g[k], o2, x, &o2, &st[k]);
+	}
+
+	return o2;
+}
+
+/* Lower branch of any order */
+static double lwdf_fb_n(double g[], double st[], double i1, unsigned int n)
+{
+	unsigned int k;
+	double x;
+	double o1;
+
+	o1 = i1;
+	for (k = 1; (k + 1) < n; k += 4) {
+		lwd_adaptor(g[k + 1], st[k], st[k + 1], &x, &st[k + 1]);
+		lwd_adaptor(g[k], o1, x, &o1, &st[k]);
+	}
+
+	return o1;
+}
+
 
 ssize_t lwdf_fp64_lowpass(struct lwdf_fp64 * flt, 
 						  double y[], const double x[], size_t len)
@@ -524,6 +512,23 @@ ssize_t lwdf_fp64_lowpass(struct lwdf_fp64 * flt,
 //	fprintf(stderr, "lwdf_lowpass: n=%2d idx=%d\n", n, n / 2);
 #endif
 
+	if ((flt->kern.lp != NULL) && (len <= UINT_MAX)) {
+		flt->kern.lp(t, y, x, len);
+		return len;
+	}
+
+	if ((n / 2) >= SUB_LUT_LEN) {
+		/* high orders (transformed filters) */
+		for (i = 0; i < len; ++i) {
+			double ya = lwdf_fa_n(g, t, x[i], n);
+			double yb = lwdf_fb_n(g, t, x[i], n);
+
+			y[i] = (ya + yb) / 2;
+		}
+
+		return len;
+	}
+
 	fa = sub_lut[n / 2].fa;
 	fb = sub_lut[n / 2].fb;
 
@@ -558,6 +563,22 @@ ssize_t lwdf_fp64_higpass(struct lwdf_fp64 * flt, double y[], const double x[],
 	/* State */
 	t = flt->state.t;
 
+	if ((flt->kern.hp != NULL) && (len <= UINT_MAX)) {
+		flt->kern.hp(t, y, x, len);
+		return len;
+	}
+
+	if ((n / 2) >= SUB_LUT_LEN) {
+		for (i = 0; i < len; ++i) {
+			double y0 = lwdf_fa_n(g, t, x[i], n);
+			double y1 = lwdf_fb_n(g, t, x[i], n);
+
+			y[i] = (y0 - y1) / 2;
+		}
+
+		return len;
+	}
+
 	fa = sub_lut[n / 2].fa;
 	fb = sub_lut[n / 2].fb;
 
@@ -599,6 +620,7 @@ int lwdf_fp64_free(struct lwdf_fp64 *flt)
 		return -1;
 	};
 
+	__lwdf_fp64_kernel_drop(flt);
 	free(flt);
 
 	return 0;
@@ -627,6 +649,7 @@ int lwdf_fp64_init(struct lwdf_fp64 * flt, double samplerate)
 	flt->coeff.max = LWDF_COEFF_MAX;
 	flt->state.max = LWDF_STATE_MAX;
 	flt->samplerate = samplerate;
+	memset(&flt->kern, 0, sizeof(flt->kern));
 
 	return 0;
 }
@@ -661,6 +684,9 @@ ssize_t lwdf_fp64_gamma_set(struct lwdf_fp64 * flt, const double gamma[],
 	assert(gamma != NULL);
 	assert(cnt < LWDF_COEFF_MAX);
 
+	/* the native kernels have the old coefficients built in */
+	__lwdf_fp64_kernel_drop(flt);
+
 	/* Set the coefficients */
 	for (i = 0; i < LWDF_COEFF_MAX; ++i) {
 		flt->coeff.gamma[i] = gamma[i];
@@ -721,8 +747,25 @@ void lwdf_fp64_coeff_set(struct lwdf_fp64 * flt,
 	assert(idx < flt->coeff.cnt);
 
 	if (flt->coeff.gamma[idx] != coeff) {
+		__lwdf_fp64_kernel_drop(flt);
 		flt->coeff.gamma[idx] = coeff;
 	}
 }
 
+int lwdf_fp64_kernel_set(struct lwdf_fp64 * flt, lwdf_fp64_kernel_t lp,
+						 lwdf_fp64_kernel_t hp, void (* release)(void *),
+						 void * arg)
+{
+	assert(flt != NULL);
+
+	__lwdf_fp64_kernel_drop(flt);
+
+	flt->kern.lp = lp;
+	flt->kern.hp = hp;
+	flt->kern.release = release;
+	flt->kern.arg = arg;
+
+	return 0;
+}
+
 
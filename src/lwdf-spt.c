@@ -0,0 +1,603 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-spt.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Multiplierless coefficient optimization
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Each adaptor multiplies by alpha (see adaptor() in lwdf-cgen.c), with
+ * aQ = alpha * 2^nbits an integer. The cost of an adaptor depends on
+ * the number of non zero digits of aQ in canonical signed digit (CSD)
+ * form:
+ *
+ *   0 digits: g = 0, no adaptor
+ *   1 digit: power of two, a shift
+ *   n digits: a multiplier (or n - 1 adders)
+ *
+ * The coefficients are quantized to gamma = m / 2^nbits, which maps to
+ * an exact aQ in every region of gamma. For each adaptor a list of
+ * candidates is built: g = 0, every power of two with the sign of the
+ * ideal coefficient and the nearest values of each other CSD weight
+ * above and below it. The candidates are tried nearest first, which
+ * finds good solutions early when the search is cut by the node limit.
+ * A greedy solution, cheapened one adaptor at a time from the rounded
+ * coefficients, is the initial upper bound.
+ *
+ * The search is a depth first branch and bound over the adaptors:
+ *
+ *  - bound: the cost so far plus the cheapest candidate of each
+ *    remaining adaptor must be less than the best solution. Candidates
+ *    that fail the (relaxed) mask alone, with all the other adaptors at
+ *    their ideal values, are removed beforehand;
+ *  - feasibility: the response, with the adaptors not yet assigned
+ *    at their ideal values, must meet the specification mask, relaxed
+ *    by a fraction (slack) of asmin and ap that shrinks to zero as the
+ *    adaptors are assigned. Complete solutions must meet the mask.
+ *
+ * The relaxation lets the quantization errors of the adaptors
+ * compensate each other. The feasibility test is still a heuristic:
+ * a branch may be dropped that a later quantization would have brought
+ * back inside the mask; a larger slack searches more of the tree.
+ * The subtrees of the first two adaptors are distributed among a pool
+ * of threads, sharing the best cost found. Solutions of equal cost are
+ * ordered by margin, then by their coefficients, and the subtrees that
+ * can only tie with the best are still searched, so a search that runs
+ * to the end returns the same solution with any number of threads. A
+ * search cut by the node limit depends on the order of the threads.
+ */
+
+_Pragma ("GCC optimize (\"Ofast\")")
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwdf.h"
+
+#define LWDF_SPT_THREAD_MAX 64
+#define SPT_CAND_MAX 192
+#define SPT_SCAN_MAX (1 << 16)
+/* candidates of each CSD weight in each direction */
+#define SPT_NEAR_MAX 2
+/* a multiplier costs more than any number of shifts */
+#define SPT_MUL_COST 1024
+#define SPT_COST_INF 0xffffffffU
+
+struct spt_cand {
+	double g;
+	unsigned int cost;
+	double dist;
+};
+
+struct spt_list {
+	struct spt_cand c[SPT_CAND_MAX];
+	unsigned int cnt;
+};
+
+struct lwdf_spt {
+	const struct lwdfwiz_param * spec;
+	const double * gamma;
+	unsigned int order;
+	unsigned long nodes_max;
+	double slack;
+	struct spt_list * lst;
+	/* lower bound of the cost of adaptors i to order - 1 */
+	unsigned int lb[LWDF_ORDER_MAX + 1];
+	/* subtree tasks (first two adaptors) */
+	unsigned int ntask;
+	unsigned int next;
+	/* shared state */
+	atomic_ulong nodes;
+	atomic_uint best_cost;
+	double best_margin;
+	double best[LWDF_ORDER_MAX];
+	pthread_mutex_t mutex;
+};
+
+/* Number of non zero digits of x in CSD form */
+static unsigned int __csd_weight(unsigned int x)
+{
+	unsigned int w = 0;
+
+	while (x) {
+		if (x & 1) {
+			/* digit -1 when the next bit is also set */
+			if (x & 2)
+				x++;
+			else
+				x--;
+			w++;
+		}
+		x >>= 1;
+	}
+
+	return w;
+}
+
+/* CSD weight of the adaptor coefficient of gamma = m / Q */
+static unsigned int __spt_weight(int m, int Q)
+{
+	if (2 * m > Q)
+		return __csd_weight(Q - m);
+	if (m >= 0)
+		return __csd_weight(m);
+	if (2 * m > -Q)
+		return __csd_weight(-m);
+	return __csd_weight(Q + m);
+}
+
+static unsigned int __spt_cost(unsigned int w)
+{
+	return (w <= 1) ? w : SPT_MUL_COST + w;
+}
+
+static int __spt_cand_cmp(const void * p1, const void * p2)
+{
+	const struct spt_cand * a = (const struct spt_cand *)p1;
+	const struct spt_cand * b = (const struct spt_cand *)p2;
+
+	if (a->dist != b->dist)
+		return (a->dist > b->dist) - (a->dist < b->dist);
+
+	return (a->cost > b->cost) - (a->cost < b->cost);
+}
+
+static void __spt_cand_add(struct spt_list * lst, int m, int Q, double g0)
+{
+	struct spt_cand * c;
+
+	if (lst->cnt == SPT_CAND_MAX)
+		return;
+
+	c = &lst->c[lst->cnt++];
+	c->g = (double)m / Q;
+	c->cost = __spt_cost(__spt_weight(m, Q));
+	c->dist = fabs(c->g - g0);
+}
+
+/* Nearest coefficients of each CSD weight (2 or more) in the
+   direction dir */
+static void __spt_scan(struct spt_list * lst, double g0, int m0, int dir,
+					   int Q)
+{
+	uint8_t seen[32];
+	int m;
+	int i;
+
+	memset(seen, 0, sizeof(seen));
+
+	for (i = 0, m = m0; (i < SPT_SCAN_MAX) && (m > -Q) && (m < Q);
+		 ++i, m += dir) {
+		unsigned int w = __spt_weight(m, Q);
+
+		if ((w >= 2) && (seen[w] < SPT_NEAR_MAX)) {
+			seen[w]++;
+			__spt_cand_add(lst, m, Q, g0);
+		}
+	}
+}
+
+/* Build the sorted candidate list of one coefficient: g = 0, the powers
+   of two on the side of g0 and the nearest values of each weight */
+static void __spt_list_init(struct spt_list * lst, double g0,
+							unsigned int nbits)
+{
+	int Q = 1 << nbits;
+	int s = (g0 < 0) ? -1 : 1;
+	unsigned int k;
+	int m0;
+
+	lst->cnt = 0;
+	__spt_cand_add(lst, 0, Q, g0);
+
+	if (g0 == 0.0)
+		return;
+
+	/* alpha = 2^-k, in both regions of the sign of g0 */
+	for (k = 1; k <= nbits; ++k) {
+		int aQ = Q >> k;
+
+		__spt_cand_add(lst, s * aQ, Q, g0);
+		if (k > 1)
+			__spt_cand_add(lst, s * (Q - aQ), Q, g0);
+	}
+
+	m0 = (int)floor(g0 * Q);
+	__spt_scan(lst, g0, m0, -1, Q);
+	__spt_scan(lst, g0, m0 + 1, 1, Q);
+
+	qsort(lst->c, lst->cnt, sizeof(struct spt_cand), __spt_cand_cmp);
+}
+
+/* Cost of a quantized set of coefficients */
+static unsigned int __spt_total(const double q[], unsigned int order,
+								unsigned int nbits)
+{
+	int Q = 1 << nbits;
+	unsigned int cost = 0;
+	unsigned int i;
+
+	for (i = 0; i < order; ++i)
+		cost += __spt_cost(__spt_weight((int)floor(q[i] * Q + 0.5), Q));
+
+	return cost;
+}
+
+/* Check q against the mask, relaxed in proportion to the number of
+   adaptors not yet assigned (nfree) */
+static bool __spt_check(struct lwdf_spt * spt, const double q[],
+						unsigned int nfree, double * margin)
+{
+	double r = (spt->slack * nfree) / spt->order;
+	double as_m;
+	double ap_m;
+
+	if (lwdf_spec_margin(spt->spec, q, spt->order, &as_m, &ap_m)) {
+		*margin = as_m;
+		return true;
+	}
+
+	if (nfree == 0)
+		return false;
+
+	*margin = as_m;
+
+	return (as_m >= -r * spt->spec->asmin) && (ap_m >= -r * spt->spec->ap);
+}
+
+/* Feasibility of a partial solution, with the adaptors from i on at
+   their ideal values */
+static bool __spt_feasible(struct lwdf_spt * spt, double q[], unsigned int i,
+						   double * margin)
+{
+	memcpy(&q[i], &spt->gamma[i], (spt->order - i) * sizeof(double));
+
+	return __spt_check(spt, q, spt->order - i, margin);
+}
+
+/* Lower cost, then larger margin, then the smaller coefficients: a
+   total order, so the solution does not depend on the search order */
+static bool __spt_better(struct lwdf_spt * spt, const double q[],
+						 unsigned int cost, double margin)
+{
+	unsigned int i;
+
+	if (cost != spt->best_cost)
+		return cost < spt->best_cost;
+	if (margin != spt->best_margin)
+		return margin > spt->best_margin;
+
+	for (i = 0; i < spt->order; ++i) {
+		if (q[i] != spt->best[i])
+			return q[i] < spt->best[i];
+	}
+
+	return false;
+}
+
+/* Record a complete solution */
+static void __spt_leaf(struct lwdf_spt * spt, const double q[],
+					   unsigned int cost, double margin)
+{
+	pthread_mutex_lock(&spt->mutex);
+	if (__spt_better(spt, q, cost, margin)) {
+		spt->best_cost = cost;
+		spt->best_margin = margin;
+		memcpy(spt->best, q, spt->order * sizeof(double));
+	}
+	pthread_mutex_unlock(&spt->mutex);
+}
+
+static unsigned int __spt_bound(struct lwdf_spt * spt)
+{
+	/* written under the mutex, a stale value only prunes less */
+	return atomic_load_explicit(&spt->best_cost, memory_order_relaxed);
+}
+
+/* Returns false when the node limit was reached */
+static bool __spt_dfs(struct lwdf_spt * spt, double q[], unsigned int i,
+					  unsigned int cost)
+{
+	struct spt_list * lst = &spt->lst[i];
+	unsigned int k;
+
+	for (k = 0; k < lst->cnt; ++k) {
+		struct spt_cand * c = &lst->c[k];
+		unsigned int bound = __spt_bound(spt);
+		unsigned long nodes;
+		double margin;
+
+		/* the subtrees of equal cost are searched for the tie break */
+		if ((bound != SPT_COST_INF) &&
+			(cost + c->cost + spt->lb[i + 1] > bound))
+			continue;
+
+		/* a plain counter, no ordering with the shared best */
+		nodes = atomic_fetch_add_explicit(&spt->nodes, 1,
+										  memory_order_relaxed);
+		if ((spt->nodes_max != 0) && (nodes >= spt->nodes_max))
+			return false;
+
+		q[i] = c->g;
+		if (!__spt_feasible(spt, q, i + 1, &margin))
+			continue;
+
+		if (i + 1 == spt->order) {
+			__spt_leaf(spt, q, cost + c->cost, margin);
+			continue;
+		}
+
+		if (!__spt_dfs(spt, q, i + 1, cost + c->cost))
+			return false;
+	}
+
+	return true;
+}
+
+/* Starting from the rounded (or truncated) coefficients, replace one
+   adaptor at a time by a cheaper candidate while the mask is met */
+static void __spt_greedy(struct lwdf_spt * spt, unsigned int nbits)
+{
+	double q[LWDF_ORDER_MAX];
+	int Q = 1 << nbits;
+	unsigned int i;
+	unsigned int k;
+	double margin;
+	bool improved;
+
+	for (i = 0; i < spt->order; ++i) {
+		int m = (int)floor(spt->gamma[i] * Q + 0.5);
+
+		if (m >= Q)
+			m = Q - 1;
+		if (m <= -Q)
+			m = 1 - Q;
+		q[i] = (double)m / Q;
+	}
+
+	if (!lwdf_spec_margin(spt->spec, q, spt->order, &margin, NULL)) {
+		lwdf_gamma_quantize(q, spt->gamma, spt->order, nbits);
+		if (!lwdf_spec_margin(spt->spec, q, spt->order, &margin, NULL))
+			return;
+	}
+
+	do {
+		improved = false;
+		for (i = 0; i < spt->order; ++i) {
+			struct spt_list * lst = &spt->lst[i];
+			unsigned int cost = __spt_total(&q[i], 1, nbits);
+			double g = q[i];
+
+			for (k = 0; k < lst->cnt; ++k) {
+				if (lst->c[k].cost >= cost)
+					continue;
+				q[i] = lst->c[k].g;
+				if (lwdf_spec_margin(spt->spec, q, spt->order, &margin,
+									 NULL)) {
+					improved = true;
+					break;
+				}
+				q[i] = g;
+			}
+		}
+	} while (improved);
+
+	lwdf_spec_margin(spt->spec, q, spt->order, &margin, NULL);
+	spt->best_cost = __spt_total(q, spt->order, nbits);
+	spt->best_margin = margin;
+	memcpy(spt->best, q, spt->order * sizeof(double));
+}
+
+/* Run the subtree of the first (one or two) adaptors of task t */
+static bool __spt_task_run(struct lwdf_spt * spt, unsigned int t)
+{
+	double q[LWDF_ORDER_MAX];
+	unsigned int n = (spt->order > 1) ? 2 : 1;
+	unsigned int cost;
+	double margin;
+	struct spt_cand * c;
+
+	c = &spt->lst[0].c[t % spt->lst[0].cnt];
+	q[0] = c->g;
+	cost = c->cost;
+	if (n > 1) {
+		c = &spt->lst[1].c[t / spt->lst[0].cnt];
+		q[1] = c->g;
+		cost += c->cost;
+	}
+
+	if (cost + spt->lb[n] > __spt_bound(spt))
+		return true;
+
+	if (!__spt_feasible(spt, q, n, &margin))
+		return true;
+
+	if (n == spt->order) {
+		__spt_leaf(spt, q, cost, margin);
+		return true;
+	}
+
+	return __spt_dfs(spt, q, n, cost);
+}
+
+static void * __spt_task(void * arg)
+{
+	struct lwdf_spt * spt = (struct lwdf_spt *)arg;
+
+	for (;;) {
+		unsigned int t;
+
+		pthread_mutex_lock(&spt->mutex);
+		t = spt->next++;
+		pthread_mutex_unlock(&spt->mutex);
+
+		if (t >= spt->ntask)
+			break;
+
+		if (!__spt_task_run(spt, t)) {
+			/* node limit: drop the remaining tasks */
+			pthread_mutex_lock(&spt->mutex);
+			spt->next = spt->ntask;
+			pthread_mutex_unlock(&spt->mutex);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Search coefficients of nbits with the fewest multipliers (then the
+ * fewest CSD digits) such that the filter still meets the specification
+ * mask of spec (samplerate, fp, fs, ap and asmin).
+ *
+ * The result is written to q[], whose values are exact multiples of
+ * 2^-nbits, so the code generator reproduces them. Returns 0 on success
+ * or -1 if no quantized filter within the node limit meets the mask.
+ */
+int lwdf_spt_optimize(const struct lwdfwiz_param * spec,
+					  const double gamma[], unsigned int order,
+					  const struct lwdf_spt_cfg * cfg, double q[])
+{
+	pthread_t thread[LWDF_SPT_THREAD_MAX];
+	struct lwdf_spt spt;
+	unsigned int nthreads;
+	unsigned int i;
+	unsigned int j;
+	int ret;
+
+	assert(spec != NULL);
+	assert(gamma != NULL);
+	assert(cfg != NULL);
+	assert(q != NULL);
+
+	if ((order < 1) || (order > LWDF_ORDER_MAX)) {
+		fprintf(stderr, "%s: invalid order %d.\n", __func__, order);
+		return -1;
+	}
+
+	if ((cfg->nbits < 2) || (cfg->nbits > 30)) {
+		fprintf(stderr, "%s: invalid wordlength %d.\n", __func__,
+				cfg->nbits);
+		return -1;
+	}
+
+	memset(&spt, 0, sizeof(spt));
+	spt.spec = spec;
+	spt.gamma = gamma;
+	spt.order = order;
+	spt.nodes_max = cfg->nodes_max;
+	atomic_init(&spt.nodes, 0);
+	spt.slack = cfg->slack;
+	spt.best_cost = SPT_COST_INF;
+
+	if ((spt.lst = calloc(order, sizeof(struct spt_list))) == NULL) {
+		fprintf(stderr, "%s: calloc() failed: %s", __func__,
+				strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < order; ++i)
+		__spt_list_init(&spt.lst[i], gamma[i], cfg->nbits);
+
+	/* drop the candidates that fail the (relaxed) mask on their own */
+	for (i = 0; i < order; ++i) {
+		struct spt_list * lst = &spt.lst[i];
+		double q[LWDF_ORDER_MAX];
+		unsigned int k;
+		unsigned int n;
+
+		for (k = 0, n = 0; k < lst->cnt; ++k) {
+			double margin;
+
+			memcpy(q, gamma, order * sizeof(double));
+			q[i] = lst->c[k].g;
+			if (__spt_check(&spt, q, order - 1, &margin))
+				lst->c[n++] = lst->c[k];
+		}
+		lst->cnt = n;
+
+		if (n == 0) {
+			free(spt.lst);
+			return -1;
+		}
+	}
+
+	spt.lb[order] = 0;
+	for (i = order; i > 0; --i) {
+		struct spt_list * lst = &spt.lst[i - 1];
+		unsigned int min = lst->c[0].cost;
+		unsigned int k;
+
+		for (k = 1; k < lst->cnt; ++k) {
+			if (lst->c[k].cost < min)
+				min = lst->c[k].cost;
+		}
+		spt.lb[i - 1] = spt.lb[i] + min;
+	}
+
+	/* a greedy solution is the first upper bound */
+	__spt_greedy(&spt, cfg->nbits);
+
+	spt.ntask = spt.lst[0].cnt;
+	if (order > 1)
+		spt.ntask *= spt.lst[1].cnt;
+
+	nthreads = cfg->nthreads;
+	if (nthreads == 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > LWDF_SPT_THREAD_MAX)
+		nthreads = LWDF_SPT_THREAD_MAX;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	pthread_mutex_init(&spt.mutex, NULL);
+
+	for (i = 0; i + 1 < nthreads; ++i) {
+		if (pthread_create(&thread[i], NULL, __spt_task, &spt) != 0) {
+			fprintf(stderr, "%s: pthread_create() failed.\n", __func__);
+			break;
+		}
+	}
+	__spt_task(&spt);
+	for (j = 0; j < i; ++j)
+		pthread_join(thread[j], NULL);
+
+	pthread_mutex_destroy(&spt.mutex);
+
+	if (spt.best_cost == SPT_COST_INF) {
+		ret = -1;
+	} else {
+		memcpy(q, spt.best, order * sizeof(double));
+		ret = 0;
+	}
+
+	free(spt.lst);
+
+	return ret;
+}
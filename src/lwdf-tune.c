@@ -0,0 +1,528 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-tune.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: C code generator variants benchmarked on the host
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Each variant of the generated code is written to a temporary
+ * directory together with a small benchmark main(), compiled with the
+ * host compiler ($CC, default cc, flags from $CFLAGS, default -O2) and
+ * run. The benchmark filters a pseudo random block from a zero state,
+ * writes the output for the correctness check against the lwdf_fp64
+ * runtime, and then times the kernel on the same block. The fastest
+ * correct variant is emitted. The fixed point code is checked bit for
+ * bit against an integer model of its adaptors.
+ *
+ * The knobs: temporaries reuse (rx) and the block loop unrolling for
+ * the scalar code, rx and the vector width for the multi-channel code.
+ * The coefficient wordlength changes the response, it is not tuned.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+
+#include "lwdf.h"
+
+/* samples per channel of the benchmark block */
+#define TUNE_LEN 4096
+/* blocks per timing, the best of TUNE_REP timings is taken */
+#define TUNE_RUNS 64
+#define TUNE_REP 5
+
+#define TUNE_VAR_MAX 16
+
+struct tune_var {
+	uint8_t rx;
+	uint8_t unroll;
+	uint8_t vlen;
+	/* nanoseconds per sample and channel, 0 if it failed */
+	double ns;
+	/* error relative to the peak of the reference */
+	double err;
+};
+
+/* The input of the benchmark, the same sequence is written in C */
+static double __tune_input(uint32_t * r)
+{
+	*r = *r * 1103515245u + 12345u;
+	return (double)((*r >> 16) & 0x7fff) / 32768.0 - 0.5;
+}
+
+/* Input amplitude of the fixed point code, away from the overflow of
+   the coefficient products */
+static int __tune_scale(const struct lwdfwiz_param * wiz)
+{
+	int b = 29 - wiz->nbits;
+
+	if (wiz->nbits == 0)
+		return 1;
+	if (b > 12)
+		b = 12;
+	if (b < 4)
+		b = 4;
+	return 1 << b;
+}
+
+static const char * __tune_dtype(const struct lwdfwiz_param * wiz)
+{
+	if (wiz->nbits > 0)
+		return "int";
+	return wiz->fp64 ? "double" : "float";
+}
+
+static size_t __tune_dsize(const struct lwdfwiz_param * wiz)
+{
+	if (wiz->nbits > 0)
+		return sizeof(int);
+	return wiz->fp64 ? sizeof(double) : sizeof(float);
+}
+
+static void __tune_main(FILE * f, const char * prefix,
+						const struct lwdfwiz_param * wiz, unsigned int nch,
+						unsigned int nst)
+{
+	const char * dtype = __tune_dtype(wiz);
+	bool id = wiz->bi && wiz->id;
+	unsigned int nx = id ? 2 * TUNE_LEN : TUNE_LEN;
+
+	fprintf(f, "\n/* ---- benchmark ---- */\n\n");
+	fprintf(f, "#include <stdio.h>\n");
+	fprintf(f, "#include <stdint.h>\n");
+	fprintf(f, "#include <time.h>\n\n");
+	fprintf(f, "static %s x[%u][%u];\n", dtype, nx, nch);
+	fprintf(f, "static %s y[%u][%u];\n", dtype, TUNE_LEN, nch);
+	fprintf(f, "static %s st[%u][%u];\n\n", dtype, nst, nch);
+
+	fprintf(f, "static void run(void)\n");
+	fprintf(f, "{\n");
+	if (nch > 1)
+		fprintf(f, "\t%svlowpass(st, y, (const %s (*)[%u])x, %u);\n",
+				prefix, dtype, nch, TUNE_LEN);
+	else if (id)
+		fprintf(f, "\t%sdecimate2(st[0], y[0], x[0], %u);\n",
+				prefix, TUNE_LEN);
+	else
+		fprintf(f, "\t%slp_filter(st[0], y[0], x[0], %u);\n",
+				prefix, TUNE_LEN);
+	fprintf(f, "}\n\n");
+
+	fprintf(f, "int main(int argc, char *argv[])\n");
+	fprintf(f, "{\n");
+	fprintf(f, "\tstruct timespec t0, t1;\n");
+	fprintf(f, "\tdouble ns = 0;\n");
+	fprintf(f, "\tuint32_t r = 1;\n");
+	fprintf(f, "\tunsigned int i, c, k;\n");
+	fprintf(f, "\tFILE * f;\n\n");
+	fprintf(f, "\tfor (i = 0; i < %u; ++i)\n", nx);
+	fprintf(f, "\t\tfor (c = 0; c < %u; ++c) {\n", nch);
+	fprintf(f, "\t\t\tr = r * 1103515245u + 12345u;\n");
+	fprintf(f, "\t\t\tx[i][c] = (%s)(%d * ((double)((r >> 16) & 0x7fff)"
+			" / 32768.0 - 0.5));\n", dtype, __tune_scale(wiz));
+	fprintf(f, "\t\t}\n\n");
+	fprintf(f, "\trun();\n");
+	fprintf(f, "\tif ((f = fopen(argv[1], \"w\")) == NULL)\n");
+	fprintf(f, "\t\treturn 1;\n");
+	fprintf(f, "\tfwrite(y, sizeof(y), 1, f);\n");
+	fprintf(f, "\tfclose(f);\n\n");
+	fprintf(f, "\tfor (k = 0; k < %u; ++k) {\n", TUNE_REP);
+	fprintf(f, "\t\tdouble dt;\n\n");
+	fprintf(f, "\t\tclock_gettime(CLOCK_MONOTONIC, &t0);\n");
+	fprintf(f, "\t\tfor (i = 0; i < %u; ++i)\n", TUNE_RUNS);
+	fprintf(f, "\t\t\trun();\n");
+	fprintf(f, "\t\tclock_gettime(CLOCK_MONOTONIC, &t1);\n");
+	fprintf(f, "\t\tdt = (t1.tv_sec - t0.tv_sec) * 1e9 + "
+			"(t1.tv_nsec - t0.tv_nsec);\n");
+	fprintf(f, "\t\tif ((k == 0) || (dt < ns))\n");
+	fprintf(f, "\t\t\tns = dt;\n");
+	fprintf(f, "\t}\n");
+	fprintf(f, "\tprintf(\"%%.6f\\n\", ns / %u.0);\n",
+			TUNE_RUNS * nx * nch);
+	fprintf(f, "\n");
+	fprintf(f, "\treturn 0;\n");
+	fprintf(f, "}\n");
+}
+
+/* Integer adaptor, the arithmetic of the fixed point code */
+static void __tune_adaptor(double g, int nbits, int in1, int in2,
+						   int * out1, int * out2)
+{
+	int Q = 1 << nbits;
+	int aQ;
+	int t;
+
+	if (g == 0.0) {
+		*out1 = in2;
+		*out2 = in1;
+	} else if (g > 0.5) {
+		aQ = (int)((1.0 - g) * (double)Q);
+		t = in1 - in2;
+		*out2 = ((aQ * t) >> nbits) + in2;
+		*out1 = *out2 - t;
+	} else if (g > 0.0) {
+		aQ = (int)(g * (double)Q);
+		t = in2 - in1;
+		*out1 = ((aQ * t) >> nbits) + in2;
+		*out2 = *out1 - t;
+	} else if (g > -0.5) {
+		aQ = (int)(-g * (double)Q);
+		t = in1 - in2;
+		*out1 = ((aQ * t) >> nbits) - in2;
+		*out2 = *out1 - t;
+	} else {
+		aQ = (int)((1.0 + g) * (double)Q);
+		t = in2 - in1;
+		*out2 = ((aQ * t) >> nbits) - in2;
+		*out1 = *out2 - t;
+	}
+}
+
+/* Integer model of the fixed point lowpass output, one channel, s[k] is
+   the state of the adaptor k */
+static int __tune_iref(const struct lwdf_info * inf, int nbits, bool id,
+					   int s[], int x0, int x1)
+{
+	const double * g = inf->gamma;
+	int N = inf->order;
+	int o1;
+	int o2;
+	int u;
+	int k;
+
+	if (id) {
+		/* half rate arms of the decimator */
+		for (o2 = x0, k = 3; k < N; k += 4)
+			__tune_adaptor(g[k], nbits, o2, s[k], &o2, &s[k]);
+		for (o1 = x1, k = 1; k < N; k += 4)
+			__tune_adaptor(g[k], nbits, o1, s[k], &o1, &s[k]);
+		return (o1 + o2) >> 1;
+	}
+
+	__tune_adaptor(g[0], nbits, x0, s[0], &o2, &s[0]);
+	for (k = 3; (k + 1) < N; k += 4) {
+		__tune_adaptor(g[k + 1], nbits, s[k], s[k + 1], &u, &s[k + 1]);
+		__tune_adaptor(g[k], nbits, o2, u, &o2, &s[k]);
+	}
+	for (o1 = x0, k = 1; (k + 1) < N; k += 4) {
+		__tune_adaptor(g[k + 1], nbits, s[k], s[k + 1], &u, &s[k + 1]);
+		__tune_adaptor(g[k], nbits, o1, u, &o1, &s[k]);
+	}
+
+	return (o1 + o2) >> 1;
+}
+
+/* Reference of the benchmark output, y[TUNE_LEN][nch]: the lwdf_fp64
+   runtime for the floating point code, the integer model for the fixed
+   point code */
+static int __tune_ref(double * y, const struct lwdfwiz_param * wiz,
+					  const struct lwdf_info * inf, unsigned int nch)
+{
+	bool id = wiz->bi && wiz->id;
+	unsigned int nx = id ? 2 * TUNE_LEN : TUNE_LEN;
+	double scale = __tune_scale(wiz);
+	struct lwdf_fp64 * flt;
+	double * x;
+	double * t;
+	uint32_t r = 1;
+	unsigned int i;
+	unsigned int c;
+
+	if ((flt = lwdf_fp64_new(wiz->samplerate)) == NULL)
+		return -1;
+
+	x = calloc(nx * nch, sizeof(double));
+	t = calloc(nx, sizeof(double));
+	for (i = 0; i < nx; ++i)
+		for (c = 0; c < nch; ++c)
+			x[i * nch + c] = scale * __tune_input(&r);
+
+	for (c = 0; (wiz->nbits > 0) && (c < nch); ++c) {
+		int s[LWDF_ORDER_MAX];
+
+		memset(s, 0, sizeof(s));
+		/* the input truncated as in the benchmark */
+		for (i = 0; i < TUNE_LEN; ++i)
+			y[i * nch + c] = id ?
+				__tune_iref(inf, wiz->nbits, true, s,
+							(int)x[2 * i * nch + c],
+							(int)x[(2 * i + 1) * nch + c]) :
+				__tune_iref(inf, wiz->nbits, false, s,
+							(int)x[i * nch + c], 0);
+	}
+
+	for (c = 0; (wiz->nbits == 0) && (c < nch); ++c) {
+		for (i = 0; i < nx; ++i)
+			t[i] = x[i * nch + c];
+		lwdf_fp64_reset(flt);
+		lwdf_fp64_gamma_set(flt, inf->gamma, inf->order);
+		lwdf_fp64_lowpass(flt, t, t, nx);
+		/* the decimator keeps the odd samples */
+		for (i = 0; i < TUNE_LEN; ++i)
+			y[i * nch + c] = id ? t[2 * i + 1] : t[i];
+	}
+
+	free(t);
+	free(x);
+	lwdf_fp64_free(flt);
+
+	return 0;
+}
+
+static double __tune_err(const char * fname, const double * ref,
+						 const struct lwdfwiz_param * wiz, unsigned int nch)
+{
+	unsigned int n = TUNE_LEN * nch;
+	size_t size = __tune_dsize(wiz);
+	double e = 0;
+	double s = 0;
+	unsigned int i;
+	void * y;
+	FILE * f;
+
+	if ((f = fopen(fname, "r")) == NULL)
+		return INFINITY;
+
+	y = calloc(n, size);
+	if (fread(y, size, n, f) != n) {
+		free(y);
+		fclose(f);
+		return INFINITY;
+	}
+	fclose(f);
+
+	for (i = 0; i < n; ++i) {
+		double v;
+
+		if (wiz->nbits > 0)
+			v = ((int *)y)[i];
+		else if (wiz->fp64)
+			v = ((double *)y)[i];
+		else
+			v = ((float *)y)[i];
+
+		e = fmax(e, fabs(v - ref[i]));
+		s = fmax(s, fabs(ref[i]));
+	}
+	free(y);
+
+	return e / s;
+}
+
+static int __tune_run(struct tune_var * var, const char * dir,
+					  const char * prefix, const struct lwdfwiz_param * wiz,
+					  const struct lwdf_info * inf, const double * ref,
+					  unsigned int nch)
+{
+	const char * cc = getenv("CC");
+	const char * cflags = getenv("CFLAGS");
+	struct lwdfwiz_param w = *wiz;
+	char src[256];
+	char bin[256];
+	char out[256];
+	char log[256];
+	char cmd[1024];
+	FILE * f;
+	int ret;
+
+	if (cc == NULL)
+		cc = "cc";
+	if (cflags == NULL)
+		cflags = "-O2";
+
+	w.rx = var->rx;
+	w.unroll = var->unroll;
+	w.vlen = var->vlen;
+	var->ns = 0;
+	var->err = INFINITY;
+
+	snprintf(src, sizeof(src), "%s/bench.c", dir);
+	snprintf(bin, sizeof(bin), "%s/bench", dir);
+	snprintf(out, sizeof(out), "%s/bench.out", dir);
+	snprintf(log, sizeof(log), "%s/cc.log", dir);
+
+	if ((f = fopen(src, "w")) == NULL) {
+		fprintf(stderr, "%s: %s: %s.\n", __func__, src, strerror(errno));
+		return -1;
+	}
+	ret = lwdf_cgen(f, prefix, &w, inf);
+	if (ret >= 0) {
+		unsigned int nst = (nch > 1) ? inf->order : 4 * LWDF_ORDER_MAX;
+
+		__tune_main(f, prefix, &w, nch, nst);
+	}
+	fclose(f);
+	if (ret < 0)
+		return -1;
+
+	snprintf(cmd, sizeof(cmd), "%s %s -o %s %s -lm >%s 2>&1",
+			 cc, cflags, bin, src, log);
+	if (system(cmd) != 0) {
+		char buf[256];
+		size_t n;
+
+		fprintf(stderr, "%s: \"%s\" failed.\n", __func__, cmd);
+		/* the compiler messages */
+		if ((f = fopen(log, "r")) != NULL) {
+			while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+				fwrite(buf, 1, n, stderr);
+			fclose(f);
+		}
+		return -1;
+	}
+
+	snprintf(cmd, sizeof(cmd), "%s %s", bin, out);
+	if ((f = popen(cmd, "r")) == NULL) {
+		fprintf(stderr, "%s: %s: %s.\n", __func__, bin, strerror(errno));
+		return -1;
+	}
+	if (fscanf(f, "%lf", &var->ns) != 1)
+		var->ns = 0;
+	ret = pclose(f);
+
+	if ((ret != 0) || (var->ns <= 0)) {
+		fprintf(stderr, "%s: %s failed.\n", __func__, bin);
+		var->ns = 0;
+		return -1;
+	}
+
+	var->err = __tune_err(out, ref, wiz, nch);
+
+	return 0;
+}
+
+int lwdf_cgen_tune(FILE * fout, const char * prefix,
+				   const struct lwdfwiz_param * wiz,
+				   const struct lwdf_info * inf)
+{
+	struct tune_var var[TUNE_VAR_MAX];
+	char dir[] = "/tmp/lwdf-tune-XXXXXX";
+	struct lwdfwiz_param w = *wiz;
+	/* float code against the double runtime, fixed point bit exact */
+	double tol = (wiz->nbits == 0) ? 1e-4 : 0;
+	unsigned int nch = (wiz->nchan > 0) ? wiz->nchan : 1;
+	bool id = wiz->bi && wiz->id;
+	double * ref;
+	char fname[256];
+	int best = -1;
+	int n = 0;
+	int rx;
+	int u;
+	int i;
+
+	if ((wiz->nchan > 0) && id) {
+		fprintf(stderr, "%s: no multi-channel decimator to tune.\n",
+				__func__);
+		return -1;
+	}
+
+	/* the decimator loop is not unrolled */
+	for (rx = 0; rx <= 1; ++rx) {
+		if (wiz->nchan > 0) {
+			for (u = 2; u <= 16; u *= 2) {
+				if ((wiz->nchan % u) == 0)
+					var[n++] = (struct tune_var){ .rx = rx, .vlen = u };
+			}
+		} else if (id) {
+			var[n++] = (struct tune_var){ .rx = rx };
+		} else {
+			for (u = 1; u <= 8; u *= 2)
+				var[n++] = (struct tune_var){ .rx = rx, .unroll = u };
+		}
+	}
+
+	if (n == 0) {
+		fprintf(stderr, "%s: no vector width for %d channels.\n",
+				__func__, wiz->nchan);
+		return -1;
+	}
+
+	if (mkdtemp(dir) == NULL) {
+		fprintf(stderr, "%s: mkdtemp(): %s.\n", __func__, strerror(errno));
+		return -1;
+	}
+
+	ref = calloc(TUNE_LEN * nch, sizeof(double));
+	if (__tune_ref(ref, wiz, inf, nch) < 0) {
+		free(ref);
+		rmdir(dir);
+		return -1;
+	}
+
+	fprintf(stderr, " %-28s %12s %10s\n", "variant", "ns/sample", "error");
+	for (i = 0; i < n; ++i) {
+		char name[64];
+		bool ok;
+
+		__tune_run(&var[i], dir, prefix, wiz, inf, ref, nch);
+		ok = (var[i].ns > 0) && (var[i].err <= tol);
+
+		if (wiz->nchan > 0)
+			snprintf(name, sizeof(name), "rx=%d vlen=%d",
+					 var[i].rx, var[i].vlen);
+		else if (id)
+			snprintf(name, sizeof(name), "rx=%d", var[i].rx);
+		else
+			snprintf(name, sizeof(name), "rx=%d unroll=%d",
+					 var[i].rx, var[i].unroll);
+
+		if (var[i].ns > 0)
+			fprintf(stderr, " %-28s %12.3f %10.2e%s\n", name,
+					var[i].ns, var[i].err, ok ? "" : "  FAIL");
+		else
+			fprintf(stderr, " %-28s %12s %10s\n", name, "-", "-");
+
+		if (ok && ((best < 0) || (var[i].ns < var[best].ns)))
+			best = i;
+	}
+
+	snprintf(fname, sizeof(fname), "%s/bench.c", dir);
+	unlink(fname);
+	snprintf(fname, sizeof(fname), "%s/bench", dir);
+	unlink(fname);
+	snprintf(fname, sizeof(fname), "%s/bench.out", dir);
+	unlink(fname);
+	snprintf(fname, sizeof(fname), "%s/cc.log", dir);
+	unlink(fname);
+	rmdir(dir);
+	free(ref);
+
+	if (best < 0) {
+		fprintf(stderr, "%s: no variant passed.\n", __func__);
+		return -1;
+	}
+
+	w.rx = var[best].rx;
+	w.unroll = var[best].unroll;
+	w.vlen = var[best].vlen;
+	fprintf(stderr, " fastest: rx=%d unroll=%d vlen=%d\n",
+			w.rx, w.unroll, w.vlen);
+
+	return lwdf_cgen(fout, prefix, &w, inf);
+}
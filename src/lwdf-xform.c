@@ -0,0 +1,373 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdf-xform.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Lowpass to highpass, bandpass and bandstop transformations
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Frequency transformations (Constantinides, 1970) replace the delay
+ * of the prototype by an allpass function of u = z^-1:
+ *
+ *   lowpass:  u -> (u - b) / (1 - b u)
+ *   highpass: u -> -(u + a) / (1 + a u)
+ *   bandpass: u -> -(u^2 - a1 u + a2) / (a2 u^2 - a1 u + 1)
+ *   bandstop: u -> (u^2 - a1 u + a2) / (a2 u^2 - a1 u + 1)
+ *
+ * An allpass of allpasses is an allpass, so the branches of the lattice
+ * stay allpass and the filter is again a lattice. The poles are mapped
+ * one at a time: a prototype pole p maps to the roots of
+ *
+ *   D(u) - s p N(u) = 0
+ *
+ * G(u) = s N(u) / D(u) being the transformation. The highpass keeps the
+ * order; the bandpass and bandstop double it, every pole becomes a
+ * second order section. The new sections are built from the pairs of
+ * poles (z1, z2) with a1 = -(z1 + z2), a2 = z1 z2, so g1 = -a2 and
+ * g2 = a1 / (g1 - 1).
+ *
+ * A section is 1 at DC. The transformations map DC to u = s, and a
+ * first order section at u = -1 is -1, so a branch comes out of the
+ * highpass and bandpass negated if it had the first order section.
+ * Without a first order section (bandpass, bandstop) the sign of the
+ * upper branch is set with gamma[0] = -1 (A(z) = 1) or 1 (A(z) = -1),
+ * and the sign of the lower branch selects the sum or the difference
+ * output, so the result is exact. The highpass keeps the first order
+ * section and comes out inverted, like the flip (ff) of lwdf_design().
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "lwdf.h"
+
+/* Poles of one branch, second order sections as pairs */
+struct xform_branch {
+	unsigned int cnt; /* number of sections */
+	bool first; /* has a first order section */
+	double p0; /* pole of the first order section */
+	complex double p[LWDF_ORDER_MAX][2];
+	int sign;
+};
+
+/* Transformation G(u) = s N(u) / D(u) */
+struct xform_map {
+	unsigned int ord; /* 1 or 2 */
+	double s;
+	double b; /* first order: N = u - b, D = 1 - b u */
+	double a1; /* second order: N = u^2 - a1 u + a2 */
+	double a2; /*               D = a2 u^2 - a1 u + 1 */
+};
+
+/* Roots of A z^2 + B z + C, A != 0 */
+static void __quad_roots(complex double A, complex double B,
+						 complex double C, complex double z[2])
+{
+	complex double d = csqrt(B * B - 4.0 * A * C);
+	complex double q;
+
+	/* avoid the cancellation of -B + d */
+	if (creal(conj(B) * d) < 0)
+		d = -d;
+	q = -(B + d) / 2.0;
+
+	z[0] = q / A;
+	z[1] = (q != 0) ? C / q : 0;
+}
+
+/* The poles of the transformed filter for a prototype pole p */
+static unsigned int __pole_map(const struct xform_map * m,
+							   complex double p, complex double z[2])
+{
+	complex double sp = m->s * p;
+
+	if (m->ord == 1) {
+		z[0] = (m->b + sp) / (1.0 + sp * m->b);
+		return 1;
+	}
+
+	/* z^2 (1 - s p a2) + z a1 (s p - 1) + (a2 - s p) = 0 */
+	__quad_roots(1.0 - sp * m->a2, m->a1 * (sp - 1.0), m->a2 - sp, z);
+
+	return 2;
+}
+
+/* Poles of a prototype section (g1, g2) */
+static void __sect_poles(double g1, double g2, complex double p[2])
+{
+	double a1 = g2 * (g1 - 1.0);
+	double a2 = -g1;
+
+	__quad_roots(1.0, a1, a2, p);
+}
+
+static void __branch_add(struct xform_branch * br, complex double z0,
+						 complex double z1)
+{
+	br->p[br->cnt][0] = z0;
+	br->p[br->cnt][1] = z1;
+	br->cnt++;
+}
+
+/* Transform the prototype branch src into dst */
+static void __branch_map(const struct xform_map * m,
+						 const struct xform_branch * src,
+						 struct xform_branch * dst)
+{
+	complex double z[2];
+	complex double w[2];
+	unsigned int k;
+
+	memset(dst, 0, sizeof(struct xform_branch));
+
+	if (src->first) {
+		if (__pole_map(m, src->p0, z) == 1) {
+			dst->first = true;
+			dst->p0 = creal(z[0]);
+		} else {
+			/* the pair of a real pole is real or conjugate */
+			__branch_add(dst, z[0], z[1]);
+		}
+	}
+
+	for (k = 0; k < src->cnt; ++k) {
+		complex double p0 = src->p[k][0];
+		complex double p1 = src->p[k][1];
+
+		if (m->ord == 1) {
+			__pole_map(m, p0, z);
+			__pole_map(m, p1, w);
+			__branch_add(dst, z[0], w[0]);
+		} else if (cimag(p0) == 0) {
+			/* two real poles, each one gives a section */
+			__pole_map(m, p0, z);
+			__branch_add(dst, z[0], z[1]);
+			__pole_map(m, p1, z);
+			__branch_add(dst, z[0], z[1]);
+		} else {
+			/* the poles of p1 = conj(p0) are the conjugates */
+			__pole_map(m, p0, z);
+			__branch_add(dst, z[0], conj(z[0]));
+			__branch_add(dst, z[1], conj(z[1]));
+		}
+	}
+
+	dst->sign = ((m->s < 0) && src->first) ? -1 : 1;
+}
+
+/* Write the sections of br to the slots k0, k0 + 4, ... of gamma[] */
+static void __branch_store(const struct xform_branch * br, double gamma[],
+						   unsigned int k0)
+{
+	unsigned int i;
+
+	for (i = 0; i < br->cnt; ++i) {
+		complex double z0 = br->p[i][0];
+		complex double z1 = br->p[i][1];
+		double a1 = -creal(z0 + z1);
+		double a2 = creal(z0 * z1);
+		double g1 = -a2;
+
+		gamma[k0 + 4 * i] = g1;
+		gamma[k0 + 4 * i + 1] = a1 / (g1 - 1.0);
+	}
+}
+
+static int __map_init(struct xform_map * m, const struct lwdf_xform * xf,
+					  double F, double fp)
+{
+	double tp = M_PI * fp / F;
+	double w1 = M_PI * xf->f1 / F;
+	double w2 = M_PI * xf->f2 / F;
+	double a;
+	double k;
+
+	memset(m, 0, sizeof(struct xform_map));
+
+	switch (xf->type) {
+	case LWDF_XFORM_LOWPASS:
+		m->ord = 1;
+		m->s = 1.0;
+		m->b = sin(tp - w1) / sin(tp + w1);
+		return 0;
+
+	case LWDF_XFORM_HIGHPASS:
+		m->ord = 1;
+		m->s = -1.0;
+		m->b = cos(tp + w1) / cos(tp - w1);
+		return 0;
+
+	case LWDF_XFORM_BANDPASS:
+		a = cos(w2 + w1) / cos(w2 - w1);
+		k = tan(tp) / tan(w2 - w1);
+		m->ord = 2;
+		m->s = -1.0;
+		m->a1 = 2.0 * a * k / (k + 1.0);
+		m->a2 = (k - 1.0) / (k + 1.0);
+		return 0;
+
+	case LWDF_XFORM_BANDSTOP:
+		a = cos(w2 + w1) / cos(w2 - w1);
+		k = tan(tp) * tan(w2 - w1);
+		m->ord = 2;
+		m->s = 1.0;
+		m->a1 = 2.0 * a / (k + 1.0);
+		m->a2 = (1.0 - k) / (1.0 + k);
+		return 0;
+	}
+
+	return -1;
+}
+
+/* The lower stopband edge of the transformed filter. With the warped
+   frequencies W = tan(pi f / F) the transformations are the analog ones,
+   L = W(fs) / W(fp) being the stopband edge of the normalized prototype */
+static double __edge_map(const struct lwdf_xform * xf, double F,
+						 double fp, double fs)
+{
+	double L = tan(M_PI * fs / F) / tan(M_PI * fp / F);
+	double W1 = tan(M_PI * xf->f1 / F);
+	double W2 = tan(M_PI * xf->f2 / F);
+	double B = W2 - W1;
+	double W;
+
+	switch (xf->type) {
+	case LWDF_XFORM_LOWPASS:
+		W = W1 * L;
+		break;
+	case LWDF_XFORM_HIGHPASS:
+		W = W1 / L;
+		break;
+	case LWDF_XFORM_BANDPASS:
+		/* L = (W^2 - W1 W2) / (B W), the root below W1 */
+		W = (sqrt(L * L * B * B + 4 * W1 * W2) - L * B) / 2;
+		break;
+	default:
+		/* L = B W / (W1 W2 - W^2), the root above W1 */
+		W = (sqrt(B * B + 4 * L * L * W1 * W2) - B) / (2 * L);
+		break;
+	}
+
+	return F * atan(W) / M_PI;
+}
+
+/*
+ * Frequency transformation of the lowpass prototype proto (not flipped),
+ * whose passband edge proto->fp moves to xf->f1 (lowpass, highpass) or
+ * to both xf->f1 and xf->f2 (bandpass, bandstop). The attenuations are
+ * kept. The result in inf runs on the lattice kernels as is, inf->fp
+ * and inf->fs are its lower passband and stopband edges.
+ *
+ * Returns the output to use, LWDF_RESP_LOWPASS (sum of the branches) or
+ * LWDF_RESP_HIGHPASS (difference), or -1 on error.
+ */
+int lwdf_xform(const struct lwdf_info * proto, const struct lwdf_xform * xf,
+			   struct lwdf_info * inf)
+{
+	struct xform_branch src[2];
+	struct xform_branch dst[2];
+	struct xform_map m;
+	unsigned int up;
+	unsigned int cnt;
+	unsigned int k;
+	unsigned int N;
+	double F;
+	int resp;
+
+	assert(proto != NULL);
+	assert(xf != NULL);
+	assert(inf != NULL);
+
+	N = proto->order;
+	F = proto->samplerate;
+
+	if ((N < 1) || (N > LWDF_ORDER_MAX) || ((N & 1) == 0)) {
+		fprintf(stderr, "%s: invalid order %d.\n", __func__, N);
+		return -1;
+	}
+
+	if ((proto->fp <= 0) || (proto->fp >= F / 2) ||
+		(xf->f1 <= 0) || (xf->f1 >= F / 2)) {
+		fprintf(stderr, "%s: invalid band edge.\n", __func__);
+		return -1;
+	}
+
+	if (((xf->type == LWDF_XFORM_BANDPASS) ||
+		 (xf->type == LWDF_XFORM_BANDSTOP)) &&
+		((xf->f2 <= xf->f1) || (xf->f2 >= F / 2))) {
+		fprintf(stderr, "%s: invalid band edges.\n", __func__);
+		return -1;
+	}
+
+	if (__map_init(&m, xf, F, proto->fp) < 0) {
+		fprintf(stderr, "%s: invalid transformation %d.\n", __func__,
+				xf->type);
+		return -1;
+	}
+
+	if ((m.ord == 2) && (2 * N + 1 > LWDF_ORDER_MAX)) {
+		fprintf(stderr, "%s: order %d too high.\n", __func__, N);
+		return -1;
+	}
+
+	/* prototype poles, upper (0) and lower (1) branches */
+	memset(src, 0, sizeof(src));
+	src[0].first = true;
+	src[0].p0 = proto->gamma[0];
+	for (k = 1; k + 1 < N; k += 2) {
+		unsigned int b = (((k - 1) / 2) & 1) ? 0 : 1;
+		struct xform_branch * br = &src[b];
+
+		__sect_poles(proto->gamma[k], proto->gamma[k + 1], br->p[br->cnt]);
+		br->cnt++;
+	}
+
+	__branch_map(&m, &src[0], &dst[0]);
+	__branch_map(&m, &src[1], &dst[1]);
+
+	memcpy(inf, proto, sizeof(struct lwdf_info));
+	memset(inf->gamma, 0, sizeof(inf->gamma));
+	inf->bi = false;
+
+	/* the lower branch takes the odd section, if any */
+	cnt = dst[0].cnt + dst[1].cnt;
+	up = (dst[0].cnt == cnt / 2) ? 0 : 1;
+
+	if (dst[up].first) {
+		inf->gamma[0] = dst[up].p0;
+		resp = (dst[up].sign < 0) ? LWDF_RESP_HIGHPASS : LWDF_RESP_LOWPASS;
+	} else {
+		inf->gamma[0] = (dst[up].sign < 0) ? 1.0 : -1.0;
+		resp = (dst[!up].sign < 0) ? LWDF_RESP_HIGHPASS : LWDF_RESP_LOWPASS;
+	}
+
+	__branch_store(&dst[up], inf->gamma, 3);
+	__branch_store(&dst[!up], inf->gamma, 1);
+	inf->order = 2 * cnt + 1;
+
+	inf->fs = __edge_map(xf, F, proto->fp, proto->fs);
+	inf->fp = xf->f1;
+
+	return resp;
+}
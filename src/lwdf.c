@@ -27,6 +27,7 @@
  */
 
 #include <unistd.h>
+#include <getopt.h>
 #include <string.h>
 #include <errno.h>
 #include <string.h>
@@ -37,6 +38,7 @@
 
 #include "lwdf.h"
 #include "conf.h"
+#include "lwdf-conf.h"
 
 #define PROG_NAME "lwdfwiz"
 #define VERSION_MAJOR 1
@@ -44,58 +46,12 @@
 
 static char *progname;
 
-
-struct lwdfwiz_cfg conf = {
-	.wiz = {
-		.samplerate = 88200,
-		.ftype = LWDF_ELLIP,
-		.order = 13,
-		.nbits = 0,
-		.bi = false,
-		.id = false,
-		.rx = false,
-		.ff = false,
-		.asmin = 6.0,
-		.as = 6.0,
-		.es = 0.0,
-		.fs = 22100.0,
-		.ap = 0.0,
-		.ep = 0.0,
-		.fp = 0.0
-	},
-	.prefix = "lp",
-	.cfname = "../test/filter.c",
-	.jlfname = "test.jl"
+static const struct option long_opts[] = {
+	{ "tune", no_argument, NULL, 'T' },
+	{ "report", required_argument, NULL, 'R' },
+	{ NULL, 0, NULL, 0 }
 };
 
-/*
- * Configuration profile
- */
-/* *INDENT-OFF* */
-BEGIN_SECTION(wiz)
-       DEFINE_FLOAT("samplerate", &conf.wiz.samplerate)
-       DEFINE_INT("ftype", &conf.wiz.ftype)
-       DEFINE_INT("nbits", &conf.wiz.nbits)
-       DEFINE_FLOAT("asmin", &conf.wiz.asmin)
-       DEFINE_FLOAT("as", &conf.wiz.as)
-       DEFINE_FLOAT("es", &conf.wiz.es)
-       DEFINE_FLOAT("fs", &conf.wiz.fs)
-       DEFINE_FLOAT("ap", &conf.wiz.ap)
-       DEFINE_FLOAT("ep", &conf.wiz.ep)
-       DEFINE_FLOAT("fp", &conf.wiz.fp)
-       DEFINE_BOOLEAN("bi", &conf.wiz.bi)
-       DEFINE_BOOLEAN("id", &conf.wiz.id)
-       DEFINE_BOOLEAN("rx", &conf.wiz.rx)
-       DEFINE_BOOLEAN("ff", &conf.wiz.ff)
-END_SECTION
-/* *INDENT-ON* */
-
-BEGIN_SECTION(conf_root)
-       DEFINE_SECTION("wizard", &wiz)
-       DEFINE_STRING("prefix", &conf.prefix)
-       DEFINE_STRING("cfname", &conf.prefix)
-       DEFINE_STRING("jlfname", &conf.jlfname)
-END_SECTION
 
 const char *confpath = "lwdfwiz.conf";
 
@@ -110,14 +66,27 @@ static void show_usage(void)
 	fprintf(stderr, "  -v  \tShow version\n");
 	fprintf(stderr, "  -o \t'FILE'\tOutput to a file\n");
 	fprintf(stderr, "  -g \tgenerate a gamma coefficients file\n");
+	fprintf(stderr, "  -p \tgenerate a C++ header\n");
 	fprintf(stderr, "  -F \t'FREQ'\tSamplerate frequency [Hz]"
 			" Default to 44100KHz.\n");
 	fprintf(stderr, "  -c \t'FREQ'\tCutoff frequency [Hz]"
 		" Default to 200Hz.\n");
 	fprintf(stderr, "  -a \t'ATTENUATION'\tpassband attenuation [dB]\n");
 	fprintf(stderr, "  -x \t'OVERSAMPLE'\toversampling factor\n");
-	fprintf(stderr, "  -d \t'DECIMATE'\tdecimation factor\n");
+	fprintf(stderr, "  -d \t'DECIMATE'\tdecimation/interpolation factor"
+			" (power of 2)\n");
 	fprintf(stderr, "  -i \t'INTERLEAVE'\tinterleaving factor\n");
+	fprintf(stderr, "  -b \t'BITS'\tcoefficients wordlength (0=float)\n");
+	fprintf(stderr, "  -m \tminimize multipliers (power-of-two/CSD coeffs)\n");
+	fprintf(stderr, "  -s \tshift and add C code for the fixed point"
+			" multipliers\n");
+	fprintf(stderr, "  -k \t'CHANNELS'\tvectorized C code for N channels\n");
+	fprintf(stderr, "  -l \t'LANES'\tchannels per vector (0=auto)\n");
+	fprintf(stderr, "  -u \t'UNROLL'\tsamples per C block loop iteration\n");
+	fprintf(stderr, "  -T, --tune\tbenchmark the C code variants on the host,"
+			" output the fastest\n");
+	fprintf(stderr, "  -R, --report \t'FILE'\tJSON cost report of the C"
+			" code\n");
 	fprintf(stderr, "\n");
 }
 
@@ -140,11 +109,14 @@ int main(int argc, char *argv[])
 {
 	char outname[FNAME_MAX_LEN + 1] = "";
 	char prefix[PREFIX_MAX_LEN + 1] = "";
+	char * rptname = NULL;
 	double samplerate = 11025;
 	bool jlgen = false;
+	bool cppgen = false;
 	bool gmgen = false;
 	bool cgen = false;
 	bool hgen = false;
+	bool tune = false;
 	bool do_magic = true;
 	bool outname_set = false;
 	int decimate = 0;
@@ -174,7 +146,8 @@ int main(int argc, char *argv[])
 	wiz = conf.wiz;
 
 	/* parse the command line options */
-	while ((c = getopt(argc, argv, "VH?hvqgjcdho:F:xdib:n:t:r:")) > 0) {
+	while ((c = getopt_long(argc, argv, "VH?hvqgjpcd:hmo:F:xib:n:t:r:k:l:u:sTR:",
+							long_opts, NULL)) > 0) {
 		switch (c) {
 		case 'V':
 			show_version();
@@ -195,12 +168,21 @@ int main(int argc, char *argv[])
 		case 'j':
 			jlgen = true;
 			break;
+		case 'p':
+			cppgen = true;
+			break;
 		case 'c':
 			cgen = true;
 			break;
 		case 'h':
 			hgen = true;
 			break;
+		case 'm':
+			wiz.mm = true;
+			break;
+		case 's':
+			wiz.csd = true;
+			break;
 		case 'o':
 			strncpy(outname, optarg, FNAME_MAX_LEN);
 			outname_set = true;
@@ -226,6 +208,22 @@ int main(int argc, char *argv[])
 		case 'b':
 			wiz.nbits = strtoul(optarg, NULL, 10);
 			break;
+		case 'k':
+			wiz.nchan = strtoul(optarg, NULL, 10);
+			break;
+		case 'l':
+			wiz.vlen = strtoul(optarg, NULL, 10);
+			break;
+		case 'u':
+			wiz.unroll = strtoul(optarg, NULL, 10);
+			break;
+		case 'T':
+			tune = true;
+			cgen = true;
+			break;
+		case 'R':
+			rptname = optarg;
+			break;
 		case 'N':
 			wiz.order = strtoul(optarg, NULL, 10);
 			break;
@@ -239,7 +237,6 @@ int main(int argc, char *argv[])
 	}
 
 	(void)samplerate;
-	(void)decimate;
 	(void)oversample;
 	(void)interleave;
 
@@ -251,6 +248,14 @@ int main(int argc, char *argv[])
 	if (quiet) 
 		verbose = 0;
 
+	if (decimate > 1) {
+		if (decimate & (decimate - 1)) {
+			fprintf(stderr, "decimation factor not a power of 2\n");
+			return 1;
+		}
+		for (wiz.stages = 0; (1 << wiz.stages) < decimate; wiz.stages++);
+	}
+
 	/* command line arguments sanity check */
 	if (cgen && hgen) {
 		fprintf(stderr, "incompatible options: -o -c -h\n");
@@ -267,6 +272,11 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	if (cppgen && (cgen || jlgen || gmgen)) {
+		fprintf(stderr, "incompatible options: -o -p -c -j -g\n");
+		return 1;
+	}
+
 	if (outname_set) {
 		if ((fout = fopen(outname, "w")) == NULL) {
 			fprintf(stderr, "ERROR: creating file \"%s\": %s\n", 
@@ -289,11 +299,22 @@ int main(int argc, char *argv[])
 	/* readback */
 
 	if (do_magic) {
+		struct lwdf_design_cache * cache = NULL;
+
+		/* an empty name disables the design cache */
+		if (conf.cache[0] != '\0')
+			cache = lwdf_design_cache_open(conf.cache);
+		lwdfwiz_cache_set(cache);
+
 		if (lwdfwiz_term(&wiz, &inf) < 0) {
 			fprintf(stderr, "!Error!1\n");
 			return 1;
 		}
 
+		lwdfwiz_cache_set(NULL);
+		if (cache != NULL)
+			lwdf_design_cache_close(cache);
+
 		/* write back to configuration */
 		conf.wiz = wiz;
 		/* save configuration */
@@ -322,8 +343,46 @@ int main(int argc, char *argv[])
 		return 0;
 	}
 
+	if (rptname != NULL) {
+		FILE * f;
+
+		if ((f = fopen(rptname, "w")) == NULL) {
+			fprintf(stderr, "ERROR: creating file \"%s\": %s\n",
+					rptname, strerror(errno));
+			return 1;
+		}
+		lwdf_cgen_report(f, &wiz, &inf);
+		fclose(f);
+		if (verbose)
+			fprintf(stderr, "cost report saved to file %s\n", rptname);
+	}
+
+	if (cppgen) {
+		if (lwdf_cppgen(fout, prefix, &wiz, &inf) < 0) {
+			fprintf(stderr, "ERROR: C++ code generation failed\n");
+			return 1;
+		}
+		if (outname_set) {
+			if (verbose) {
+				fprintf(stderr, "C++ header saved to file %s\n", outname);
+			}
+			fclose(fout);
+		}
+
+		return 0;
+	}
+
 	if (cgen) {
-		lwdf_cgen(fout, prefix, &wiz, &inf);
+		int ret;
+
+		if (tune)
+			ret = lwdf_cgen_tune(fout, prefix, &wiz, &inf);
+		else
+			ret = lwdf_cgen(fout, prefix, &wiz, &inf);
+		if (ret < 0) {
+			fprintf(stderr, "ERROR: C code generation failed\n");
+			return 1;
+		}
 		if (outname_set) {
 			if (verbose) {
 				fprintf(stderr, "C code saved to file %s\n", outname);
@@ -333,7 +392,10 @@ int main(int argc, char *argv[])
 	}
 
 	if (jlgen) {
-		lwdf_jlgen(fout, prefix, &wiz, &inf);
+		if (lwdf_jlgen(fout, prefix, &wiz, &inf) < 0) {
+			fprintf(stderr, "ERROR: Julia code generation failed\n");
+			return 1;
+		}
 		if (outname_set) {
 			if (verbose) {
 				fprintf(stderr, "Julia code saved to file %s\n", outname);
@@ -0,0 +1,428 @@
+/*
+ * lwdffit(1)  Lattice Wave Digital Filters custom mask fit
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdffit.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment:
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The mask file has one band per line:
+ *
+ *   # f0[Hz]  f1[Hz]  min[dB]  max[dB]  [gd]
+ *   0         9600    -0.1     0        1
+ *   12000     24000   -        -60
+ *
+ * '-' stands for no bound, a trailing 1 puts the band under the group
+ * delay ripple constraint (-G).
+ *
+ * The fit starts from elliptic designs derived from the mask, one for
+ * each stopband step, relaxed if needed to reach the order. The orders
+ * are tried from 3 up to the minimum order of the classic elliptic
+ * design. With a group delay constraint the search goes on for up to
+ * GD_ORDER_EXTRA (16) orders beyond it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwdf.h"
+
+#define PROG_NAME "lwdffit"
+#define VERSION_MAJOR 1
+#define VERSION_MINOR 0
+
+#define BAND_MAX 32
+#define GD_ORDER_EXTRA 16
+
+struct band {
+	double f0;
+	double f1;
+	double lo;
+	double hi;
+	bool gd;
+};
+
+static char *progname;
+
+static void show_usage(void)
+{
+	fprintf(stderr, "Usage: %s [OPTION...] MASKFILE\n", progname);
+	fprintf(stderr, "  -h  \tShow this help message\n");
+	fprintf(stderr, "  -v  \tShow version\n");
+	fprintf(stderr, "  -F \t'FREQ'\tSamplerate frequency [Hz]\n");
+	fprintf(stderr, "  -n \t'ORDER'\tfilter order (default: lowest found)\n");
+	fprintf(stderr, "  -k \t'POINTS'\tgrid points per band\n");
+	fprintf(stderr, "  -G \t'SAMPLES'\tgroup delay max ripple\n");
+	fprintf(stderr, "  -i \t'ITER'\tmax iterations\n");
+	fprintf(stderr, "  -H  \thighpass mask\n");
+	fprintf(stderr, "\n");
+}
+
+static void show_version(void)
+{
+	fprintf(stderr, "%s %d.%d\n", PROG_NAME, VERSION_MAJOR, VERSION_MINOR);
+}
+
+static double bound_parse(const char * s, double none)
+{
+	if (strcmp(s, "-") == 0)
+		return none;
+
+	return strtod(s, NULL);
+}
+
+static int mask_load(const char * fname, struct band band[])
+{
+	char buf[256];
+	FILE * f;
+	int cnt = 0;
+	int ln = 0;
+
+	if ((f = fopen(fname, "r")) == NULL) {
+		fprintf(stderr, "%s: can't open '%s'\n", progname, fname);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), f) != NULL) {
+		char lo[32];
+		char hi[32];
+		int gd = 0;
+		int n;
+
+		ln++;
+		if ((buf[strspn(buf, " \t\r\n")] == '\0') ||
+			(buf[strspn(buf, " \t")] == '#'))
+			continue;
+
+		if (cnt == BAND_MAX) {
+			fprintf(stderr, "%s:%d: too many bands\n", fname, ln);
+			break;
+		}
+
+		n = sscanf(buf, "%lf %lf %31s %31s %d", &band[cnt].f0,
+				   &band[cnt].f1, lo, hi, &gd);
+		if ((n < 4) || (band[cnt].f1 < band[cnt].f0)) {
+			fprintf(stderr, "%s:%d: invalid band\n", fname, ln);
+			fclose(f);
+			return -1;
+		}
+
+		band[cnt].lo = bound_parse(lo, -INFINITY);
+		band[cnt].hi = bound_parse(hi, INFINITY);
+		band[cnt].gd = (gd != 0);
+		cnt++;
+	}
+
+	fclose(f);
+
+	return cnt;
+}
+
+/* Classic lowpass specification meeting the mask: passband where there is
+   a min gain, stopband where the max gain is below -3dB. */
+static int mask_spec(const struct band band[], int cnt, double samplerate,
+					 bool hp, struct lwdfwiz_param * spec)
+{
+	double fp = 0;
+	double fs = samplerate / 2;
+	double ap = 0;
+	double as = 0;
+	int i;
+
+	for (i = 0; i < cnt; ++i) {
+		double f0 = hp ? (samplerate / 2 - band[i].f1) : band[i].f0;
+		double f1 = hp ? (samplerate / 2 - band[i].f0) : band[i].f1;
+
+		if (isfinite(band[i].lo)) {
+			fp = fmax(fp, f1);
+			ap = fmax(ap, -band[i].lo);
+		}
+		if (band[i].hi <= -3) {
+			fs = fmin(fs, f0);
+			as = fmax(as, -band[i].hi);
+		}
+	}
+
+	if ((fp <= 0) || (fs <= fp) || (as <= 0) || !isfinite(as)) {
+		fprintf(stderr, "%s: the mask is not a %s\n", progname,
+				hp ? "highpass" : "lowpass");
+		return -1;
+	}
+
+	memset(spec, 0, sizeof(struct lwdfwiz_param));
+	spec->samplerate = samplerate;
+	spec->ftype = LWDF_ELLIP;
+	spec->fp = fp;
+	spec->fs = fs;
+	spec->ft = fs;
+	spec->ap = (ap > 0) ? ap : 0.1;
+	spec->asmin = as;
+
+	return 0;
+}
+
+/* Initial guess: elliptic design of order N with the stopband from the
+   edge of band b, relaxing the attenuation if the order is too low. */
+static int initial_guess(const struct lwdfwiz_param * spec,
+						 const struct band band[], int cnt, int b,
+						 unsigned int N, bool hp, double gamma[])
+{
+	struct lwdfwiz_param wiz = *spec;
+	double fnyq = spec->samplerate / 2;
+	struct lwdf_info inf;
+	unsigned int i;
+
+	if (band[b].hi > -3)
+		return -1;
+
+	wiz.fs = hp ? (fnyq - band[b].f1) : band[b].f0;
+	if (wiz.fs <= wiz.fp)
+		return -1;
+
+	/* attenuation beyond the edge */
+	wiz.asmin = 0;
+	for (i = 0; i < (unsigned int)cnt; ++i) {
+		double f = hp ? (fnyq - band[i].f1) : band[i].f0;
+
+		if ((band[i].hi <= -3) && (f >= wiz.fs))
+			wiz.asmin = fmax(wiz.asmin, -band[i].hi);
+	}
+
+	wiz.order = N;
+	for (; wiz.asmin > 1; wiz.asmin *= 0.9) {
+		wiz.ft = wiz.fs;
+		if (lwdf_design(&wiz, &inf) < 0)
+			continue;
+
+		for (i = 0; i < N; ++i) {
+			/* z -> -z maps the lowpass into a highpass, the first order
+			   section changes sign, so the branches are subtracted */
+			gamma[i] = (hp && ((i & 1) == 0)) ? -inf.gamma[i] : inf.gamma[i];
+		}
+		return 0;
+	}
+
+	return -1;
+}
+
+int main(int argc, char *argv[])
+{
+	struct band band[BAND_MAX];
+	double gamma[LWDF_ORDER_MAX];
+	struct lwdf_design_range rng;
+	struct lwdfwiz_param spec;
+	struct lwdf_fit_cfg cfg;
+	struct lwdf_mask mask;
+	double samplerate = 48000;
+	unsigned int order = 0;
+	unsigned int npts = 64;
+	unsigned int nmax;
+	unsigned int last = 0;
+	unsigned int N;
+	double ripple = 0;
+	bool hp = false;
+	double * w;
+	double * lo;
+	double * hi;
+	bool * gd;
+	double err = 0;
+	int ret = 0;
+	int cnt;
+	int c;
+	int i;
+	int j;
+
+	/* the program name start just after the last slash */
+	if ((progname = (char *)strrchr(argv[0], '/')) == NULL)
+		progname = argv[0];
+	else
+		progname++;
+
+	memset(&cfg, 0, sizeof(cfg));
+
+	while ((c = getopt(argc, argv, "V?hvHF:n:k:G:i:")) > 0) {
+		switch (c) {
+		case 'V':
+		case 'v':
+			show_version();
+			return 0;
+		case '?':
+		case 'h':
+			show_usage();
+			return 1;
+		case 'H':
+			hp = true;
+			break;
+		case 'F':
+			samplerate = strtod(optarg, NULL);
+			break;
+		case 'n':
+			order = strtoul(optarg, NULL, 10);
+			break;
+		case 'k':
+			npts = strtoul(optarg, NULL, 10);
+			break;
+		case 'G':
+			ripple = strtod(optarg, NULL);
+			break;
+		case 'i':
+			cfg.iter_max = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			show_usage();
+			return 2;
+		}
+	}
+
+	if (optind != argc - 1) {
+		show_usage();
+		return 3;
+	}
+
+	if ((order != 0) && (((order & 1) == 0) || (order > LWDF_ORDER_MAX))) {
+		fprintf(stderr, "invalid order: %u\n", order);
+		return 1;
+	}
+
+	if (npts < 2) {
+		fprintf(stderr, "invalid number of points: %u\n", npts);
+		return 1;
+	}
+
+	if ((cnt = mask_load(argv[optind], band)) <= 0)
+		return 1;
+
+	if (mask_spec(band, cnt, samplerate, hp, &spec) < 0)
+		return 1;
+
+	/* grid */
+	w = calloc(cnt * npts, sizeof(double));
+	lo = calloc(cnt * npts, sizeof(double));
+	hi = calloc(cnt * npts, sizeof(double));
+	gd = calloc(cnt * npts, sizeof(bool));
+	if ((w == NULL) || (lo == NULL) || (hi == NULL) || (gd == NULL)) {
+		fprintf(stderr, "calloc() failed!\n");
+		return 1;
+	}
+
+	memset(&mask, 0, sizeof(mask));
+	mask.len = cnt * npts;
+	mask.w = w;
+	mask.lo = lo;
+	mask.hi = hi;
+	mask.gd = (ripple > 0) ? gd : NULL;
+	mask.gd_ripple = ripple;
+
+	for (i = 0; i < cnt; ++i) {
+		for (j = 0; j < (int)npts; ++j) {
+			double f = band[i].f0 + (band[i].f1 - band[i].f0) * j / (npts - 1);
+			int k = i * npts + j;
+
+			w[k] = f / samplerate;
+			lo[k] = band[i].lo;
+			hi[k] = band[i].hi;
+			gd[k] = band[i].gd;
+		}
+	}
+
+	/* classic design minimum order */
+	spec.order = 0;
+	if (lwdf_design_range(&spec, &rng) < 0) {
+		fprintf(stderr, "invalid mask specification\n");
+		ret = 1;
+		goto done;
+	}
+	printf("# elliptic minimum order: %d\n", rng.nmin);
+
+	N = (order != 0) ? order : 3;
+	nmax = (order != 0) ? order : rng.nmin;
+	if ((order == 0) && (ripple > 0)) {
+		/* the classic designs don't bound the group delay */
+		nmax = (rng.nmin + GD_ORDER_EXTRA < LWDF_ORDER_MAX) ?
+			rng.nmin + GD_ORDER_EXTRA : LWDF_ORDER_MAX;
+	}
+	for (; N <= nmax; N += 2) {
+		double best = INFINITY;
+		bool met = false;
+
+		/* one start per stopband step, keep the closest fit */
+		for (i = 0; (i < cnt) && !met; ++i) {
+			double g[LWDF_ORDER_MAX];
+			double e;
+
+			if (initial_guess(&spec, band, cnt, i, N, hp, g) < 0)
+				continue;
+
+			if ((ret = lwdf_fit(&mask, hp ? LWDF_RESP_HIGHPASS :
+								LWDF_RESP_LOWPASS, g, N, &cfg, &e)) < 0) {
+				ret = 1;
+				goto done;
+			}
+
+			if (e < best) {
+				memcpy(gamma, g, N * sizeof(double));
+				best = e;
+				met = (ret == 1);
+			}
+		}
+
+		if (isfinite(best)) {
+			err = best;
+			last = N;
+		}
+
+		if (met)
+			break;
+	}
+
+	if (last == 0) {
+		fprintf(stderr, "no initial design for the mask\n");
+		ret = 1;
+		goto done;
+	}
+
+	if (N > nmax) {
+		/* report the last attempt */
+		N = last;
+		printf("# mask not met, max error: %.6f\n", err);
+		ret = 1;
+	} else {
+		printf("# mask met\n");
+		ret = 0;
+	}
+
+	printf("# order: %d\n", N);
+	for (j = 0; j < (int)N; j++)
+		printf("    gamma[%2d] = %+12.9f\n", j, gamma[j]);
+
+done:
+	free(w);
+	free(lo);
+	free(hi);
+	free(gd);
+
+	return ret;
+}
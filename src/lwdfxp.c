@@ -0,0 +1,258 @@
+/*
+ * lwdfwiz(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	lwdfxp.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: Design space explorer
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwdf.h"
+
+#define PROG_NAME "lwdfxp"
+#define VERSION_MAJOR 1
+#define VERSION_MINOR 0
+
+static char *progname;
+
+static void show_usage(void)
+{
+	fprintf(stderr, "Usage: %s [OPTION...]\n", progname);
+	fprintf(stderr, "  -h  \tShow this help message\n");
+	fprintf(stderr, "  -v  \tShow version\n");
+	fprintf(stderr, "  -F \t'FREQ'\tSamplerate frequency [Hz]\n");
+	fprintf(stderr, "  -p \t'FREQ'\tPassband upper edge [Hz]\n");
+	fprintf(stderr, "  -s \t'FREQ'\tStopband lower edge [Hz]\n");
+	fprintf(stderr, "  -a \t'ATTENUATION'\tpassband attenuation spread [dB]\n");
+	fprintf(stderr, "  -A \t'ATTENUATION'\tstopband min attenuation [dB]\n");
+	fprintf(stderr, "  -n \t'ORDERS'\textra orders above the minimum\n");
+	fprintf(stderr, "  -k \t'STEPS'\tsteps of each design parameter\n");
+	fprintf(stderr, "  -b \t'BITS'\tmax coefficient wordlength\n");
+	fprintf(stderr, "  -j \t'THREADS'\tworker threads (0=all cpus)\n");
+	fprintf(stderr, "  -g  \tprint the gamma coefficients\n");
+	fprintf(stderr, "  -C \t'FILE'\tdesign cache file\n");
+	fprintf(stderr, "  -t \t'TARGET'\tsort by the cycles on TARGET "
+			"(cortex-m4, x86)\n");
+	fprintf(stderr, "\n");
+}
+
+static void show_version(void)
+{
+	fprintf(stderr, "%s %d.%d\n", PROG_NAME, VERSION_MAJOR, VERSION_MINOR);
+}
+
+static const char * ftype_name(const struct lwdf_cand * c)
+{
+	switch (c->wiz.ftype) {
+	case LWDF_BUTTW:
+		return c->inf.bi ? "buttw-bi" : "buttw";
+	case LWDF_CHEB1:
+		return "cheb1";
+	case LWDF_ELLIP:
+		return c->inf.bi ? "ellip-bi" : "ellip";
+	}
+
+	return "?";
+}
+
+/* Candidate and its cycle estimate on the sorting target */
+struct cand_cyc {
+	double cyc;
+	int idx;
+};
+
+static int cand_cyc_cmp(const void * a, const void * b)
+{
+	const struct cand_cyc * x = (const struct cand_cyc *)a;
+	const struct cand_cyc * y = (const struct cand_cyc *)b;
+
+	if (x->cyc != y->cyc)
+		return (x->cyc < y->cyc) ? -1 : 1;
+	/* ties keep the order of the front */
+	return x->idx - y->idx;
+}
+
+int main(int argc, char *argv[])
+{
+	struct lwdf_explore_cfg cfg;
+	struct lwdfwiz_param spec;
+	struct lwdf_cand * front;
+	const struct lwdf_target * m4 = lwdf_target_get("cortex-m4");
+	const struct lwdf_target * x86 = lwdf_target_get("x86");
+	const struct lwdf_target * tgt = m4;
+	struct cand_cyc * ord;
+	char * cname = NULL;
+	bool gamma = false;
+	int cnt;
+	int c;
+	int i;
+	int j;
+
+	/* the program name start just after the last slash */
+	if ((progname = (char *)strrchr(argv[0], '/')) == NULL)
+		progname = argv[0];
+	else
+		progname++;
+
+	memset(&spec, 0, sizeof(spec));
+	spec.samplerate = 48000;
+	spec.fp = 9600;
+	spec.fs = 12000;
+	spec.ap = 0.1;
+	spec.asmin = 60;
+
+	cfg.dn = 4;
+	cfg.nstep = 8;
+	cfg.nbits_max = 24;
+	cfg.nthreads = 0;
+	cfg.cache = NULL;
+
+	while ((c = getopt(argc, argv, "VH?hvgF:p:s:a:A:n:k:b:j:C:t:")) > 0) {
+		switch (c) {
+		case 'V':
+		case 'v':
+			show_version();
+			return 0;
+		case '?':
+		case 'H':
+		case 'h':
+			show_usage();
+			return 1;
+		case 'g':
+			gamma = true;
+			break;
+		case 'F':
+			spec.samplerate = strtod(optarg, NULL);
+			break;
+		case 'p':
+			spec.fp = strtod(optarg, NULL);
+			break;
+		case 's':
+			spec.fs = strtod(optarg, NULL);
+			break;
+		case 'a':
+			spec.ap = strtod(optarg, NULL);
+			break;
+		case 'A':
+			spec.asmin = strtod(optarg, NULL);
+			break;
+		case 'n':
+			cfg.dn = strtoul(optarg, NULL, 10);
+			break;
+		case 'k':
+			cfg.nstep = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			cfg.nbits_max = strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			cfg.nthreads = strtoul(optarg, NULL, 10);
+			break;
+		case 'C':
+			cname = optarg;
+			break;
+		case 't':
+			if ((tgt = lwdf_target_get(optarg)) == NULL) {
+				fprintf(stderr, "unknown target: %s\n", optarg);
+				return 1;
+			}
+			break;
+		default:
+			show_usage();
+			return 2;
+		}
+	}
+
+	if (optind < argc) {
+		fprintf(stderr, "Unexpected positional argument\n");
+		return 3;
+	}
+
+	if ((cfg.nbits_max < 2) || (cfg.nbits_max > LWDF_NBITS_MAX)) {
+		fprintf(stderr, "invalid wordlength: %u\n", cfg.nbits_max);
+		return 1;
+	}
+
+	if ((cname != NULL) &&
+		((cfg.cache = lwdf_design_cache_open(cname)) == NULL))
+		return 1;
+
+	cnt = lwdf_explore(&spec, &cfg, &front);
+
+	if (cfg.cache != NULL) {
+		unsigned int hit;
+		unsigned int miss;
+
+		lwdf_design_cache_stat(cfg.cache, &hit, &miss);
+		fprintf(stderr, "design cache: %u hits, %u misses\n", hit, miss);
+		lwdf_design_cache_close(cfg.cache);
+	}
+
+	if (cnt < 0) {
+		fprintf(stderr, "!Error!1\n");
+		return 1;
+	}
+
+	if (cnt == 0) {
+		fprintf(stderr, "no design meets the specification\n");
+		return 1;
+	}
+
+	/* the cheapest on the target first */
+	ord = calloc(cnt, sizeof(struct cand_cyc));
+	for (i = 0; i < cnt; ++i) {
+		ord[i].cyc = lwdf_cgen_cycles(&front[i].wiz, &front[i].inf, tgt);
+		ord[i].idx = i;
+	}
+	qsort(ord, cnt, sizeof(struct cand_cyc), cand_cyc_cmp);
+
+	printf("# %-8s %3s %4s %5s %5s %4s %5s %10s %10s %8s %8s %9s %6s %6s\n",
+		   "type", "N", "mul", "shift", "adapt", "coef", "nbits",
+		   "g", "ep", "ft", "as_mrg", "ap_mrg", "m4cyc", "x86cyc");
+
+	for (i = 0; i < cnt; ++i) {
+		struct lwdf_cand * p = &front[ord[i].idx];
+
+		printf("  %-8s %3d %4d %5d %5d %4d %5d %10.6f %10.6f %8.1f "
+			   "%8.3f %9.5f %6.1f %6.1f\n", ftype_name(p), p->inf.order,
+			   p->cost.mul, p->cost.shift, p->cost.adaptor, p->cost.coeff,
+			   p->cost.nbits, p->wiz.g, p->wiz.ep, p->wiz.ft,
+			   p->as_margin, p->ap_margin,
+			   lwdf_cgen_cycles(&p->wiz, &p->inf, m4),
+			   lwdf_cgen_cycles(&p->wiz, &p->inf, x86));
+
+		if (gamma) {
+			for (j = 0; j < p->inf.order; j++)
+				printf("    gamma[%2d] = %+12.9f\n", j, p->inf.gamma[j]);
+		}
+	}
+
+	free(ord);
+	free(front);
+
+	return 0;
+}
@@ -0,0 +1,358 @@
+/*
+ * cache-test(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	cache-test.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: frequency response cache self check
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The cache is built with a small CACHE_FILE_MAX (see the Makefile), so
+ * the concurrent test goes through many compactions of the file while
+ * the other processes read it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "lwdf.h"
+
+/* frequencies of each response */
+#define TEST_LEN 64
+/* distinct responses of the concurrent test */
+#define TEST_KEYS 64
+#define TEST_PROCS 4
+#define TEST_THREADS 2
+#define TEST_OPS 400
+
+/* Leading fields of the file records, lwdf-fp64-cache.c */
+struct test_file_hdr {
+	char magic[8];
+	uint32_t gen;
+	uint32_t rsvd;
+};
+
+struct test_rec {
+	uint32_t magic;
+	uint32_t size;
+	uint64_t hash;
+	double samplerate;
+	uint32_t dftn;
+	uint16_t resp;
+	uint16_t order;
+	uint32_t len;
+	uint32_t version;
+};
+
+static int fail;
+
+static void check(const char * name, bool ok)
+{
+	printf("%-40s %s\n", name, ok ? "ok" : "FAIL");
+	if (!ok)
+		fail++;
+}
+
+/* Filter of the key k */
+static struct lwdf_fp64 * __flt(unsigned int k)
+{
+	double gamma[3] = { 0.1 + 0.001 * k, 0.5, -0.3 };
+	struct lwdf_fp64 * flt;
+
+	flt = lwdf_fp64_new(48000);
+	lwdf_fp64_gamma_set(flt, gamma, 3);
+
+	return flt;
+}
+
+static void __w(double w[])
+{
+	unsigned int i;
+
+	for (i = 0; i < TEST_LEN; ++i)
+		w[i] = 0.5 * i / TEST_LEN;
+}
+
+/* Response stored for the key k, any data will do */
+static void __z(complex double z[], unsigned int k)
+{
+	unsigned int i;
+
+	for (i = 0; i < TEST_LEN; ++i)
+		z[i] = k + 1e-3 * i - I * k;
+}
+
+static int __put(struct lwdf_fp64_cache * cache, unsigned int k)
+{
+	struct lwdf_fp64 * flt = __flt(k);
+	complex double z[TEST_LEN];
+	double w[TEST_LEN];
+	int ret;
+
+	__w(w);
+	__z(z, k);
+	ret = lwdf_fp64_cache_put(cache, flt, 0, 0, w, z, TEST_LEN);
+	lwdf_fp64_free(flt);
+
+	return ret;
+}
+
+/* 1 hit with the expected response, 0 miss, -1 error or wrong data */
+static int __get(struct lwdf_fp64_cache * cache, unsigned int k,
+				 unsigned int resp)
+{
+	struct lwdf_fp64 * flt = __flt(k);
+	complex double z[TEST_LEN];
+	complex double ref[TEST_LEN];
+	double w[TEST_LEN];
+	ssize_t n;
+
+	__w(w);
+	__z(ref, k);
+	n = lwdf_fp64_cache_get(cache, flt, resp, 0, w, z, TEST_LEN);
+	lwdf_fp64_free(flt);
+
+	if (n == 0)
+		return 0;
+	if (n != TEST_LEN)
+		return -1;
+
+	return (memcmp(z, ref, sizeof(z)) == 0) ? 1 : -1;
+}
+
+/* Memory only: hits, misses on any other key field, statistics */
+static void test_hit_miss(void)
+{
+	struct lwdf_fp64_cache * cache = lwdf_fp64_cache_new(4, NULL);
+	unsigned int hit;
+	unsigned int miss;
+
+	check("empty cache miss", __get(cache, 1, 0) == 0);
+	__put(cache, 1);
+	check("hit", __get(cache, 1, 0) == 1);
+	check("miss, other filter", __get(cache, 2, 0) == 0);
+	check("miss, other response type", __get(cache, 1, 1) == 0);
+	lwdf_fp64_cache_stat(cache, &hit, &miss);
+	check("statistics", (hit == 1) && (miss == 3));
+
+	lwdf_fp64_cache_free(cache);
+}
+
+/* The least recently used entry goes first */
+static void test_eviction(void)
+{
+	struct lwdf_fp64_cache * cache = lwdf_fp64_cache_new(3, NULL);
+
+	__put(cache, 1);
+	__put(cache, 2);
+	__put(cache, 3);
+	/* 1 becomes the most recently used, 2 the least */
+	__get(cache, 1, 0);
+	__put(cache, 4);
+	check("LRU evicted", __get(cache, 2, 0) == 0);
+	check("LRU kept", (__get(cache, 1, 0) == 1) &&
+		  (__get(cache, 3, 0) == 1) && (__get(cache, 4, 0) == 1));
+
+	lwdf_fp64_cache_free(cache);
+}
+
+/* Responses of an earlier run, records of another version, files of
+   an older format */
+static void test_file(const char * path)
+{
+	struct lwdf_fp64_cache * cache;
+	struct test_rec rec;
+	int fd;
+
+	unlink(path);
+	cache = lwdf_fp64_cache_new(0, path);
+	__put(cache, 5);
+	lwdf_fp64_cache_free(cache);
+
+	cache = lwdf_fp64_cache_new(0, path);
+	check("file hit", __get(cache, 5, 0) == 1);
+	lwdf_fp64_cache_free(cache);
+
+	/* the first record, made by another version of the computation */
+	fd = open(path, O_RDWR);
+	pread(fd, &rec, sizeof(rec), sizeof(struct test_file_hdr));
+	rec.version++;
+	pwrite(fd, &rec, sizeof(rec), sizeof(struct test_file_hdr));
+	close(fd);
+
+	cache = lwdf_fp64_cache_new(0, path);
+	check("file version mismatch miss", __get(cache, 5, 0) == 0);
+	__put(cache, 5);
+	check("file version mismatch replaced", __get(cache, 5, 0) == 1);
+	lwdf_fp64_cache_free(cache);
+
+	/* an older file format is emptied */
+	fd = open(path, O_RDWR);
+	pwrite(fd, "LWDFRC01", 8, 0);
+	close(fd);
+
+	cache = lwdf_fp64_cache_new(0, path);
+	check("older file format", (cache != NULL) && (__get(cache, 5, 0) == 0));
+	if (cache != NULL)
+		lwdf_fp64_cache_free(cache);
+
+	unlink(path);
+}
+
+struct test_task {
+	struct lwdf_fp64_cache * cache;
+	unsigned int seed;
+	unsigned int hit;
+	unsigned int err;
+};
+
+static void * __task(void * arg)
+{
+	struct test_task * t = (struct test_task *)arg;
+	unsigned int i;
+
+	for (i = 0; i < TEST_OPS; ++i) {
+		unsigned int k = rand_r(&t->seed) % TEST_KEYS;
+		int r = __get(t->cache, k, 0);
+
+		if (r < 0)
+			t->err++;
+		else if (r > 0)
+			t->hit++;
+		else if (__put(t->cache, k) < 0)
+			t->err++;
+	}
+
+	return NULL;
+}
+
+/* A process of the concurrent test: threads sharing a small memory
+   cache, the file shared with the other processes */
+static int __proc(const char * path, unsigned int id)
+{
+	struct test_task task[TEST_THREADS];
+	pthread_t thread[TEST_THREADS];
+	struct lwdf_fp64_cache * cache;
+	unsigned int err = 0;
+	unsigned int hit = 0;
+	unsigned int i;
+
+	if ((cache = lwdf_fp64_cache_new(8, path)) == NULL)
+		return 1;
+
+	for (i = 0; i < TEST_THREADS; ++i) {
+		task[i].cache = cache;
+		task[i].seed = 1 + id * TEST_THREADS + i;
+		task[i].hit = 0;
+		task[i].err = 0;
+		pthread_create(&thread[i], NULL, __task, &task[i]);
+	}
+	for (i = 0; i < TEST_THREADS; ++i) {
+		pthread_join(thread[i], NULL);
+		err += task[i].err;
+		hit += task[i].hit;
+	}
+	lwdf_fp64_cache_free(cache);
+
+	/* every hit returned the response stored for its key */
+	return (err == 0) && (hit > 0) ? 0 : 1;
+}
+
+static void test_concurrent(const char * path)
+{
+	struct test_file_hdr hdr;
+	struct lwdf_fp64_cache * cache;
+	pid_t pid[TEST_PROCS];
+	unsigned int i;
+	int ok = 1;
+	int err = 0;
+	int fd;
+
+	unlink(path);
+	for (i = 0; i < TEST_PROCS; ++i) {
+		if ((pid[i] = fork()) == 0)
+			_exit(__proc(path, i));
+	}
+	for (i = 0; i < TEST_PROCS; ++i) {
+		int st;
+
+		if ((pid[i] < 0) || (waitpid(pid[i], &st, 0) < 0) ||
+			!WIFEXITED(st) || (WEXITSTATUS(st) != 0))
+			ok = 0;
+	}
+	check("concurrent processes and threads", ok);
+
+	/* whatever survived the compactions is intact */
+	cache = lwdf_fp64_cache_new(0, path);
+	ok = 0;
+	for (i = 0; i < TEST_KEYS; ++i) {
+		int r = __get(cache, i, 0);
+
+		if (r < 0)
+			err++;
+		ok += r;
+	}
+	check("file after the concurrent test", (err == 0) && (ok > 0));
+	lwdf_fp64_cache_free(cache);
+
+	/* the generation counts the compactions */
+	memset(&hdr, 0, sizeof(hdr));
+	if ((fd = open(path, O_RDONLY)) >= 0) {
+		pread(fd, &hdr, sizeof(hdr), 0);
+		close(fd);
+	}
+	check("file compacted", hdr.gen > 0);
+
+	unlink(path);
+}
+
+int main(int argc, char *argv[])
+{
+	char path[] = "/tmp/cache-test-XXXXXX";
+	int fd;
+
+	if ((fd = mkstemp(path)) < 0) {
+		fprintf(stderr, "mkstemp(): %s.\n", strerror(errno));
+		return 1;
+	}
+	close(fd);
+
+	test_hit_miss();
+	test_eviction();
+	test_file(path);
+	test_concurrent(path);
+
+	if (fail) {
+		printf("%d tests failed\n", fail);
+		return 1;
+	}
+
+	return 0;
+}
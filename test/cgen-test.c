@@ -0,0 +1,938 @@
+/*
+ * cgen-test(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	cgen-test.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: generated C code check and throughput
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * For each design of the matrix the code of lwdf_cgen() is written to
+ * a temporary directory with a driver, compiled with $CC (default cc)
+ * and $CFLAGS (default -O2) and run on a sweep, an impulse and noise. The float code is checked
+ * against the lwdf_fp64 runtime, the fixed point code bit by bit
+ * against the integer model of the adaptors below. The first call of
+ * each kernel is a short odd block, the state must carry over.
+ *
+ * The other code variants are cross checked against the scalar code of
+ * the same design, bit by bit: the multi-channel vector kernels, the
+ * unrolled block loops and the multistage decimators and interpolators,
+ * against cascades of the 2x ones.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "lwdf.h"
+
+/* samples of each input signal */
+#define TEST_LEN 2048
+#define TEST_NX (3 * TEST_LEN)
+/* first block of the kernels */
+#define TEST_BLK 37
+/* samples of the cross checks, a multiple of the largest rate change */
+#define TEST_XNX 8192
+/* float code error, relative to the peak of the reference */
+#define TEST_TOL 1e-4
+
+static int fail;
+static int skip;
+
+static const char * const ftype_name[] = { "", "buttw", "cheb1", "ellip" };
+
+static const char * const drv_code[] = {
+	"",
+	"/* ---- test driver ---- */",
+	"",
+	"#include <stdio.h>",
+	"#include <string.h>",
+	"#include <time.h>",
+	"",
+	"static T x[NX];",
+	"static T y[4][2 * NX];",
+	"static T st[4 * 128];",
+	"",
+	"static double now(void)",
+	"{",
+	"\tstruct timespec t;",
+	"",
+	"\tclock_gettime(CLOCK_MONOTONIC, &t);",
+	"\treturn t.tv_sec + t.tv_nsec * 1e-9;",
+	"}",
+	"",
+	"int main(int argc, char *argv[])",
+	"{",
+	"\tunsigned int n;",
+	"\tdouble t0;",
+	"\tdouble dt;",
+	"\tFILE * f;",
+	"",
+	"\tif ((f = fopen(argv[1], \"r\")) == NULL)",
+	"\t\treturn 1;",
+	"\tif (fread(x, sizeof(T), NX, f) != NX)",
+	"\t\treturn 1;",
+	"\tfclose(f);",
+	"",
+	"#if ID",
+	"\tdecimate2(st, y[0], x, BLK);",
+	"\tdecimate2(st, y[0] + BLK, x + 2 * BLK, NX / 2 - BLK);",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tinterpolate2(st, y[1], x, BLK);",
+	"\tinterpolate2(st, y[1] + 2 * BLK, x + BLK, NX - BLK);",
+	"#else",
+	"\tlp_filter(st, y[0], x, BLK);",
+	"\tlp_filter(st, y[0] + BLK, x + BLK, NX - BLK);",
+	"\tmemset(st, 0, sizeof(st));",
+	"\thp_filter(st, y[1], x, BLK);",
+	"\thp_filter(st, y[1] + BLK, x + BLK, NX - BLK);",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tsplitband(st, y[2], y[3], x, BLK);",
+	"\tsplitband(st, y[2] + BLK, y[3] + BLK, x + BLK, NX - BLK);",
+	"#endif",
+	"",
+	"\tif ((f = fopen(argv[2], \"w\")) == NULL)",
+	"\t\treturn 1;",
+	"\tfwrite(y, sizeof(y), 1, f);",
+	"\tfclose(f);",
+	"",
+	"\t/* input samples per second, on the noise: the decay of the",
+	"\t   impulse response ends in denormals */",
+	"\tn = 0;",
+	"\tt0 = now();",
+	"\tdo {",
+	"#if ID",
+	"\t\tdecimate2(st, y[0], x + 2 * LEN, LEN / 2);",
+	"#else",
+	"\t\tlp_filter(st, y[0], x + 2 * LEN, LEN);",
+	"#endif",
+	"\t\tn++;",
+	"\t} while ((dt = now() - t0) < 0.05);",
+	"\tprintf(\"%.0f\\n\", (double)n * LEN / dt);",
+	"",
+	"\treturn 0;",
+	"}",
+	NULL
+};
+
+/*
+ * Cross check driver: the kernels under test (prefix x_) against the
+ * scalar code of the same design on noise, the first call of each
+ * kernel on a short odd block. Prints the largest difference.
+ */
+static const char * const xdrv_code[] = {
+	"",
+	"/* ---- cross check driver ---- */",
+	"",
+	"#include <stdio.h>",
+	"#include <string.h>",
+	"",
+	"static double err;",
+	"",
+	"static void cmp(const T * a, const T * b, unsigned int n,",
+	"\t\t\t\tunsigned int sa, unsigned int sb)",
+	"{",
+	"\tunsigned int i;",
+	"",
+	"\tfor (i = 0; i < n; ++i) {",
+	"\t\tdouble d = (double)a[i * sa] - (double)b[i * sb];",
+	"",
+	"\t\tif (d < 0)",
+	"\t\t\td = -d;",
+	"\t\tif (d > err)",
+	"\t\t\terr = d;",
+	"\t}",
+	"}",
+	"",
+	"static T sig(void)",
+	"{",
+	"\tstatic unsigned int r = 1;",
+	"",
+	"\tr = r * 1103515245u + 12345u;",
+	"\treturn (T)(A * ((double)((r >> 16) & 0x7fff) / 16384.0 - 1.0));",
+	"}",
+	"",
+	"#if XCHK == 1",
+	"static T x[NX][NCH];",
+	"static T y[NX][NCH];",
+	"static T vst[128][NCH];",
+	"static T xs[NX];",
+	"static T ys[NX];",
+	"static T st[128];",
+	"",
+	"static void scalar(int hp)",
+	"{",
+	"\tunsigned int c;",
+	"\tunsigned int i;",
+	"",
+	"\tfor (c = 0; c < NCH; ++c) {",
+	"\t\tfor (i = 0; i < NX; ++i)",
+	"\t\t\txs[i] = x[i][c];",
+	"\t\tmemset(st, 0, sizeof(st));",
+	"\t\tif (hp)",
+	"\t\t\thp_filter(st, ys, xs, NX);",
+	"\t\telse",
+	"\t\t\tlp_filter(st, ys, xs, NX);",
+	"\t\tcmp(ys, &y[0][c], NX, 1, NCH);",
+	"\t}",
+	"}",
+	"",
+	"int main(int argc, char *argv[])",
+	"{",
+	"\tunsigned int c;",
+	"\tunsigned int i;",
+	"",
+	"\tfor (i = 0; i < NX; ++i)",
+	"\t\tfor (c = 0; c < NCH; ++c)",
+	"\t\t\tx[i][c] = sig();",
+	"",
+	"\tx_vlowpass(vst, y, x, BLK);",
+	"\tx_vlowpass(vst, y + BLK, x + BLK, NX - BLK);",
+	"\tscalar(0);",
+	"\tmemset(vst, 0, sizeof(vst));",
+	"\tx_vhighpass(vst, y, x, BLK);",
+	"\tx_vhighpass(vst, y + BLK, x + BLK, NX - BLK);",
+	"\tscalar(1);",
+	"",
+	"\tprintf(\"%.17g\\n\", err);",
+	"",
+	"\treturn 0;",
+	"}",
+	"#endif",
+	"",
+	"#if XCHK == 2",
+	"static T x[NX];",
+	"static T y[4][NX];",
+	"static T st[128];",
+	"",
+	"int main(int argc, char *argv[])",
+	"{",
+	"\tunsigned int i;",
+	"",
+	"\tfor (i = 0; i < NX; ++i)",
+	"\t\tx[i] = sig();",
+	"",
+	"\tx_lp_filter(st, y[0], x, BLK);",
+	"\tx_lp_filter(st, y[0] + BLK, x + BLK, NX - BLK);",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tlp_filter(st, y[1], x, NX);",
+	"\tcmp(y[0], y[1], NX, 1, 1);",
+	"",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tx_hp_filter(st, y[0], x, BLK);",
+	"\tx_hp_filter(st, y[0] + BLK, x + BLK, NX - BLK);",
+	"\tmemset(st, 0, sizeof(st));",
+	"\thp_filter(st, y[1], x, NX);",
+	"\tcmp(y[0], y[1], NX, 1, 1);",
+	"",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tx_splitband(st, y[0], y[1], x, BLK);",
+	"\tx_splitband(st, y[0] + BLK, y[1] + BLK, x + BLK, NX - BLK);",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tsplitband(st, y[2], y[3], x, NX);",
+	"\tcmp(y[0], y[2], NX, 1, 1);",
+	"\tcmp(y[1], y[3], NX, 1, 1);",
+	"",
+	"\tprintf(\"%.17g\\n\", err);",
+	"",
+	"\treturn 0;",
+	"}",
+	"#endif",
+	"",
+	"#if XCHK == 3",
+	"static T x[NX];",
+	"static T y[M * NX];",
+	"static T t[2][M * NX];",
+	"static T st[S * 128];",
+	"static T sj[S][128];",
+	"",
+	"int main(int argc, char *argv[])",
+	"{",
+	"\tunsigned int i;",
+	"\tunsigned int n;",
+	"\tint j;",
+	"",
+	"\tfor (i = 0; i < NX; ++i)",
+	"\t\tx[i] = sig();",
+	"",
+	"\t/* M x decimator against S 2x stages */",
+	"\tx_DECIM(st, y, x, BLK);",
+	"\tx_DECIM(st, y + BLK, x + M * BLK, NX / M - BLK);",
+	"\tmemcpy(t[0], x, sizeof(x));",
+	"\tfor (j = 0, n = NX; j < S; ++j, n /= 2)",
+	"\t\tx_decimate2(sj[j], t[(j + 1) % 2], t[j % 2], n / 2);",
+	"\tcmp(y, t[S % 2], NX / M, 1, 1);",
+	"",
+	"\t/* M x interpolator against S 2x stages */",
+	"\tmemset(st, 0, sizeof(st));",
+	"\tmemset(sj, 0, sizeof(sj));",
+	"\tx_INTERP(st, y, x, BLK);",
+	"\tx_INTERP(st, y + M * BLK, x + BLK, NX - BLK);",
+	"\tmemcpy(t[0], x, sizeof(x));",
+	"\tfor (j = 0, n = NX; j < S; ++j, n *= 2)",
+	"\t\tx_interpolate2(sj[j], t[(j + 1) % 2], t[j % 2], n);",
+	"\tcmp(y, t[S % 2], M * NX, 1, 1);",
+	"",
+	"\tprintf(\"%.17g\\n\", err);",
+	"",
+	"\treturn 0;",
+	"}",
+	"#endif",
+	NULL
+};
+
+/* Integer adaptor, the arithmetic of the fixed point code */
+static void __iref_adaptor(double g, int nbits, int in1, int in2,
+						   int * out1, int * out2)
+{
+	int Q = 1 << nbits;
+	int aQ;
+	int t;
+
+	if (g == 0.0) {
+		*out1 = in2;
+		*out2 = in1;
+	} else if (g > 0.5) {
+		aQ = (int)((1.0 - g) * (double)Q);
+		t = in1 - in2;
+		*out2 = ((aQ * t) >> nbits) + in2;
+		*out1 = *out2 - t;
+	} else if (g > 0.0) {
+		aQ = (int)(g * (double)Q);
+		t = in2 - in1;
+		*out1 = ((aQ * t) >> nbits) + in2;
+		*out2 = *out1 - t;
+	} else if (g > -0.5) {
+		aQ = (int)(-g * (double)Q);
+		t = in1 - in2;
+		*out1 = ((aQ * t) >> nbits) - in2;
+		*out2 = *out1 - t;
+	} else {
+		aQ = (int)((1.0 + g) * (double)Q);
+		t = in2 - in1;
+		*out2 = ((aQ * t) >> nbits) - in2;
+		*out1 = *out2 - t;
+	}
+}
+
+/* Full rate arms, s[k] is the state of the adaptor k */
+static void __iref_arms(const struct lwdf_info * inf, int nbits, int s[],
+						int x, int * o1, int * o2)
+{
+	const double * g = inf->gamma;
+	int N = inf->order;
+	int v;
+	int u;
+	int k;
+
+	__iref_adaptor(g[0], nbits, x, s[0], &v, &s[0]);
+	for (k = 3; (k + 1) < N; k += 4) {
+		__iref_adaptor(g[k + 1], nbits, s[k], s[k + 1], &u, &s[k + 1]);
+		__iref_adaptor(g[k], nbits, v, u, &v, &s[k]);
+	}
+	*o2 = v;
+
+	v = x;
+	for (k = 1; (k + 1) < N; k += 4) {
+		__iref_adaptor(g[k + 1], nbits, s[k], s[k + 1], &u, &s[k + 1]);
+		__iref_adaptor(g[k], nbits, v, u, &v, &s[k]);
+	}
+	*o1 = v;
+}
+
+/* Half rate arms of the interpolation/decimation code */
+static void __iref_id_arms(const struct lwdf_info * inf, int nbits, int s[],
+						   int i1, int i2, int * o1, int * o2)
+{
+	const double * g = inf->gamma;
+	int N = inf->order;
+	int v;
+	int k;
+
+	for (v = i1, k = 3; k < N; k += 4)
+		__iref_adaptor(g[k], nbits, v, s[k], &v, &s[k]);
+	*o2 = v;
+
+	for (v = i2, k = 1; k < N; k += 4)
+		__iref_adaptor(g[k], nbits, v, s[k], &v, &s[k]);
+	*o1 = v;
+}
+
+/* Expected outputs of the driver, y[4][2 * TEST_NX] */
+static void __iref(double * y, const struct lwdfwiz_param * w,
+				   const struct lwdf_info * inf, const double * x)
+{
+	int s[LWDF_ORDER_MAX];
+	int o1;
+	int o2;
+	int i;
+
+	memset(s, 0, sizeof(s));
+	if (w->bi && w->id) {
+		for (i = 0; i < TEST_NX / 2; ++i) {
+			__iref_id_arms(inf, w->nbits, s, x[2 * i], x[2 * i + 1],
+						   &o1, &o2);
+			y[i] = (o1 + o2) >> 1;
+		}
+		memset(s, 0, sizeof(s));
+		for (i = 0; i < TEST_NX; ++i) {
+			__iref_id_arms(inf, w->nbits, s, x[i], x[i], &o1, &o2);
+			y[2 * TEST_NX + 2 * i] = o1;
+			y[2 * TEST_NX + 2 * i + 1] = o2;
+		}
+		return;
+	}
+
+	for (i = 0; i < TEST_NX; ++i) {
+		__iref_arms(inf, w->nbits, s, x[i], &o1, &o2);
+		y[i] = (o1 + o2) >> 1;
+		y[4 * TEST_NX + i] = y[i];
+	}
+	memset(s, 0, sizeof(s));
+	for (i = 0; i < TEST_NX; ++i) {
+		__iref_arms(inf, w->nbits, s, x[i], &o1, &o2);
+		y[2 * TEST_NX + i] = (o2 - o1) >> 1;
+		y[6 * TEST_NX + i] = y[2 * TEST_NX + i];
+	}
+}
+
+/* Expected outputs from the double precision runtime */
+static void __fref(double * y, const struct lwdfwiz_param * w,
+				   const struct lwdf_info * inf, const double * x)
+{
+	struct lwdf_fp64 * flt = lwdf_fp64_new(w->samplerate);
+	double * t = calloc(2 * TEST_NX, sizeof(double));
+	int i;
+
+	lwdf_fp64_gamma_set(flt, inf->gamma, inf->order);
+	if (w->bi && w->id) {
+		/* the decimator keeps the odd samples */
+		lwdf_fp64_lowpass(flt, t, x, TEST_NX);
+		for (i = 0; i < TEST_NX / 2; ++i)
+			y[i] = t[2 * i + 1];
+		/* the interpolator is the filter of the zero stuffed input,
+		   with a gain of 2 */
+		for (i = 0; i < TEST_NX; ++i) {
+			t[2 * i] = x[i];
+			t[2 * i + 1] = 0;
+		}
+		lwdf_fp64_reset(flt);
+		lwdf_fp64_lowpass(flt, y + 2 * TEST_NX, t, 2 * TEST_NX);
+		for (i = 0; i < 2 * TEST_NX; ++i)
+			y[2 * TEST_NX + i] *= 2;
+	} else {
+		lwdf_fp64_lowpass(flt, y, x, TEST_NX);
+		lwdf_fp64_reset(flt);
+		lwdf_fp64_higpass(flt, y + 2 * TEST_NX, x, TEST_NX);
+		memcpy(y + 4 * TEST_NX, y, TEST_NX * sizeof(double));
+		memcpy(y + 6 * TEST_NX, y + 2 * TEST_NX, TEST_NX * sizeof(double));
+	}
+
+	free(t);
+	lwdf_fp64_free(flt);
+}
+
+/* Sweep, impulse and noise, amplitude a */
+static void __input(double * x, double a, bool fixed)
+{
+	uint32_t r = 1;
+	int i;
+
+	for (i = 0; i < TEST_LEN; ++i) {
+		double ph = M_PI * i * (double)i / (2.0 * TEST_LEN);
+
+		x[i] = a * sin(ph);
+		x[TEST_LEN + i] = (i == 0) ? a : 0;
+		r = r * 1103515245u + 12345u;
+		x[2 * TEST_LEN + i] = a * ((double)((r >> 16) & 0x7fff) / 16384.0 - 1.0);
+	}
+
+	if (fixed) {
+		for (i = 0; i < TEST_NX; ++i)
+			x[i] = floor(x[i]);
+	}
+}
+
+static int __run(const char * dir, const struct lwdfwiz_param * w,
+				 const struct lwdf_info * inf, double * err, double * sps)
+{
+	const char * cc = getenv("CC");
+	const char * cflags = getenv("CFLAGS");
+	bool fixed = (w->nbits != 0);
+	bool id = w->bi && w->id;
+	/* away from the overflow of the coefficient products */
+	double a = fixed ? (1 << 12) : 0.5;
+	unsigned int ny = 4 * 2 * TEST_NX;
+	double * x = calloc(TEST_NX, sizeof(double));
+	double * ref = calloc(ny, sizeof(double));
+	void * y = calloc(ny, sizeof(float));
+	char src[256];
+	char bin[256];
+	char in[256];
+	char out[256];
+	char cmd[1024];
+	double e = 0;
+	double s = 0;
+	unsigned int n;
+	unsigned int i;
+	FILE * f;
+	int ret = -1;
+
+	if (cc == NULL)
+		cc = "cc";
+	if (cflags == NULL)
+		cflags = "-O2";
+
+	snprintf(src, sizeof(src), "%s/k.c", dir);
+	snprintf(bin, sizeof(bin), "%s/k", dir);
+	snprintf(in, sizeof(in), "%s/x.bin", dir);
+	snprintf(out, sizeof(out), "%s/y.bin", dir);
+
+	__input(x, a, fixed);
+	if (fixed)
+		__iref(ref, w, inf, x);
+	else
+		__fref(ref, w, inf, x);
+
+	if ((f = fopen(in, "w")) == NULL)
+		goto done;
+	for (i = 0; i < TEST_NX; ++i) {
+		if (fixed) {
+			int v = x[i];
+
+			fwrite(&v, sizeof(int), 1, f);
+		} else {
+			float v = x[i];
+
+			fwrite(&v, sizeof(float), 1, f);
+		}
+	}
+	fclose(f);
+
+	if ((f = fopen(src, "w")) == NULL)
+		goto done;
+	fprintf(f, "#define T %s\n", fixed ? "int" : "float");
+	fprintf(f, "#define LEN %d\n", TEST_LEN);
+	fprintf(f, "#define NX %d\n", TEST_NX);
+	fprintf(f, "#define BLK %d\n", TEST_BLK);
+	fprintf(f, "#define ID %d\n\n", id ? 1 : 0);
+	if (lwdf_cgen(f, "", w, inf) < 0) {
+		fclose(f);
+		goto done;
+	}
+	for (i = 0; drv_code[i] != NULL; ++i)
+		fprintf(f, "%s\n", drv_code[i]);
+	fclose(f);
+
+	snprintf(cmd, sizeof(cmd), "%s %s -Wall -o %s %s", cc, cflags, bin, src);
+	if (system(cmd) != 0) {
+		fprintf(stderr, "%s: \"%s\" failed.\n", __func__, cmd);
+		goto done;
+	}
+
+	snprintf(cmd, sizeof(cmd), "%s %s %s", bin, in, out);
+	if ((f = popen(cmd, "r")) == NULL)
+		goto done;
+	if (fscanf(f, "%lf", sps) != 1)
+		*sps = 0;
+	if ((pclose(f) != 0) || ((f = fopen(out, "r")) == NULL))
+		goto done;
+	n = fread(y, sizeof(float), ny, f);
+	fclose(f);
+	if (n != ny)
+		goto done;
+
+	/* decimator and interpolator in the first two outputs */
+	for (i = 0; i < ny; ++i) {
+		double v = fixed ? ((int *)y)[i] : ((float *)y)[i];
+
+		if (id && (i >= 4 * TEST_NX))
+			break;
+		if (id && (i < 2 * TEST_NX) && (i >= TEST_NX / 2))
+			continue;
+		if (!id && ((i % (2 * TEST_NX)) >= TEST_NX))
+			continue;
+		e = fmax(e, fabs(v - ref[i]));
+		s = fmax(s, fabs(ref[i]));
+	}
+	*err = fixed ? e : e / s;
+	ret = 0;
+
+done:
+	unlink(src);
+	unlink(bin);
+	unlink(in);
+	unlink(out);
+	free(y);
+	free(ref);
+	free(x);
+
+	return ret;
+}
+
+/*
+ * Cross check of the kernels of wx (prefix x_) against the scalar code
+ * of w, or against the other functions of wx if w is NULL. Both are
+ * generated into one file with the driver xdrv_code[], mode xchk.
+ * The arithmetic is the same, the difference must be 0; the
+ * contraction to fused multiply-adds is turned off for the float code.
+ */
+static int __xrun(const char * dir, int xchk, const char * defs,
+				  const struct lwdfwiz_param * wx,
+				  const struct lwdfwiz_param * w,
+				  const struct lwdf_info * inf, double * err)
+{
+	const char * cc = getenv("CC");
+	const char * cflags = getenv("CFLAGS");
+	const char * dtype;
+	char src[256];
+	char bin[256];
+	char cmd[1024];
+	unsigned int i;
+	FILE * f;
+	int ret = -1;
+
+	if (cc == NULL)
+		cc = "cc";
+	if (cflags == NULL)
+		cflags = "-O2";
+
+	if (wx->nbits != 0)
+		dtype = "int";
+	else
+		dtype = wx->fp64 ? "double" : "float";
+
+	snprintf(src, sizeof(src), "%s/xk.c", dir);
+	snprintf(bin, sizeof(bin), "%s/xk", dir);
+
+	if ((f = fopen(src, "w")) == NULL)
+		goto done;
+	fprintf(f, "#define T %s\n", dtype);
+	fprintf(f, "#define A %s\n", (wx->nbits != 0) ? "4096" : "0.5");
+	fprintf(f, "#define NX %d\n", TEST_XNX);
+	fprintf(f, "#define BLK %d\n", TEST_BLK);
+	fprintf(f, "#define XCHK %d\n", xchk);
+	fprintf(f, "%s\n", defs);
+	if (lwdf_cgen(f, "x_", wx, inf) < 0) {
+		fclose(f);
+		goto done;
+	}
+	if ((w != NULL) && (lwdf_cgen(f, "", w, inf) < 0)) {
+		fclose(f);
+		goto done;
+	}
+	for (i = 0; xdrv_code[i] != NULL; ++i)
+		fprintf(f, "%s\n", xdrv_code[i]);
+	fclose(f);
+
+	snprintf(cmd, sizeof(cmd), "%s %s -ffp-contract=off -Wall -o %s %s",
+			 cc, cflags, bin, src);
+	if (system(cmd) != 0) {
+		fprintf(stderr, "%s: \"%s\" failed.\n", __func__, cmd);
+		goto done;
+	}
+
+	if ((f = popen(bin, "r")) == NULL)
+		goto done;
+	if (fscanf(f, "%lf", err) != 1)
+		*err = INFINITY;
+	if (pclose(f) == 0)
+		ret = 0;
+
+done:
+	unlink(src);
+	unlink(bin);
+
+	return ret;
+}
+
+/* Samples per second of the runtime */
+static double __fp64_sps(const struct lwdfwiz_param * w,
+						 const struct lwdf_info * inf)
+{
+	struct lwdf_fp64 * flt = lwdf_fp64_new(w->samplerate);
+	double * x = calloc(TEST_NX, sizeof(double));
+	double * y = calloc(TEST_LEN, sizeof(double));
+	struct timespec t0;
+	struct timespec t1;
+	double dt;
+	unsigned int n = 0;
+
+	/* on the noise, as the driver */
+	__input(x, 0.5, false);
+	lwdf_fp64_gamma_set(flt, inf->gamma, inf->order);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	do {
+		lwdf_fp64_lowpass(flt, y, x + 2 * TEST_LEN, TEST_LEN);
+		n++;
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		dt = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	} while (dt < 0.05);
+
+	free(y);
+	free(x);
+	lwdf_fp64_free(flt);
+
+	return (double)n * TEST_LEN / dt;
+}
+
+/* A loose specification down to the first order, the elliptic
+   transition band narrows so the high orders stay in range */
+static void __spec(struct lwdfwiz_param * w, int ftype, int order, bool bi,
+				   bool id, int nbits, bool csd)
+{
+	memset(w, 0, sizeof(struct lwdfwiz_param));
+	w->samplerate = 48000;
+	w->ftype = ftype;
+	w->order = order;
+	w->bi = bi;
+	w->id = id;
+	w->nbits = nbits;
+	w->csd = csd;
+	w->asmin = 3;
+	w->ap = 0.5;
+	w->fp = 6000;
+	w->fs = (ftype == LWDF_ELLIP) ? 6600 : 18000;
+	if (bi) {
+		w->fp = 11000;
+		w->fs = 13000;
+		w->ap = 0;
+	}
+	w->ft = w->fs;
+}
+
+static void test_design(const char * dir, int ftype, int order, bool bi,
+						bool id, int nbits, bool csd)
+{
+	struct lwdfwiz_param w;
+	struct lwdf_info inf;
+	char tag[64];
+	double err = INFINITY;
+	double sps = 0;
+	bool ok;
+	int i;
+
+	__spec(&w, ftype, order, bi, id, nbits, csd);
+
+	snprintf(tag, sizeof(tag), "%s N=%-2d%s%s nbits=%-2d%s", ftype_name[ftype],
+			 order, bi ? " bi" : "", id ? " id" : "", nbits,
+			 csd ? " csd" : "");
+
+	if (lwdf_design(&w, &inf) < 0) {
+		printf("%-36s skip (order out of the design range)\n", tag);
+		skip++;
+		return;
+	}
+	w.order = inf.order;
+
+	for (i = 0; i < inf.order; ++i) {
+		if (!isfinite(inf.gamma[i])) {
+			printf("%-36s skip (gamma[%d] not finite)\n", tag, i);
+			skip++;
+			return;
+		}
+	}
+
+	if (__run(dir, &w, &inf, &err, &sps) < 0) {
+		printf("%-36s FAIL (build/run)\n", tag);
+		fail++;
+		return;
+	}
+
+	ok = (nbits != 0) ? (err == 0) : (err < TEST_TOL);
+	printf("%-36s err=%-9.3g %7.2f Msps (runtime %6.2f) %s\n", tag, err,
+		   sps * 1e-6, __fp64_sps(&w, &inf) * 1e-6, ok ? "" : "FAIL");
+	if (!ok)
+		fail++;
+}
+
+/* Outcome of a cross check, the difference must be 0 */
+static void __xcheck(const char * tag, int ret, double err)
+{
+	if (ret < 0) {
+		printf("%-36s FAIL (build/run)\n", tag);
+		fail++;
+		return;
+	}
+	printf("%-36s err=%-9.3g %s\n", tag, err, (err == 0) ? "" : "FAIL");
+	if (err != 0)
+		fail++;
+}
+
+/* Vector kernel of nchan channels, vectors of vlen, against the scalar
+   code run on each channel */
+static void test_vec(const char * dir, int ftype, int order, int nbits,
+					 bool fp64, int nchan, int vlen)
+{
+	struct lwdfwiz_param wx;
+	struct lwdfwiz_param w;
+	struct lwdf_info inf;
+	char defs[64];
+	char tag[64];
+	double err = INFINITY;
+	int ret;
+
+	__spec(&w, ftype, order, false, false, nbits, false);
+	w.fp64 = fp64;
+	snprintf(tag, sizeof(tag), "%s N=%-2d nbits=%-2d%s nchan=%d vlen=%d",
+			 ftype_name[ftype], order, nbits, fp64 ? " fp64" : "", nchan,
+			 vlen);
+	if (lwdf_design(&w, &inf) < 0) {
+		printf("%-36s skip (order out of the design range)\n", tag);
+		skip++;
+		return;
+	}
+	w.order = inf.order;
+
+	wx = w;
+	wx.nchan = nchan;
+	wx.vlen = vlen;
+	snprintf(defs, sizeof(defs), "#define NCH %d\n", nchan);
+
+	ret = __xrun(dir, 1, defs, &wx, &w, &inf, &err);
+	__xcheck(tag, ret, err);
+}
+
+/* Block loops unrolled by unroll samples against the plain loops */
+static void test_unroll(const char * dir, int ftype, int order, int nbits,
+						bool csd, int unroll)
+{
+	struct lwdfwiz_param wx;
+	struct lwdfwiz_param w;
+	struct lwdf_info inf;
+	char tag[64];
+	double err = INFINITY;
+	int ret;
+
+	__spec(&w, ftype, order, false, false, nbits, csd);
+	snprintf(tag, sizeof(tag), "%s N=%-2d nbits=%-2d%s unroll=%d",
+			 ftype_name[ftype], order, nbits, csd ? " csd" : "", unroll);
+	if (lwdf_design(&w, &inf) < 0) {
+		printf("%-36s skip (order out of the design range)\n", tag);
+		skip++;
+		return;
+	}
+	w.order = inf.order;
+
+	wx = w;
+	wx.unroll = unroll;
+
+	ret = __xrun(dir, 2, "", &wx, &w, &inf, &err);
+	__xcheck(tag, ret, err);
+}
+
+/* 2^stages decimator and interpolator against cascades of the 2x ones
+   of the same code */
+static void test_stages(const char * dir, int order, int nbits, bool csd,
+						int stages)
+{
+	struct lwdfwiz_param w;
+	struct lwdf_info inf;
+	char defs[128];
+	char tag[64];
+	double err = INFINITY;
+	int M = 1 << stages;
+	int ret;
+
+	__spec(&w, LWDF_ELLIP, order, true, true, nbits, csd);
+	snprintf(tag, sizeof(tag), "ellip N=%-2d bi id nbits=%-2d%s stages=%d",
+			 order, nbits, csd ? " csd" : "", stages);
+	if (lwdf_design(&w, &inf) < 0) {
+		printf("%-36s skip (order out of the design range)\n", tag);
+		skip++;
+		return;
+	}
+	w.order = inf.order;
+	w.stages = stages;
+
+	snprintf(defs, sizeof(defs), "#define S %d\n#define M %d\n"
+			 "#define x_DECIM x_decimate%d\n#define x_INTERP x_interpolate%d\n",
+			 stages, M, M, M);
+
+	ret = __xrun(dir, 3, defs, &w, NULL, &inf, &err);
+	__xcheck(tag, ret, err);
+}
+
+int main(int argc, char *argv[])
+{
+	static const int order[] = { 1, 3, 5, 9, 17, 33, 63 };
+	static const int bi_order[] = { 3, 11, 31, 63 };
+	char dir[] = "/tmp/cgen-test-XXXXXX";
+	unsigned int i;
+	int t;
+
+	if (mkdtemp(dir) == NULL) {
+		fprintf(stderr, "mkdtemp(): %s.\n", strerror(errno));
+		return 1;
+	}
+
+	for (t = LWDF_BUTTW; t <= LWDF_ELLIP; ++t) {
+		for (i = 0; i < sizeof(order) / sizeof(order[0]); ++i) {
+			test_design(dir, t, order[i], false, false, 0, false);
+			test_design(dir, t, order[i], false, false, 14, false);
+			test_design(dir, t, order[i], false, false, 14, true);
+		}
+	}
+
+	for (i = 0; i < sizeof(bi_order) / sizeof(bi_order[0]); ++i) {
+		test_design(dir, LWDF_ELLIP, bi_order[i], true, false, 0, false);
+		test_design(dir, LWDF_ELLIP, bi_order[i], true, true, 0, false);
+		test_design(dir, LWDF_ELLIP, bi_order[i], true, true, 12, false);
+		test_design(dir, LWDF_ELLIP, bi_order[i], true, true, 12, true);
+	}
+
+	/* multi-channel kernels */
+	test_vec(dir, LWDF_ELLIP, 9, 0, false, 8, 4);
+	test_vec(dir, LWDF_ELLIP, 9, 0, false, 16, 0);
+	test_vec(dir, LWDF_ELLIP, 9, 0, true, 4, 2);
+	test_vec(dir, LWDF_CHEB1, 5, 14, false, 8, 8);
+	test_vec(dir, LWDF_ELLIP, 9, 14, false, 12, 4);
+
+	/* unrolled block loops, the remainder of the odd blocks one by one */
+	test_unroll(dir, LWDF_ELLIP, 9, 0, false, 4);
+	test_unroll(dir, LWDF_BUTTW, 5, 0, false, 3);
+	test_unroll(dir, LWDF_ELLIP, 9, 14, false, 8);
+	test_unroll(dir, LWDF_CHEB1, 5, 14, true, 5);
+
+	/* multistage rate changers */
+	test_stages(dir, 11, 0, false, 2);
+	test_stages(dir, 11, 0, false, 4);
+	test_stages(dir, 11, 12, false, 3);
+	test_stages(dir, 31, 12, true, 2);
+
+	rmdir(dir);
+
+	if (skip)
+		printf("%d designs skipped\n", skip);
+	if (fail) {
+		printf("%d tests failed\n", fail);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * sweep(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	filter.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: filter of the sweep test
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lwdf.h"
+
+/* Filtered samples kept on the stack per pass */
+#define FILTER_BLK 1024
+
+struct filter {
+	struct lwdf_fp64 * lwdf;
+	/* rate ratio, output j takes the filtered input floor(j * nx / ny) */
+	uint64_t nx;
+	uint64_t ny;
+	/* next input sample */
+	uint64_t n;
+	/* input sample of the next output, remainder of j * nx / ny */
+	uint64_t m;
+	uint64_t rem;
+};
+
+/*
+ * Elliptic lowpass of the sweep, lwdf_fp64 runtime. The frequencies are
+ * relative to the input rate: the passband ends at 40% and the stopband
+ * (60 dB) starts at 50% of the output band. The output takes every
+ * nx/ny-th filtered sample, or holds them when ny > nx.
+ */
+struct filter * filter_open(uint64_t ny, uint64_t nx)
+{
+	struct lwdfwiz_param wiz;
+	struct lwdf_info inf;
+	struct filter * flt;
+	double band = 0.5;
+
+	if ((nx == 0) || (ny == 0)) {
+		fprintf(stderr, "%s: empty signal.\n", __func__);
+		return NULL;
+	}
+
+	if (ny < nx)
+		band = 0.5 * ny / nx;
+
+	memset(&wiz, 0, sizeof(wiz));
+	wiz.samplerate = 1.0;
+	wiz.ftype = LWDF_ELLIP;
+	wiz.asmin = 60;
+	wiz.ap = 0.1;
+	wiz.fp = 0.4 * band;
+	wiz.fs = 0.5 * band;
+	wiz.ft = wiz.fs;
+
+	if (lwdf_design(&wiz, &inf) < 0) {
+		fprintf(stderr, "%s: filter design failed.\n", __func__);
+		return NULL;
+	}
+
+	if ((flt = calloc(1, sizeof(struct filter))) == NULL)
+		return NULL;
+
+	flt->lwdf = lwdf_fp64_new(wiz.samplerate);
+	lwdf_fp64_gamma_set(flt->lwdf, inf.gamma, inf.order);
+	flt->nx = nx;
+	flt->ny = ny;
+
+	return flt;
+}
+
+void filter_close(struct filter * flt)
+{
+	lwdf_fp64_free(flt->lwdf);
+	free(flt);
+}
+
+/*
+ * Filter the next len input samples, the state is kept across the
+ * calls. Returns the number of samples written to y, at most
+ * (len * ny / nx) + 1.
+ */
+unsigned int do_filter(struct filter * flt, float y[], const float x[],
+					   unsigned int len)
+{
+	double t[FILTER_BLK];
+	unsigned int k = 0;
+	unsigned int i0;
+
+	for (i0 = 0; i0 < len; i0 += FILTER_BLK) {
+		unsigned int n = len - i0;
+		unsigned int i;
+
+		if (n > FILTER_BLK)
+			n = FILTER_BLK;
+
+		for (i = 0; i < n; ++i)
+			t[i] = x[i0 + i];
+		lwdf_fp64_lowpass(flt->lwdf, t, t, n);
+
+		while (flt->m < flt->n + n) {
+			y[k++] = t[flt->m - flt->n];
+			flt->rem += flt->nx;
+			flt->m += flt->rem / flt->ny;
+			flt->rem %= flt->ny;
+		}
+		flt->n += n;
+	}
+
+	return k;
+}
@@ -0,0 +1,221 @@
+/*
+ * jit-test(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	jit-test.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: native kernels self check
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The kernels of lwdf_fp64_jit() against the generic kernels of the
+ * runtime on the same input. The native lowpass takes over in the
+ * middle of the block, from the state left by the generic kernel.
+ * Filters sharing one library keep it while any of them is left. The
+ * tests are skipped when there is no host compiler.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "lwdf.h"
+
+#define TEST_LEN 4096
+/* error relative to the peak of the output */
+#define TEST_TOL 1e-14
+
+static int fail;
+static int skip;
+
+static void check(const char * name, double err, double tol)
+{
+	printf("%-40s err=%.3g %s\n", name, err, (err < tol) ? "ok" : "FAIL");
+	if (!(err < tol))
+		fail++;
+}
+
+static bool __cc(void)
+{
+	const char * cc = getenv("CC");
+	char cmd[256];
+
+	snprintf(cmd, sizeof(cmd), "%s --version >/dev/null 2>&1",
+			 (cc == NULL) ? "cc" : cc);
+
+	return system(cmd) == 0;
+}
+
+static double __err(const double y[], const double ref[], size_t len)
+{
+	double e = 0;
+	double s = 0;
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		e = fmax(e, fabs(y[i] - ref[i]));
+		s = fmax(s, fabs(ref[i]));
+	}
+
+	return e / s;
+}
+
+static void test_jit(const char * tag, int ftype, int order, bool bi)
+{
+	struct lwdfwiz_param w;
+	struct lwdf_info inf;
+	struct lwdf_fp64 * flt;
+	struct lwdf_fp64 * jit;
+	double x[TEST_LEN];
+	double ref[TEST_LEN];
+	double y[TEST_LEN];
+	char name[64];
+	uint32_t r = 1;
+	unsigned int i;
+
+	memset(&w, 0, sizeof(w));
+	w.samplerate = 48000;
+	w.ftype = ftype;
+	w.order = order;
+	w.bi = bi;
+	w.asmin = 40;
+	w.ap = 0.5;
+	w.fp = 6000;
+	w.fs = (ftype == LWDF_ELLIP) ? 8000 : 16000;
+	if (bi) {
+		w.fp = 10000;
+		w.fs = 14000;
+		w.ap = 0;
+	}
+	w.ft = w.fs;
+
+	if (lwdf_design(&w, &inf) < 0) {
+		printf("%-40s skip (design)\n", tag);
+		skip++;
+		return;
+	}
+
+	for (i = 0; i < TEST_LEN; ++i) {
+		r = r * 1103515245u + 12345u;
+		x[i] = (double)((r >> 16) & 0x7fff) / 32768.0 - 0.5;
+	}
+
+	flt = lwdf_fp64_new(w.samplerate);
+	lwdf_fp64_gamma_set(flt, inf.gamma, inf.order);
+	jit = lwdf_fp64_new(w.samplerate);
+	lwdf_fp64_gamma_set(jit, inf.gamma, inf.order);
+
+	/* the first half with the generic kernel */
+	lwdf_fp64_lowpass(flt, ref, x, TEST_LEN);
+	lwdf_fp64_lowpass(jit, y, x, TEST_LEN / 2);
+	if (lwdf_fp64_jit(jit) < 0) {
+		printf("%-40s FAIL (jit)\n", tag);
+		fail++;
+		lwdf_fp64_free(jit);
+		lwdf_fp64_free(flt);
+		return;
+	}
+	lwdf_fp64_lowpass(jit, y + TEST_LEN / 2, x + TEST_LEN / 2,
+					  TEST_LEN / 2);
+	snprintf(name, sizeof(name), "%s lowpass", tag);
+	check(name, __err(y, ref, TEST_LEN), TEST_TOL);
+
+	lwdf_fp64_reset(flt);
+	lwdf_fp64_reset(jit);
+	lwdf_fp64_higpass(flt, ref, x, TEST_LEN);
+	lwdf_fp64_higpass(jit, y, x, TEST_LEN);
+	snprintf(name, sizeof(name), "%s highpass", tag);
+	check(name, __err(y, ref, TEST_LEN), TEST_TOL);
+
+	lwdf_fp64_free(jit);
+	lwdf_fp64_free(flt);
+}
+
+/* Channels of a stream: one library, loaded until the last filter
+   drops it */
+static void test_shared(const char * tag, unsigned int cnt)
+{
+	double gamma[5] = { 0.1, -0.4, 0.7, -0.2, 0.55 };
+	struct lwdf_fp64 * flt[cnt];
+	struct lwdf_fp64 * ref;
+	double x[TEST_LEN];
+	double y[TEST_LEN];
+	double r[TEST_LEN];
+	double err = 0;
+	unsigned int i;
+	unsigned int k;
+
+	for (i = 0; i < TEST_LEN; ++i)
+		x[i] = (i % 64) ? 0.0 : 1.0;
+
+	ref = lwdf_fp64_new(48000);
+	lwdf_fp64_gamma_set(ref, gamma, 5);
+	lwdf_fp64_lowpass(ref, r, x, TEST_LEN);
+	lwdf_fp64_free(ref);
+
+	for (k = 0; k < cnt; ++k) {
+		flt[k] = lwdf_fp64_new(48000);
+		lwdf_fp64_gamma_set(flt[k], gamma, 5);
+	}
+	if (lwdf_fp64_jit_shared(flt, cnt) < 0) {
+		printf("%-40s FAIL (jit)\n", tag);
+		fail++;
+		for (k = 0; k < cnt; ++k)
+			lwdf_fp64_free(flt[k]);
+		return;
+	}
+
+	/* the first filters go first, the others keep the kernels */
+	for (k = 0; k < cnt; ++k) {
+		lwdf_fp64_free(flt[k]);
+		if (k + 1 < cnt) {
+			lwdf_fp64_lowpass(flt[cnt - 1], y, x, TEST_LEN);
+			lwdf_fp64_reset(flt[cnt - 1]);
+			err = fmax(err, __err(y, r, TEST_LEN));
+		}
+	}
+	check(tag, err, TEST_TOL);
+}
+
+int main(int argc, char *argv[])
+{
+	if (!__cc()) {
+		printf("no host compiler, tests skipped\n");
+		return 0;
+	}
+
+	test_jit("buttw N=5", LWDF_BUTTW, 5, false);
+	test_jit("cheb1 N=7", LWDF_CHEB1, 7, false);
+	test_jit("ellip N=9", LWDF_ELLIP, 9, false);
+	test_jit("ellip N=11 bi", LWDF_ELLIP, 11, true);
+	test_shared("4 channels, shared kernels", 4);
+	if (skip)
+		printf("%d tests skipped\n", skip);
+	if (fail) {
+		printf("%d tests failed\n", fail);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * resp-test(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	resp-test.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: analytic frequency response self check
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * The response of lwdf_resp_eval() is checked against the impulse
+ * response of the lwdf_fp64 runtime. The impulse response is long
+ * enough to decay below the double precision, its DFT is the
+ * frequency response and the DFT of n h[n] gives the group delay:
+ *
+ *   gd(w) = Re(sum(n h[n] e^-jwn) / H(w))
+ *
+ * The adaptive grid of lwdf_fp64_freq_adapt_set() is checked on the
+ * dense uniform grid of the DFT lattice: the linear interpolation of
+ * the response between its points stays within the tolerance, where
+ * a uniform grid of the same size does not.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "lwdf.h"
+
+/* impulse response samples */
+#define TEST_NH (1 << 15)
+/* frequencies */
+#define TEST_LEN 101
+/* group delay checked above this magnitude */
+#define TEST_GD_MAG 1e-3
+/* adaptive grid: DFT length, points and tolerance [dB] */
+#define TEST_DFTN 8192
+#define TEST_NPTS 512
+#define TEST_TOL_DB 0.1
+/* floor of the interpolated response, as in lwdf-fp64-freq.c */
+#define TEST_DB_MIN -200.0
+
+static int fail;
+static int skip;
+
+static void check(const char * name, double err, double tol)
+{
+	printf("%-40s err=%.3g %s\n", name, err, (err < tol) ? "ok" : "FAIL");
+	if (!(err < tol))
+		fail++;
+}
+
+static int __design(struct lwdf_info * inf, int ftype, int order, bool bi)
+{
+	struct lwdfwiz_param w;
+	unsigned int i;
+
+	memset(&w, 0, sizeof(w));
+	w.samplerate = 48000;
+	w.ftype = ftype;
+	w.order = order;
+	w.bi = bi;
+	w.asmin = 3;
+	w.ap = 0.5;
+	w.fp = 6000;
+	w.fs = (ftype == LWDF_ELLIP) ? 6600 : 18000;
+	if (bi) {
+		w.fp = 11000;
+		w.fs = 13000;
+		w.ap = 0;
+	}
+	w.ft = w.fs;
+
+	if (lwdf_design(&w, inf) < 0)
+		return -1;
+
+	for (i = 0; i < inf->order; ++i) {
+		if (!isfinite(inf->gamma[i]))
+			return -1;
+	}
+
+	return 0;
+}
+
+static void test_resp(const char * tag, int ftype, int order, bool bi,
+					  unsigned int resp)
+{
+	struct lwdf_resp_vec rv;
+	struct lwdf_info inf;
+	struct lwdf_fp64 * flt;
+	double mag[TEST_LEN];
+	double ph[TEST_LEN];
+	double gd[TEST_LEN];
+	double w[TEST_LEN];
+	double * x;
+	double * h;
+	double eh = 0;
+	double egd = 0;
+	char name[64];
+	unsigned int i;
+	size_t nh;
+	size_t n;
+
+	if (__design(&inf, ftype, order, bi) < 0) {
+		printf("%-40s skip (design)\n", tag);
+		skip++;
+		return;
+	}
+
+	x = calloc(TEST_NH, sizeof(double));
+	h = calloc(TEST_NH, sizeof(double));
+	x[0] = 1.0;
+
+	flt = lwdf_fp64_new(inf.samplerate);
+	lwdf_fp64_gamma_set(flt, inf.gamma, inf.order);
+	if (resp == LWDF_RESP_LOWPASS)
+		lwdf_fp64_lowpass(flt, h, x, TEST_NH);
+	else
+		lwdf_fp64_higpass(flt, h, x, TEST_NH);
+	lwdf_fp64_free(flt);
+
+	/* the tail below the tolerances is left out of the sums */
+	for (nh = TEST_NH; (nh > 0) && (fabs(h[nh - 1]) < 1e-20); --nh);
+	if (nh == TEST_NH) {
+		printf("%-40s FAIL (impulse response too long)\n", tag);
+		fail++;
+	}
+
+	/* the edges, the transition band and some irrational frequencies */
+	for (i = 0; i < TEST_LEN; ++i)
+		w[i] = 0.5 * i / (TEST_LEN - 1) + ((i % 2) ? 1e-3 * M_SQRT2 : 0);
+	w[TEST_LEN - 1] = 0.5;
+
+	rv.mag = mag;
+	rv.ph = ph;
+	rv.gd = gd;
+	rv.pd = NULL;
+	lwdf_resp_eval(inf.gamma, inf.order, resp, w, TEST_LEN, &rv);
+
+	for (i = 0; i < TEST_LEN; ++i) {
+		complex double z = 0;
+		complex double zn = 0;
+		complex double e;
+
+		/* in long double, the sums of the slow decaying designs */
+		for (n = 0; n < nh; ++n) {
+			long double a = 2.0L * M_PI * w[i] * n;
+
+			e = cosl(a) - I * sinl(a);
+			z += h[n] * e;
+			zn += (double)n * h[n] * e;
+		}
+
+		eh = fmax(eh, cabs(z - mag[i] * cexp(I * ph[i])));
+		if (cabs(z) > TEST_GD_MAG)
+			egd = fmax(egd, fabs(creal(zn / z) - gd[i]) * cabs(z));
+	}
+
+	snprintf(name, sizeof(name), "%s %s H(w)", tag,
+			 (resp == LWDF_RESP_LOWPASS) ? "lowpass" : "highpass");
+	check(name, eh, 1e-13);
+	snprintf(name, sizeof(name), "%s %s gd(w)", tag,
+			 (resp == LWDF_RESP_LOWPASS) ? "lowpass" : "highpass");
+	check(name, egd, 1e-11);
+
+	free(h);
+	free(x);
+}
+
+/* Response at the frequencies w, dB and phase */
+static void __resp(const struct lwdf_info * inf, const double w[],
+				   double db[], double ph[], size_t len)
+{
+	struct lwdf_resp_vec rv;
+	size_t i;
+
+	memset(&rv, 0, sizeof(rv));
+	rv.mag = db;
+	rv.ph = ph;
+	lwdf_resp_eval(inf->gamma, inf->order, LWDF_RESP_LOWPASS, w, len, &rv);
+
+	for (i = 0; i < len; ++i) {
+		db[i] = (db[i] > 0) ? 20 * log10(db[i]) : TEST_DB_MIN;
+		if (db[i] < TEST_DB_MIN)
+			db[i] = TEST_DB_MIN;
+	}
+}
+
+/* Largest interpolation error of the grid g on the dense grid w, in
+   the units of the adaptive grid: nepers and radians */
+static double __interp_err(const struct lwdf_info * inf,
+						   const double g[], size_t n,
+						   const double w[], const double db[],
+						   const double ph[], size_t len)
+{
+	double gdb[n];
+	double gph[n];
+	double err = 0;
+	size_t i;
+	size_t k;
+
+	__resp(inf, g, gdb, gph, n);
+
+	for (i = 0, k = 0; i < len; ++i) {
+		double edb;
+		double eph;
+		double t;
+
+		if ((w[i] < g[0]) || (w[i] > g[n - 1]))
+			continue;
+		while ((k + 2 < n) && (g[k + 1] <= w[i]))
+			k++;
+		t = (w[i] - g[k]) / (g[k + 1] - g[k]);
+		edb = fabs(db[i] - (gdb[k] + t * (gdb[k + 1] - gdb[k]))) /
+			(20 / M_LN10);
+		eph = fabs(ph[i] - (gph[k] + t * (gph[k + 1] - gph[k])));
+		err = fmax(err, fmax(edb, eph));
+	}
+
+	return err * (20 / M_LN10);
+}
+
+static void test_adapt(const char * tag, int ftype, int order, bool bi)
+{
+	struct lwdf_fp64_freq * ffr;
+	struct lwdf_fp64 * flt;
+	struct lwdf_info inf;
+	complex double * z;
+	double * g;
+	double * u;
+	double * w;
+	double * db;
+	double * ph;
+	char name[64];
+	ssize_t n;
+	size_t len;
+	size_t i;
+
+	if (__design(&inf, ftype, order, bi) < 0) {
+		printf("%-40s skip (design)\n", tag);
+		skip++;
+		return;
+	}
+
+	flt = lwdf_fp64_new(inf.samplerate);
+	lwdf_fp64_gamma_set(flt, inf.gamma, inf.order);
+	ffr = lwdf_fp64_freq_new(flt, TEST_DFTN);
+
+	/* the grid of the response of the gtk frequency tool */
+	lwdf_fp64_freq_adapt_set(ffr, 0.5 / 256, 0.5, TEST_NPTS, TEST_TOL_DB);
+	n = lwdf_fp64_lowwpass_freq_resp(ffr, flt, &g, &z);
+
+	/* dense uniform grid, every lattice point of the range */
+	len = (size_t)round((g[n - 1] - g[0]) * TEST_DFTN / 2) + 1;
+	w = calloc(len, sizeof(double));
+	u = calloc(n, sizeof(double));
+	db = calloc(len, sizeof(double));
+	ph = calloc(len, sizeof(double));
+	for (i = 0; i < len; ++i)
+		w[i] = g[0] + 2.0 * i / TEST_DFTN;
+	__resp(&inf, w, db, ph, len);
+
+	/* uniform grid of the same size */
+	for (i = 0; i < (size_t)n; ++i)
+		u[i] = g[0] + (g[n - 1] - g[0]) * i / (n - 1);
+
+	snprintf(name, sizeof(name), "%s adaptive grid (%zd pts)", tag, n);
+	check(name, __interp_err(&inf, g, n, w, db, ph, len), TEST_TOL_DB);
+	snprintf(name, sizeof(name), "%s uniform grid, tol/err", tag);
+	check(name, TEST_TOL_DB / __interp_err(&inf, u, n, w, db, ph, len),
+		  1.0);
+
+	free(ph);
+	free(db);
+	free(u);
+	free(w);
+	lwdf_fp64_freq_free(ffr);
+	lwdf_fp64_free(flt);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int resp;
+
+	for (resp = LWDF_RESP_LOWPASS; resp <= LWDF_RESP_HIGHPASS; ++resp) {
+		test_resp("buttw N=5", LWDF_BUTTW, 5, false, resp);
+		test_resp("cheb1 N=7", LWDF_CHEB1, 7, false, resp);
+		test_resp("ellip N=9", LWDF_ELLIP, 9, false, resp);
+		test_resp("ellip N=11 bi", LWDF_ELLIP, 11, true, resp);
+	}
+
+	test_adapt("cheb1 N=7", LWDF_CHEB1, 7, false);
+	test_adapt("ellip N=9", LWDF_ELLIP, 9, false);
+	test_adapt("ellip N=11 bi", LWDF_ELLIP, 11, true);
+
+	if (skip)
+		printf("%d tests skipped\n", skip);
+	if (fail) {
+		printf("%d tests failed\n", fail);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * spt-test(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	spt-test.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: multiplierless coefficient search self check
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * For each design lwdf_spt_optimize() must return coefficients on the
+ * 2^-nbits grid that meet the specification mask, with no more
+ * multipliers than the rounded coefficients and than the greedy
+ * solution (the search cut at its first node), and the same
+ * coefficients with any number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "lwdf.h"
+
+#define TEST_NTHREADS 4
+
+static int fail;
+static int skip;
+
+static void check(const char * name, bool ok)
+{
+	printf("%-48s %s\n", name, ok ? "ok" : "FAIL");
+	if (!ok)
+		fail++;
+}
+
+static unsigned int __mul(const double q[], unsigned int order,
+						  unsigned int nbits)
+{
+	struct lwdf_cost cost;
+
+	lwdf_cost_get(q, order, nbits, &cost);
+
+	return cost.mul;
+}
+
+static int __spt(const struct lwdfwiz_param * spec,
+				 const struct lwdf_info * inf, unsigned int nbits,
+				 unsigned int nthreads, unsigned long nodes_max, double q[])
+{
+	struct lwdf_spt_cfg cfg;
+
+	cfg.nbits = nbits;
+	cfg.nthreads = nthreads;
+	cfg.nodes_max = nodes_max;
+	cfg.slack = 1.0;
+
+	return lwdf_spt_optimize(spec, inf->gamma, inf->order, &cfg, q);
+}
+
+static void test_spt(const char * tag, int ftype, int order, bool bi,
+					 unsigned int nbits)
+{
+	struct lwdfwiz_param w;
+	struct lwdf_info inf;
+	double q[LWDF_ORDER_MAX];
+	double qg[LWDF_ORDER_MAX];
+	double qn[LWDF_ORDER_MAX];
+	double qr[LWDF_ORDER_MAX];
+	char name[64];
+	bool ok;
+	unsigned int i;
+	int n;
+
+	memset(&w, 0, sizeof(w));
+	w.samplerate = 48000;
+	w.ftype = ftype;
+	w.order = order;
+	w.bi = bi;
+	w.asmin = 40;
+	w.ap = 0.5;
+	w.fp = 6000;
+	w.fs = (ftype == LWDF_ELLIP) ? 8000 : 16000;
+	if (bi) {
+		w.fp = 10000;
+		w.fs = 14000;
+		w.ap = 0;
+	}
+	w.ft = w.fs;
+
+	if (lwdf_design(&w, &inf) < 0) {
+		printf("%-48s skip (design)\n", tag);
+		skip++;
+		return;
+	}
+	/* the mask of the achieved design, as in lwdf-wiz.c */
+	w.ap = inf.ap;
+	w.fp = inf.fp;
+
+	if (__spt(&w, &inf, nbits, 1, 0, q) < 0) {
+		printf("%-48s skip (no %d bits solution)\n", tag, nbits);
+		skip++;
+		return;
+	}
+
+	ok = true;
+	for (i = 0; i < inf.order; ++i)
+		ok = ok && (ldexp(q[i], nbits) == round(ldexp(q[i], nbits)));
+	snprintf(name, sizeof(name), "%s nbits=%d grid", tag, nbits);
+	check(name, ok);
+
+	snprintf(name, sizeof(name), "%s nbits=%d mask", tag, nbits);
+	check(name, lwdf_spec_margin(&w, q, inf.order, NULL, NULL));
+
+	/* the rounded coefficients, if they meet the mask */
+	for (i = 0; i < inf.order; ++i)
+		qr[i] = round(ldexp(inf.gamma[i], nbits)) / (1 << nbits);
+	if (lwdf_spec_margin(&w, qr, inf.order, NULL, NULL)) {
+		snprintf(name, sizeof(name), "%s nbits=%d mul %d <= rounded %d",
+				 tag, nbits, __mul(q, inf.order, nbits),
+				 __mul(qr, inf.order, nbits));
+		check(name, __mul(q, inf.order, nbits) <=
+			  __mul(qr, inf.order, nbits));
+	}
+
+	/* the first node ends the search, the greedy solution is left */
+	if (__spt(&w, &inf, nbits, 1, 1, qg) == 0) {
+		snprintf(name, sizeof(name), "%s nbits=%d mul %d <= greedy %d",
+				 tag, nbits, __mul(q, inf.order, nbits),
+				 __mul(qg, inf.order, nbits));
+		check(name, __mul(q, inf.order, nbits) <=
+			  __mul(qg, inf.order, nbits));
+	}
+
+	for (n = 2; n <= TEST_NTHREADS; n *= 2) {
+		snprintf(name, sizeof(name), "%s nbits=%d %d threads", tag,
+				 nbits, n);
+		check(name, (__spt(&w, &inf, nbits, n, 0, qn) == 0) &&
+			  (memcmp(q, qn, inf.order * sizeof(double)) == 0));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	test_spt("buttw N=5", LWDF_BUTTW, 5, false, 8);
+	test_spt("cheb1 N=5", LWDF_CHEB1, 5, false, 8);
+	test_spt("cheb1 N=9", LWDF_CHEB1, 9, false, 8);
+	test_spt("ellip N=7 bi", LWDF_ELLIP, 7, true, 8);
+	test_spt("ellip N=11 bi", LWDF_ELLIP, 11, true, 8);
+	if (skip)
+		printf("%d tests skipped\n", skip);
+	if (fail) {
+		printf("%d tests failed\n", fail);
+		return 1;
+	}
+
+	return 0;
+}
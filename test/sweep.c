@@ -39,8 +39,10 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "pcm.h"
+#include "vector.h"
 
 #define APP_NAME "sweep"
 #define VERSION_MAJOR 1
@@ -48,25 +50,186 @@
 
 static char *progname;
 
-void do_filter(float y[], unsigned int ny, float x[], unsigned int nx);
+/* Input samples per block of the pipeline */
+#define SWEEP_BLK 4096
+/* Blocks in flight, they bound the memory of the pipeline */
+#define SWEEP_NBLK 8
+/* Buffer of the output files */
+#define SWEEP_FILE_BUF (1 << 20)
+
+struct filter;
+
+struct filter * filter_open(uint64_t ny, uint64_t nx);
+
+void filter_close(struct filter * flt);
+
+unsigned int do_filter(struct filter * flt, float y[], const float x[],
+					   unsigned int len);
+
+struct sweep_blk {
+	unsigned int nx;
+	unsigned int ny;
+	float * x;
+	float * y;
+};
+
+/* Bounded FIFO of blocks between two stages. A NULL block marks the
+   end of the stream, pop() returns NULL as well once it is closed, the
+   blocks left in it are dropped. */
+struct sweep_fifo {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned int head;
+	unsigned int tail;
+	bool closed;
+	struct sweep_blk * blk[SWEEP_NBLK + 1];
+};
+
+struct sweep {
+	struct sweep_fifo free; /* writer -> generator */
+	struct sweep_fifo gen; /* generator -> filter */
+	struct sweep_fifo out; /* filter -> writer */
+	struct sweep_blk blk[SWEEP_NBLK];
+	struct filter * flt;
+	float * xi; /* interleaved block of the filter stage */
+	int interleave;
+	uint64_t xsamples;
+	uint64_t nsweep;
+	float w0;
+	float w1;
+	float ampl;
+};
+
+static void fifo_init(struct sweep_fifo * q)
+{
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->cond, NULL);
+	q->head = 0;
+	q->tail = 0;
+	q->closed = false;
+}
+
+static void fifo_destroy(struct sweep_fifo * q)
+{
+	pthread_cond_destroy(&q->cond);
+	pthread_mutex_destroy(&q->mutex);
+}
+
+/* There are never more than SWEEP_NBLK blocks and the end marker in
+   a FIFO, push() does not wait */
+static void fifo_push(struct sweep_fifo * q, struct sweep_blk * b)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->blk[q->head++ % (SWEEP_NBLK + 1)] = b;
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+static struct sweep_blk * fifo_pop(struct sweep_fifo * q)
+{
+	struct sweep_blk * b = NULL;
+
+	pthread_mutex_lock(&q->mutex);
+	while ((q->head == q->tail) && !q->closed)
+		pthread_cond_wait(&q->cond, &q->mutex);
+	if (!q->closed)
+		b = q->blk[q->tail++ % (SWEEP_NBLK + 1)];
+	pthread_mutex_unlock(&q->mutex);
+
+	return b;
+}
+
+static void fifo_close(struct sweep_fifo * q)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->closed = true;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/* Sweep over the first nsweep samples, silence after */
+static void * sweep_gen_task(void * arg)
+{
+	struct sweep * sw = arg;
+	struct sweep_blk * b;
+	uint64_t n0;
+
+	for (n0 = 0; n0 < sw->xsamples; n0 += SWEEP_BLK) {
+		unsigned int n = 0;
+		unsigned int i;
+
+		if ((b = fifo_pop(&sw->free)) == NULL)
+			break;
+
+		b->nx = (sw->xsamples - n0 < SWEEP_BLK) ?
+			sw->xsamples - n0 : SWEEP_BLK;
+
+		if (n0 < sw->nsweep) {
+			n = (sw->nsweep - n0 < b->nx) ? sw->nsweep - n0 : b->nx;
+			vec_fp32_chirp(b->x, n, sw->w0, sw->w1, sw->nsweep, n0);
+			for (i = 0; i < n; ++i)
+				b->x[i] *= sw->ampl;
+		}
+		for (i = n; i < b->nx; ++i)
+			b->x[i] = 0;
+
+		fifo_push(&sw->gen, b);
+	}
+	fifo_push(&sw->gen, NULL);
+
+	return NULL;
+}
+
+static void * sweep_filter_task(void * arg)
+{
+	struct sweep * sw = arg;
+	struct sweep_blk * b;
+
+	while ((b = fifo_pop(&sw->gen)) != NULL) {
+		unsigned int n = b->nx * sw->interleave;
+		unsigned int i;
+
+		/* Interleave */
+		for (i = 0; i < n; ++i)
+			sw->xi[i] = b->x[i / sw->interleave];
+
+		b->ny = do_filter(sw->flt, b->y, sw->xi, n);
+		fifo_push(&sw->out, b);
+	}
+	fifo_push(&sw->out, NULL);
 
+	return NULL;
+}
 
-int do_pcmfloat_sweep(const char *prefix, float samplerate,
-		      int oversample, int decimation, int interleave,
-		      float f0, float f1,
-		      float ampl, float duration, float silence)
+/*
+ * The sweep is generated, filtered and written in blocks of SWEEP_BLK
+ * input samples by three stages: a generator and a filter thread, the
+ * writer runs in the caller. The blocks go around through the FIFOs,
+ * the memory does not depend on the duration of the sweep.
+ */
+int do_sweep(const char *prefix, float samplerate,
+	     int oversample, int decimation, int interleave,
+	     float f0, float f1,
+	     float ampl, float duration, float silence)
 {
 	bool enable_png = true;
 	char name[128];
-	struct pcmfloat *x;
-	struct pcmfloat *y;
-	struct pcmfloat *xi;
-	uint32_t nsamples;
-	uint32_t xsamples;
-	uint32_t ysamples;
-	unsigned int j;
+	char xpath[PATH_MAX];
+	char ypath[PATH_MAX];
+	struct sweep sw;
+	struct sweep_blk * b;
+	pthread_t gen_thread;
+	pthread_t flt_thread;
+	struct pcm_plot_env xenv;
+	struct pcm_plot_env yenv;
+	FILE * fx = NULL;
+	FILE * fy = NULL;
+	uint64_t nsamples;
+	uint64_t ysamples;
+	double yrate;
+	unsigned int ylen;
 	unsigned int i;
-	int ret = 0;
+	int ret = -1;
 
 	if (oversample <= 1)
 		oversample = 1;
@@ -81,22 +244,28 @@ int do_pcmfloat_sweep(const char *prefix, float samplerate,
 
 	/* number of samples in a sweep period */
 	nsamples = samplerate * (duration + silence);
-	xsamples = nsamples * decimation;
-	ysamples = nsamples * oversample;
 
-	/* create PCM buffers */
+	memset(&sw, 0, sizeof(sw));
+	sw.interleave = interleave;
+	sw.xsamples = nsamples * decimation;
+	sw.nsweep = sw.xsamples * duration / (duration + silence);
+	sw.w0 = f0 / samplerate;
+	sw.w1 = f1 / samplerate;
+	sw.ampl = ampl;
+	ysamples = nsamples * oversample;
+	yrate = (double)samplerate * oversample / decimation;
 
-	/* input */
-	x = pcmfloat_create(xsamples, samplerate);
-	/* interleaved input */
-	xi = pcmfloat_create(xsamples * interleave, samplerate);
-	/* output */
-	y = pcmfloat_create(ysamples, samplerate * oversample / decimation);
+	if (sw.xsamples == 0) {
+		fprintf(stderr, "%s: empty sweep.\n", __func__);
+		return -1;
+	}
 
 	printf("\n");
 	printf("Sweep: %.1f .. %.1f Hz in %.2f sec.\n", f0, f1, duration);
-	printf("Input: %d samples at %.1f SPS.\n", x->len, x->samplerate);
-	printf("Output: %d samples at %.1f SPS.\n", y->len, y->samplerate);
+	printf("Input: %llu samples at %.1f SPS.\n",
+		   (unsigned long long)sw.xsamples, samplerate);
+	printf("Output: %llu samples at %.1f SPS.\n",
+		   (unsigned long long)ysamples, yrate);
 	fflush(stdout);
 
 	if (duration > 120) {
@@ -125,40 +294,100 @@ int do_pcmfloat_sweep(const char *prefix, float samplerate,
 	       samplerate, ampl, oversample, decimation, interleave);
 	fflush(stdout);
 
-	printf("Creating a sweep waveform...\n");
-	fflush(stdout);
-	pcmfloat_sweep(x, f0, f1, ampl);
+	if ((sw.flt = filter_open(ysamples, sw.xsamples * interleave)) == NULL)
+		return -1;
 
-	sprintf(name, "%sx", prefix);
-	printf("Writing %s files...\n", name);
-	fflush(stdout);
-	pcmfloat_plot(name, x, "lc rgb '#108010' pt 0 lt 1 lw 1", enable_png);
+	/* output samples of a block, see do_filter() */
+	ylen = ((uint64_t)SWEEP_BLK * interleave * ysamples +
+			sw.xsamples * interleave - 1) / (sw.xsamples * interleave) + 1;
 
-	/* Interleave */
-	for (i = 0; i < x->len; ++i) {
-		for (j = 0; j < interleave; ++j) {
-			xi->sample[(i * interleave) + j] = x->sample[i];
-		}
-/*		xi->sample[(i * interleave)] = x->sample[i];
-		for (j = 1; j < interleave; ++j) {
-			xi->sample[(i * interleave) + j] = 0;
-		} */
-	}
-
-	printf("Applying filter ...\n");
-	fflush(stdout);
+	fifo_init(&sw.free);
+	fifo_init(&sw.gen);
+	fifo_init(&sw.out);
 
-	do_filter(y->sample, y->len, xi->sample, xi->len);
+	sw.xi = calloc((size_t)SWEEP_BLK * interleave, sizeof(float));
+	for (i = 0; i < SWEEP_NBLK; ++i) {
+		sw.blk[i].x = calloc(SWEEP_BLK, sizeof(float));
+		sw.blk[i].y = calloc(ylen, sizeof(float));
+		if ((sw.blk[i].x == NULL) || (sw.blk[i].y == NULL))
+			goto error;
+		fifo_push(&sw.free, &sw.blk[i]);
+	}
+	if (sw.xi == NULL)
+		goto error;
 
+	sprintf(name, "%sx", prefix);
+	pcm_plot_script(name, samplerate, sw.xsamples,
+					"lc rgb '#108010' pt 0 lt 1 lw 1", enable_png);
+	sprintf(xpath, "%s.dat", name);
 	sprintf(name, "%sy", prefix);
-	printf("Writing %s files...\n", name);
+	pcm_plot_script(name, yrate, ysamples,
+					"lc rgb '#c01010' pt 0 lt 1 lw 1", enable_png);
+	sprintf(ypath, "%s.dat", name);
+
+	/* plot data, written through large buffers */
+	if ((fx = fopen(xpath, "wb")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!\n",
+			xpath, strerror(errno));
+		goto error;
+	}
+	if ((fy = fopen(ypath, "wb")) == NULL) {
+		fprintf(stderr, "fopen(\"%s\") failed: %s!\n",
+			ypath, strerror(errno));
+		goto error;
+	}
+	setvbuf(fx, NULL, _IOFBF, SWEEP_FILE_BUF);
+	setvbuf(fy, NULL, _IOFBF, SWEEP_FILE_BUF);
+	pcm_plot_env_init(&xenv, fx, sw.xsamples);
+	pcm_plot_env_init(&yenv, fy, ysamples);
+
+	printf("Filtering the sweep into %s and %s...\n", xpath, ypath);
 	fflush(stdout);
 
-	pcmfloat_plot(name, y, "lc rgb '#c01010' pt 0 lt 1 lw 1", enable_png);
+	if (pthread_create(&gen_thread, NULL, sweep_gen_task, &sw) != 0) {
+		fprintf(stderr, "%s: pthread_create() failed.\n", __func__);
+		goto error;
+	}
+	if (pthread_create(&flt_thread, NULL, sweep_filter_task, &sw) != 0) {
+		fprintf(stderr, "%s: pthread_create() failed.\n", __func__);
+		/* stop the generator */
+		fifo_close(&sw.free);
+		pthread_join(gen_thread, NULL);
+		goto error;
+	}
 
-	pcmfloat_destroy(xi);
-	pcmfloat_destroy(x);
-	pcmfloat_destroy(y);
+	ret = 0;
+	while ((b = fifo_pop(&sw.out)) != NULL) {
+		if ((ret == 0) &&
+			((pcm_plot_env_write(&xenv, b->x, b->nx) < 0) ||
+			 (pcm_plot_env_write(&yenv, b->y, b->ny) < 0))) {
+			fprintf(stderr, "%s: write failed.\n", __func__);
+			/* stop the generator, drain the pipeline */
+			fifo_close(&sw.free);
+			ret = -1;
+		}
+		/* no more blocks to the generator after a failure */
+		if (ret == 0)
+			fifo_push(&sw.free, b);
+	}
+
+	pthread_join(flt_thread, NULL);
+	pthread_join(gen_thread, NULL);
+
+error:
+	if (fy != NULL)
+		fclose(fy);
+	if (fx != NULL)
+		fclose(fx);
+	for (i = 0; i < SWEEP_NBLK; ++i) {
+		free(sw.blk[i].y);
+		free(sw.blk[i].x);
+	}
+	free(sw.xi);
+	fifo_destroy(&sw.out);
+	fifo_destroy(&sw.gen);
+	fifo_destroy(&sw.free);
+	filter_close(sw.flt);
 
 	return ret;
 }
@@ -215,6 +444,7 @@ int main(int argc, char *argv[])
 	int decimate = 1;
 	int oversample = 1;
 	int interleave = 1;
+	int ret;
 	int c;
 
 	/* the program name start just after the last slash */
@@ -287,11 +517,11 @@ int main(int argc, char *argv[])
 	printf("TDM Sweep Generator. %d.%d\n", VERSION_MAJOR, VERSION_MINOR);
 	printf("(C) Copyright 2018, Bob Mittmann.\n");
 
-	do_pcmfloat_sweep(prefix, samplerate, oversample, decimate,
-			  interleave, f0, f1, ampl, duration, silence);
+	ret = do_sweep(prefix, samplerate, oversample, decimate,
+				   interleave, f0, f1, ampl, duration, silence);
 
 	system_cleanup();
 
-	return 0;
+	return (ret < 0) ? 1 : 0;
 }
 
@@ -0,0 +1,510 @@
+/*
+ * vec-test(1)  Lattice Wave Digital Filters Wizard
+ *
+ * This file is part of LWDFWiz.
+ *
+ * File:	vec-test.c
+ * Module:
+ * Project:	lwdfwiz
+ * Author:	Robinson Mittmann (bobmittmann@gmail.com)
+ * Target:
+ * Comment: vector kernels self check
+ * Copyright(C) 2021 Robinson Mittmann. All Rights Reserved.
+ *
+ * LWDFWiz is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include "../include/pcm.h"
+#include "vector.h"
+
+static int fail;
+
+/* Goertzel bank against the single term DFT, m frequencies */
+static void test_goertzel_fp64(size_t m, size_t len)
+{
+	complex double * z = calloc(m, sizeof(complex double));
+	double * w = calloc(m, sizeof(double));
+	double * x = calloc(len, sizeof(double));
+	double err = 0;
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		x[i] = sin(0.1 * i) + 0.5 * cos(0.37 * i) + (double)rand() / RAND_MAX;
+	for (i = 0; i < m; ++i)
+		w[i] = 0.5 * (i + 0.5) / m;
+
+	vec_fp64_goertzel_bank(z, w, m, x, len);
+
+	for (i = 0; i < m; ++i) {
+		complex double ref = vec_fp64_gortzel_dft(x, len, w[i]);
+		err = fmax(err, cabs(z[i] - ref) / fmax(cabs(ref), 1.0));
+	}
+
+	printf("goertzel_bank fp64 m=%-4zu len=%-6zu err=%.3g %s\n",
+		   m, len, err, (err < 1e-12) ? "ok" : "FAIL");
+	if (!(err < 1e-12))
+		fail++;
+
+	free(z);
+	free(w);
+	free(x);
+}
+
+static void test_goertzel_fp32(size_t m, size_t len)
+{
+	complex float * z = calloc(m, sizeof(complex float));
+	float * w = calloc(m, sizeof(float));
+	float * x = calloc(len, sizeof(float));
+	double err = 0;
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		x[i] = sin(0.1 * i) + 0.5 * cos(0.37 * i) + (float)rand() / RAND_MAX;
+	for (i = 0; i < m; ++i)
+		w[i] = 0.5 * (i + 0.5) / m;
+
+	vec_fp32_goertzel_bank(z, w, m, x, len);
+
+	for (i = 0; i < m; ++i) {
+		complex float ref = vec_fp32_gortzel_dft(x, len, w[i]);
+		err = fmax(err, cabsf(z[i] - ref) / fmax(cabsf(ref), 1.0));
+	}
+
+	/* both accumulate the same recursion in single precision */
+	printf("goertzel_bank fp32 m=%-4zu len=%-6zu err=%.3g %s\n",
+		   m, len, err, (err < 1e-3) ? "ok" : "FAIL");
+	if (!(err < 1e-3))
+		fail++;
+
+	free(z);
+	free(w);
+	free(x);
+}
+
+#define PI_L 3.141592653589793238462643383279502884L
+
+static void check(const char * name, double err, double tol)
+{
+	printf("%-32s err=%.3g %s\n", name, err, (err < tol) ? "ok" : "FAIL");
+	if (!(err < tol))
+		fail++;
+}
+
+/* sin(2*pi*cyc), cyc reduced in extended precision */
+static double sin_cyc(long double cyc)
+{
+	return sinl(2 * PI_L * (cyc - floorl(cyc)));
+}
+
+/* Oscillators against the exact phase. The length keeps the extended
+   precision reference well below the bounds in vec-osc.c. */
+static void test_osc(void)
+{
+	const size_t len = 200000;
+	double * y = calloc(len, sizeof(double));
+	float * y32 = calloc(len, sizeof(float));
+	double w0 = 0.001;
+	double w1 = 0.45;
+	double e = 0;
+	double e32 = 0;
+	double c2;
+	double lnq;
+	size_t n;
+
+	vec_fp64_sine(y, len, 0.1234567);
+	for (n = 0; n < len; ++n)
+		e = fmax(e, fabs(y[n] - sin_cyc((long double)0.1234567 * n)));
+	check("vec_fp64_sine", e, 5e-14);
+
+	c2 = (w1 - w0) / (2.0 * len);
+	vec_fp64_chirp(y, len, w0, w1, len, 0);
+	e = 0;
+	for (n = 0; n < len; ++n) {
+		long double cyc = (long double)w0 * n + (long double)c2 * n * n;
+		e = fmax(e, fabs(y[n] - sin_cyc(cyc)));
+	}
+	check("vec_fp64_chirp", e, 1e-13);
+
+	c2 = ((double)(float)w1 - (float)w0) / (2.0 * len);
+	vec_fp32_chirp(y32, len, w0, w1, len, 0);
+	for (n = 0; n < len; ++n) {
+		long double cyc = (long double)(float)w0 * n + (long double)c2 * n * n;
+		e32 = fmax(e32, fabs(y32[n] - sin_cyc(cyc)));
+	}
+	check("vec_fp32_chirp", e32, 1e-5);
+
+	/* error relative to 1e-15 + 2e-14 * cyc(n) */
+	lnq = log(w1 / w0) / len;
+	vec_fp64_logchirp(y, len, w0, w1, len, 0);
+	e = 0;
+	for (n = 0; n < len; ++n) {
+		long double cyc = w0 * expm1l((long double)lnq * n) / lnq;
+		e = fmax(e, fabs(y[n] - sin_cyc(cyc)) / (1e-15 + 2e-14 * cyc));
+	}
+	check("vec_fp64_logchirp (rel. bound)", e, 1.0);
+
+	/* negative frequencies, the time reversed phase */
+	vec_fp64_logchirp(y, len, -w0, -w1, len, 0);
+	e = 0;
+	for (n = 0; n < len; ++n) {
+		long double cyc = w0 * expm1l((long double)lnq * n) / lnq;
+		e = fmax(e, fabs(y[n] + sin_cyc(cyc)) / (1e-15 + 2e-14 * cyc));
+	}
+	check("vec_fp64_logchirp w < 0 (rel. bound)", e, 1.0);
+
+	/* an empty sweep is a tone at w0 */
+	vec_fp64_chirp(y, len, w0, w1, 0, 0);
+	vec_fp64_logchirp(y + len / 2, len / 2, w0, w1, 0, 0);
+	e = 0;
+	for (n = 0; n < len / 2; ++n) {
+		e = fmax(e, fabs(y[n] - sin_cyc((long double)w0 * n)));
+		e = fmax(e, fabs(y[len / 2 + n] - sin_cyc((long double)w0 * n)));
+	}
+	check("vec_fp64_chirp cnt=0", e, 5e-14);
+
+	free(y);
+	free(y32);
+}
+
+/* The sweep is generated in blocks, it must match a single chirp */
+static void test_pcm_sweep(void)
+{
+	const size_t len = 100003;
+	struct pcm_fp64 * pcm;
+	double * y = calloc(len, sizeof(double));
+	double e = 0;
+	size_t n;
+
+	pcm = pcm_fp64_create(len, 48000);
+
+	pcm_fp64_sweep(pcm, 20, 20000, 0.5);
+	vec_fp64_chirp(y, len, 20.0 / 48000, 20000.0 / 48000, len, 0);
+	for (n = 0; n < len; ++n)
+		e = fmax(e, fabs(pcm->sample[n] - 0.5 * y[n]));
+	check("pcm_fp64_sweep", e, 1e-13);
+
+	memset(pcm->sample, 0, len * sizeof(double));
+	pcm_fp64_logsweep(pcm, 20, 20000, 0.5);
+	vec_fp64_logchirp(y, len, 20.0 / 48000, 20000.0 / 48000, len, 0);
+	e = 0;
+	for (n = 0; n < len; ++n)
+		e = fmax(e, fabs(pcm->sample[n] - 0.5 * y[n]));
+	check("pcm_fp64_logsweep", e, 1e-13);
+
+	memset(pcm->sample, 0, len * sizeof(double));
+	pcm_fp64_sin(pcm, 1000, 0.5);
+	e = 0;
+	for (n = 0; n < len; ++n)
+		e = fmax(e, fabs(pcm->sample[n] -
+						 0.5 * sin_cyc((long double)n * 1000 / 48000)));
+	check("pcm_fp64_sin", e, 1e-12);
+
+	pcm_fp64_destroy(pcm);
+	free(y);
+}
+
+/* Noise: blocks against a single call, range and moments of the
+   uniform distribution */
+static void test_noise(void)
+{
+	const size_t len = 1000003;
+	double * y = calloc(len, sizeof(double));
+	double * b = calloc(len, sizeof(double));
+	float * y32 = calloc(len, sizeof(float));
+	double mean = 0;
+	double var = 0;
+	double e = 0;
+	double e32 = 0;
+	size_t i;
+	size_t n;
+
+	vec_fp64_noise(y, len, 12345, 0);
+	vec_fp32_noise(y32, len, 12345, 0);
+	for (i = 0; i < len; i += n) {
+		n = (7 * i + 1 < len - i) ? 7 * i + 1 : len - i;
+		vec_fp64_noise(b + i, n, 12345, i);
+	}
+
+	for (i = 0; i < len; ++i) {
+		e = fmax(e, fabs(b[i] - y[i]));
+		e32 = fmax(e32, fabs(y32[i] - y[i]));
+		if ((y[i] < -1) || (y[i] >= 1))
+			e = 1;
+		mean += y[i];
+		var += y[i] * y[i];
+	}
+	mean /= len;
+	var = var / len - mean * mean;
+
+	check("vec_fp64_noise (blocks)", e, 1e-300);
+	check("vec_fp32_noise", e32, 1e-7);
+	check("vec_fp64_noise mean", fabs(mean), 3e-3);
+	check("vec_fp64_noise variance", fabs(var - 1.0 / 3), 3e-3);
+
+	free(y);
+	free(b);
+	free(y32);
+}
+
+/* Every 16 bits value through the floats and back, the saturation */
+static void test_conv(void)
+{
+	const size_t len = 65536 + 4;
+	int16_t * x = calloc(len, sizeof(int16_t));
+	int16_t * z = calloc(len, sizeof(int16_t));
+	double * y = calloc(len, sizeof(double));
+	float * y32 = calloc(len, sizeof(float));
+	double e = 0;
+	double e32 = 0;
+	size_t i;
+
+	for (i = 0; i < 65536; ++i)
+		x[i] = (int16_t)(i - 32768);
+
+	vec_fp64_from_i16(y, x, 65536);
+	vec_fp64_to_i16(z, y, 65536);
+	e = memcmp(x, z, 65536 * sizeof(int16_t)) ? 1 : 0;
+	vec_fp32_from_i16(y32, x, 65536);
+	vec_fp32_to_i16(z, y32, 65536);
+	e32 = memcmp(x, z, 65536 * sizeof(int16_t)) ? 1 : 0;
+
+	y[65536] = 2.0;
+	y[65537] = -2.0;
+	y[65538] = 0.49 / 32768;
+	y[65539] = -0.51 / 32768;
+	vec_fp64_to_i16(z + 65536, y + 65536, 4);
+	vec_fp64_to_fp32(y32 + 65536, y + 65536, 4);
+	if ((z[65536] != 32767) || (z[65537] != -32768) ||
+		(z[65538] != 0) || (z[65539] != -1))
+		e = 1;
+	vec_fp32_to_i16(z + 65536, y32 + 65536, 4);
+	if ((z[65536] != 32767) || (z[65537] != -32768) ||
+		(z[65538] != 0) || (z[65539] != -1))
+		e32 = 1;
+
+	check("vec_fp64_to/from_i16", e, 1e-300);
+	check("vec_fp32_to/from_i16", e32, 1e-300);
+
+	free(x);
+	free(z);
+	free(y);
+	free(y32);
+}
+
+/* Aligned signals, the 16 bits generators against the single precision
+   ones, added to the existing samples */
+static void test_pcm_signals(void)
+{
+	const size_t len = 10007;
+	struct pcm_fp64 * p64 = pcm_fp64_create(len, 8000);
+	struct pcm_fp32 * p32 = pcm_fp32_create(len, 8000);
+	struct pcm_i16 * p16 = pcm_i16_create(len, 8000);
+	double e = 0;
+	size_t i;
+
+	if (((uintptr_t)p64->sample % PCM_ALIGN) ||
+		((uintptr_t)p32->sample % PCM_ALIGN) ||
+		((uintptr_t)p16->sample % PCM_ALIGN))
+		e = 1;
+	check("pcm_*_create aligned", e, 1e-300);
+
+	pcm_fp32_sin(p32, 440, 0.25);
+	pcm_fp32_sweep(p32, 100, 3000, 0.25);
+	pcm_fp32_white_noise(p32, 0.1, 7);
+	pcm_i16_sin(p16, 440, 0.25);
+	pcm_i16_sweep(p16, 100, 3000, 0.25);
+	pcm_i16_white_noise(p16, 0.1, 7);
+	for (i = 0; i < len; ++i)
+		e = fmax(e, fabs(p16->sample[i] - 32768.0 * p32->sample[i]));
+	check("pcm_i16 generators (LSB)", e, 1.5);
+
+	pcm_fp64_white_noise(p64, 0.1, 7);
+	e = 0;
+	for (i = 0; i < len; ++i)
+		e = fmax(e, fabs(p64->sample[i] - p32->sample[i]));
+	/* the same noise, the difference is the tones of p32 */
+	check("pcm_fp64_white_noise", fmax(e - 0.5, 0), 1e-6);
+
+	pcm_fp64_destroy(p64);
+	pcm_fp32_destroy(p32);
+	pcm_i16_destroy(p16);
+}
+
+/* Envelope against the column by column scalar reference */
+static void test_envelope(size_t m, size_t len)
+{
+	double * x = calloc(len, sizeof(double));
+	float * x32 = calloc(len, sizeof(float));
+	double * y = calloc(3 * m, sizeof(double));
+	float * y32 = calloc(3 * m, sizeof(float));
+	char name[64];
+	double e = 0;
+	double e32 = 0;
+	size_t i;
+	size_t k;
+
+	for (i = 0; i < len; ++i) {
+		x[i] = sin(0.003 * i) + 0.1 * (double)rand() / RAND_MAX;
+		x32[i] = x[i];
+	}
+
+	vec_fp64_envelope(y, y + m, y + 2 * m, m, x, len);
+	vec_fp32_envelope(y32, y32 + m, y32 + 2 * m, m, x32, len);
+
+	for (k = 0; k < m; ++k) {
+		size_t i0 = k * len / m;
+		size_t i1 = ((k + 1) * len / m > i0) ? (k + 1) * len / m : i0 + 1;
+		double mn = x[i0];
+		double mx = x[i0];
+		double sq = 0;
+
+		for (i = i0; i < i1; ++i) {
+			mn = fmin(mn, x[i]);
+			mx = fmax(mx, x[i]);
+			sq += x[i] * x[i];
+		}
+		sq = sqrt(sq / (i1 - i0));
+		e = fmax(e, fmax(fabs(y[k] - mn), fabs(y[m + k] - mx)));
+		e = fmax(e, fabs(y[2 * m + k] - sq));
+		e32 = fmax(e32, fmax(fabs(y32[k] - mn), fabs(y32[m + k] - mx)));
+		e32 = fmax(e32, fabs(y32[2 * m + k] - sq));
+	}
+
+	sprintf(name, "vec_fp64_envelope m=%zu len=%zu", m, len);
+	check(name, e, 1e-12);
+	sprintf(name, "vec_fp32_envelope m=%zu len=%zu", m, len);
+	check(name, e32, 1e-5);
+
+	free(x);
+	free(x32);
+	free(y);
+	free(y32);
+}
+
+/* Round trip through the files of each format, written in uneven
+   pieces, read back converted and through the mapping */
+static void test_pcm_io(void)
+{
+	static const char * const fmt_name[] = {
+		"s16", "s24", "s32", "f32", "f64"
+	};
+	static const double tol[] = {
+		0.6 / 32768, 0.6 / 8388608, 1e-9, 1e-7, 1e-300
+	};
+	const size_t len = 3001;
+	const unsigned int nch = 3;
+	double * x = calloc(len * nch, sizeof(double));
+	double * y = calloc(len * nch, sizeof(double));
+	struct pcm_file_info info = { .channels = nch, .samplerate = 44100 };
+	struct pcm_file * pf;
+	struct pcm_fp32 * pcm;
+	char name[64];
+	double e;
+	size_t i;
+	int wav;
+	int fmt;
+
+	for (i = 0; i < len * nch; ++i)
+		x[i] = 0.99 * sin(0.01 * i) * cos(0.0007 * i);
+
+	for (fmt = PCM_S16; fmt <= PCM_F64; ++fmt) {
+		for (wav = 0; wav <= 1; ++wav) {
+			const char * path = wav ? "vec-test.wav" : "vec-test.raw";
+
+			info.fmt = fmt;
+			pf = pcm_file_create(path, &info, wav);
+			for (i = 0; i < len; i += 7 * i + 1)
+				pcm_file_write_fp64(pf, x + i * nch,
+									(8 * i + 1 < len) ? 7 * i + 1 : len - i);
+			pcm_file_close(pf);
+
+			memset(y, 0, len * nch * sizeof(double));
+			pf = pcm_file_open(path, wav ? NULL : &info);
+			e = (pf == NULL) ? 1 : 0;
+			if (pf != NULL) {
+				e = (pcm_file_info(pf)->frames == len) &&
+					(pcm_file_info(pf)->channels == nch) &&
+					(pcm_file_info(pf)->fmt == fmt) ? 0 : 1;
+				for (i = 0; i < len; i += 1000)
+					pcm_file_read_fp64(pf, y + i * nch, 1000);
+				for (i = 0; i < len * nch; ++i)
+					e = fmax(e, fabs(y[i] - x[i]));
+				if ((fmt == PCM_F64) &&
+					(memcmp(pcm_file_data(pf), x, len * nch * 8) != 0))
+					e = 1;
+				pcm_file_close(pf);
+			}
+			sprintf(name, "pcm_file %s %s", wav ? "wav" : "raw",
+					fmt_name[fmt]);
+			check(name, e, tol[fmt]);
+		}
+	}
+
+	/* mono signal, first channel */
+	pcm = pcm_fp32_load("vec-test.wav", NULL);
+	pcm_fp32_save("vec-test.wav", pcm, PCM_F32);
+	pcm_fp32_destroy(pcm);
+	pcm = pcm_fp32_load("vec-test.wav", NULL);
+	e = (pcm->len == len) && (pcm->samplerate == 44100) ? 0 : 1;
+	for (i = 0; i < len; ++i)
+		e = fmax(e, fabs(pcm->sample[i] - x[i * nch]));
+	check("pcm_fp32_load/save", e, 1e-7);
+	pcm_fp32_destroy(pcm);
+
+	unlink("vec-test.wav");
+	unlink("vec-test.raw");
+	free(x);
+	free(y);
+}
+
+int main(int argc, char *argv[])
+{
+	static const size_t m[] = { 1, 3, 4, 9, 64, 200 };
+	static const size_t len[] = { 1, 100, 1024, 5000 };
+	unsigned int i;
+	unsigned int j;
+
+	for (i = 0; i < sizeof(m) / sizeof(m[0]); ++i) {
+		for (j = 0; j < sizeof(len) / sizeof(len[0]); ++j) {
+			test_goertzel_fp64(m[i], len[j]);
+			test_goertzel_fp32(m[i], len[j]);
+		}
+	}
+
+	test_osc();
+	test_pcm_sweep();
+	test_noise();
+	test_conv();
+	test_pcm_signals();
+	test_envelope(1, 1);
+	test_envelope(7, 3);
+	test_envelope(2048, 100003);
+	test_envelope(100, 1000000);
+	test_pcm_io();
+
+	if (fail) {
+		printf("%d tests failed\n", fail);
+		return 1;
+	}
+
+	return 0;
+}